@@ -0,0 +1,97 @@
+using System.Net.WebSockets;
+using System.Text.Json;
+using NATS.Client.JetStream.Models;
+using NatsHttpGateway.Protos;
+using NUnit.Framework;
+
+namespace NatsHttpGateway.ComponentTests;
+
+/// <summary>
+/// Component tests for the /ws/websocketmessages endpoints.
+/// Verifies where the ephemeral consumer behind a WebSocket stream starts.
+/// </summary>
+[TestFixture]
+[Category("Component")]
+public class WebSocketEndpointComponentTests : NatsComponentTestBase
+{
+    private static readonly TimeSpan ReceiveTimeout = TimeSpan.FromSeconds(10);
+
+    [Test]
+    public async Task StreamMessages_WithStartSequence_StartsAtThatSequence()
+    {
+        // Arrange - Create stream and publish 5 messages directly to NATS
+        await JetStream.CreateStreamAsync(new StreamConfig(TestStreamName, new[] { $"{TestStreamName}.>" }));
+
+        for (int i = 1; i <= 5; i++)
+        {
+            var payload = JsonSerializer.SerializeToUtf8Bytes(new
+            {
+                message_id = $"msg-{i}",
+                timestamp = DateTime.UtcNow.ToString("o"),
+                source = "direct-nats",
+                data = new { index = i }
+            });
+            await JetStream.PublishAsync($"{TestStreamName}.events", payload);
+        }
+
+        // Act - Stream from sequence 3
+        var client = Factory.Server.CreateWebSocketClient();
+        using var webSocket = await client.ConnectAsync(
+            GetWebSocketUri($"/ws/websocketmessages/{TestStreamName}.events?startSequence=3"),
+            CancellationToken.None);
+
+        var ack = await ReceiveFrameAsync(webSocket);
+        var sequences = new List<ulong>();
+        for (int i = 0; i < 3; i++)
+        {
+            var frame = await ReceiveFrameAsync(webSocket);
+            Assert.That(frame.Type, Is.EqualTo(FrameType.Message), $"Unexpected frame: {frame}");
+            sequences.Add(frame.Message.Sequence);
+        }
+
+        // Assert - Stored messages from 3 onwards, in order, and nothing earlier
+        Assert.That(ack.Type, Is.EqualTo(FrameType.Control));
+        Assert.That(ack.Control.Type, Is.EqualTo(ControlType.SubscribeAck));
+        Assert.That(sequences, Is.EqualTo(new ulong[] { 3, 4, 5 }));
+
+        await webSocket.CloseAsync(WebSocketCloseStatus.NormalClosure, "done", CancellationToken.None);
+    }
+
+    [TestCase("0")]
+    [TestCase("-1")]
+    [TestCase("abc")]
+    public async Task StreamMessages_WithInvalidStartSequence_RejectsUpgrade(string startSequence)
+    {
+        // Arrange
+        await JetStream.CreateStreamAsync(new StreamConfig(TestStreamName, new[] { $"{TestStreamName}.>" }));
+        var client = Factory.Server.CreateWebSocketClient();
+        var uri = GetWebSocketUri($"/ws/websocketmessages/{TestStreamName}.events?startSequence={startSequence}");
+
+        // Act & Assert - The test server reports the non-101 status as a failed handshake
+        var ex = Assert.ThrowsAsync<InvalidOperationException>(
+            async () => await client.ConnectAsync(uri, CancellationToken.None));
+        Assert.That(ex!.Message, Does.Contain("400"));
+
+        // No ephemeral consumer was created for the rejected request
+        var info = await JetStream.GetStreamAsync(TestStreamName);
+        Assert.That(info.Info.State.ConsumerCount, Is.EqualTo(0));
+    }
+
+    /// <summary>
+    /// Reads one binary WebSocket message and parses it as a WebSocketFrame.
+    /// </summary>
+    private static async Task<WebSocketFrame> ReceiveFrameAsync(WebSocket webSocket)
+    {
+        using var cts = new CancellationTokenSource(ReceiveTimeout);
+        using var buffer = new MemoryStream();
+        var chunk = new byte[4096];
+        WebSocketReceiveResult result;
+        do
+        {
+            result = await webSocket.ReceiveAsync(new ArraySegment<byte>(chunk), cts.Token);
+            buffer.Write(chunk, 0, result.Count);
+        } while (!result.EndOfMessage);
+
+        return WebSocketFrame.Parser.ParseFrom(buffer.ToArray());
+    }
+}
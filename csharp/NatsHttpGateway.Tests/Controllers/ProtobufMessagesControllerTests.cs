@@ -186,6 +186,38 @@ public class ProtobufMessagesControllerTests
         Assert.That(protoResponse.Messages, Has.Count.EqualTo(2));
     }
 
+    [Test]
+    public async Task FetchProtobufMessages_IncludesLastSequence()
+    {
+        // Arrange
+        var subject = "events.test";
+        var limit = 5;
+
+        var fetchResponse = new FetchMessagesResponse
+        {
+            Subject = subject,
+            Count = 1,
+            Stream = "events",
+            LastSequence = 42,
+            Messages = new List<MessageResponse>
+            {
+                new() { Subject = subject, Sequence = 40, Data = new { msg = "test" }, SizeBytes = 50 }
+            }
+        };
+
+        _mockNatsService
+            .Setup(s => s.FetchMessagesAsync(subject, limit, It.IsAny<int>()))
+            .ReturnsAsync(fetchResponse);
+
+        // Act
+        var result = await _controller.FetchProtobufMessages(subject, limit) as FileContentResult;
+
+        // Assert
+        Assert.That(result, Is.Not.Null);
+        var protoResponse = FetchResponse.Parser.ParseFrom(result!.FileContents);
+        Assert.That(protoResponse.LastSequence, Is.EqualTo(42UL));
+    }
+
     [Test]
     public async Task FetchProtobufMessages_WithLimitBelowMinimum_ReturnsBadRequest()
     {
@@ -1,5 +1,6 @@
 using System.Net.WebSockets;
 using Microsoft.AspNetCore.Http;
+using Microsoft.AspNetCore.Http.Features;
 using Microsoft.AspNetCore.Mvc;
 using Microsoft.Extensions.Logging;
 using Moq;
@@ -59,9 +60,31 @@ public class WebSocketMessagesControllerTests
         Assert.That(method!.ReturnType, Is.EqualTo(typeof(Task)));
 
         var parameters = method.GetParameters();
-        Assert.That(parameters.Length, Is.EqualTo(1));
+        Assert.That(parameters.Length, Is.EqualTo(2));
         Assert.That(parameters[0].Name, Is.EqualTo("subjectFilter"));
         Assert.That(parameters[0].ParameterType, Is.EqualTo(typeof(string)));
+        Assert.That(parameters[1].Name, Is.EqualTo("startSequence"));
+        Assert.That(parameters[1].ParameterType, Is.EqualTo(typeof(ulong?)));
+        Assert.That(parameters[1].IsOptional, Is.True);
+    }
+
+    [Test]
+    public async Task StreamMessages_WithStartSequenceZero_Returns400WithoutAccepting()
+    {
+        // Arrange
+        var webSocketFeature = new Mock<IHttpWebSocketFeature>();
+        webSocketFeature.Setup(f => f.IsWebSocketRequest).Returns(true);
+        _httpContext.Features.Set(webSocketFeature.Object);
+
+        // Act
+        await _controller.StreamMessages("events.test", startSequence: 0);
+
+        // Assert
+        Assert.That(_httpContext.Response.StatusCode, Is.EqualTo(StatusCodes.Status400BadRequest));
+        webSocketFeature.Verify(f => f.AcceptAsync(It.IsAny<WebSocketAcceptContext>()), Times.Never);
+        _mockNatsService.Verify(
+            s => s.StreamMessagesAsync(It.IsAny<string>(), It.IsAny<ulong?>(), It.IsAny<CancellationToken>()),
+            Times.Never);
     }
 
     [Test]
@@ -69,7 +92,7 @@ public class WebSocketMessagesControllerTests
     {
         // Arrange
         _mockNatsService
-            .Setup(s => s.StreamMessagesAsync(It.IsAny<string>(), It.IsAny<CancellationToken>()))
+            .Setup(s => s.StreamMessagesAsync(It.IsAny<string>(), It.IsAny<ulong?>(), It.IsAny<CancellationToken>()))
             .Throws(new InvalidOperationException("Invalid subject filter"));
 
         // Assert
@@ -194,7 +217,7 @@ public class WebSocketMessagesControllerTests
 
         // Setup async enumerable
         _mockNatsService
-            .Setup(s => s.StreamMessagesAsync(subjectFilter, It.IsAny<CancellationToken>()))
+            .Setup(s => s.StreamMessagesAsync(subjectFilter, It.IsAny<ulong?>(), It.IsAny<CancellationToken>()))
             .Returns(ToAsyncEnumerable(messages));
 
         // Assert
@@ -298,9 +321,13 @@ public class WebSocketMessagesControllerTests
  * - Controller instantiation and dependency injection
  * - Route attributes and API structure
  * - Non-WebSocket request rejection (returns 400)
+ * - startSequence=0 rejection before the upgrade (returns 400)
  * - Service method configuration
  * - Error handling structure
  *
+ * NatsHttpGateway.ComponentTests/WebSocketEndpointComponentTests.cs connects
+ * to the endpoint against real NATS (startSequence handling).
+ *
  * For comprehensive testing, consider:
  * 1. Integration tests using Microsoft.AspNetCore.TestHost
  * 2. WebSocket client tests that actually connect to the endpoint
@@ -137,7 +137,8 @@ public class ProtobufMessagesController : ControllerBase
             {
                 Subject = response.Subject,
                 Count = response.Count,
-                Stream = response.Stream
+                Stream = response.Stream,
+                LastSequence = response.LastSequence
             };
 
             // Convert each message
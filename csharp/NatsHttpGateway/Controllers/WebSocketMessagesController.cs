@@ -24,9 +24,18 @@ public class WebSocketMessagesController : ControllerBase
     /// WebSocket endpoint for streaming messages from a subject using an ephemeral consumer
     /// </summary>
     /// <param name="subjectFilter">NATS subject filter (supports wildcards)</param>
+    /// <param name="startSequence">Optional: start at this stream sequence (1 or higher) instead of new messages only</param>
     [HttpGet("{subjectFilter}")]
-    public async Task StreamMessages(string subjectFilter)
+    public async Task StreamMessages(string subjectFilter, [FromQuery] ulong? startSequence = null)
     {
+        // Stream sequences start at 1; reject 0 before the upgrade rather than
+        // failing consumer creation after it
+        if (startSequence == 0)
+        {
+            HttpContext.Response.StatusCode = StatusCodes.Status400BadRequest;
+            return;
+        }
+
         if (!HttpContext.WebSockets.IsWebSocketRequest)
         {
             HttpContext.Response.StatusCode = StatusCodes.Status400BadRequest;
@@ -45,7 +54,7 @@ public class WebSocketMessagesController : ControllerBase
                 $"Subscribed to {subjectFilter}", cts.Token);
 
             // Stream messages from NATS
-            await foreach (var message in _natsService.StreamMessagesAsync(subjectFilter, cts.Token))
+            await foreach (var message in _natsService.StreamMessagesAsync(subjectFilter, startSequence, cts.Token))
             {
                 try
                 {
@@ -0,0 +1,391 @@
+/*
+ * bench_compare: detect performance regressions between benchmark runs
+ *
+ * Compares the --json output (bench_report.h) of a baseline and a candidate
+ * build, result by result:
+ *
+ *   metrics   one value per run (throughput). With four or more runs per
+ *             side the runs are compared with a Mann-Whitney U test (exact
+ *             for small samples without ties, normal approximation
+ *             otherwise). Fewer runs cannot reach p < 0.05 (the smallest
+ *             p is 0.33 for 2 vs 2 and 0.10 for 3 vs 3), so the change is
+ *             shown untested.
+ *   samples   per-operation values (latency). p50, p90 and p99 are
+ *             compared with a bootstrap 95% confidence interval of the
+ *             relative change, resampling runs and then samples within
+ *             them. Samples from one run are not independent (a slow
+ *             moment affects many operations), so several runs per side
+ *             give a more honest interval. A percentile needs at least 10
+ *             samples beyond it on each side to be tested.
+ *
+ * A change is a regression when it is significant (p < --alpha, or the
+ * confidence interval excludes zero) and larger than --threshold percent
+ * in the direction the report marks as worse. The process exits with 2
+ * when there is one, so it can gate a local build.
+ *
+ * Requirements:
+ *   - C++17
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 bench_compare.cpp -o bench_compare
+ *
+ * Usage:
+ *   ./bench_compare base.json new.json
+ *   ./bench_compare base1.json base2.json base3.json -- new1.json new2.json new3.json
+ *                   [--alpha 0.05] [--threshold 5] [--bootstrap 2000]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bench_report.h"
+
+struct Comparison {
+    double base = 0;        // median / percentile
+    double candidate = 0;
+    double change = 0;      // relative, candidate vs base
+    bool tested = false;
+    bool significant = false;
+    std::string evidence;   // "p=0.012 (3 vs 3)" or "[-4.1%, +0.3%]"
+};
+
+// Two-sided Mann-Whitney U test p-value for "same distribution"
+static double mann_whitney_p(const std::vector<double>& base, const std::vector<double>& candidate) {
+    size_t n1 = base.size();
+    size_t n2 = candidate.size();
+    std::vector<std::pair<double, int>> all;
+    for (double v : base) all.emplace_back(v, 0);
+    for (double v : candidate) all.emplace_back(v, 1);
+    std::sort(all.begin(), all.end());
+
+    // Average ranks over ties; tie term for the variance correction
+    double rank_sum = 0;
+    double tie_term = 0;
+    bool ties = false;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) j++;
+        double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; ++k) {
+            if (all[k].second == 0) rank_sum += rank;
+        }
+        double t = static_cast<double>(j - i);
+        tie_term += t * t * t - t;
+        ties = ties || j - i > 1;
+        i = j;
+    }
+    double u = rank_sum - n1 * (n1 + 1) / 2.0;
+
+    if (!ties && n1 + n2 <= 40) {
+        // Exact: counts[m][n][k] = arrangements with U = k, built up one
+        // observation at a time (f(m, n, k) = f(m-1, n, k-n) + f(m, n-1, k))
+        size_t max_u = n1 * n2;
+        std::vector<std::vector<std::vector<double>>> f(
+            n1 + 1, std::vector<std::vector<double>>(n2 + 1, std::vector<double>(max_u + 1, 0)));
+        for (size_t m = 0; m <= n1; ++m) {
+            for (size_t n = 0; n <= n2; ++n) {
+                if (m == 0 || n == 0) {
+                    f[m][n][0] = 1;
+                    continue;
+                }
+                for (size_t k = 0; k <= m * n; ++k) {
+                    f[m][n][k] = (k >= n ? f[m - 1][n][k - n] : 0) + f[m][n - 1][k];
+                }
+            }
+        }
+        double total = 0;
+        double below = 0;
+        double above = 0;
+        auto observed = static_cast<size_t>(std::llround(u));
+        for (size_t k = 0; k <= max_u; ++k) {
+            total += f[n1][n2][k];
+            if (k <= observed) below += f[n1][n2][k];
+            if (k >= observed) above += f[n1][n2][k];
+        }
+        return std::min(1.0, 2 * std::min(below, above) / total);
+    }
+
+    double n = static_cast<double>(n1 + n2);
+    double mean = n1 * n2 / 2.0;
+    double variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)));
+    if (variance <= 0) {
+        return 1.0;
+    }
+    double z = (std::fabs(u - mean) - 0.5) / std::sqrt(variance);
+    return std::min(1.0, std::erfc(std::max(0.0, z) / std::sqrt(2.0)));
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+// Nearest-rank percentile of a sorted sample
+static double percentile(const std::vector<double>& sorted, double q) {
+    size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+static double relative(double base, double candidate) {
+    return base != 0 ? (candidate - base) / std::fabs(base) : 0;
+}
+
+static std::string percent(double change) {
+    std::ostringstream s;
+    s << std::showpos << std::fixed << std::setprecision(1) << change * 100 << "%";
+    return s.str();
+}
+
+// Smallest two-sided p the exact test can give for n vs m runs (complete
+// separation): 2 / C(n + m, n)
+static double min_exact_p(size_t n, size_t m) {
+    double combinations = 1;
+    for (size_t i = 1; i <= n; ++i) combinations = combinations * static_cast<double>(m + i) / static_cast<double>(i);
+    return std::min(1.0, 2 / combinations);
+}
+
+static Comparison compare_metric(const std::vector<double>& base, const std::vector<double>& candidate,
+                                 double alpha) {
+    const size_t min_runs = 4;
+    Comparison c;
+    c.base = median(base);
+    c.candidate = median(candidate);
+    c.change = relative(c.base, c.candidate);
+    std::ostringstream evidence;
+    if (base.size() < min_runs || candidate.size() < min_runs || min_exact_p(base.size(), candidate.size()) >= alpha) {
+        evidence << "untested / insufficient runs";
+    } else {
+        double p = mann_whitney_p(base, candidate);
+        c.tested = true;
+        c.significant = p < alpha;
+        evidence << "p=" << std::fixed << std::setprecision(3) << p;
+    }
+    evidence << " (" << base.size() << " vs " << candidate.size() << " runs)";
+    c.evidence = evidence.str();
+    return c;
+}
+
+// Samples of one metric, one vector per run
+using Runs = std::vector<std::vector<double>>;
+
+static std::vector<double> pooled(const Runs& runs) {
+    std::vector<double> all;
+    for (const auto& run : runs) all.insert(all.end(), run.begin(), run.end());
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+// Two-level bootstrap CI of the relative change in the q-th percentile:
+// each iteration resamples whole runs, then samples within each picked run,
+// so run-to-run variation widens the interval. Percentiles with fewer than
+// 10 samples beyond them on either side are not tested.
+static Comparison compare_percentile(const Runs& base_runs, const Runs& candidate_runs, double q, int iterations,
+                                     std::mt19937_64& random) {
+    std::vector<double> base = pooled(base_runs);
+    std::vector<double> candidate = pooled(candidate_runs);
+    Comparison c;
+    c.base = percentile(base, q);
+    c.candidate = percentile(candidate, q);
+    c.change = relative(c.base, c.candidate);
+
+    size_t needed = static_cast<size_t>(std::ceil(10 / (1 - q)));
+    if (base.size() < needed || candidate.size() < needed) {
+        c.evidence = "untested (n < " + std::to_string(needed) + ")";
+        return c;
+    }
+
+    auto resample = [&](const Runs& runs, std::vector<double>& out) {
+        out.clear();
+        std::uniform_int_distribution<size_t> pick_run(0, runs.size() - 1);
+        for (size_t r = 0; r < runs.size(); ++r) {
+            const auto& run = runs[pick_run(random)];
+            std::uniform_int_distribution<size_t> pick(0, run.size() - 1);
+            for (size_t i = 0; i < run.size(); ++i) out.push_back(run[pick(random)]);
+        }
+    };
+    auto nth = [](std::vector<double>& v, double q) {
+        size_t rank = static_cast<size_t>(std::ceil(q * v.size()));
+        auto it = v.begin() + static_cast<std::ptrdiff_t>(std::min(v.size() - 1, rank == 0 ? 0 : rank - 1));
+        std::nth_element(v.begin(), it, v.end());
+        return *it;
+    };
+
+    std::vector<double> changes;
+    std::vector<double> a;
+    std::vector<double> b;
+    for (int i = 0; i < iterations; ++i) {
+        resample(base_runs, a);
+        resample(candidate_runs, b);
+        changes.push_back(relative(nth(a, q), nth(b, q)));
+    }
+    std::sort(changes.begin(), changes.end());
+    double low = changes[static_cast<size_t>(0.025 * (changes.size() - 1))];
+    double high = changes[static_cast<size_t>(0.975 * (changes.size() - 1))];
+    c.tested = true;
+    c.significant = low > 0 || high < 0;
+    c.evidence = "[" + percent(low) + ", " + percent(high) + "]";
+    return c;
+}
+
+static std::string format_value(double value) {
+    std::ostringstream s;
+    double magnitude = std::fabs(value);
+    s << std::fixed << std::setprecision(magnitude >= 1000 ? 0 : magnitude >= 10 ? 1 : 3) << value;
+    return s.str();
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> base_files;
+    std::vector<std::string> candidate_files;
+    double alpha = 0.05;
+    double threshold = 5.0;
+    int iterations = 2000;
+    bool split = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--alpha" && i + 1 < argc) {
+            alpha = std::stod(argv[++i]);
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::stod(argv[++i]);
+        } else if (arg == "--bootstrap" && i + 1 < argc) {
+            iterations = std::max(100, std::stoi(argv[++i]));
+        } else if (arg == "--") {
+            split = true;
+        } else {
+            (split ? candidate_files : base_files).push_back(arg);
+        }
+    }
+    if (!split && base_files.size() == 2) {
+        candidate_files.push_back(base_files.back());
+        base_files.pop_back();
+    }
+    if (base_files.empty() || candidate_files.empty()) {
+        std::cerr << "Usage: " << argv[0] << " base.json new.json" << std::endl
+                  << "       " << argv[0] << " base1.json [base2.json...] -- new1.json [new2.json...]"
+                  << " [--alpha 0.05] [--threshold 5] [--bootstrap 2000]" << std::endl;
+        return 1;
+    }
+
+    auto load_all = [](const std::vector<std::string>& files, std::vector<BenchRun>* runs) {
+        for (const auto& file : files) {
+            runs->emplace_back();
+            if (!BenchRun::load(file, &runs->back())) {
+                return false;
+            }
+        }
+        return true;
+    };
+    std::vector<BenchRun> base;
+    std::vector<BenchRun> candidate;
+    if (!load_all(base_files, &base) || !load_all(candidate_files, &candidate)) {
+        return 1;
+    }
+    for (const auto& run : candidate) {
+        if (run.benchmark != base.front().benchmark) {
+            std::cerr << "✗ Comparing " << base.front().benchmark << " with " << run.benchmark << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << base.front().benchmark << ": " << base.size() << " base run(s) from " << base.front().host
+              << ", " << candidate.size() << " new run(s) from " << candidate.front().host << std::endl
+              << "regression: significant at alpha " << alpha << " and worse by more than " << threshold << "%"
+              << std::endl << std::endl;
+    // Size the name columns from the rows printed below (samples get a " p99" suffix)
+    size_t result_width = 6;
+    size_t metric_width = 6;
+    for (const auto& result : base.front().results) {
+        result_width = std::max(result_width, result.name.size());
+        for (const auto& entry : result.metrics) metric_width = std::max(metric_width, entry.first.size());
+        for (const auto& entry : result.samples) metric_width = std::max(metric_width, entry.first.size() + 4);
+    }
+    result_width += 2;
+    metric_width += 2;
+
+    std::cout << std::left << std::setw(result_width) << "result" << std::setw(metric_width) << "metric" << std::right
+              << std::setw(12) << "base" << std::setw(12) << "new" << std::setw(10) << "change" << "  "
+              << std::left << std::setw(44) << "evidence" << "verdict" << std::endl;
+
+    std::mt19937_64 random(42);
+    int regressions = 0;
+    int improvements = 0;
+    auto print = [&](const std::string& result, const std::string& metric, const Comparison& c, Better better) {
+        bool worse = better == Better::Higher ? c.change < 0 : c.change > 0;
+        bool large = std::fabs(c.change) * 100 > threshold;
+        std::string verdict = "~";
+        if (!c.tested) {
+            verdict = large ? (worse ? "worse? (untested)" : "better? (untested)") : "~";
+        } else if (c.significant && large) {
+            verdict = worse ? "REGRESSION" : "improved";
+            (worse ? regressions : improvements)++;
+        } else if (c.significant) {
+            verdict = "~ (significant, under threshold)";
+        }
+        std::cout << std::left << std::setw(result_width) << result << std::setw(metric_width) << metric << std::right
+                  << std::setw(12) << format_value(c.base) << std::setw(12) << format_value(c.candidate)
+                  << std::setw(10) << percent(c.change) << "  " << std::left << std::setw(44) << c.evidence
+                  << verdict << std::endl;
+    };
+
+    for (const auto& result : base.front().results) {
+        // Metrics: one value per run
+        std::set<std::string> metric_names;
+        std::set<std::string> sample_names;
+        for (const auto& entry : result.metrics) metric_names.insert(entry.first);
+        for (const auto& entry : result.samples) sample_names.insert(entry.first);
+
+        for (const auto& name : metric_names) {
+            std::vector<double> a;
+            std::vector<double> b;
+            Better better = result.metrics.at(name).better;
+            for (const auto& run : base) {
+                const BenchResult* r = run.find(result.name);
+                if (r && r->metrics.count(name)) a.push_back(r->metrics.at(name).value);
+            }
+            for (const auto& run : candidate) {
+                const BenchResult* r = run.find(result.name);
+                if (r && r->metrics.count(name)) b.push_back(r->metrics.at(name).value);
+            }
+            if (a.empty() || b.empty()) continue;
+            print(result.name, name, compare_metric(a, b, alpha), better);
+        }
+
+        // Samples: compared by percentile, runs kept apart for the bootstrap
+        for (const auto& name : sample_names) {
+            Runs a;
+            Runs b;
+            Better better = result.samples.at(name).better;
+            auto collect = [&](const std::vector<BenchRun>& runs, Runs* out) {
+                for (const auto& run : runs) {
+                    const BenchResult* r = run.find(result.name);
+                    if (r && r->samples.count(name) && !r->samples.at(name).values.empty()) {
+                        out->push_back(r->samples.at(name).values);
+                    }
+                }
+            };
+            collect(base, &a);
+            collect(candidate, &b);
+            if (a.empty() || b.empty()) continue;
+            for (auto [label, q] : {std::pair<const char*, double>{" p50", 0.50}, {" p90", 0.90}, {" p99", 0.99}}) {
+                print(result.name, name + label, compare_percentile(a, b, q, iterations, random), better);
+            }
+        }
+    }
+
+    std::cout << std::endl;
+    if (regressions) {
+        std::cout << "✗ " << regressions << " regression(s), " << improvements << " improvement(s)" << std::endl;
+        return 2;
+    }
+    std::cout << "✓ No regressions (" << improvements << " improvement(s))" << std::endl;
+    return 0;
+}
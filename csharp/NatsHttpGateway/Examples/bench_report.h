@@ -0,0 +1,257 @@
+/*
+ * Machine-readable benchmark results
+ *
+ * Every benchmark takes --json FILE ("-" for stdout) and records what it
+ * prints in a BenchReport:
+ *
+ *   {"format": "natsgw-bench/1", "benchmark": "fetch_coalescing_bench",
+ *    "started": "2026-10-18T09:12:03.000000000Z", "host": "build-7",
+ *    "cpus": 8, "args": ["--threads", "32"],
+ *    "results": [
+ *      {"name": "coalesced",
+ *       "metrics": {"calls_per_s": {"value": 5120.4, "better": "higher"}},
+ *       "samples": {"latency_ms": {"better": "lower", "values": [7.1, ...]}}}]}
+ *
+ * A result is a row of the benchmark's table. Metrics are single values per
+ * run (throughput, totals). Samples are per-operation measurements
+ * (latencies), kept so that percentiles can be compared with confidence
+ * intervals. Samples are capped at kMaxSamples evenly spaced order
+ * statistics, which keeps the distribution's shape. "better" tells
+ * bench_compare which direction is a regression.
+ *
+ * BenchRun::load() reads the file back (bench_compare.cpp).
+ *
+ * Requirements:
+ *   - C++17 (no JSON library)
+ */
+
+#pragma once
+
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "nats_json.h"
+
+enum class Better { Higher, Lower };
+
+struct BenchMetric {
+    double value = 0;
+    Better better = Better::Higher;
+};
+
+struct BenchSamples {
+    std::vector<double> values;
+    Better better = Better::Lower;
+};
+
+struct BenchResult {
+    std::string name;
+    std::map<std::string, BenchMetric> metrics;
+    std::map<std::string, BenchSamples> samples;
+};
+
+struct BenchRun {
+    std::string benchmark;
+    std::string started;
+    std::string host;
+    std::vector<BenchResult> results;
+
+    const BenchResult* find(const std::string& name) const {
+        for (const auto& result : results) {
+            if (result.name == name) return &result;
+        }
+        return nullptr;
+    }
+
+    // False (and reported) if the file is missing or not a benchmark report
+    static bool load(const std::string& path, BenchRun* run);
+};
+
+class BenchReport {
+public:
+    static constexpr size_t kMaxSamples = 10000;
+
+private:
+    std::string benchmark_;
+    std::vector<std::string> args_;
+    std::string started_;
+    std::vector<BenchResult> results_;
+
+public:
+    // `argv[0]` names the benchmark; the remaining arguments are recorded
+    BenchReport(int argc, char* argv[]) {
+        std::string_view name = argv[0];
+        size_t slash = name.rfind('/');
+        benchmark_ = std::string(slash == std::string_view::npos ? name : name.substr(slash + 1));
+        for (int i = 1; i < argc; ++i) args_.push_back(argv[i]);
+        started_ = format_rfc3339(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    void metric(const std::string& result, const std::string& name, double value, Better better) {
+        row(result).metrics[name] = BenchMetric{value, better};
+    }
+
+    void samples(const std::string& result, const std::string& name, std::vector<double> values, Better better) {
+        std::sort(values.begin(), values.end());
+        if (values.size() > kMaxSamples) {
+            std::vector<double> kept(kMaxSamples);
+            for (size_t i = 0; i < kMaxSamples; ++i) {
+                kept[i] = values[i * (values.size() - 1) / (kMaxSamples - 1)];
+            }
+            values.swap(kept);
+        }
+        row(result).samples[name] = BenchSamples{std::move(values), better};
+    }
+
+    std::string json() const {
+        std::string out = "{\"format\": \"natsgw-bench/1\", \"benchmark\": ";
+        append_json_string(out, benchmark_);
+        out += ", \"started\": ";
+        append_json_string(out, started_);
+        char host[256] = {};
+        gethostname(host, sizeof(host) - 1);
+        out += ", \"host\": ";
+        append_json_string(out, host);
+        out += ", \"cpus\": " + std::to_string(std::thread::hardware_concurrency()) + ", \"args\": [";
+        for (size_t i = 0; i < args_.size(); ++i) {
+            if (i) out += ", ";
+            append_json_string(out, args_[i]);
+        }
+        out += "],\n \"results\": [";
+        for (size_t r = 0; r < results_.size(); ++r) {
+            const BenchResult& result = results_[r];
+            out += r ? ",\n  {\"name\": " : "\n  {\"name\": ";
+            append_json_string(out, result.name);
+            out += ", \"metrics\": {";
+            bool first = true;
+            for (const auto& entry : result.metrics) {
+                out += first ? "" : ", ";
+                first = false;
+                append_json_string(out, entry.first);
+                out += ": {\"value\": " + number(entry.second.value) + ", \"better\": " +
+                       better_name(entry.second.better) + "}";
+            }
+            out += "}, \"samples\": {";
+            first = true;
+            for (const auto& entry : result.samples) {
+                out += first ? "" : ", ";
+                first = false;
+                append_json_string(out, entry.first);
+                out += ": {\"better\": " + better_name(entry.second.better) + ", \"values\": [";
+                for (size_t i = 0; i < entry.second.values.size(); ++i) {
+                    if (i) out += ",";
+                    out += number(entry.second.values[i]);
+                }
+                out += "]}";
+            }
+            out += "}}";
+        }
+        out += "]}\n";
+        return out;
+    }
+
+    // Writes to `path`, or stdout for "-"; an empty path writes nothing
+    bool write(const std::string& path) const {
+        if (path.empty()) {
+            return true;
+        }
+        if (path == "-") {
+            std::cout << json() << std::flush;
+            return true;
+        }
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << json();
+        if (!file.flush()) {
+            std::cerr << "✗ Cannot write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    BenchResult& row(const std::string& name) {
+        for (auto& result : results_) {
+            if (result.name == name) return result;
+        }
+        results_.push_back(BenchResult{name, {}, {}});
+        return results_.back();
+    }
+
+    static std::string better_name(Better better) {
+        return better == Better::Higher ? "\"higher\"" : "\"lower\"";
+    }
+
+    static std::string number(double value) {
+        if (!std::isfinite(value)) return "null";
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+};
+
+inline bool BenchRun::load(const std::string& path, BenchRun* run) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "✗ Cannot read " << path << std::endl;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+
+    nats_json::Value root;
+    const nats_json::Value* format = nullptr;
+    const nats_json::Value* results = nullptr;
+    if (!nats_json::Parser(text.str()).parse(&root) || !(format = root.get("format")) ||
+        format->text != "natsgw-bench/1" || !(results = root.get("results"))) {
+        std::cerr << "✗ " << path << " is not a benchmark report (natsgw-bench/1)" << std::endl;
+        return false;
+    }
+
+    auto text_of = [](const nats_json::Value* v) { return v ? v->text : std::string(); };
+    auto better_of = [](const nats_json::Value& v, Better fallback) {
+        const nats_json::Value* b = v.get("better");
+        return !b ? fallback : b->text == "lower" ? Better::Lower : Better::Higher;
+    };
+    run->benchmark = text_of(root.get("benchmark"));
+    run->started = text_of(root.get("started"));
+    run->host = text_of(root.get("host"));
+    run->results.clear();
+    for (const auto& item : results->items) {
+        BenchResult result;
+        result.name = text_of(item.get("name"));
+        if (const auto* metrics = item.get("metrics")) {
+            for (const auto& field : metrics->fields) {
+                const nats_json::Value* value = field.second.get("value");
+                if (value && value->type == nats_json::Value::Number) {
+                    result.metrics[field.first] = BenchMetric{value->number, better_of(field.second, Better::Higher)};
+                }
+            }
+        }
+        if (const auto* samples = item.get("samples")) {
+            for (const auto& field : samples->fields) {
+                BenchSamples s;
+                s.better = better_of(field.second, Better::Lower);
+                if (const auto* values = field.second.get("values")) {
+                    for (const auto& v : values->items) {
+                        if (v.type == nats_json::Value::Number) s.values.push_back(v.number);
+                    }
+                }
+                result.samples[field.first] = std::move(s);
+            }
+        }
+        run->results.push_back(std::move(result));
+    }
+    return true;
+}
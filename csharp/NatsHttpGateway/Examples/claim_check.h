@@ -0,0 +1,470 @@
+/*
+ * Claim-check publishing for oversized payloads
+ *
+ * Large payloads (reports, exports) cost gateway bandwidth and JetStream
+ * storage for data consumers usually read once. ClaimCheckPublisher stores
+ * any payload of at least `threshold` bytes in a BlobStore and publishes
+ * only a reference in its place:
+ *
+ *   data      claimcheck:sha256:<64 hex digits>:<size>
+ *   metadata  claim-check = sha256:<hex>, claim-check-size = <size>
+ *
+ * ClaimCheckResolver turns references back into payloads on the consumer
+ * side. wrap() does it transparently for a message handler. resolve() hands
+ * out the stored blob itself, memory-mapped, without a copy. Messages from
+ * the gateway carry the JSON envelope the gateway stores, so the resolver
+ * unwraps it first; data that is not an envelope is reported as a failure
+ * rather than passed on as if it were the payload. A resolver for messages
+ * received directly from NATS (gateway = false) takes data as the payload.
+ * The gateway drops PublishMessage.metadata, so only the reference in
+ * `data` is used.
+ *
+ * Blobs are content-addressed by SHA-256, so republishing the same payload
+ * stores it once. The resolver checks the hash before delivery, which
+ * catches a truncated or modified blob.
+ *
+ * LocalBlobStore keeps blobs in a directory (<dir>/<2 hex>/<62 hex>),
+ * written to a temporary file and renamed into place. Publishers and
+ * consumers must share the directory (same host or a shared mount). Other
+ * stores (object storage, a blob service) implement BlobStore.
+ *
+ * Requirements:
+ *   - POSIX (mmap)
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "message.pb.h"
+#include "message_transport.h"
+#include "nats_json.h"
+
+// SHA-256 (FIPS 180-4); enough for content addressing, not constant-time
+class Sha256 {
+private:
+    uint32_t state_[8];
+    uint8_t block_[64];
+    size_t block_size_ = 0;
+    uint64_t length_ = 0;
+
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress(const uint8_t* p) {
+        static const uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(p[4 * i]) << 24) | (uint32_t(p[4 * i + 1]) << 16) | (uint32_t(p[4 * i + 2]) << 8) |
+                   uint32_t(p[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+        state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+    }
+
+public:
+    Sha256() {
+        static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        std::memcpy(state_, initial, sizeof(state_));
+    }
+
+    void update(std::string_view data) {
+        const auto* p = reinterpret_cast<const uint8_t*>(data.data());
+        size_t n = data.size();
+        length_ += n;
+        if (block_size_ > 0) {
+            size_t take = std::min(n, 64 - block_size_);
+            std::memcpy(block_ + block_size_, p, take);
+            block_size_ += take;
+            p += take;
+            n -= take;
+            if (block_size_ < 64) return;
+            compress(block_);
+            block_size_ = 0;
+        }
+        for (; n >= 64; p += 64, n -= 64) compress(p);
+        std::memcpy(block_, p, n);
+        block_size_ = n;
+    }
+
+    // Lowercase hex digest; the object is spent afterwards
+    std::string hex() {
+        uint64_t bits = length_ * 8;
+        uint8_t pad = 0x80;
+        update(std::string_view(reinterpret_cast<const char*>(&pad), 1));
+        pad = 0;
+        while (block_size_ != 56) update(std::string_view(reinterpret_cast<const char*>(&pad), 1));
+        uint8_t tail[8];
+        for (int i = 0; i < 8; ++i) tail[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+        update(std::string_view(reinterpret_cast<const char*>(tail), 8));
+
+        static const char digits[] = "0123456789abcdef";
+        std::string out;
+        for (uint32_t word : state_) {
+            for (int shift = 28; shift >= 0; shift -= 4) out.push_back(digits[(word >> shift) & 15]);
+        }
+        return out;
+    }
+
+    static std::string hex(std::string_view data) {
+        Sha256 hash;
+        hash.update(data);
+        return hash.hex();
+    }
+};
+
+// Stored payload bytes, valid as long as the Blob is alive
+class Blob {
+public:
+    virtual ~Blob() = default;
+    virtual std::string_view bytes() const = 0;
+};
+
+class BlobStore {
+public:
+    virtual ~BlobStore() = default;
+
+    // Store `bytes` under its SHA-256 (hex). Storing an existing digest is
+    // a no-op.
+    virtual bool put(const std::string& digest, std::string_view bytes) = 0;
+
+    // nullptr when the digest is unknown or unreadable (reported)
+    virtual std::shared_ptr<const Blob> get(const std::string& digest) = 0;
+};
+
+class LocalBlobStore : public BlobStore {
+private:
+    std::string dir_;
+
+    class MappedBlob : public Blob {
+    private:
+        void* address_;
+        size_t size_;
+
+    public:
+        MappedBlob(void* address, size_t size) : address_(address), size_(size) {}
+        ~MappedBlob() override {
+            if (size_ > 0) munmap(address_, size_);
+        }
+        std::string_view bytes() const override {
+            return std::string_view(static_cast<const char*>(address_), size_);
+        }
+    };
+
+    static bool valid_digest(const std::string& digest) {
+        if (digest.size() != 64) return false;
+        for (char c : digest) {
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+        }
+        return true;
+    }
+
+    std::string path(const std::string& digest) const {
+        return dir_ + "/" + digest.substr(0, 2) + "/" + digest.substr(2);
+    }
+
+public:
+    explicit LocalBlobStore(const std::string& dir) : dir_(dir) {
+        if (mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("Cannot create blob directory " + dir_ + ": " + std::strerror(errno));
+        }
+    }
+
+    const std::string& directory() const { return dir_; }
+
+    bool put(const std::string& digest, std::string_view bytes) override {
+        if (!valid_digest(digest)) {
+            std::cerr << "✗ Invalid blob digest: " << digest << std::endl;
+            return false;
+        }
+        std::string target = path(digest);
+        struct stat existing;
+        if (stat(target.c_str(), &existing) == 0 && static_cast<size_t>(existing.st_size) == bytes.size()) {
+            return true;
+        }
+
+        std::string shard = dir_ + "/" + digest.substr(0, 2);
+        if (mkdir(shard.c_str(), 0755) != 0 && errno != EEXIST) {
+            std::cerr << "✗ Cannot create " << shard << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        // Write beside the target and rename, so readers never see a
+        // partial blob and concurrent writers of one digest don't collide
+        std::string temp = target + ".tmp" + std::to_string(std::random_device()());
+        int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+            std::cerr << "✗ Cannot write " << temp << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        const char* p = bytes.data();
+        size_t left = bytes.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        bool ok = left == 0 && ::close(fd) == 0;
+        if (left != 0) ::close(fd);
+        if (!ok || std::rename(temp.c_str(), target.c_str()) != 0) {
+            std::cerr << "✗ Failed to store blob " << digest << ": " << std::strerror(errno) << std::endl;
+            std::remove(temp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<const Blob> get(const std::string& digest) override {
+        if (!valid_digest(digest)) {
+            std::cerr << "✗ Invalid blob digest: " << digest << std::endl;
+            return nullptr;
+        }
+        std::string source = path(digest);
+        int fd = ::open(source.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "✗ Blob " << digest << " not found in " << dir_ << std::endl;
+            return nullptr;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            std::cerr << "✗ Cannot stat " << source << std::endl;
+            return nullptr;
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        void* address = nullptr;
+        if (size > 0) {
+            address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                ::close(fd);
+                std::cerr << "✗ Cannot map " << source << ": " << std::strerror(errno) << std::endl;
+                return nullptr;
+            }
+            // Resolvers read the whole blob front to back
+            madvise(address, size, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        return std::make_shared<MappedBlob>(address, size);
+    }
+};
+
+struct ClaimCheckStats {
+    uint64_t published = 0;        // messages through the publisher
+    uint64_t checked = 0;          // payloads moved to the blob store
+    uint64_t bytes_offloaded = 0;  // payload bytes that skipped the gateway
+    uint64_t resolved = 0;         // references turned back into payloads
+    uint64_t failed = 0;           // store, lookup or hash failures
+};
+
+namespace claim_check {
+
+constexpr std::string_view kPrefix = "claimcheck:sha256:";
+
+inline std::string reference(const std::string& digest, size_t size) {
+    return std::string(kPrefix) + digest + ":" + std::to_string(size);
+}
+
+// True if `data` is a reference; fills the digest and size
+inline bool parse_reference(std::string_view data, std::string* digest, uint64_t* size) {
+    if (data.size() < kPrefix.size() + 66 || data.size() > kPrefix.size() + 85 ||
+        data.substr(0, kPrefix.size()) != kPrefix || data[kPrefix.size() + 64] != ':') {
+        return false;
+    }
+    std::string_view hex = data.substr(kPrefix.size(), 64);
+    std::string_view length = data.substr(kPrefix.size() + 65);
+    uint64_t value = 0;
+    for (char c : length) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    digest->assign(hex);
+    *size = value;
+    return true;
+}
+
+}  // namespace claim_check
+
+// Publishes large payloads by reference; smaller ones unchanged
+class ClaimCheckPublisher : public MessagePublisher {
+private:
+    MessagePublisher& inner_;
+    BlobStore& store_;
+    size_t threshold_;
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> checked_{0};
+    std::atomic<uint64_t> bytes_offloaded_{0};
+    std::atomic<uint64_t> failed_{0};
+
+public:
+    // NATS' default max_payload is 1 MB; well below that by default
+    ClaimCheckPublisher(MessagePublisher& inner, BlobStore& store, size_t threshold = 256 * 1024)
+        : inner_(inner)
+        , store_(store)
+        , threshold_(threshold)
+    {
+    }
+
+    bool publish(const std::string& subject, const nats::messages::PublishMessage& message,
+                 nats::messages::PublishAck* ack = nullptr) override {
+        published_++;
+        if (message.data().size() < threshold_) {
+            return inner_.publish(subject, message, ack);
+        }
+
+        std::string digest = Sha256::hex(message.data());
+        if (!store_.put(digest, message.data())) {
+            failed_++;
+            return false;
+        }
+
+        // Copy everything but the payload
+        nats::messages::PublishMessage checked;
+        checked.set_message_id(message.message_id());
+        checked.set_subject(message.subject());
+        if (message.has_timestamp()) *checked.mutable_timestamp() = message.timestamp();
+        checked.set_source(message.source());
+        *checked.mutable_metadata() = message.metadata();
+        *checked.mutable_metadata_refs() = message.metadata_refs();
+        *checked.mutable_metadata_definitions() = message.metadata_definitions();
+        checked.set_data(claim_check::reference(digest, message.data().size()));
+        (*checked.mutable_metadata())["claim-check"] = "sha256:" + digest;
+        (*checked.mutable_metadata())["claim-check-size"] = std::to_string(message.data().size());
+
+        checked_++;
+        bytes_offloaded_ += message.data().size();
+        return inner_.publish(subject, checked, ack);
+    }
+
+    ClaimCheckStats stats() const {
+        ClaimCheckStats stats;
+        stats.published = published_.load();
+        stats.checked = checked_.load();
+        stats.bytes_offloaded = bytes_offloaded_.load();
+        stats.failed = failed_.load();
+        return stats;
+    }
+};
+
+// Consumer side: looks up references, verifies them and delivers payloads
+class ClaimCheckResolver {
+private:
+    BlobStore& store_;
+    bool verify_;
+    bool gateway_;
+    std::atomic<uint64_t> resolved_{0};
+    std::atomic<uint64_t> failed_{0};
+
+public:
+    // `verify` re-hashes each blob before delivery (~3 ms per MB).
+    // `gateway` expects data in the gateway's JSON envelope; pass false for
+    // messages received directly from NATS.
+    explicit ClaimCheckResolver(BlobStore& store, bool verify = true, bool gateway = true)
+        : store_(store)
+        , verify_(verify)
+        , gateway_(gateway)
+    {
+    }
+
+    // `blob` is set to the stored payload when the message is a reference.
+    // Otherwise it is left null (with true returned) and `payload`, if
+    // given, receives the original payload. False when the data is not a
+    // gateway envelope (with `gateway`) or a reference can't be resolved.
+    bool resolve(std::string_view data, std::shared_ptr<const Blob>* blob, std::string* payload = nullptr) {
+        blob->reset();
+        std::string unwrapped;
+        if (gateway_) {
+            if (!gateway_envelope_data(data, &unwrapped)) {
+                std::cerr << "✗ Claim check: message data is not a gateway envelope" << std::endl;
+                failed_++;
+                return false;
+            }
+            data = unwrapped;
+        }
+        std::string digest;
+        uint64_t size = 0;
+        if (!claim_check::parse_reference(data, &digest, &size)) {
+            if (payload) payload->assign(data.data(), data.size());
+            return true;
+        }
+        auto stored = store_.get(digest);
+        if (!stored || stored->bytes().size() != size || (verify_ && Sha256::hex(stored->bytes()) != digest)) {
+            if (stored) {
+                std::cerr << "✗ Blob " << digest << " does not match its reference" << std::endl;
+            }
+            failed_++;
+            return false;
+        }
+        resolved_++;
+        *blob = std::move(stored);
+        return true;
+    }
+
+    // Handler that sees original payloads: resolved references, and other
+    // messages unwrapped from the gateway envelope. Messages that fail to
+    // resolve are reported and not delivered.
+    MessageSubscriber::MessageHandler wrap(MessageSubscriber::MessageHandler handler) {
+        return [this, handler = std::move(handler)](const nats::messages::StreamMessage& message) {
+            std::shared_ptr<const Blob> blob;
+            std::string payload;
+            if (!resolve(message.data(), &blob, &payload)) {
+                return;
+            }
+            if (!blob && !gateway_) {
+                handler(message);
+                return;
+            }
+            nats::messages::StreamMessage resolved = message;
+            if (blob) {
+                resolved.set_data(blob->bytes().data(), blob->bytes().size());
+            } else {
+                resolved.set_data(std::move(payload));
+            }
+            resolved.set_size_bytes(static_cast<int32_t>(resolved.data().size()));
+            handler(resolved);
+        };
+    }
+
+    ClaimCheckStats stats() const {
+        ClaimCheckStats stats;
+        stats.resolved = resolved_.load();
+        stats.failed = failed_.load();
+        return stats;
+    }
+};
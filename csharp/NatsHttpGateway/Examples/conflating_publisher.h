@@ -0,0 +1,244 @@
+/*
+ * ConflatingPublisher - last-value-wins publishing for state-update subjects
+ *
+ * Subjects matching one of the configured patterns carry state snapshots
+ * where only the newest value matters. For each such subject at most one
+ * publish is in flight; while it is in flight, or while the first update
+ * lingers for `linger`, newer messages replace the pending one instead of
+ * becoming extra gateway round trips. Subjects that match no pattern are
+ * passed through in FIFO order, unconflated.
+ *
+ * A subject's slot lives only while it has an update pending, scheduled or
+ * in flight, so memory follows the active subjects, not every subject seen.
+ *
+ * Requirements:
+ *   - libcurl, Protobuf (via http_client.h)
+ *   - pthread
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "http_client.h"
+#include "nats_subject.h"
+
+struct ConflationStats {
+    uint64_t submitted = 0;   // publish() calls accepted
+    uint64_t conflated = 0;   // pending updates replaced by a newer one
+    uint64_t dropped = 0;     // accepted but never delivered (failed or discarded on close)
+    uint64_t sent = 0;        // acknowledged by the gateway
+};
+
+class ConflatingPublisher {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot {
+        bool has_pending = false;
+        nats::messages::PublishMessage pending;
+        bool in_flight = false;
+        bool scheduled = false;
+    };
+
+    struct Ready {
+        std::string subject;
+        Clock::time_point at;
+    };
+
+    std::vector<std::string> patterns_;
+    std::chrono::milliseconds linger_;
+    std::vector<std::unique_ptr<HttpClient>> clients_;
+    std::vector<std::thread> workers_;
+
+    // Guards everything below
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    std::unordered_map<std::string, Slot> slots_;
+    std::deque<Ready> ready_;   // linger is constant, so FIFO order is deadline order
+    std::deque<std::pair<std::string, nats::messages::PublishMessage>> passthrough_;
+    size_t busy_ = 0;
+    size_t flushing_ = 0;       // flush() calls waiting; linger is skipped while > 0
+    bool stopping_ = false;
+    ConflationStats stats_;
+
+public:
+    ConflatingPublisher(const std::string& base_url, std::vector<std::string> patterns,
+                        std::chrono::milliseconds linger = std::chrono::milliseconds(0),
+                        int connections = 1)
+        : patterns_(std::move(patterns))
+        , linger_(linger)
+    {
+        for (int i = 0; i < std::max(1, connections); ++i) {
+            clients_.push_back(std::make_unique<HttpClient>(base_url));
+        }
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            workers_.emplace_back(&ConflatingPublisher::worker_loop, this, i);
+        }
+    }
+
+    ~ConflatingPublisher() {
+        close(true);
+    }
+
+    ConflatingPublisher(const ConflatingPublisher&) = delete;
+    ConflatingPublisher& operator=(const ConflatingPublisher&) = delete;
+
+    bool conflates(const std::string& subject) const {
+        for (const auto& pattern : patterns_) {
+            if (subject_matches(pattern, subject)) return true;
+        }
+        return false;
+    }
+
+    bool publish(const std::string& subject, nats::messages::PublishMessage message) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return false;
+            }
+            stats_.submitted++;
+
+            if (!conflates(subject)) {
+                passthrough_.emplace_back(subject, std::move(message));
+            } else {
+                Slot& slot = slots_[subject];
+                if (slot.has_pending) {
+                    stats_.conflated++;
+                }
+                slot.pending = std::move(message);
+                slot.has_pending = true;
+
+                // An in-flight subject is rescheduled when its publish completes
+                if (!slot.in_flight && !slot.scheduled) {
+                    slot.scheduled = true;
+                    ready_.push_back(Ready{subject, Clock::now() + linger_});
+                }
+            }
+        }
+        work_cv_.notify_one();
+        return true;
+    }
+
+    // Send everything pending now, ignoring the linger window, and wait for it
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        flushing_++;
+        work_cv_.notify_all();
+        idle_cv_.wait(lock, [this] { return idle(); });
+        flushing_--;
+    }
+
+    // Stop the workers. With drain=false pending updates are discarded and
+    // counted as dropped.
+    void close(bool drain = true) {
+        if (drain) {
+            flush();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ && workers_.empty()) return;
+            stopping_ = true;
+            for (auto& entry : slots_) {
+                if (entry.second.has_pending) {
+                    stats_.dropped++;
+                }
+            }
+            slots_.clear();
+            stats_.dropped += passthrough_.size();
+            passthrough_.clear();
+            ready_.clear();
+        }
+        work_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+    }
+
+    ConflationStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    bool idle() const {
+        return ready_.empty() && passthrough_.empty() && busy_ == 0;
+    }
+
+    void worker_loop(size_t index) {
+        HttpClient& client = *clients_[index];
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        while (!stopping_) {
+            std::string subject;
+            nats::messages::PublishMessage message;
+            bool conflated_subject = false;
+
+            if (!passthrough_.empty()) {
+                subject = std::move(passthrough_.front().first);
+                message = std::move(passthrough_.front().second);
+                passthrough_.pop_front();
+            } else if (!ready_.empty()) {
+                if (flushing_ == 0 && ready_.front().at > Clock::now()) {
+                    work_cv_.wait_until(lock, ready_.front().at);
+                    continue;
+                }
+                subject = std::move(ready_.front().subject);
+                ready_.pop_front();
+
+                Slot& slot = slots_[subject];
+                slot.scheduled = false;
+                slot.has_pending = false;
+                slot.in_flight = true;
+                message = std::move(slot.pending);
+                conflated_subject = true;
+            } else {
+                work_cv_.wait(lock);
+                continue;
+            }
+
+            busy_++;
+            lock.unlock();
+            bool ok = client.publish(subject, message);
+            lock.lock();
+            busy_--;
+
+            if (ok) {
+                stats_.sent++;
+            } else {
+                stats_.dropped++;
+            }
+
+            // close(false) may have discarded the slot meanwhile
+            auto it = conflated_subject ? slots_.find(subject) : slots_.end();
+            if (it != slots_.end()) {
+                Slot& slot = it->second;
+                slot.in_flight = false;
+                if (slot.has_pending && !stopping_) {
+                    // Updates that arrived during the flight go out right away
+                    slot.scheduled = true;
+                    ready_.push_front(Ready{subject, Clock::now()});
+                    work_cv_.notify_one();
+                } else {
+                    slots_.erase(it);
+                }
+            }
+
+            if (idle()) {
+                idle_cv_.notify_all();
+            }
+        }
+    }
+};
@@ -0,0 +1,363 @@
+/*
+ * ConsumerApi - the gateway's JetStream consumer management endpoints
+ *
+ *   POST   /api/consumers/{stream}                      create
+ *   GET    /api/consumers/{stream}                      list
+ *   GET    /api/consumers/{stream}/{consumer}           info, state and lag
+ *   GET    /api/consumers/{stream}/{consumer}/health    health verdict
+ *   DELETE /api/consumers/{stream}/{consumer}           delete
+ *   GET    /api/messages/{stream}/consumer/{consumer}   fetch (and ack)
+ *
+ * These endpoints speak JSON, not protobuf. Replies are read with the small
+ * tree reader in nats_json.h. Like HttpClient, one ConsumerApi holds one
+ * curl handle and is not thread-safe; give each thread its own.
+ *
+ * Requirements:
+ *   - libcurl
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "curl_global.h"
+#include "nats_json.h"
+
+struct ConsumerSpec {
+    std::string name;
+    std::string filter_subject;
+    std::string description;
+    std::string deliver_policy = "all";     // all, last, new, by_start_sequence, by_start_time
+    std::string ack_policy = "explicit";
+    int ack_wait_s = 0;                     // 0: server default
+    int max_ack_pending = 0;                // 0: server default
+};
+
+struct ConsumerInfo {
+    std::string stream;
+    std::string name;
+    std::string filter_subject;
+    uint64_t delivered = 0;         // consumer sequence of the last delivery
+    uint64_t ack_pending = 0;
+    uint64_t redelivered = 0;
+    uint64_t num_pending = 0;       // matching messages not yet delivered
+    uint64_t num_waiting = 0;       // pull requests waiting
+    uint64_t last_delivered_ns = 0;
+    uint64_t consumer_lag = 0;      // stream last sequence - last delivered stream sequence
+    uint64_t acknowledged = 0;
+    uint64_t max_ack_pending = 0;   // 0: not reported
+    int ack_wait_s = 0;             // 0: not reported
+    bool healthy = true;
+};
+
+struct ConsumerHealth {
+    bool healthy = false;
+    std::string status;             // Healthy, Inactive, Overloaded, Lagging
+    std::string issue;
+    uint64_t pending = 0;
+    uint64_t ack_pending = 0;
+    uint64_t last_activity_ns = 0;
+};
+
+struct ConsumedMessage {
+    std::string subject;
+    uint64_t sequence = 0;
+    uint64_t timestamp_ns = 0;
+    uint64_t size_bytes = 0;        // as stored, envelope included
+    std::string data;               // original payload, unwrapped from the envelope
+};
+
+class ConsumerApi {
+private:
+    std::string base_url_;
+    CURL* curl_;
+
+    static size_t append_body(void* contents, size_t size, size_t nmemb, void* userp) {
+        static_cast<std::string*>(userp)->append(static_cast<char*>(contents), size * nmemb);
+        return size * nmemb;
+    }
+
+    static uint64_t uint_of(const nats_json::Value* v) {
+        return v && v->type == nats_json::Value::Number && v->number > 0 ? static_cast<uint64_t>(v->number) : 0;
+    }
+
+    static std::string text_of(const nats_json::Value* v) {
+        return v && v->type == nats_json::Value::String ? v->text : std::string();
+    }
+
+    static const nats_json::Value* path(const nats_json::Value& root, const char* object, const char* field) {
+        const nats_json::Value* o = root.get(object);
+        return o ? o->get(field) : nullptr;
+    }
+
+    static ConsumerInfo info_from(const nats_json::Value& v) {
+        ConsumerInfo info;
+        info.stream = text_of(v.get("streamName"));
+        info.name = text_of(v.get("name"));
+        info.filter_subject = text_of(path(v, "config", "filterSubject"));
+        info.max_ack_pending = uint_of(path(v, "config", "maxAckPending"));
+        info.ack_wait_s = timespan_seconds(text_of(path(v, "config", "ackWait")));
+        info.delivered = uint_of(path(v, "state", "delivered"));
+        info.ack_pending = uint_of(path(v, "state", "ackPending"));
+        info.redelivered = uint_of(path(v, "state", "redelivered"));
+        info.num_pending = uint_of(path(v, "state", "numPending"));
+        info.num_waiting = uint_of(path(v, "state", "numWaiting"));
+        info.last_delivered_ns = parse_rfc3339(text_of(path(v, "state", "lastDelivered")));
+        info.consumer_lag = uint_of(path(v, "metrics", "consumerLag"));
+        info.acknowledged = uint_of(path(v, "metrics", "acknowledgedMessages"));
+        const nats_json::Value* healthy = path(v, "metrics", "isHealthy");
+        info.healthy = !healthy || healthy->number != 0;
+        return info;
+    }
+
+    // TimeSpan as System.Text.Json writes and reads it
+    static std::string timespan(int seconds) {
+        char text[16];
+        std::snprintf(text, sizeof(text), "%02d:%02d:%02d", seconds / 3600, seconds / 60 % 60, seconds % 60);
+        return text;
+    }
+
+    // "hh:mm:ss", "d.hh:mm:ss" or either with fractional seconds; 0 if unset
+    static int timespan_seconds(const std::string& text) {
+        int days = 0, hours = 0, minutes = 0, seconds = 0;
+        if (std::sscanf(text.c_str(), "%d.%d:%d:%d", &days, &hours, &minutes, &seconds) == 4) {
+            return ((days * 24 + hours) * 60 + minutes) * 60 + seconds;
+        }
+        if (std::sscanf(text.c_str(), "%d:%d:%d", &hours, &minutes, &seconds) == 3) {
+            return (hours * 60 + minutes) * 60 + seconds;
+        }
+        return 0;
+    }
+
+public:
+    explicit ConsumerApi(const std::string& base_url) : base_url_(base_url) {
+        curl_global_once();
+        curl_ = curl_easy_init();
+        if (!curl_) {
+            throw std::runtime_error("Failed to initialize CURL");
+        }
+    }
+
+    ~ConsumerApi() {
+        if (curl_) {
+            curl_easy_cleanup(curl_);
+        }
+    }
+
+    ConsumerApi(const ConsumerApi&) = delete;
+    ConsumerApi& operator=(const ConsumerApi&) = delete;
+
+    const std::string& base_url() const { return base_url_; }
+
+    // Sends a request and returns the status code (0 if the request failed).
+    // Errors are not printed here; callers decide what a status means.
+    long request(const char* method, const std::string& path, const std::string& body, std::string* response,
+                 long timeout_s = 0) {
+        std::string url = base_url_ + path;
+        response->clear();
+        curl_easy_reset(curl_);
+        curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl_, CURLOPT_CUSTOMREQUEST, method);
+        if (timeout_s > 0) {
+            curl_easy_setopt(curl_, CURLOPT_TIMEOUT, timeout_s);
+        }
+        struct curl_slist* headers = nullptr;
+        headers = curl_slist_append(headers, "Accept: application/json");
+        if (!body.empty()) {
+            headers = curl_slist_append(headers, "Content-Type: application/json");
+            curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, body.c_str());
+            curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+        }
+        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, append_body);
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, response);
+
+        CURLcode res = curl_easy_perform(curl_);
+        curl_slist_free_all(headers);
+        if (res != CURLE_OK) {
+            *response = curl_easy_strerror(res);
+            return 0;
+        }
+        long code = 0;
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &code);
+        return code;
+    }
+
+    // Consumer info. A missing consumer sets *not_found (when given) and
+    // returns false without printing.
+    bool get(const std::string& stream, const std::string& name, ConsumerInfo* info, bool* not_found = nullptr) {
+        if (not_found) *not_found = false;
+        std::string body;
+        long code = request("GET", "/api/consumers/" + stream + "/" + name, "", &body);
+        if (code == 404 && not_found) {
+            *not_found = true;
+            return false;
+        }
+        return parse_info(code, body, "Consumer " + stream + "/" + name, info);
+    }
+
+    bool create(const std::string& stream, const ConsumerSpec& spec, ConsumerInfo* info) {
+        std::string json = "{\"name\":";
+        append_json_string(json, spec.name);
+        json += ",\"durable\":true,\"deliverPolicy\":";
+        append_json_string(json, spec.deliver_policy);
+        json += ",\"ackPolicy\":";
+        append_json_string(json, spec.ack_policy);
+        if (!spec.filter_subject.empty()) {
+            json += ",\"filterSubject\":";
+            append_json_string(json, spec.filter_subject);
+        }
+        if (!spec.description.empty()) {
+            json += ",\"description\":";
+            append_json_string(json, spec.description);
+        }
+        if (spec.ack_wait_s > 0) {
+            json += ",\"ackWait\":\"" + timespan(spec.ack_wait_s) + "\"";
+        }
+        if (spec.max_ack_pending > 0) {
+            json += ",\"maxAckPending\":" + std::to_string(spec.max_ack_pending);
+        }
+        json += "}";
+
+        std::string body;
+        long code = request("POST", "/api/consumers/" + stream, json, &body);
+        if (code == 201) code = 200;   // Created, with the consumer as the body
+        return parse_info(code, body, "Create consumer " + stream + "/" + spec.name, info);
+    }
+
+    // Reuse the consumer if it exists with the same filter, create it if it
+    // doesn't. An existing consumer with another filter is an error: it
+    // belongs to someone else, or to an older layout.
+    bool ensure(const std::string& stream, const ConsumerSpec& spec, ConsumerInfo* info, bool* created = nullptr) {
+        if (created) *created = false;
+        bool not_found = false;
+        if (get(stream, spec.name, info, &not_found)) {
+            if (info->filter_subject != spec.filter_subject) {
+                std::cerr << "✗ Consumer " << stream << "/" << spec.name << " exists with filter '"
+                          << info->filter_subject << "', expected '" << spec.filter_subject << "'" << std::endl;
+                return false;
+            }
+            return true;
+        }
+        if (!not_found || !create(stream, spec, info)) {
+            return false;
+        }
+        if (created) *created = true;
+        return true;
+    }
+
+    bool list(const std::string& stream, std::vector<ConsumerInfo>* consumers) {
+        std::string body;
+        long code = request("GET", "/api/consumers/" + stream, "", &body);
+        nats_json::Value root;
+        if (!parse(code, body, "List consumers " + stream, &root)) {
+            return false;
+        }
+        consumers->clear();
+        if (const nats_json::Value* items = root.get("consumers")) {
+            for (const auto& item : items->items) consumers->push_back(info_from(item));
+        }
+        return true;
+    }
+
+    bool health(const std::string& stream, const std::string& name, ConsumerHealth* health) {
+        std::string body;
+        long code = request("GET", "/api/consumers/" + stream + "/" + name + "/health", "", &body);
+        nats_json::Value root;
+        if (!parse(code, body, "Health " + stream + "/" + name, &root)) {
+            return false;
+        }
+        const nats_json::Value* healthy = root.get("isHealthy");
+        health->healthy = healthy && healthy->number != 0;
+        health->status = text_of(root.get("status"));
+        health->issue = text_of(root.get("issue"));
+        health->pending = uint_of(root.get("pendingMessages"));
+        health->ack_pending = uint_of(root.get("ackPending"));
+        health->last_activity_ns = parse_rfc3339(text_of(root.get("lastActivity")));
+        return true;
+    }
+
+    bool remove(const std::string& stream, const std::string& name) {
+        std::string body;
+        long code = request("DELETE", "/api/consumers/" + stream + "/" + name, "", &body);
+        if (code != 200 && code != 204) {
+            report(code, body, "Delete consumer " + stream + "/" + name);
+            return false;
+        }
+        return true;
+    }
+
+    // Up to `limit` (1-100) messages, waiting up to timeout_s (1-30) for
+    // them. The gateway acknowledges each message it returns. Its "data" is
+    // the stored envelope as a JSON object; the payload is decoded from the
+    // envelope's base64 "data" field. Data that is not an envelope (published
+    // to NATS directly) is kept as the string it was sent as, and left empty
+    // otherwise.
+    bool fetch(const std::string& stream, const std::string& name, int limit, int timeout_s,
+               std::vector<ConsumedMessage>* messages) {
+        std::string body;
+        long code = request("GET", "/api/messages/" + stream + "/consumer/" + name + "?limit=" +
+                            std::to_string(limit) + "&timeout=" + std::to_string(timeout_s), "", &body,
+                            timeout_s + 10);
+        nats_json::Value root;
+        if (!parse(code, body, "Fetch " + stream + "/" + name, &root)) {
+            return false;
+        }
+        messages->clear();
+        if (const nats_json::Value* items = root.get("messages")) {
+            for (const auto& item : items->items) {
+                ConsumedMessage m;
+                m.subject = text_of(item.get("subject"));
+                m.sequence = uint_of(item.get("sequence"));
+                m.timestamp_ns = parse_rfc3339(text_of(item.get("timestamp")));
+                m.size_bytes = uint_of(item.get("size_bytes"));
+                if (const nats_json::Value* data = item.get("data")) {
+                    const nats_json::Value* encoded = data->get("data");
+                    if (data->get("message_id") && encoded && encoded->type == nats_json::Value::String) {
+                        if (!base64_decode(encoded->text, &m.data)) m.data.clear();
+                    } else if (data->type == nats_json::Value::String) {
+                        m.data = data->text;
+                    }
+                }
+                messages->push_back(std::move(m));
+            }
+        }
+        return true;
+    }
+
+private:
+    static void report(long code, const std::string& body, const std::string& what) {
+        if (code == 0) {
+            std::cerr << "✗ " << what << ": HTTP request failed: " << body << std::endl;
+        } else {
+            std::cerr << "✗ " << what << ": server returned status " << code
+                      << (body.empty() ? "" : ": " + body.substr(0, 200)) << std::endl;
+        }
+    }
+
+    static bool parse(long code, const std::string& body, const std::string& what, nats_json::Value* root) {
+        if (code != 200) {
+            report(code, body, what);
+            return false;
+        }
+        if (!nats_json::Parser(body).parse(root) || root->type != nats_json::Value::Object) {
+            std::cerr << "✗ " << what << ": invalid JSON response" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static bool parse_info(long code, const std::string& body, const std::string& what, ConsumerInfo* info) {
+        nats_json::Value root;
+        if (!parse(code, body, what, &root)) {
+            return false;
+        }
+        *info = info_from(root);
+        return true;
+    }
+};
@@ -0,0 +1,498 @@
+/*
+ * ConsumerGroup - one stream's processing spread over several processes
+ *
+ * The subject space is split into a fixed number of partitions by hashing
+ * key tokens, and each partition gets a durable consumer whose filter
+ * selects only that partition:
+ *
+ *   template  orders.{partition}.>       partitions 4, group billing
+ *   producer  orders.eu.42  ->  orders.3.eu.42      (subject_for)
+ *   consumer  billing-p3, filterSubject orders.3.>  (created or reused)
+ *
+ * The partition is FNV-1a 32 of the key tokens modulo the partition count,
+ * the same as the server's partition() subject mapping. The insertion can
+ * therefore happen on the server instead of in every producer:
+ *
+ *   orders.*.*  ->  orders.{{partition(4,1,2)}}.{{wildcard(1)}}.{{wildcard(2)}}
+ *
+ * Group members find each other through a Membership:
+ *
+ *   LeaseFileMembership   a lease file per member in a shared directory,
+ *                         renewed on every heartbeat (same host or shared FS)
+ *   SubjectMembership     heartbeats published to <prefix>.<group>.<member>
+ *                         through the gateway; the last 100 are read back
+ *
+ * Every member computes the same assignment from the sorted list of live
+ * members (rendezvous hashing with a load bound, so each member gets
+ * floor or ceil of partitions/members and few partitions move when one
+ * joins or leaves), so there is no leader to elect. On a membership change
+ * a member stops partitions it lost at once, and starts ones it gained only
+ * after `settle`, by when their previous owner has let go. Partitions whose
+ * previous owner left the group (or whose lease expired) are taken over at
+ * once, since nobody else is fetching them. Fetching from a
+ * durable consumer acks, so an overlap would interleave a partition but not
+ * duplicate it.
+ *
+ * Requirements:
+ *   - libcurl, Protobuf (SubjectMembership, via http_client.h)
+ *   - C++17 <filesystem> (LeaseFileMembership)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+#include "consumer_api.h"
+#include "http_client.h"
+#include "nats_json.h"
+#include "receive_modes.h"
+
+// FNV-1a 32 of `key` modulo `partitions`: the server's partition() mapping
+// over the concatenated key tokens
+inline uint32_t nats_partition(std::string_view key, uint32_t partitions) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return partitions ? hash % partitions : 0;
+}
+
+inline std::vector<std::string_view> subject_tokens(std::string_view subject) {
+    std::vector<std::string_view> tokens;
+    size_t pos = 0;
+    while (true) {
+        size_t dot = subject.find('.', pos);
+        tokens.push_back(subject.substr(pos, dot == std::string_view::npos ? std::string_view::npos : dot - pos));
+        if (dot == std::string_view::npos) break;
+        pos = dot + 1;
+    }
+    return tokens;
+}
+
+struct PartitionScheme {
+    std::string stream;               // e.g. orders
+    std::string filter_template;      // one whole token is {partition}, e.g. orders.{partition}.>
+    int partitions = 8;
+    std::string group;                // consumers are <group>-p<N>
+    std::vector<int> key_tokens;      // 1-based, among the tokens after the prefix; empty = all
+
+    bool valid(std::string* error) const {
+        auto tokens = subject_tokens(filter_template);
+        int found = 0;
+        for (auto token : tokens) {
+            if (token == "{partition}") found++;
+        }
+        if (found != 1) {
+            *error = "filter template needs exactly one {partition} token: " + filter_template;
+            return false;
+        }
+        if (partitions < 1 || partitions > 1000) {
+            *error = "partitions must be between 1 and 1000";
+            return false;
+        }
+        if (group.empty() || group.find_first_of(". *>") != std::string::npos) {
+            *error = "group must be a plain name (no dots, spaces or wildcards)";
+            return false;
+        }
+        if (stream.empty()) {
+            *error = "stream is required";
+            return false;
+        }
+        return true;
+    }
+
+    std::string filter(int partition) const {
+        std::string out = filter_template;
+        out.replace(out.find("{partition}"), 11, std::to_string(partition));
+        return out;
+    }
+
+    std::string consumer(int partition) const {
+        return group + "-p" + std::to_string(partition);
+    }
+
+    // Partition of an unpartitioned subject, or -1 if it doesn't start with
+    // the template's prefix or lacks a key token
+    int partition_of(std::string_view subject) const {
+        size_t prefix_tokens = prefix_size();
+        auto tokens = subject_tokens(subject);
+        auto prefix = subject_tokens(filter_template);
+        if (tokens.size() <= prefix_tokens) return -1;
+        for (size_t i = 0; i < prefix_tokens; ++i) {
+            if (tokens[i] != prefix[i]) return -1;
+        }
+        std::string key;
+        if (key_tokens.empty()) {
+            for (size_t i = prefix_tokens; i < tokens.size(); ++i) key.append(tokens[i]);
+        } else {
+            for (int index : key_tokens) {
+                size_t i = prefix_tokens + static_cast<size_t>(index) - 1;
+                if (index < 1 || i >= tokens.size()) return -1;
+                key.append(tokens[i]);
+            }
+        }
+        return static_cast<int>(nats_partition(key, static_cast<uint32_t>(partitions)));
+    }
+
+    // "orders.eu.42" -> "orders.3.eu.42"; empty if the subject doesn't fit
+    std::string subject_for(std::string_view subject) const {
+        int partition = partition_of(subject);
+        if (partition < 0) return "";
+        size_t prefix_tokens = prefix_size();
+        size_t pos = 0;
+        for (size_t i = 0; i < prefix_tokens; ++i) pos = subject.find('.', pos) + 1;
+        std::string out(subject.substr(0, pos));
+        out += std::to_string(partition);
+        out += '.';
+        out.append(subject.substr(pos));
+        return out;
+    }
+
+private:
+    size_t prefix_size() const {
+        auto tokens = subject_tokens(filter_template);
+        return static_cast<size_t>(std::find(tokens.begin(), tokens.end(), "{partition}") - tokens.begin());
+    }
+};
+
+class Membership {
+public:
+    virtual ~Membership() = default;
+
+    // Renew this member's lease (or give it up when leaving) and list the
+    // live members, sorted. False if the lease could not be renewed.
+    virtual bool heartbeat(bool leaving, std::vector<std::string>* members) = 0;
+};
+
+// <dir>/<group>.<member>.lease holds the lease's expiry (unix ms). Each
+// member only ever writes its own file; expired ones are ignored.
+class LeaseFileMembership : public Membership {
+private:
+    std::filesystem::path dir_;
+    std::string group_;
+    std::string member_;
+    std::chrono::milliseconds ttl_;
+
+    static int64_t now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+public:
+    LeaseFileMembership(std::string dir, std::string group, std::string member, std::chrono::milliseconds ttl)
+        : dir_(std::move(dir)), group_(std::move(group)), member_(std::move(member)), ttl_(ttl)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        if (ec) {
+            throw std::runtime_error("Cannot create lease directory " + dir_.string() + ": " + ec.message());
+        }
+    }
+
+    bool heartbeat(bool leaving, std::vector<std::string>* members) override {
+        std::filesystem::path lease = dir_ / (group_ + "." + member_ + ".lease");
+        std::error_code ec;
+        if (leaving) {
+            std::filesystem::remove(lease, ec);
+        } else {
+            // Write and rename, so readers never see a half-written lease
+            std::filesystem::path temp = lease;
+            temp += ".tmp" + std::to_string(::getpid());
+            {
+                std::ofstream out(temp, std::ios::trunc);
+                out << now_ms() + ttl_.count() << "\n";
+                if (!out.flush()) {
+                    std::cerr << "✗ Cannot write lease " << temp << std::endl;
+                    return false;
+                }
+            }
+            std::filesystem::rename(temp, lease, ec);
+            if (ec) {
+                std::cerr << "✗ Cannot renew lease " << lease << ": " << ec.message() << std::endl;
+                return false;
+            }
+        }
+
+        members->clear();
+        const std::string prefix = group_ + ".";
+        const std::string suffix = ".lease";
+        int64_t now = now_ms();
+        for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+                name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                continue;
+            }
+            std::ifstream in(entry.path());
+            int64_t expires = 0;
+            if (in >> expires && expires >= now) {
+                members->push_back(name.substr(prefix.size(), name.size() - prefix.size() - suffix.size()));
+            }
+        }
+        std::sort(members->begin(), members->end());
+        return true;
+    }
+};
+
+// Heartbeats on <prefix>.<group>.<member> through the gateway. Liveness is
+// judged against the timestamp the gateway gave our own heartbeat, so
+// member clocks don't need to agree. The last 100 heartbeats are read back
+// (the fetch limit), which covers about 100 / (ttl / heartbeat interval)
+// members. Give the heartbeat stream a short max age.
+class SubjectMembership : public Membership {
+private:
+    HttpClient client_;
+    std::string subject_;
+    std::string filter_;
+    std::string member_;
+    std::chrono::milliseconds ttl_;
+
+    static int64_t timestamp_ms(const google::protobuf::Timestamp& t) {
+        return t.seconds() * 1000 + t.nanos() / 1000000;
+    }
+
+public:
+    SubjectMembership(const std::string& url, const std::string& prefix, const std::string& group,
+                      std::string member, std::chrono::milliseconds ttl)
+        : client_(url)
+        , subject_(prefix + "." + group + "." + member)
+        , filter_(prefix + "." + group + ".*")
+        , member_(std::move(member))
+        , ttl_(ttl)
+    {
+    }
+
+    bool heartbeat(bool leaving, std::vector<std::string>* members) override {
+        std::string body = "{\"member\":";
+        append_json_string(body, member_);
+        body += ",\"ttl_ms\":" + std::to_string(ttl_.count()) + ",\"leaving\":" + (leaving ? "true" : "false") + "}";
+        nats::messages::PublishMessage message;
+        message.set_subject(subject_);
+        message.set_source("consumer-group");
+        message.set_data(body);
+        nats::messages::PublishAck ack;
+        if (!client_.publish(subject_, message, &ack)) {
+            return false;
+        }
+        int64_t now = timestamp_ms(ack.timestamp());
+
+        nats::messages::FetchResponse response;
+        if (!client_.fetch(filter_, 100, &response)) {
+            return false;
+        }
+        // Latest heartbeat per member wins; messages come in stream order
+        std::map<std::string, bool> alive;
+        std::string data;
+        for (const auto& m : response.messages()) {
+            std::string name;
+            uint64_t ttl_ms = 0;
+            if (!gateway_envelope_data(m.data(), &data) || !json_string_field(data, "member", &name) ||
+                !json_uint_field(data, "ttl_ms", &ttl_ms)) {
+                continue;
+            }
+            alive[name] = !json_bool_field(data, "leaving") &&
+                          timestamp_ms(m.timestamp()) + static_cast<int64_t>(ttl_ms) >= now;
+        }
+        members->clear();
+        for (const auto& entry : alive) {
+            if (entry.second) members->push_back(entry.first);
+        }
+        return true;
+    }
+};
+
+struct GroupOptions {
+    std::chrono::milliseconds heartbeat{2000};   // how often tick() is expected
+    std::chrono::milliseconds ttl{6000};         // a member is gone this long after its last heartbeat
+    std::chrono::milliseconds settle{3000};      // wait before taking over partitions
+    int ack_wait_s = 0;                          // partition consumers (0: server default)
+    int max_ack_pending = 0;
+};
+
+class ConsumerGroup {
+public:
+    using Clock = std::chrono::steady_clock;
+    using AssignHandler = std::function<void(int partition, const std::string& consumer)>;
+    using RevokeHandler = std::function<void(int partition)>;
+    using MembersHandler = std::function<void(const std::vector<std::string>& members, uint64_t generation)>;
+
+private:
+    PartitionScheme scheme_;
+    std::string member_;
+    std::unique_ptr<Membership> membership_;
+    GroupOptions options_;
+    AssignHandler on_assign_;
+    RevokeHandler on_revoke_;
+    MembersHandler on_members_;
+
+    std::vector<std::string> members_;
+    std::vector<std::string> settled_members_;   // the list the current owners were assigned from
+    std::set<int> owned_;
+    Clock::time_point changed_at_{};
+    uint64_t generation_ = 0;
+
+public:
+    ConsumerGroup(PartitionScheme scheme, std::string member, std::unique_ptr<Membership> membership,
+                  GroupOptions options, AssignHandler on_assign, RevokeHandler on_revoke)
+        : scheme_(std::move(scheme))
+        , member_(std::move(member))
+        , membership_(std::move(membership))
+        , options_(options)
+        , on_assign_(std::move(on_assign))
+        , on_revoke_(std::move(on_revoke))
+    {
+        std::string error;
+        if (!scheme_.valid(&error)) {
+            throw std::runtime_error(error);
+        }
+        if (member_.empty() || member_.find_first_of(". *>") != std::string::npos) {
+            throw std::runtime_error("member must be a plain name (no dots, spaces or wildcards)");
+        }
+    }
+
+    const PartitionScheme& scheme() const { return scheme_; }
+    const std::vector<std::string>& members() const { return members_; }
+    const std::set<int>& owned() const { return owned_; }
+    uint64_t generation() const { return generation_; }
+
+    // Called from tick() when the member list changes, before the
+    // resulting revocations
+    void on_members(MembersHandler handler) { on_members_ = std::move(handler); }
+
+    // Create the partition consumers that don't exist yet and check the
+    // ones that do. Safe to run from every member at startup.
+    bool ensure_consumers(ConsumerApi& api, bool verbose = true) {
+        int created = 0;
+        for (int p = 0; p < scheme_.partitions; ++p) {
+            ConsumerSpec spec;
+            spec.name = scheme_.consumer(p);
+            spec.filter_subject = scheme_.filter(p);
+            spec.description = "consumer group " + scheme_.group + ", partition " + std::to_string(p) + "/" +
+                               std::to_string(scheme_.partitions);
+            spec.ack_wait_s = options_.ack_wait_s;
+            spec.max_ack_pending = options_.max_ack_pending;
+            ConsumerInfo info;
+            bool was_created = false;
+            if (!api.ensure(scheme_.stream, spec, &info, &was_created)) {
+                return false;
+            }
+            created += was_created;
+        }
+        if (verbose) {
+            std::cout << "✓ " << scheme_.partitions << " partition consumers on " << scheme_.stream << " ("
+                      << created << " created, " << scheme_.partitions - created << " reused)" << std::endl;
+        }
+        return true;
+    }
+
+    // Partitions per member: each partition goes to the member that ranks
+    // it highest among those still under their share. Shares are floor or
+    // ceil of partitions/members, handed out deterministically.
+    static std::map<std::string, std::vector<int>> assign(const std::vector<std::string>& members, int partitions) {
+        std::map<std::string, std::vector<int>> result;
+        if (members.empty()) return result;
+        size_t floor_share = static_cast<size_t>(partitions) / members.size();
+        size_t ceil_slots = static_cast<size_t>(partitions) % members.size();
+        std::vector<uint64_t> member_hash;
+        for (const auto& m : members) {
+            member_hash.push_back(fnv1a64(m));
+            result[m];
+        }
+        std::vector<size_t> order(members.size());
+        for (int p = 0; p < partitions; ++p) {
+            uint64_t salt = mix64(static_cast<uint64_t>(p) + 1);
+            for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                uint64_t ra = mix64(member_hash[a] ^ salt);
+                uint64_t rb = mix64(member_hash[b] ^ salt);
+                return ra != rb ? ra > rb : members[a] < members[b];
+            });
+            for (size_t i : order) {
+                auto& mine = result[members[i]];
+                if (mine.size() < floor_share || (mine.size() == floor_share && ceil_slots > 0)) {
+                    if (mine.size() == floor_share) ceil_slots--;
+                    mine.push_back(p);
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
+    // Renew the lease, refresh the member list and rebalance. Call every
+    // options.heartbeat. Handlers run on the calling thread; on_revoke
+    // should return once the partition is no longer being fetched.
+    bool tick() {
+        std::vector<std::string> members;
+        if (!membership_->heartbeat(false, &members)) {
+            return false;
+        }
+        // Our own lease may not be visible yet (lease file just written on
+        // a slow FS, heartbeat not yet readable): count ourselves in
+        if (!std::binary_search(members.begin(), members.end(), member_)) {
+            members.insert(std::upper_bound(members.begin(), members.end(), member_), member_);
+        }
+        Clock::time_point now = Clock::now();
+        if (members != members_) {
+            members_ = members;
+            changed_at_ = now;
+            generation_++;
+            if (on_members_) on_members_(members_, generation_);
+        }
+
+        auto assignment = assign(members_, scheme_.partitions);
+        const auto& target = assignment[member_];
+        std::set<int> wanted(target.begin(), target.end());
+
+        for (auto it = owned_.begin(); it != owned_.end();) {
+            if (!wanted.count(*it)) {
+                if (on_revoke_) on_revoke_(*it);
+                it = owned_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        // Alone from the start there is no previous owner to wait for
+        bool settled = (generation_ == 1 && members_.size() == 1) || now - changed_at_ >= options_.settle;
+        std::map<int, std::string> previous_owner;
+        if (!settled) {
+            for (const auto& entry : assign(settled_members_, scheme_.partitions)) {
+                for (int p : entry.second) previous_owner[p] = entry.first;
+            }
+        }
+        for (int p : wanted) {
+            auto previous = previous_owner.find(p);
+            bool orphaned = previous != previous_owner.end() &&
+                            !std::binary_search(members_.begin(), members_.end(), previous->second);
+            if ((settled || orphaned) && owned_.insert(p).second && on_assign_) {
+                on_assign_(p, scheme_.consumer(p));
+            }
+        }
+        if (settled) settled_members_ = members_;
+        return true;
+    }
+
+    // Give everything up and tell the others right away
+    void leave() {
+        for (int p : owned_) {
+            if (on_revoke_) on_revoke_(p);
+        }
+        owned_.clear();
+        std::vector<std::string> ignored;
+        membership_->heartbeat(true, &ignored);
+    }
+};
@@ -0,0 +1,26 @@
+/*
+ * curl_global_once() - libcurl's global initialisation, once per process
+ *
+ * curl_global_init() is not thread-safe on older libcurl, and a
+ * curl_global_cleanup() from one client's destructor tears down state
+ * (TLS backends) that other live clients still use. Every curl-based
+ * client here calls curl_global_once() instead: the function-local static
+ * runs curl_global_init() exactly once, even from several threads, and
+ * the matching cleanup is left to process exit.
+ *
+ * Requirements:
+ *   - libcurl
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+#include <stdexcept>
+#include <string>
+
+inline void curl_global_once() {
+    static const CURLcode result = curl_global_init(CURL_GLOBAL_DEFAULT);
+    if (result != CURLE_OK) {
+        throw std::runtime_error(std::string("Failed to initialize CURL: ") + curl_easy_strerror(result));
+    }
+}
@@ -0,0 +1,693 @@
+/*
+ * FaultProxy - TCP proxy that injects network faults
+ *
+ * Sits between clients and a gateway (or mock_gateway / mock_nats_server)
+ * and impairs the traffic in user space, without root or tc:
+ *
+ *   latency=5ms jitter=2ms dist=normal   delay per chunk, from a distribution
+ *                                        (fixed, uniform, normal,
+ *                                        exponential, pareto)
+ *   spike=1%:200ms                       occasional extra delay
+ *   rate=1mbit                           bandwidth cap (bit, kbit, mbit,
+ *                                        gbit per second, or B, kB, MB)
+ *   stall=0.5%:300ms                     hold the direction, connection open
+ *   reset=0.1%                           reset the connection (RST) halfway
+ *                                        through a chunk
+ *   reset_after=64k                      reset once this many bytes passed
+ *   clear                                back to no faults
+ *
+ * Faults are set per direction (up = client to server, down = server to
+ * client, both) by rules, one per line of a scenario:
+ *
+ *   listen 19090
+ *   upstream 127.0.0.1:8080
+ *   seed 42
+ *   both latency=2ms jitter=1ms dist=normal
+ *   down rate=2mbit spike=1%:100ms
+ *   conn %5 up reset_after=16k          # every fifth connection
+ *   conn 2 down stall=100%:1s           # only the second connection
+ *   at 30s both clear                   # from 30 s after start
+ *
+ * Later rules override earlier ones for the keys they set. Rules are
+ * evaluated for every chunk, so timed (at) rules change live connections.
+ *
+ * Each connection runs a reader and a writer thread per direction, in the
+ * blocking style of the mock servers. The reader stamps every chunk it
+ * reads with a release time of arrival + sampled delay. The writer sends
+ * it then, paced by the rate cap. Release times never go backwards (TCP
+ * can't reorder), so jitter delays later chunks behind a slow one, as
+ * netem does. Queued bytes per direction are bounded, so a rate-capped
+ * direction pushes back on the sender. Latency is added to chunks as read
+ * (one read may hold several small messages), so a request/response
+ * exchange sees the up delay plus the down delay.
+ *
+ * Requirements:
+ *   - Boost.Asio, pthread
+ */
+
+#pragma once
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LatencyDistribution { Fixed, Uniform, Normal, Exponential, Pareto };
+
+// Resolved faults for one direction of one connection
+struct FaultSettings {
+    double latency_ms = 0;
+    double jitter_ms = 0;
+    LatencyDistribution distribution = LatencyDistribution::Normal;
+    double spike_probability = 0;
+    double spike_ms = 0;
+    double rate_bytes_per_s = 0;    // 0 = unlimited
+    double stall_probability = 0;
+    double stall_ms = 0;
+    double reset_probability = 0;   // per chunk
+    uint64_t reset_after = 0;       // bytes, 0 = never
+};
+
+struct FaultRule {
+    enum Field : uint32_t {
+        kLatency = 1, kJitter = 2, kDistribution = 4, kSpike = 8, kRate = 16,
+        kStall = 32, kReset = 64, kResetAfter = 128, kAll = 255
+    };
+
+    double at_s = 0;          // active from this many seconds after start
+    uint64_t connection = 0;  // only this connection (1-based), 0 = all
+    uint64_t every = 0;       // only every n-th connection, 0 = all
+    bool up = true;
+    bool down = true;
+    uint32_t fields = 0;      // which settings the rule sets
+    FaultSettings settings;
+
+    bool applies(uint64_t id, bool upstream, double elapsed_s) const {
+        return elapsed_s >= at_s && (upstream ? up : down) && (connection == 0 || connection == id) &&
+               (every == 0 || id % every == 0);
+    }
+
+    void apply(FaultSettings& target) const {
+        if (fields & kLatency) target.latency_ms = settings.latency_ms;
+        if (fields & kJitter) target.jitter_ms = settings.jitter_ms;
+        if (fields & kDistribution) target.distribution = settings.distribution;
+        if (fields & kSpike) {
+            target.spike_probability = settings.spike_probability;
+            target.spike_ms = settings.spike_ms;
+        }
+        if (fields & kRate) target.rate_bytes_per_s = settings.rate_bytes_per_s;
+        if (fields & kStall) {
+            target.stall_probability = settings.stall_probability;
+            target.stall_ms = settings.stall_ms;
+        }
+        if (fields & kReset) target.reset_probability = settings.reset_probability;
+        if (fields & kResetAfter) target.reset_after = settings.reset_after;
+    }
+};
+
+struct FaultProxyConfig {
+    std::string listen_host = "127.0.0.1";
+    unsigned short listen_port = 0;   // 0 = any free port (see port())
+    std::string upstream_host = "127.0.0.1";
+    unsigned short upstream_port = 0;
+    uint64_t seed = 1;
+    bool verbose = false;             // one line per closed connection
+    std::vector<FaultRule> rules;
+
+    // Parse one scenario line (see the top of this file). Returns false and
+    // sets `error` on a malformed line; blank and comment lines are fine.
+    bool parse_line(const std::string& line, std::string* error) {
+        std::string text = line.substr(0, line.find('#'));
+        std::istringstream in(text);
+        std::vector<std::string> tokens;
+        for (std::string token; in >> token;) tokens.push_back(token);
+        if (tokens.empty()) return true;
+
+        try {
+            if (tokens[0] == "listen" && tokens.size() == 2) {
+                return parse_endpoint(tokens[1], &listen_host, &listen_port, error);
+            }
+            if (tokens[0] == "upstream" && tokens.size() == 2) {
+                return parse_endpoint(tokens[1], &upstream_host, &upstream_port, error);
+            }
+            if (tokens[0] == "seed" && tokens.size() == 2) {
+                seed = std::stoull(tokens[1]);
+                return true;
+            }
+
+            FaultRule rule;
+            size_t i = 0;
+            if (tokens[i] == "at" && i + 1 < tokens.size()) {
+                rule.at_s = parse_duration_ms(tokens[i + 1]) / 1000;
+                i += 2;
+            }
+            if (i < tokens.size() && tokens[i] == "conn" && i + 1 < tokens.size()) {
+                const std::string& which = tokens[i + 1];
+                if (which[0] == '%') {
+                    rule.every = std::stoull(which.substr(1));
+                } else {
+                    rule.connection = std::stoull(which);
+                }
+                i += 2;
+            }
+            if (i >= tokens.size() || (tokens[i] != "up" && tokens[i] != "down" && tokens[i] != "both")) {
+                *error = "expected up, down or both";
+                return false;
+            }
+            rule.up = tokens[i] != "down";
+            rule.down = tokens[i] != "up";
+            for (++i; i < tokens.size(); ++i) {
+                if (!parse_setting(tokens[i], &rule, error)) return false;
+            }
+            rules.push_back(rule);
+            return true;
+        } catch (const std::exception&) {
+            *error = "bad number";
+            return false;
+        }
+    }
+
+    // Parse several lines; `;` also separates lines
+    bool parse(const std::string& text, std::string* error) {
+        std::string normalized = text;
+        std::replace(normalized.begin(), normalized.end(), ';', '\n');
+        std::istringstream in(normalized);
+        int number = 0;
+        for (std::string line; std::getline(in, line);) {
+            number++;
+            if (!parse_line(line, error)) {
+                *error = "line " + std::to_string(number) + ": " + *error + ": " + line;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // "5ms", "2s", "300us", "1.5" (ms)
+    static double parse_duration_ms(const std::string& text) {
+        size_t end = 0;
+        double value = std::stod(text, &end);
+        std::string unit = text.substr(end);
+        if (unit.empty() || unit == "ms") return value;
+        if (unit == "s") return value * 1000;
+        if (unit == "us") return value / 1000;
+        throw std::invalid_argument(text);
+    }
+
+    // "0.01" or "1%"
+    static double parse_probability(const std::string& text) {
+        double value = std::stod(text);
+        return text.back() == '%' ? value / 100 : value;
+    }
+
+    // "64k", "1m", "512"
+    static uint64_t parse_size(const std::string& text) {
+        size_t end = 0;
+        double value = std::stod(text, &end);
+        std::string unit = text.substr(end);
+        if (unit.empty() || unit == "b" || unit == "B") return static_cast<uint64_t>(value);
+        if (unit == "k" || unit == "K" || unit == "kB") return static_cast<uint64_t>(value * 1024);
+        if (unit == "m" || unit == "M" || unit == "MB") return static_cast<uint64_t>(value * 1024 * 1024);
+        throw std::invalid_argument(text);
+    }
+
+    // Bytes per second from "1mbit", "512kbit", "100kB", "1MB"
+    static double parse_rate(const std::string& text) {
+        size_t end = 0;
+        double value = std::stod(text, &end);
+        std::string unit = text.substr(end);
+        if (unit == "bit") return value / 8;
+        if (unit == "kbit") return value * 1000 / 8;
+        if (unit == "mbit") return value * 1000000 / 8;
+        if (unit == "gbit") return value * 1000000000 / 8;
+        if (unit == "B" || unit.empty()) return value;
+        if (unit == "kB") return value * 1000;
+        if (unit == "MB") return value * 1000000;
+        throw std::invalid_argument(text);
+    }
+
+private:
+    static bool parse_endpoint(const std::string& text, std::string* host, unsigned short* port,
+                               std::string* error) {
+        size_t colon = text.rfind(':');
+        std::string port_text = colon == std::string::npos ? text : text.substr(colon + 1);
+        if (colon != std::string::npos) *host = text.substr(0, colon);
+        int value = std::stoi(port_text);
+        if (value < 0 || value > 65535) {
+            *error = "bad port";
+            return false;
+        }
+        *port = static_cast<unsigned short>(value);
+        return true;
+    }
+
+    static bool parse_setting(const std::string& token, FaultRule* rule, std::string* error) {
+        FaultSettings& s = rule->settings;
+        if (token == "clear") {
+            s = FaultSettings{};
+            rule->fields = FaultRule::kAll;
+            return true;
+        }
+        size_t equals = token.find('=');
+        if (equals == std::string::npos) {
+            *error = "expected key=value, got " + token;
+            return false;
+        }
+        std::string key = token.substr(0, equals);
+        std::string value = token.substr(equals + 1);
+        auto pair = [&](double* probability, double* ms) {
+            size_t colon = value.find(':');
+            if (colon == std::string::npos) throw std::invalid_argument(value);
+            *probability = parse_probability(value.substr(0, colon));
+            *ms = parse_duration_ms(value.substr(colon + 1));
+        };
+
+        if (key == "latency") {
+            s.latency_ms = parse_duration_ms(value);
+            rule->fields |= FaultRule::kLatency;
+        } else if (key == "jitter") {
+            s.jitter_ms = parse_duration_ms(value);
+            rule->fields |= FaultRule::kJitter;
+        } else if (key == "dist") {
+            static const std::pair<const char*, LatencyDistribution> names[] = {
+                {"fixed", LatencyDistribution::Fixed}, {"uniform", LatencyDistribution::Uniform},
+                {"normal", LatencyDistribution::Normal}, {"exponential", LatencyDistribution::Exponential},
+                {"pareto", LatencyDistribution::Pareto}};
+            auto it = std::find_if(std::begin(names), std::end(names),
+                                   [&](const auto& name) { return value == name.first; });
+            if (it == std::end(names)) {
+                *error = "unknown distribution " + value;
+                return false;
+            }
+            s.distribution = it->second;
+            rule->fields |= FaultRule::kDistribution;
+        } else if (key == "spike") {
+            pair(&s.spike_probability, &s.spike_ms);
+            rule->fields |= FaultRule::kSpike;
+        } else if (key == "rate") {
+            s.rate_bytes_per_s = parse_rate(value);
+            rule->fields |= FaultRule::kRate;
+        } else if (key == "stall") {
+            pair(&s.stall_probability, &s.stall_ms);
+            rule->fields |= FaultRule::kStall;
+        } else if (key == "reset") {
+            s.reset_probability = parse_probability(value);
+            rule->fields |= FaultRule::kReset;
+        } else if (key == "reset_after") {
+            s.reset_after = parse_size(value);
+            rule->fields |= FaultRule::kResetAfter;
+        } else {
+            *error = "unknown key " + key;
+            return false;
+        }
+        return true;
+    }
+};
+
+struct FaultProxyStats {
+    uint64_t connections = 0;
+    uint64_t bytes_up = 0;
+    uint64_t bytes_down = 0;
+    uint64_t spikes = 0;
+    uint64_t stalls = 0;
+    uint64_t resets = 0;
+};
+
+class FaultProxy {
+private:
+    using tcp = boost::asio::ip::tcp;
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kChunkBytes = 16 * 1024;
+    static constexpr size_t kQueueBytes = 256 * 1024;   // per direction
+
+    struct Chunk {
+        enum Kind { Data, End, Reset } kind = Data;
+        std::string data;
+        Clock::time_point release;
+    };
+
+    // One direction of a connection: chunks from the reader to the writer
+    struct Pipe {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<Chunk> queue;
+        size_t queued_bytes = 0;
+        bool closed = false;      // the link was reset; both threads leave
+        std::atomic<uint64_t> bytes{0};   // written by the reader, logged by the writer
+        Clock::time_point last_release{};
+    };
+
+    struct Link {
+        uint64_t id;
+        tcp::socket client;
+        tcp::socket upstream;
+        Pipe up;
+        Pipe down;
+        std::atomic<bool> reset{false};
+        std::atomic<uint64_t> stalls{0};
+
+        Link(uint64_t link_id, tcp::socket client_socket, tcp::socket upstream_socket)
+            : id(link_id)
+            , client(std::move(client_socket))
+            , upstream(std::move(upstream_socket))
+        {
+        }
+    };
+
+    FaultProxyConfig config_;
+    boost::asio::io_context ioc_;
+    tcp::acceptor acceptor_;
+    std::thread accept_thread_;
+    Clock::time_point started_;
+    std::atomic<bool> stopping_{false};
+
+    std::mutex links_mutex_;
+    std::list<std::weak_ptr<Link>> links_;
+    std::condition_variable threads_done_;
+    size_t threads_ = 0;
+
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> bytes_up_{0};
+    std::atomic<uint64_t> bytes_down_{0};
+    std::atomic<uint64_t> spikes_{0};
+    std::atomic<uint64_t> stalls_{0};
+    std::atomic<uint64_t> resets_{0};
+
+public:
+    // Binds the listening socket; throws std::runtime_error if it can't
+    explicit FaultProxy(FaultProxyConfig config) : config_(std::move(config)), acceptor_(ioc_) {
+        boost::system::error_code ec;
+        tcp::endpoint endpoint(boost::asio::ip::make_address(config_.listen_host, ec), config_.listen_port);
+        if (!ec) acceptor_.open(endpoint.protocol(), ec);
+        if (!ec) acceptor_.set_option(tcp::acceptor::reuse_address(true), ec);
+        if (!ec) acceptor_.bind(endpoint, ec);
+        if (!ec) acceptor_.listen(tcp::acceptor::max_listen_connections, ec);
+        if (ec) {
+            throw std::runtime_error("Cannot listen on " + config_.listen_host + ":" +
+                                     std::to_string(config_.listen_port) + ": " + ec.message());
+        }
+    }
+
+    ~FaultProxy() {
+        stop();
+    }
+
+    FaultProxy(const FaultProxy&) = delete;
+    FaultProxy& operator=(const FaultProxy&) = delete;
+
+    unsigned short port() const { return acceptor_.local_endpoint().port(); }
+
+    // Accept connections on a background thread. Timed rules count from here.
+    void start() {
+        started_ = Clock::now();
+        accept_thread_ = std::thread([this] { accept_loop(); });
+    }
+
+    // Stop accepting, reset every open connection, and wait for its threads
+    void stop() {
+        if (stopping_.exchange(true) || !accept_thread_.joinable()) return;
+
+        // A blocking accept() isn't interrupted by close(); connect to wake it
+        {
+            boost::system::error_code ec;
+            tcp::socket wake(ioc_);
+            wake.connect({acceptor_.local_endpoint().address(), port()}, ec);
+        }
+        accept_thread_.join();
+
+        std::unique_lock<std::mutex> lock(links_mutex_);
+        for (auto& weak : links_) {
+            if (auto link = weak.lock()) {
+                abort(*link);
+            }
+        }
+        threads_done_.wait(lock, [&] { return threads_ == 0; });
+    }
+
+    FaultProxyStats stats() const {
+        FaultProxyStats s;
+        s.connections = connections_.load();
+        s.bytes_up = bytes_up_.load();
+        s.bytes_down = bytes_down_.load();
+        s.spikes = spikes_.load();
+        s.stalls = stalls_.load();
+        s.resets = resets_.load();
+        return s;
+    }
+
+    // Effective settings for one direction of connection `id` right now
+    FaultSettings settings_for(uint64_t id, bool upstream) const {
+        double elapsed = std::chrono::duration<double>(Clock::now() - started_).count();
+        FaultSettings settings;
+        for (const auto& rule : config_.rules) {
+            if (rule.applies(id, upstream, elapsed)) rule.apply(settings);
+        }
+        return settings;
+    }
+
+private:
+    void accept_loop() {
+        while (!stopping_) {
+            tcp::socket client(ioc_);
+            boost::system::error_code ec;
+            acceptor_.accept(client, ec);
+            if (stopping_) break;
+            if (ec) continue;
+
+            tcp::socket upstream(ioc_);
+            tcp::resolver resolver(ioc_);
+            auto endpoints = resolver.resolve(config_.upstream_host, std::to_string(config_.upstream_port), ec);
+            if (!ec) boost::asio::connect(upstream, endpoints, ec);
+            if (ec) {
+                std::cerr << "✗ Proxy cannot reach " << config_.upstream_host << ":" << config_.upstream_port
+                          << ": " << ec.message() << std::endl;
+                continue;   // closing `client` refuses the connection
+            }
+            client.set_option(tcp::no_delay(true), ec);
+            upstream.set_option(tcp::no_delay(true), ec);
+
+            auto link = std::make_shared<Link>(++connections_, std::move(client), std::move(upstream));
+            std::lock_guard<std::mutex> lock(links_mutex_);
+            links_.remove_if([](const std::weak_ptr<Link>& weak) { return weak.expired(); });
+            links_.push_back(link);
+            threads_ += 4;
+            spawn(link, true, true);
+            spawn(link, false, true);
+            spawn(link, true, false);
+            spawn(link, false, false);
+        }
+    }
+
+    void spawn(std::shared_ptr<Link> link, bool upstream, bool reader) {
+        std::thread([this, link = std::move(link), upstream, reader]() mutable {
+            if (reader) {
+                read_loop(*link, upstream);
+            } else {
+                write_loop(*link, upstream);
+            }
+            // The last thread out closes the sockets, before stop() can
+            // return and take the io_context with it
+            link.reset();
+            std::lock_guard<std::mutex> lock(links_mutex_);
+            if (--threads_ == 0) threads_done_.notify_all();
+        }).detach();
+    }
+
+    // Reset the connection: linger 0 makes the final close send RST, and
+    // shutting down the receive side wakes both blocked readers
+    void abort(Link& link) {
+        if (link.reset.exchange(true)) return;
+        boost::system::error_code ec;
+        for (tcp::socket* socket : {&link.client, &link.upstream}) {
+            socket->set_option(boost::asio::socket_base::linger(true, 0), ec);
+            socket->shutdown(tcp::socket::shutdown_receive, ec);
+        }
+        for (Pipe* pipe : {&link.up, &link.down}) {
+            std::lock_guard<std::mutex> lock(pipe->mutex);
+            pipe->closed = true;
+            pipe->changed.notify_all();
+        }
+    }
+
+    void push(Pipe& pipe, Chunk chunk) {
+        std::unique_lock<std::mutex> lock(pipe.mutex);
+        pipe.changed.wait(lock, [&] { return pipe.queued_bytes < kQueueBytes || pipe.closed; });
+        if (pipe.closed) return;
+        pipe.queued_bytes += chunk.data.size();
+        pipe.queue.push_back(std::move(chunk));
+        pipe.changed.notify_all();
+    }
+
+    void read_loop(Link& link, bool upstream) {
+        tcp::socket& from = upstream ? link.client : link.upstream;
+        Pipe& pipe = upstream ? link.up : link.down;
+        std::mt19937_64 random(mix(config_.seed, link.id * 2 + (upstream ? 0 : 1)));
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::string buffer(kChunkBytes, '\0');
+
+        while (!link.reset) {
+            boost::system::error_code ec;
+            size_t n = from.read_some(boost::asio::buffer(buffer), ec);
+            if (link.reset) return;
+            if (ec) {
+                // EOF is a half-close to pass on; anything else resets the link
+                if (ec == boost::asio::error::eof) {
+                    push(pipe, Chunk{Chunk::End, {}, Clock::now()});
+                } else {
+                    abort(link);
+                }
+                return;
+            }
+
+            Clock::time_point now = Clock::now();
+            FaultSettings faults = settings_for(link.id, upstream);
+            (upstream ? bytes_up_ : bytes_down_) += n;
+
+            Chunk chunk{Chunk::Data, buffer.substr(0, n), now};
+            bool reset = faults.reset_probability > 0 && uniform(random) < faults.reset_probability;
+            if (reset) {
+                chunk.data.resize(n / 2);   // cut mid-message, so the peer can't take it for a clean close
+            }
+            uint64_t passed = pipe.bytes.fetch_add(n);
+            if (faults.reset_after > 0 && passed + n >= faults.reset_after) {
+                chunk.data.resize(static_cast<size_t>(faults.reset_after - std::min(passed, faults.reset_after)));
+                reset = true;
+            }
+
+            double delay_ms = sample_delay_ms(faults, random, uniform);
+            if (faults.spike_probability > 0 && uniform(random) < faults.spike_probability) {
+                delay_ms += faults.spike_ms;
+                spikes_++;
+            }
+            if (faults.stall_probability > 0 && uniform(random) < faults.stall_probability) {
+                delay_ms += faults.stall_ms;
+                stalls_++;
+                link.stalls++;
+            }
+            chunk.release = std::max(pipe.last_release,
+                                     now + std::chrono::microseconds(static_cast<int64_t>(delay_ms * 1000)));
+            pipe.last_release = chunk.release;
+
+            Clock::time_point release = chunk.release;
+            if (!chunk.data.empty()) push(pipe, std::move(chunk));
+            if (reset) {
+                push(pipe, Chunk{Chunk::Reset, {}, release});
+                return;
+            }
+        }
+    }
+
+    void write_loop(Link& link, bool upstream) {
+        tcp::socket& to = upstream ? link.upstream : link.client;
+        Pipe& pipe = upstream ? link.up : link.down;
+        Clock::time_point next_send = Clock::now();
+
+        while (true) {
+            Chunk chunk;
+            {
+                std::unique_lock<std::mutex> lock(pipe.mutex);
+                pipe.changed.wait(lock, [&] { return !pipe.queue.empty() || pipe.closed; });
+                if (pipe.closed) return;
+                chunk = std::move(pipe.queue.front());
+                pipe.queue.pop_front();
+                pipe.queued_bytes -= chunk.data.size();
+                pipe.changed.notify_all();
+
+                // Wait for the release time; a reset cuts the wait short
+                pipe.changed.wait_until(lock, chunk.release, [&] { return pipe.closed; });
+                if (pipe.closed) return;
+            }
+
+            if (chunk.kind == Chunk::End) {
+                boost::system::error_code ec;
+                to.shutdown(tcp::socket::shutdown_send, ec);
+                finish(link, upstream);
+                return;
+            }
+            if (chunk.kind == Chunk::Reset) {
+                resets_++;
+                abort(link);
+                finish(link, upstream);
+                return;
+            }
+
+            // Rate cap: send in slices of about 10 ms worth of bytes
+            double rate = settings_for(link.id, upstream).rate_bytes_per_s;
+            size_t slice = rate > 0 ? std::max<size_t>(512, static_cast<size_t>(rate / 100)) : chunk.data.size();
+            for (size_t offset = 0; offset < chunk.data.size(); offset += slice) {
+                size_t n = std::min(slice, chunk.data.size() - offset);
+                if (rate > 0) {
+                    next_send = std::max(next_send, Clock::now());
+                    std::this_thread::sleep_until(next_send);
+                    next_send += std::chrono::microseconds(static_cast<int64_t>(n / rate * 1e6));
+                }
+                boost::system::error_code ec;
+                boost::asio::write(to, boost::asio::buffer(chunk.data.data() + offset, n), ec);
+                if (ec || link.reset) {
+                    abort(link);
+                    return;
+                }
+            }
+        }
+    }
+
+    // Log a connection once its last direction is done
+    void finish(Link& link, bool upstream) {
+        if (!config_.verbose) return;
+        static std::mutex log_mutex;
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::cerr << "  conn " << link.id << (upstream ? " up" : " down") << " done: "
+                  << (upstream ? link.up.bytes : link.down.bytes).load() << " B"
+                  << (link.reset ? ", reset" : "") << (link.stalls ? ", " + std::to_string(link.stalls) + " stalls" : "")
+                  << std::endl;
+    }
+
+    static uint64_t mix(uint64_t seed, uint64_t stream) {
+        uint64_t x = seed ^ (stream * 0x9e3779b97f4a7c15ULL);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    static double sample_delay_ms(const FaultSettings& f, std::mt19937_64& random,
+                                  std::uniform_real_distribution<double>& uniform) {
+        double delay = f.latency_ms;
+        if (f.jitter_ms > 0) {
+            switch (f.distribution) {
+                case LatencyDistribution::Fixed:
+                    break;
+                case LatencyDistribution::Uniform:
+                    delay += (uniform(random) * 2 - 1) * f.jitter_ms;
+                    break;
+                case LatencyDistribution::Normal:
+                    delay += std::normal_distribution<double>(0, f.jitter_ms)(random);
+                    break;
+                case LatencyDistribution::Exponential:
+                    delay += std::exponential_distribution<double>(1 / f.jitter_ms)(random);
+                    break;
+                case LatencyDistribution::Pareto:
+                    // alpha 2, scaled so the mean extra delay is jitter
+                    delay += f.jitter_ms * (1 / std::sqrt(1 - uniform(random)) - 1);
+                    break;
+            }
+        }
+        return std::max(0.0, delay);
+    }
+};
@@ -0,0 +1,329 @@
+/*
+ * Benchmark: client tail latency under injected network faults
+ *
+ * Runs the same workload against the gateway through an in-process
+ * FaultProxy (fault_proxy.h), once per scenario:
+ *
+ *   baseline   no faults (the proxy hop alone)
+ *   latency    2 ms each way
+ *   jitter     2 ms each way, normal jitter 1 ms
+ *   pareto     1 ms + heavy-tailed (pareto) extra delay on responses
+ *   spikes     2% of responses delayed by 50 ms
+ *   bandwidth  1 mbit/s each way
+ *   stalls     1% of responses stalled for 200 ms
+ *   resets     1% of responses cut by a connection reset
+ *
+ * --threads threads each make --requests calls on their own HttpClient:
+ * publishes with ack (--op publish), or fetches of the last --limit
+ * messages (--op fetch). The table shows how p50, p99, p99.9 and max
+ * degrade from the baseline. It also shows the calls that failed after
+ * --retries immediate retries.
+ *
+ * --hedge MS (fetch only) sends a second copy of a fetch that hasn't
+ * answered after MS on a spare connection, and takes whichever answers
+ * first. Comparing runs with and without it shows how much hedging buys
+ * back in each scenario.
+ *
+ * Add scenarios with --scenario 'name=RULES' (rule lines separated by ';',
+ * syntax in fault_proxy.h), or pick built-in ones by name. --json writes
+ * the results for bench_compare (bench_report.h).
+ *
+ * Requirements:
+ *   - Boost.Asio, libcurl, Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 fault_scenario_bench.cpp message.pb.cc \
+ *       -lprotobuf -lcurl -lboost_system -pthread -o fault_scenario_bench
+ *
+ * Usage:
+ *   ./fault_scenario_bench [base_url] [--threads 4] [--requests 200] [--op publish|fetch]
+ *                          [--payload 512] [--limit 20] [--retries 0] [--hedge MS]
+ *                          [--scenario NAME|'name=RULES']... [--json FILE]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "bench_report.h"
+#include "fault_proxy.h"
+#include "http_client.h"
+#include "message.pb.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Scenario {
+    std::string name;
+    std::string rules;
+};
+
+static const std::vector<Scenario> kScenarios = {
+    {"baseline", ""},
+    {"latency", "both latency=2ms"},
+    {"jitter", "both latency=2ms jitter=1ms dist=normal"},
+    {"pareto", "down latency=1ms jitter=2ms dist=pareto"},
+    {"spikes", "down spike=2%:50ms"},
+    {"bandwidth", "both rate=1mbit"},
+    {"stalls", "down stall=1%:200ms"},
+    {"resets", "down reset=1%"},
+};
+
+struct Options {
+    int threads = 4;
+    int requests = 200;
+    bool fetch = false;
+    size_t payload = 512;
+    int limit = 20;
+    int retries = 0;
+    int hedge_ms = 0;
+};
+
+struct Result {
+    uint64_t calls = 0;
+    uint64_t failed = 0;
+    uint64_t retried = 0;
+    uint64_t hedged = 0;
+    double seconds = 0;
+    std::vector<double> latencies_ms;
+    FaultProxyStats proxy;
+};
+
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()))];
+}
+
+static Result run(const Scenario& scenario, const std::string& upstream_host, unsigned short upstream_port,
+                  const Options& options) {
+    FaultProxyConfig config;
+    config.upstream_host = upstream_host;
+    config.upstream_port = upstream_port;
+    std::string error;
+    if (!config.parse(scenario.rules, &error)) {
+        throw std::runtime_error("scenario " + scenario.name + ": " + error);
+    }
+    FaultProxy proxy(config);
+    proxy.start();
+    std::string url = "http://127.0.0.1:" + std::to_string(proxy.port());
+
+    nats::messages::PublishMessage message;
+    message.set_source("fault-scenario-bench");
+    message.set_data(std::string(options.payload, 'x'));
+
+    std::vector<std::vector<double>> latencies(options.threads);
+    std::vector<uint64_t> failed(options.threads, 0);
+    std::vector<uint64_t> retried(options.threads, 0);
+    std::vector<uint64_t> hedged(options.threads, 0);
+
+    std::vector<std::unique_ptr<HttpClient>> clients;
+    std::vector<std::unique_ptr<HttpClient>> spares;
+    for (int t = 0; t < options.threads; ++t) {
+        clients.push_back(std::make_unique<HttpClient>(url));
+        if (options.hedge_ms > 0) spares.push_back(std::make_unique<HttpClient>(url));
+    }
+
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < options.threads; ++t) {
+        workers.emplace_back([&, t] {
+            HttpClient& client = *clients[t];
+            HttpClient* spare = options.hedge_ms > 0 ? spares[t].get() : nullptr;
+            std::string subject = "bench.faults." + std::to_string(t);
+
+            auto call = [&](HttpClient& c) {
+                if (!options.fetch) {
+                    nats::messages::PublishAck ack;
+                    return c.publish(subject, message, &ack);
+                }
+                nats::messages::FetchResponse response;
+                return c.fetch("bench.faults.seed", options.limit, &response);
+            };
+
+            // First answer of the primary and, after hedge_ms, a second copy.
+            // Both finish before the next call: curl can't abandon a request.
+            auto hedged_call = [&]() {
+                auto primary = std::async(std::launch::async, [&] { return call(client); });
+                if (primary.wait_for(std::chrono::milliseconds(options.hedge_ms)) == std::future_status::ready) {
+                    return std::make_pair(primary.get(), Clock::now());
+                }
+                hedged[t]++;
+                auto backup = std::async(std::launch::async, [&] { return call(*spare); });
+                while (true) {
+                    if (primary.wait_for(std::chrono::microseconds(100)) == std::future_status::ready) {
+                        auto done = Clock::now();
+                        bool ok = primary.get();
+                        if (ok) {
+                            backup.wait();
+                        } else {
+                            ok = backup.get();
+                            done = Clock::now();
+                        }
+                        return std::make_pair(ok, done);
+                    }
+                    if (backup.wait_for(std::chrono::microseconds(0)) == std::future_status::ready) {
+                        auto done = Clock::now();
+                        bool ok = backup.get();
+                        if (ok) {
+                            primary.wait();
+                        } else {
+                            ok = primary.get();
+                            done = Clock::now();
+                        }
+                        return std::make_pair(ok, done);
+                    }
+                }
+            };
+
+            for (int i = 0; i < options.requests; ++i) {
+                auto begin = Clock::now();
+                bool ok = false;
+                Clock::time_point done;
+                for (int attempt = 0; attempt <= options.retries && !ok; ++attempt) {
+                    if (attempt > 0) retried[t]++;
+                    if (options.hedge_ms > 0) {
+                        std::tie(ok, done) = hedged_call();
+                    } else {
+                        ok = call(client);
+                        done = Clock::now();
+                    }
+                }
+                if (!ok) failed[t]++;
+                latencies[t].push_back(std::chrono::duration<double, std::milli>(done - begin).count());
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    clients.clear();
+    spares.clear();
+
+    Result result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (int t = 0; t < options.threads; ++t) {
+        result.latencies_ms.insert(result.latencies_ms.end(), latencies[t].begin(), latencies[t].end());
+        result.failed += failed[t];
+        result.retried += retried[t];
+        result.hedged += hedged[t];
+    }
+    std::sort(result.latencies_ms.begin(), result.latencies_ms.end());
+    result.calls = result.latencies_ms.size();
+    proxy.stop();
+    result.proxy = proxy.stats();
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string base_url = "http://localhost:8080";
+    Options options;
+    std::vector<Scenario> scenarios;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            options.threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--requests" && i + 1 < argc) {
+            options.requests = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--op" && i + 1 < argc) {
+            options.fetch = std::string(argv[++i]) == "fetch";
+        } else if (arg == "--payload" && i + 1 < argc) {
+            options.payload = std::stoul(argv[++i]);
+        } else if (arg == "--limit" && i + 1 < argc) {
+            options.limit = std::stoi(argv[++i]);
+        } else if (arg == "--retries" && i + 1 < argc) {
+            options.retries = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--hedge" && i + 1 < argc) {
+            options.hedge_ms = std::stoi(argv[++i]);
+        } else if (arg == "--scenario" && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t equals = spec.find('=');
+            if (equals != std::string::npos) {
+                scenarios.push_back({spec.substr(0, equals), spec.substr(equals + 1)});
+                continue;
+            }
+            auto it = std::find_if(kScenarios.begin(), kScenarios.end(),
+                                   [&](const Scenario& s) { return s.name == spec; });
+            if (it == kScenarios.end()) {
+                std::cerr << "✗ Unknown scenario " << spec << std::endl;
+                return 1;
+            }
+            scenarios.push_back(*it);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            base_url = arg;
+        }
+    }
+    if (scenarios.empty()) scenarios = kScenarios;
+    if (options.hedge_ms > 0 && !options.fetch) {
+        std::cerr << "✗ --hedge needs --op fetch (a hedged publish would publish twice)" << std::endl;
+        return 1;
+    }
+
+    // http://host:port -> host, port
+    std::string authority = base_url.substr(base_url.find("://") == std::string::npos ? 0 : base_url.find("://") + 3);
+    authority = authority.substr(0, authority.find('/'));
+    size_t colon = authority.rfind(':');
+    std::string host = authority.substr(0, colon);
+    unsigned short port = colon == std::string::npos ? 80 : static_cast<unsigned short>(std::stoi(authority.substr(colon + 1)));
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        if (options.fetch) {
+            HttpClient seeder(base_url);
+            nats::messages::PublishMessage message;
+            message.set_source("fault-scenario-bench");
+            message.set_data(std::string(options.payload, 'x'));
+            for (int i = 0; i < options.limit; ++i) {
+                if (!seeder.publish("bench.faults.seed", message)) {
+                    return 1;
+                }
+            }
+        }
+
+        std::cout << options.threads << " threads x " << options.requests << " "
+                  << (options.fetch ? "fetches of " + std::to_string(options.limit) : std::string("publishes"))
+                  << ", " << options.payload << " B payloads, " << options.retries << " retries"
+                  << (options.hedge_ms > 0 ? ", hedge after " + std::to_string(options.hedge_ms) + " ms" : "")
+                  << std::endl << std::endl;
+        std::cout << std::left << std::setw(11) << "scenario" << std::right << std::setw(9) << "calls/s"
+                  << std::setw(9) << "p50 ms" << std::setw(9) << "p99 ms" << std::setw(10) << "p99.9 ms"
+                  << std::setw(9) << "max ms" << std::setw(8) << "failed" << std::setw(9) << "retried"
+                  << std::setw(8) << "hedged" << "  injected" << std::endl;
+
+        BenchReport report(argc, argv);
+        for (const auto& scenario : scenarios) {
+            Result r = run(scenario, host, port, options);
+            const auto& l = r.latencies_ms;
+            std::cout << std::left << std::setw(11) << scenario.name << std::right << std::fixed
+                      << std::setprecision(0) << std::setw(9) << r.calls / r.seconds << std::setprecision(2)
+                      << std::setw(9) << percentile(l, 0.50) << std::setw(9) << percentile(l, 0.99)
+                      << std::setw(10) << percentile(l, 0.999) << std::setw(9) << (l.empty() ? 0 : l.back())
+                      << std::setw(8) << r.failed << std::setw(9) << r.retried << std::setw(8) << r.hedged
+                      << "  " << r.proxy.spikes << " spikes, " << r.proxy.stalls << " stalls, " << r.proxy.resets
+                      << " resets, " << r.proxy.connections << " conns" << std::endl;
+
+            report.metric(scenario.name, "calls_per_s", r.calls / r.seconds, Better::Higher);
+            report.metric(scenario.name, "failed", static_cast<double>(r.failed), Better::Lower);
+            report.samples(scenario.name, "latency_ms", r.latencies_ms, Better::Lower);
+        }
+        if (!report.write(json_path)) {
+            return 1;
+        }
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * Single-flight fetch coalescing
+ *
+ * When many threads miss a cache at the same moment, they all fetch the same
+ * subject and limit. Each call is a gateway round trip, and the gateway
+ * creates an ephemeral consumer for it. FetchCoalescer lets identical
+ * concurrent fetches share one request. The first caller for a
+ * (subject, limit) pair performs the fetch. Callers that arrive while it is
+ * in flight wait for it and receive the same parsed FetchResponse. The
+ * response is shared immutably, so nothing is copied.
+ *
+ * Only in-flight requests are shared. A call that starts after a fetch has
+ * completed performs a new one, so results are never older than the call.
+ * This is not a cache.
+ *
+ * Fetches go through a pool of HttpClients (one per concurrent distinct
+ * fetch), or through any function passed to the constructor.
+ *
+ * Requirements:
+ *   - libcurl, Protobuf (via http_client.h)
+ *   - pthread
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "http_client.h"
+#include "message.pb.h"
+
+struct CoalescingStats {
+    uint64_t requests = 0;    // fetch() calls
+    uint64_t fetches = 0;     // requests that reached the gateway
+    uint64_t coalesced = 0;   // calls served by another caller's fetch
+    uint64_t failed = 0;      // calls that got no response (either kind)
+    uint64_t max_shared = 0;  // most callers served by one fetch
+
+    // Fraction of calls that didn't reach the gateway
+    double coalescing_ratio() const {
+        return requests ? static_cast<double>(coalesced) / static_cast<double>(requests) : 0.0;
+    }
+};
+
+class FetchCoalescer {
+public:
+    using Response = std::shared_ptr<const nats::messages::FetchResponse>;
+    using FetchFunction =
+        std::function<bool(const std::string& subject, int limit, nats::messages::FetchResponse* response)>;
+
+private:
+    struct Flight {
+        std::shared_future<Response> result;
+        uint64_t callers = 1;
+    };
+
+    FetchFunction fetch_;
+    std::string base_url_;
+    std::mutex clients_mutex_;
+    std::vector<std::unique_ptr<HttpClient>> idle_clients_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Flight>> in_flight_;
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> fetches_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> failed_{0};
+    std::atomic<uint64_t> max_shared_{0};
+
+public:
+    // Fetch through the gateway at `base_url`
+    explicit FetchCoalescer(const std::string& base_url) : base_url_(base_url) {
+        fetch_ = [this](const std::string& subject, int limit, nats::messages::FetchResponse* response) {
+            return fetch_with_pooled_client(subject, limit, response);
+        };
+    }
+
+    // Fetch through `fetch`, which must be safe to call from several threads
+    explicit FetchCoalescer(FetchFunction fetch) : fetch_(std::move(fetch)) {}
+
+    FetchCoalescer(const FetchCoalescer&) = delete;
+    FetchCoalescer& operator=(const FetchCoalescer&) = delete;
+
+    // The last `limit` messages on `subject`; `response` is shared with any
+    // concurrent callers asking for the same thing. False (and reported
+    // once, by the fetching caller) on failure.
+    bool fetch(const std::string& subject, int limit, Response* response) {
+        requests_++;
+        std::string key = subject;
+        key.push_back('\0');
+        key += std::to_string(limit);
+
+        std::shared_ptr<Flight> flight;
+        std::promise<Response> promise;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = in_flight_.find(key);
+            if (it != in_flight_.end()) {
+                flight = it->second;
+                flight->callers++;
+            } else {
+                flight = std::make_shared<Flight>();
+                flight->result = promise.get_future().share();
+                in_flight_.emplace(key, flight);
+                leader = true;
+            }
+        }
+
+        if (!leader) {
+            coalesced_++;
+            *response = flight->result.get();
+            if (!*response) failed_++;
+            return *response != nullptr;
+        }
+
+        // Answers the waiting callers on every way out of this call, so an
+        // exception can neither leave them with a broken promise nor leave
+        // the key in the table
+        struct Landing {
+            FetchCoalescer* owner;
+            const std::string& key;
+            Flight& flight;
+            std::promise<Response>& promise;
+            uint64_t callers = 0;
+            bool landed = false;
+
+            // Leave the table before answering: later callers start a new fetch
+            void land(Response result) {
+                {
+                    std::lock_guard<std::mutex> lock(owner->mutex_);
+                    owner->in_flight_.erase(key);
+                    callers = flight.callers;
+                }
+                landed = true;
+                promise.set_value(std::move(result));
+            }
+
+            ~Landing() {
+                if (!landed) land(nullptr);
+            }
+        } landing{this, key, *flight, promise};
+
+        fetches_++;
+        Response result;
+        try {
+            auto fetched = std::make_shared<nats::messages::FetchResponse>();
+            if (fetch_(subject, limit, fetched.get())) {
+                result = std::move(fetched);
+            }
+        } catch (std::exception const& e) {
+            std::cerr << "✗ Fetch for " << subject << " failed: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "✗ Fetch for " << subject << " failed: unknown exception" << std::endl;
+        }
+        bool ok = result != nullptr;
+        landing.land(result);
+        uint64_t callers = landing.callers;
+
+        uint64_t max = max_shared_.load();
+        while (callers > max && !max_shared_.compare_exchange_weak(max, callers)) {
+        }
+        if (!result) failed_++;
+        *response = std::move(result);
+        return ok;
+    }
+
+    // Same as HttpClient::fetch(), with a copy of the shared response
+    bool fetch(const std::string& subject, int limit, nats::messages::FetchResponse* response) {
+        Response shared;
+        if (!fetch(subject, limit, &shared)) {
+            return false;
+        }
+        *response = *shared;
+        return true;
+    }
+
+    CoalescingStats stats() const {
+        CoalescingStats stats;
+        stats.requests = requests_.load();
+        stats.fetches = fetches_.load();
+        stats.coalesced = coalesced_.load();
+        stats.failed = failed_.load();
+        stats.max_shared = max_shared_.load();
+        return stats;
+    }
+
+private:
+    bool fetch_with_pooled_client(const std::string& subject, int limit, nats::messages::FetchResponse* response) {
+        std::unique_ptr<HttpClient> client;
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex_);
+            if (!idle_clients_.empty()) {
+                client = std::move(idle_clients_.back());
+                idle_clients_.pop_back();
+            } else {
+                client = std::make_unique<HttpClient>(base_url_);
+            }
+        }
+        bool ok = client->fetch(subject, limit, response);
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        idle_clients_.push_back(std::move(client));
+        return ok;
+    }
+};
@@ -0,0 +1,218 @@
+/*
+ * Benchmark: cache-miss storms with and without fetch coalescing
+ *
+ * --threads threads repeatedly fetch the last --limit messages of one of
+ * --subjects hot subjects. Every round starts all threads at once, the way
+ * a cache expiry does. The storm runs twice:
+ *
+ *   direct     every thread has its own HttpClient and calls fetch()
+ *   coalesced  all threads share a FetchCoalescer (fetch_coalescer.h)
+ *
+ * Reports gateway requests, the coalescing ratio, calls/s and call latency.
+ * Against mock_gateway, start it with --fetch-delay-ms to model the
+ * gateway's per-fetch consumer setup. --json writes the results for
+ * bench_compare (bench_report.h).
+ *
+ * Requirements:
+ *   - libcurl, Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 fetch_coalescing_bench.cpp message.pb.cc \
+ *       -lprotobuf -lcurl -pthread -o fetch_coalescing_bench
+ *
+ * Usage:
+ *   ./fetch_coalescing_bench [base_url] [--threads 32] [--subjects 4]
+ *                            [--rounds 50] [--limit 50] [--json FILE]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_report.h"
+#include "fetch_coalescer.h"
+#include "http_client.h"
+#include "message.pb.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Releases all threads at once, `rounds` times
+class StartGate {
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int waiting_ = 0;
+    int parties_;
+    uint64_t generation_ = 0;
+
+public:
+    explicit StartGate(int parties) : parties_(parties) {}
+
+    void arrive() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t generation = generation_;
+        if (++waiting_ == parties_) {
+            waiting_ = 0;
+            generation_++;
+            cv_.notify_all();
+            return;
+        }
+        cv_.wait(lock, [&] { return generation_ != generation; });
+    }
+};
+
+struct Result {
+    uint64_t calls = 0;
+    uint64_t gateway_requests = 0;
+    uint64_t failed = 0;
+    double seconds = 0;
+    double p50_ms = 0;
+    double p99_ms = 0;
+    std::vector<double> latencies_ms;
+};
+
+template <typename Fetch>
+static Result storm(int threads, int rounds, int subjects, Fetch&& fetch) {
+    StartGate gate(threads);
+    std::vector<std::vector<double>> latencies(threads);
+    std::vector<uint64_t> failed(threads, 0);
+
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int round = 0; round < rounds; ++round) {
+                gate.arrive();
+                std::string subject = "bench.hot." + std::to_string((t + round) % subjects);
+                auto begin = Clock::now();
+                if (!fetch(t, subject)) failed[t]++;
+                latencies[t].push_back(std::chrono::duration<double, std::milli>(Clock::now() - begin).count());
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    Result result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::vector<double> all;
+    for (int t = 0; t < threads; ++t) {
+        all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+        result.failed += failed[t];
+    }
+    std::sort(all.begin(), all.end());
+    result.calls = all.size();
+    result.p50_ms = all[all.size() / 2];
+    result.p99_ms = all[all.size() * 99 / 100];
+    result.latencies_ms = std::move(all);
+    return result;
+}
+
+static void record(BenchReport& report, const char* name, const Result& r) {
+    report.metric(name, "calls_per_s", r.calls / r.seconds, Better::Higher);
+    report.metric(name, "gateway_requests", static_cast<double>(r.gateway_requests), Better::Lower);
+    report.metric(name, "failed", static_cast<double>(r.failed), Better::Lower);
+    report.samples(name, "latency_ms", r.latencies_ms, Better::Lower);
+}
+
+static void print_row(const char* name, const Result& r) {
+    std::cout << std::left << std::setw(11) << name << std::right << std::setw(8) << r.calls << std::setw(12)
+              << r.gateway_requests << std::fixed << std::setprecision(1) << std::setw(10)
+              << 100.0 * (1.0 - static_cast<double>(r.gateway_requests) / r.calls) << "%" << std::setprecision(0)
+              << std::setw(10) << r.calls / r.seconds << std::setprecision(2) << std::setw(10) << r.p50_ms
+              << std::setw(10) << r.p99_ms << std::setw(8) << r.failed << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string base_url = "http://localhost:8080";
+    int threads = 32;
+    int subjects = 4;
+    int rounds = 50;
+    int limit = 50;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--subjects" && i + 1 < argc) {
+            subjects = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--limit" && i + 1 < argc) {
+            limit = std::stoi(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            base_url = arg;
+        }
+    }
+
+    try {
+        // Something to fetch
+        HttpClient seeder(base_url);
+        nats::messages::PublishMessage message;
+        message.set_source("fetch-coalescing-bench");
+        message.set_data(std::string(200, 'x'));
+        for (int s = 0; s < subjects; ++s) {
+            std::string subject = "bench.hot." + std::to_string(s);
+            for (int i = 0; i < limit; ++i) {
+                if (!seeder.publish(subject, message)) {
+                    return 1;
+                }
+            }
+        }
+
+        std::cout << threads << " threads, " << subjects << " hot subjects, " << rounds << " rounds, limit "
+                  << limit << std::endl << std::endl;
+        std::cout << std::left << std::setw(11) << "mode" << std::right << std::setw(8) << "calls" << std::setw(12)
+                  << "requests" << std::setw(11) << "coalesced" << std::setw(10) << "calls/s" << std::setw(10)
+                  << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(8) << "failed" << std::endl;
+
+        std::vector<std::unique_ptr<HttpClient>> clients;
+        for (int t = 0; t < threads; ++t) clients.push_back(std::make_unique<HttpClient>(base_url));
+        Result direct = storm(threads, rounds, subjects, [&](int t, const std::string& subject) {
+            nats::messages::FetchResponse response;
+            return clients[t]->fetch(subject, limit, &response) && response.messages_size() == limit;
+        });
+        direct.gateway_requests = direct.calls;
+        print_row("direct", direct);
+        BenchReport report(argc, argv);
+        record(report, "direct", direct);
+
+        FetchCoalescer coalescer(base_url);
+        Result coalesced = storm(threads, rounds, subjects, [&](int, const std::string& subject) {
+            FetchCoalescer::Response response;
+            return coalescer.fetch(subject, limit, &response) && response->messages_size() == limit;
+        });
+        CoalescingStats stats = coalescer.stats();
+        coalesced.gateway_requests = stats.fetches;
+        print_row("coalesced", coalesced);
+        record(report, "coalesced", coalesced);
+        report.metric("coalesced", "coalescing_ratio", stats.coalescing_ratio(), Better::Higher);
+
+        std::cout << std::endl << "Coalescing ratio " << std::fixed << std::setprecision(3)
+                  << stats.coalescing_ratio() << ", up to " << stats.max_shared << " callers per request"
+                  << std::endl;
+        if (!report.write(json_path)) {
+            return 1;
+        }
+        if (direct.failed || coalesced.failed) {
+            std::cerr << "✗ Some fetches failed" << std::endl;
+            return 1;
+        }
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,231 @@
+/*
+ * Time-range fetch: locating ranges at different depths of a stream
+ *
+ * Fills a stream with messages on two interleaved subjects, then reads
+ * windows of --window messages on one of them, starting near the tail, in
+ * the middle and near the head of the stream. Each window is fetched by
+ * time with fetch_range() (jetstream_range.h) using both locate strategies,
+ * and with a plain scan (consumer from the first message, skipping
+ * everything before t0) as the baseline. Reports the probes, time to the
+ * first page and total time, and checks that all three return the same
+ * messages. --json writes the results for bench_compare (bench_report.h).
+ *
+ * Works against a real nats-server (`nats-server -js`; the stream must
+ * exist, e.g. `nats stream add RANGE --subjects 'range.>'`) or
+ * mock_nats_server.cpp.
+ *
+ * Requirements:
+ *   - Boost.Asio, Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 fetch_range_bench.cpp message.pb.cc \
+ *       -lprotobuf -lboost_system -pthread -o fetch_range_bench
+ *
+ * Usage:
+ *   ./fetch_range_bench [nats_url] [--stream RANGE] [--subject range.a]
+ *                       [--fill 500000] [--window 1000] [--page 256] [--json FILE]
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench_report.h"
+#include "jetstream_range.h"
+#include "message.pb.h"
+#include "nats_client.h"
+
+using SystemClock = std::chrono::system_clock;
+
+struct Outcome {
+    uint64_t first = 0;
+    uint64_t last = 0;
+    uint64_t count = 0;
+    RangeStats stats;
+};
+
+static void print_row(BenchReport& report, const std::string& depth, const char* method, const Outcome& o) {
+    std::string name = depth + " " + method;
+    report.metric(name, "first_page_ms", o.stats.first_page_ms, Better::Lower);
+    report.metric(name, "total_ms", o.stats.total_ms, Better::Lower);
+    std::cout << std::left << std::setw(10) << depth << std::setw(18) << method
+              << std::right << std::setw(10) << o.count << std::setw(10) << o.stats.probes
+              << std::fixed << std::setprecision(2)
+              << std::setw(14) << o.stats.first_page_ms << std::setw(12) << o.stats.total_ms << std::endl;
+}
+
+// Baseline: page through the subject from the start and skip to t0
+static bool scan(NatsClient& client, const std::string& stream, const std::string& subject, uint64_t t0_ns,
+                 uint64_t t1_ns, int page_size, Outcome* out) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&] {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    JsConsumerConfig config;
+    config.name = "range-bench-scan";
+    config.filter_subject = subject;
+    if (!JetStreamPullConsumer::create(client, stream, config)) {
+        return false;
+    }
+    bool ok = true;
+    {
+        PullOptions options;
+        options.batch = page_size;
+        JetStreamPullConsumer consumer(client, stream, config.name, options);
+        bool more = true;
+        while (more) {
+            nats::messages::FetchResponse page;
+            if (!consumer.fetch(page_size, &page, true)) {
+                ok = false;
+                break;
+            }
+            more = page.messages_size() == page_size;
+            for (const auto& m : page.messages()) {
+                uint64_t ns = static_cast<uint64_t>(m.timestamp().seconds()) * 1000000000ULL +
+                              static_cast<uint64_t>(m.timestamp().nanos());
+                if (ns >= t1_ns) {
+                    more = false;
+                    break;
+                }
+                if (ns < t0_ns) {
+                    continue;
+                }
+                if (out->count++ == 0) {
+                    out->first = m.sequence();
+                    out->stats.first_page_ms = elapsed_ms();
+                }
+                out->last = m.sequence();
+            }
+        }
+    }
+    JetStreamPullConsumer::remove(client, stream, config.name);
+    out->stats.total_ms = elapsed_ms();
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string url = "nats://localhost:4222";
+    std::string stream = "RANGE";
+    std::string subject = "range.a";
+    uint64_t fill = 500000;
+    uint64_t window = 1000;
+    int page_size = 256;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--stream" && i + 1 < argc) {
+            stream = argv[++i];
+        } else if (arg == "--subject" && i + 1 < argc) {
+            subject = argv[++i];
+        } else if (arg == "--fill" && i + 1 < argc) {
+            fill = std::stoull(argv[++i]);
+        } else if (arg == "--window" && i + 1 < argc) {
+            window = std::stoull(argv[++i]);
+        } else if (arg == "--page" && i + 1 < argc) {
+            page_size = std::stoi(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            url = arg;
+        }
+    }
+    std::string other = subject + ".other";
+
+    try {
+        NatsClient client(url, 0, "fetch-range-bench");
+        client.connect();
+
+        // Two interleaved subjects, so the searches have to skip the other one
+        nats::messages::PublishMessage message;
+        message.set_source("fetch-range-bench");
+        message.set_data(std::string(128, 'x'));
+        for (uint64_t i = 1; i < fill; ++i) {
+            client.publish(i % 2 ? subject : other, message);
+        }
+        nats::messages::PublishAck last;
+        if (!client.publish(subject, message, &last)) {
+            return 1;
+        }
+        std::cout << "✓ Stream " << stream << " holds " << last.sequence() << " messages" << std::endl;
+
+        JetStreamRangeReader reader(client, stream, page_size);
+        std::cout << std::endl;
+        std::cout << std::left << std::setw(10) << "depth" << std::setw(18) << "method"
+                  << std::right << std::setw(10) << "messages" << std::setw(10) << "probes"
+                  << std::setw(14) << "first page ms" << std::setw(12) << "total ms" << std::endl;
+
+        BenchReport report(argc, argv);
+        bool agree = true;
+        for (double depth : {0.01, 0.5, 0.99}) {
+            // The window starts `depth` of the way back from the tail; its
+            // bounds are the timestamps of two messages on the subject
+            uint64_t from = last.sequence() - static_cast<uint64_t>(depth * (last.sequence() - 1));
+            JsStoredMessage begin;
+            JsStoredMessage end;
+            bool found_begin = false;
+            bool found_end = false;
+            if (!reader.get_message(from, subject, &begin, &found_begin) ||
+                !reader.get_message(begin.sequence + 2 * window, subject, &end, &found_end) || !found_begin) {
+                return 1;
+            }
+            auto t0 = SystemClock::time_point(std::chrono::duration_cast<SystemClock::duration>(
+                std::chrono::nanoseconds(begin.timestamp_ns)));
+            auto t1 = found_end ? SystemClock::time_point(std::chrono::duration_cast<SystemClock::duration>(
+                                      std::chrono::nanoseconds(end.timestamp_ns)))
+                                : SystemClock::now() + std::chrono::hours(1);
+            std::string label = std::to_string(static_cast<int>(depth * 100)) + "%";
+
+            std::vector<Outcome> outcomes;
+            for (RangeLocate strategy : {RangeLocate::SequenceSearch, RangeLocate::StartTime}) {
+                Outcome o;
+                bool ok = reader.fetch_range(subject, t0, t1, [&](const nats::messages::FetchResponse& page) {
+                    if (o.count == 0) o.first = page.messages(0).sequence();
+                    o.count += page.messages_size();
+                    o.last = page.messages(page.messages_size() - 1).sequence();
+                    return true;
+                }, strategy, &o.stats);
+                if (!ok) {
+                    return 1;
+                }
+                print_row(report, label, strategy == RangeLocate::SequenceSearch ? "sequence search" : "start time", o);
+                outcomes.push_back(o);
+            }
+
+            Outcome baseline;
+            auto ns = [](SystemClock::time_point t) {
+                return static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count());
+            };
+            if (!scan(client, stream, subject, ns(t0), ns(t1), page_size, &baseline)) {
+                return 1;
+            }
+            print_row(report, label, "scan from start", baseline);
+
+            for (const auto& o : outcomes) {
+                agree = agree && o.count == baseline.count && o.first == baseline.first && o.last == baseline.last;
+            }
+        }
+
+        client.close();
+        if (!report.write(json_path)) {
+            return 1;
+        }
+        if (!agree) {
+            std::cerr << "✗ Strategies returned different messages" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ All strategies returned the same messages" << std::endl;
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Benchmark: publishing a payload held as fragments, joined vs streamed
+ *
+ * The payload is a 64-byte header, a body of --size bytes and a 16-byte
+ * trailer, held separately as producers usually have them. Two ways to
+ * publish it through the gateway:
+ *
+ *   joined     concatenate into a string, set_data(), publish()
+ *              (the join, the copy into the message and the serialize
+ *              copy of every byte)
+ *   fragments  HttpClient::publish_fragments(): the envelope is serialized
+ *              without data and curl reads the fragments in place
+ *
+ * Reports publishes/s and client CPU per publish for each body size, and
+ * fetches the last message of each run to check the gateway stored the
+ * same bytes. --json writes the results for bench_compare (bench_report.h).
+ *
+ * Works against the gateway or mock_gateway.cpp.
+ *
+ * Requirements:
+ *   - libcurl, Protobuf
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 fragment_publish_bench.cpp message.pb.cc \
+ *       -lprotobuf -lcurl -o fragment_publish_bench
+ *
+ * Usage:
+ *   ./fragment_publish_bench [base_url] [--count 200] [--subject bench.fragments]
+ *                            [--json FILE]
+ */
+
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "bench_report.h"
+#include "http_client.h"
+#include "message.pb.h"
+#include "nats_json.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double per_sec = 0;
+    double cpu_us = 0;   // client CPU per publish
+    bool stored_ok = false;
+    std::vector<double> latencies_us;
+};
+
+template <typename Publish>
+static Result run(HttpClient& client, const std::string& subject, int count, const std::string& expected,
+                  Publish&& publish) {
+    Result result;
+    auto start = Clock::now();
+    std::clock_t cpu_start = std::clock();
+    for (int i = 0; i < count; ++i) {
+        auto begin = Clock::now();
+        if (!publish()) {
+            return result;
+        }
+        result.latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+    }
+    double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    result.per_sec = count / elapsed;
+    result.cpu_us = cpu * 1e6 / count;
+
+    // The gateway returns the payload inside its JSON envelope
+    nats::messages::FetchResponse fetched;
+    std::string stored;
+    result.stored_ok = client.fetch(subject, 1, &fetched) && fetched.messages_size() == 1 &&
+                       gateway_envelope_data(fetched.messages(0).data(), &stored) && stored == expected;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string base_url = "http://localhost:8080";
+    std::string subject = "bench.fragments";
+    int count = 200;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) {
+            count = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--subject" && i + 1 < argc) {
+            subject = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            base_url = arg;
+        }
+    }
+
+    try {
+        HttpClient client(base_url);
+        BenchReport report(argc, argv);
+
+        std::cout << std::left << std::setw(12) << "body" << std::setw(12) << "method" << std::right
+                  << std::setw(14) << "publishes/s" << std::setw(16) << "client CPU us" << std::setw(10)
+                  << "stored" << std::endl;
+
+        bool all_ok = true;
+        for (size_t size : {16u * 1024, 256u * 1024, 4u * 1024 * 1024}) {
+            std::string header(64, 'H');
+            std::string body(size, 'b');
+            std::string trailer(16, 'T');
+            for (size_t i = 0; i < body.size(); i += 4096) body[i] = static_cast<char>('a' + (i / 4096) % 26);
+            std::string expected = header + body + trailer;
+
+            nats::messages::PublishMessage envelope;
+            envelope.set_subject(subject);
+            envelope.set_source("fragment-publish-bench");
+            (*envelope.mutable_metadata())["content-type"] = "application/octet-stream";
+
+            // Fewer rounds for the large bodies
+            int rounds = std::max(5, static_cast<int>(count * 16 * 1024 / std::max<size_t>(size, 16 * 1024)));
+
+            Result joined = run(client, subject, rounds, expected, [&] {
+                std::string data;
+                data.reserve(header.size() + body.size() + trailer.size());
+                data.append(header).append(body).append(trailer);
+                nats::messages::PublishMessage message = envelope;
+                message.set_data(data);
+                return client.publish(subject, message);
+            });
+
+            std::vector<std::string_view> fragments = {header, body, trailer};
+            Result streamed = run(client, subject, rounds, expected,
+                                  [&] { return client.publish_fragments(subject, envelope, fragments); });
+
+            std::string label = size >= 1024 * 1024 ? std::to_string(size / (1024 * 1024)) + " MiB"
+                                                     : std::to_string(size / 1024) + " KiB";
+            for (auto row : {std::make_pair("joined", joined), std::make_pair("fragments", streamed)}) {
+                std::cout << std::left << std::setw(12) << label << std::setw(12) << row.first << std::right
+                          << std::fixed << std::setprecision(0) << std::setw(14) << row.second.per_sec
+                          << std::setprecision(1) << std::setw(16) << row.second.cpu_us << std::setw(10)
+                          << (row.second.stored_ok ? "ok" : "MISMATCH") << std::endl;
+                all_ok = all_ok && row.second.stored_ok;
+
+                std::string name = label + " " + row.first;
+                report.metric(name, "publishes_per_s", row.second.per_sec, Better::Higher);
+                report.metric(name, "client_cpu_us", row.second.cpu_us, Better::Lower);
+                report.samples(name, "latency_us", row.second.latencies_us, Better::Lower);
+            }
+        }
+
+        if (!report.write(json_path)) {
+            return 1;
+        }
+        if (!all_ok) {
+            std::cerr << "✗ Stored payload differs from the fragments" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Both methods stored identical payloads" << std::endl;
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,578 @@
+/*
+ * HttpClient for NatsHttpGateway (protobuf REST endpoints)
+ *
+ * Shared by http_client_example.cpp and the publisher components that
+ * need one or more gateway connections.
+ *
+ * Requirements:
+ *   - libcurl (HTTP client)
+ *   - Protobuf (message parsing)
+ *   - libzstd, only when built with -DNATSGW_ZSTD (enable_compression /
+ *     enable_decompression)
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <cstring>
+#include <strings.h>
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include "curl_global.h"
+#include "message.pb.h"
+#include "message_transport.h"
+#include "metadata_dictionary.h"
+#include "natsgw_probes.h"
+#ifdef NATSGW_ZSTD
+#include "nats_json.h"
+#include "zstd_dictionary.h"
+#endif
+
+// Callback for writing HTTP response data
+static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
+    ((std::string*)userp)->append((char*)contents, size * nmemb);
+    return size * nmemb;
+}
+
+class HttpClient : public MessagePublisher {
+private:
+    std::string base_url_;
+    CURL* curl_;
+    std::unique_ptr<MetadataDictionaryEncoder> dictionary_;
+    bool dictionary_confirmed_ = false;   // the server answered with X-Metadata-Dictionary
+    bool dictionary_header_ = false;      // ... on the last response
+    bool connected_ = false;    // a request has opened a connection before
+#ifdef NATSGW_ZSTD
+    std::shared_ptr<const ZstdDictionary> compression_;
+    size_t compress_min_size_ = 64;
+    std::shared_ptr<const ZstdDictionaryRegistry> decompression_;
+#endif
+
+    // Request body for publish_fragments(): the serialized envelope and the
+    // data field's key and length, then each fragment, read in place
+    struct FragmentBody {
+        std::string head;
+        const std::vector<std::string_view>* fragments = nullptr;
+        size_t part = 0;      // 0: head, i: fragments[i - 1]
+        size_t offset = 0;    // within the part
+
+        std::string_view current() const {
+            return part == 0 ? std::string_view(head) : (*fragments)[part - 1];
+        }
+        bool done() const { return part > fragments->size(); }
+    };
+
+public:
+    HttpClient(const std::string& base_url) : base_url_(base_url) {
+        curl_global_once();
+        curl_ = curl_easy_init();
+        if (!curl_) {
+            throw std::runtime_error("Failed to initialize CURL");
+        }
+    }
+
+    ~HttpClient() {
+        if (curl_) {
+            curl_easy_cleanup(curl_);
+        }
+    }
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    const std::string& base_url() const { return base_url_; }
+
+    // Send metadata as per-connection dictionary references once the server
+    // has shown it decodes them. Publishes carry metadata inline until a 200
+    // response includes X-Metadata-Dictionary (mock_gateway.cpp sends it);
+    // the first 200 without it turns the dictionary off again.
+    // NatsHttpGateway's protobuf publish keeps only MessageId, Source and
+    // Data and never sends the header, so there publishes stay plain.
+    void enable_metadata_dictionary(size_t capacity = 256, uint32_t promote_after = 2) {
+        dictionary_ = std::make_unique<MetadataDictionaryEncoder>(capacity, promote_after);
+        dictionary_confirmed_ = false;
+    }
+
+#ifdef NATSGW_ZSTD
+    // Publish `data` through compress_payload() from now on: tagged, and zstd
+    // compressed with `dictionary` when it is at least `min_size` bytes and
+    // shrinks. Every consumer of these subjects must decode (see
+    // enable_decompression()).
+    void enable_compression(std::shared_ptr<const ZstdDictionary> dictionary, size_t min_size = 64) {
+        compression_ = std::move(dictionary);
+        compress_min_size_ = min_size;
+    }
+
+    // Decode fetched `data` with `registry` from now on (after unwrapping the
+    // gateway envelope). A fetch fails if any message is not a tagged
+    // payload from an enable_compression() publisher.
+    void enable_decompression(std::shared_ptr<const ZstdDictionaryRegistry> registry) {
+        decompression_ = std::move(registry);
+    }
+#endif
+
+    // Publish a message to NATS via HTTP without printing anything on success.
+    // Fills `ack` (when given) with the gateway's PublishAck.
+    bool publish(const std::string& subject, const nats::messages::PublishMessage& message,
+                 nats::messages::PublishAck* ack = nullptr) override {
+        std::string url = base_url_ + "/api/proto/ProtobufMessages/" + subject;
+        std::string response_data;
+        long response_code = 0;
+        int64_t start = NATSGW_PROBE_CLOCK(publish_end);
+        NATSGW_PROBE(publish_start, subject.c_str(), 0, message.data().size(), 0);
+
+        const nats::messages::PublishMessage* outgoing = &message;
+#ifdef NATSGW_ZSTD
+        nats::messages::PublishMessage compressed;
+        if (compression_) {
+            compressed = message;
+            compressed.set_data(compress_payload(*compression_, message.data(), compress_min_size_));
+            outgoing = &compressed;
+        }
+#endif
+
+        // Serialize the message to protobuf
+        std::string request_body;
+        if (!serialize_for_wire(*outgoing, &request_body)) {
+            std::cerr << "✗ Failed to serialize message" << std::endl;
+            return false;
+        }
+
+        if (!post_protobuf(url, request_body, &response_data, &response_code)) {
+            return false;
+        }
+
+        // 409: the server has no dictionary for this connection (new or
+        // reconnected socket). Re-send with every definition inline.
+        if (response_code == 409 && dictionary_) {
+            dictionary_->reset_connection();
+            response_data.clear();
+            if (!serialize_for_wire(*outgoing, &request_body) ||
+                !post_protobuf(url, request_body, &response_data, &response_code)) {
+                return false;
+            }
+        }
+
+        return parse_ack(response_code, response_data, ack, subject, message.data().size(), start);
+    }
+
+    // Publish with data = the concatenation of `fragments`, without building
+    // it: the envelope is serialized on its own (data must be empty), then
+    // the data field's tag and length, and curl reads the fragments straight
+    // from the caller's memory. The fragments must stay valid until this
+    // returns.
+    bool publish_fragments(const std::string& subject, const nats::messages::PublishMessage& envelope,
+                           const std::vector<std::string_view>& fragments,
+                           nats::messages::PublishAck* ack = nullptr) override {
+        if (!envelope.data().empty()) {
+            std::cerr << "✗ publish_fragments: the envelope already has data" << std::endl;
+            return false;
+        }
+#ifdef NATSGW_ZSTD
+        // Compression needs the whole payload in one piece
+        if (compression_) {
+            nats::messages::PublishMessage message = envelope;
+            for (auto fragment : fragments) {
+                message.mutable_data()->append(fragment.data(), fragment.size());
+            }
+            return publish(subject, message, ack);
+        }
+#endif
+        std::string url = base_url_ + "/api/proto/ProtobufMessages/" + subject;
+        std::string response_data;
+        long response_code = 0;
+        size_t size = 0;
+        for (auto fragment : fragments) size += fragment.size();
+        int64_t start = NATSGW_PROBE_CLOCK(publish_end);
+        NATSGW_PROBE(publish_start, subject.c_str(), 0, size, 0);
+
+        FragmentBody body;
+        body.fragments = &fragments;
+        if (!fragment_head(envelope, fragments, &body.head) ||
+            !post_fragments(url, &body, &response_data, &response_code)) {
+            return false;
+        }
+
+        // Same dictionary recovery as publish()
+        if (response_code == 409 && dictionary_) {
+            dictionary_->reset_connection();
+            response_data.clear();
+            body = FragmentBody();
+            body.fragments = &fragments;
+            if (!fragment_head(envelope, fragments, &body.head) ||
+                !post_fragments(url, &body, &response_data, &response_code)) {
+                return false;
+            }
+        }
+
+        return parse_ack(response_code, response_data, ack, subject, size, start);
+    }
+
+    // Publish a message to NATS via HTTP and print the acknowledgement
+    bool publish_message(const std::string& subject, const nats::messages::PublishMessage& message) {
+        nats::messages::PublishAck ack;
+        if (!publish(subject, message, &ack)) {
+            return false;
+        }
+
+        std::cout << "✓ Published successfully!" << std::endl;
+        std::cout << "  Stream:   " << ack.stream() << std::endl;
+        std::cout << "  Sequence: " << ack.sequence() << std::endl;
+        std::cout << "  Subject:  " << ack.subject() << std::endl;
+
+        return true;
+    }
+
+    // Fetch messages from NATS via HTTP without printing anything on success
+    bool fetch(const std::string& subject, int limit, nats::messages::FetchResponse* fetch_response) {
+        std::string url = base_url_ + "/api/proto/ProtobufMessages/" + subject + "?limit=" + std::to_string(limit);
+        std::string response_data;
+
+        // Set up the request
+        curl_easy_reset(curl_);
+        curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl_, CURLOPT_HTTPGET, 1L);
+
+        // Set headers
+        struct curl_slist* headers = nullptr;
+        headers = curl_slist_append(headers, "Accept: application/x-protobuf");
+        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
+
+        // Set response callback
+        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &response_data);
+
+        // Perform the request
+        CURLcode res = curl_easy_perform(curl_);
+        curl_slist_free_all(headers);
+
+        if (res != CURLE_OK) {
+            std::cerr << "✗ HTTP request failed: " << curl_easy_strerror(res) << std::endl;
+            return false;
+        }
+
+        // Check response code
+        long response_code;
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &response_code);
+        probe_response(url, response_code, response_data.size());
+        if (response_code != 200) {
+            std::cerr << "✗ Server returned status: " << response_code << std::endl;
+            return false;
+        }
+
+        // Parse the response (never empty: it names at least the subject)
+        if (response_data.empty()) {
+            std::cerr << "✗ Empty response (connection closed early)" << std::endl;
+            return false;
+        }
+        if (!fetch_response->ParseFromString(response_data)) {
+            std::cerr << "✗ Failed to parse response" << std::endl;
+            return false;
+        }
+#ifdef NATSGW_ZSTD
+        if (decompression_ && !decompress(fetch_response)) {
+            return false;
+        }
+#endif
+
+        return true;
+    }
+
+    // Fetch messages from NATS via HTTP and print them
+    bool fetch_messages(const std::string& subject, int limit = 10) {
+        nats::messages::FetchResponse fetch_response;
+        if (!fetch(subject, limit, &fetch_response)) {
+            return false;
+        }
+
+        std::cout << "✓ Fetched " << fetch_response.count() << " messages from " << fetch_response.stream() << std::endl;
+        std::cout << "  Subject: " << fetch_response.subject() << std::endl;
+        std::cout << "  Messages:" << std::endl;
+
+        for (const auto& msg : fetch_response.messages()) {
+            std::cout << "    [" << msg.sequence() << "] " << msg.subject() << std::endl;
+            std::cout << "        Size: " << msg.size_bytes() << " bytes" << std::endl;
+
+            if (msg.has_timestamp()) {
+                auto seconds = msg.timestamp().seconds();
+                auto time_t_val = static_cast<time_t>(seconds);
+                std::cout << "        Time: "
+                          << std::put_time(std::localtime(&time_t_val), "%Y-%m-%d %H:%M:%S")
+                          << std::endl;
+            }
+
+            // Try to display data
+            if (!msg.data().empty()) {
+                std::string data_str = msg.data();
+                if (data_str.length() > 50) {
+                    data_str = data_str.substr(0, 50) + "...";
+                }
+
+                bool printable = true;
+                for (char c : data_str) {
+                    if (!isprint(static_cast<unsigned char>(c)) && !isspace(static_cast<unsigned char>(c))) {
+                        printable = false;
+                        break;
+                    }
+                }
+
+                if (printable) {
+                    std::cout << "        Data: " << data_str << std::endl;
+                } else {
+                    std::cout << "        Data: [binary, " << msg.data().length() << " bytes]" << std::endl;
+                }
+            }
+        }
+
+        return true;
+    }
+
+private:
+#ifdef NATSGW_ZSTD
+    // Replace each message's data with its decoded payload
+    bool decompress(nats::messages::FetchResponse* response) {
+        std::string payload;
+        std::string decoded;
+        for (auto& message : *response->mutable_messages()) {
+            if (!gateway_envelope_data(message.data(), &payload)) {
+                payload = message.data();   // published directly to NATS
+            }
+            if (!decompression_->decode(payload, &decoded)) {
+                std::cerr << "✗ Cannot decode message " << message.sequence() << " on " << message.subject()
+                          << " (not a tagged payload, or unknown dictionary)" << std::endl;
+                return false;
+            }
+            message.set_data(decoded);
+        }
+        return true;
+    }
+#endif
+
+    bool serialize_for_wire(const nats::messages::PublishMessage& message, std::string* body) {
+        if (!dictionary_ || !dictionary_confirmed_ || message.metadata().empty()) {
+            return message.SerializeToString(body);
+        }
+        nats::messages::PublishMessage wire;
+        dictionary_->encode(message, &wire);
+        return wire.SerializeToString(body);
+    }
+
+    bool post_protobuf(const std::string& url, const std::string& request_body,
+                       std::string* response_data, long* response_code) {
+        // Set up the request
+        curl_easy_reset(curl_);
+        curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl_, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, request_body.c_str());
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, request_body.size());
+
+        // Set headers (no "Expect: 100-continue" wait before bodies over 1 MB)
+        struct curl_slist* headers = nullptr;
+        headers = curl_slist_append(headers, "Content-Type: application/x-protobuf");
+        headers = curl_slist_append(headers, "Expect:");
+        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
+
+        // Set response callback
+        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, response_data);
+        watch_dictionary_header();
+
+        // Perform the request
+        CURLcode res = curl_easy_perform(curl_);
+        curl_slist_free_all(headers);
+
+        if (res != CURLE_OK) {
+            std::cerr << "✗ HTTP request failed: " << curl_easy_strerror(res) << std::endl;
+            return false;
+        }
+
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, response_code);
+        probe_response(url, *response_code, response_data->size());
+        check_dictionary_support(*response_code);
+        return true;
+    }
+
+    // Fires publish_end with the acknowledged sequence and the time since
+    // `start`
+    bool parse_ack(long response_code, const std::string& response_data, nats::messages::PublishAck* ack,
+                   const std::string& subject, size_t size, int64_t start) {
+        // Check response code
+        if (response_code != 200) {
+            std::cerr << "✗ Server returned status: " << response_code << std::endl;
+            return false;
+        }
+
+        // Parse the response. An empty body parses as an empty ack, but the
+        // gateway always sends one: the connection was cut mid-response.
+        nats::messages::PublishAck parsed;
+        if (response_data.empty()) {
+            std::cerr << "✗ Empty response (connection closed early)" << std::endl;
+            return false;
+        }
+        if (!parsed.ParseFromString(response_data)) {
+            std::cerr << "✗ Failed to parse response" << std::endl;
+            return false;
+        }
+
+        NATSGW_PROBE(publish_end, subject.c_str(), parsed.sequence(), size, natsgw_probe_since(start));
+        if (ack) {
+            *ack = std::move(parsed);
+        }
+        return true;
+    }
+
+    // http_response for the request just performed, and reconnect when
+    // curl had to open a new connection although an earlier request had one
+    // (the server closed the kept-alive connection)
+    void probe_response(const std::string& url, long response_code, size_t size) {
+        if (NATSGW_PROBE_ENABLED(http_response)) {
+            curl_off_t total_us = 0;
+            curl_easy_getinfo(curl_, CURLINFO_TOTAL_TIME_T, &total_us);
+            NATSGW_PROBE(http_response, url.c_str(), response_code, size, total_us * 1000);
+        }
+
+        long connects = 0;
+        curl_easy_getinfo(curl_, CURLINFO_NUM_CONNECTS, &connects);
+        if (connects > 0) {
+            if (connected_ && NATSGW_PROBE_ENABLED(reconnect)) {
+                curl_off_t connect_us = 0;
+                curl_easy_getinfo(curl_, CURLINFO_CONNECT_TIME_T, &connect_us);
+                NATSGW_PROBE(reconnect, url.c_str(), 0, 0, connect_us * 1000);
+            }
+            connected_ = true;
+        }
+    }
+
+    // Envelope bytes followed by the key and length of field 5 (data).
+    // Fields may appear in any order on the wire, so appending data last
+    // parses the same as a message serialized with it.
+    bool fragment_head(const nats::messages::PublishMessage& envelope, const std::vector<std::string_view>& fragments,
+                       std::string* head) {
+        if (!serialize_for_wire(envelope, head)) {
+            std::cerr << "✗ Failed to serialize message" << std::endl;
+            return false;
+        }
+        uint64_t size = 0;
+        for (auto fragment : fragments) size += fragment.size();
+        head->push_back(static_cast<char>((5 << 3) | 2));   // field 5, length-delimited
+        do {
+            uint8_t byte = size & 0x7f;
+            size >>= 7;
+            head->push_back(static_cast<char>(size ? byte | 0x80 : byte));
+        } while (size);
+        return true;
+    }
+
+    static size_t fragment_read_callback(char* buffer, size_t size, size_t nitems, void* userp) {
+        auto* body = static_cast<FragmentBody*>(userp);
+        size_t capacity = size * nitems;
+        size_t written = 0;
+        while (written < capacity && !body->done()) {
+            std::string_view part = body->current();
+            size_t n = std::min(capacity - written, part.size() - body->offset);
+            std::memcpy(buffer + written, part.data() + body->offset, n);
+            written += n;
+            body->offset += n;
+            if (body->offset == part.size()) {
+                body->part++;
+                body->offset = 0;
+            }
+        }
+        return written;
+    }
+
+    // curl rewinds the body when it resends the request on a new
+    // connection (e.g. the kept-alive one was closed by the server)
+    static int fragment_seek_callback(void* userp, curl_off_t offset, int origin) {
+        auto* body = static_cast<FragmentBody*>(userp);
+        if (origin != SEEK_SET || offset < 0) {
+            return CURL_SEEKFUNC_CANTSEEK;
+        }
+        body->part = 0;
+        body->offset = 0;
+        auto left = static_cast<size_t>(offset);
+        while (!body->done() && left >= body->current().size()) {
+            left -= body->current().size();
+            body->part++;
+        }
+        if (body->done() && left > 0) {
+            return CURL_SEEKFUNC_FAIL;
+        }
+        body->offset = left;
+        return CURL_SEEKFUNC_OK;
+    }
+
+    bool post_fragments(const std::string& url, FragmentBody* body, std::string* response_data, long* response_code) {
+        curl_off_t size = static_cast<curl_off_t>(body->head.size());
+        for (auto fragment : *body->fragments) size += static_cast<curl_off_t>(fragment.size());
+
+        curl_easy_reset(curl_);
+        curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl_, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE_LARGE, size);
+        curl_easy_setopt(curl_, CURLOPT_READFUNCTION, fragment_read_callback);
+        curl_easy_setopt(curl_, CURLOPT_READDATA, body);
+        curl_easy_setopt(curl_, CURLOPT_SEEKFUNCTION, fragment_seek_callback);
+        curl_easy_setopt(curl_, CURLOPT_SEEKDATA, body);
+
+        struct curl_slist* headers = nullptr;
+        headers = curl_slist_append(headers, "Content-Type: application/x-protobuf");
+        headers = curl_slist_append(headers, "Expect:");
+        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
+
+        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, response_data);
+        watch_dictionary_header();
+
+        CURLcode res = curl_easy_perform(curl_);
+        curl_slist_free_all(headers);
+
+        if (res != CURLE_OK) {
+            std::cerr << "✗ HTTP request failed: " << curl_easy_strerror(res) << std::endl;
+            return false;
+        }
+
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, response_code);
+        probe_response(url, *response_code, response_data->size());
+        check_dictionary_support(*response_code);
+        return true;
+    }
+
+    // Look for X-Metadata-Dictionary while the server's support is unknown
+    void watch_dictionary_header() {
+        dictionary_header_ = false;
+        if (dictionary_ && !dictionary_confirmed_) {
+            curl_easy_setopt(curl_, CURLOPT_HEADERFUNCTION, dictionary_header_callback);
+            curl_easy_setopt(curl_, CURLOPT_HEADERDATA, &dictionary_header_);
+        }
+    }
+
+    static size_t dictionary_header_callback(char* buffer, size_t size, size_t nitems, void* userp) {
+        static const char name[] = "x-metadata-dictionary:";
+        size_t n = size * nitems;
+        if (n >= sizeof(name) - 1 && strncasecmp(buffer, name, sizeof(name) - 1) == 0) {
+            *static_cast<bool*>(userp) = true;
+        }
+        return n;
+    }
+
+    void check_dictionary_support(long response_code) {
+        if (!dictionary_ || dictionary_confirmed_ || response_code != 200) {
+            return;
+        }
+        if (dictionary_header_) {
+            dictionary_confirmed_ = true;
+            return;
+        }
+        std::cerr << "✗ " << base_url_ << " does not decode metadata dictionaries, "
+                  << "sending metadata inline" << std::endl;
+        dictionary_.reset();
+    }
+};
@@ -4,197 +4,30 @@
  * Requirements:
  *   - libcurl (HTTP client)
  *   - Protobuf (message parsing)
+ *   - pthread (priority lane workers)
  *
  * Build:
  *   g++ -std=c++17 http_client_example.cpp message.pb.cc \
- *       -lprotobuf -lcurl -o http_client
+ *       -lprotobuf -lcurl -pthread -o http_client
  *
  * Usage:
  *   ./http_client [base_url]
  *   ./http_client http://localhost:8080
  */
 
-#include <curl/curl.h>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <memory>
 #include <ctime>
+#include <chrono>
 #include <iomanip>
 #include "message.pb.h"
-
-// Callback for writing HTTP response data
-static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp) {
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
-    return size * nmemb;
-}
-
-class HttpClient {
-private:
-    std::string base_url_;
-    CURL* curl_;
-
-public:
-    HttpClient(const std::string& base_url) : base_url_(base_url) {
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-        curl_ = curl_easy_init();
-        if (!curl_) {
-            throw std::runtime_error("Failed to initialize CURL");
-        }
-    }
-
-    ~HttpClient() {
-        if (curl_) {
-            curl_easy_cleanup(curl_);
-        }
-        curl_global_cleanup();
-    }
-
-    // Publish a message to NATS via HTTP
-    bool publish_message(const std::string& subject, const nats::messages::PublishMessage& message) {
-        std::string url = base_url_ + "/api/proto/ProtobufMessages/" + subject;
-        std::string response_data;
-
-        // Serialize the message to protobuf
-        std::string request_body;
-        if (!message.SerializeToString(&request_body)) {
-            std::cerr << "✗ Failed to serialize message" << std::endl;
-            return false;
-        }
-
-        // Set up the request
-        curl_easy_reset(curl_);
-        curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl_, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, request_body.c_str());
-        curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, request_body.size());
-
-        // Set headers
-        struct curl_slist* headers = nullptr;
-        headers = curl_slist_append(headers, "Content-Type: application/x-protobuf");
-        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
-
-        // Set response callback
-        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &response_data);
-
-        // Perform the request
-        CURLcode res = curl_easy_perform(curl_);
-        curl_slist_free_all(headers);
-
-        if (res != CURLE_OK) {
-            std::cerr << "✗ HTTP request failed: " << curl_easy_strerror(res) << std::endl;
-            return false;
-        }
-
-        // Check response code
-        long response_code;
-        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &response_code);
-        if (response_code != 200) {
-            std::cerr << "✗ Server returned status: " << response_code << std::endl;
-            return false;
-        }
-
-        // Parse the response
-        nats::messages::PublishAck ack;
-        if (!ack.ParseFromString(response_data)) {
-            std::cerr << "✗ Failed to parse response" << std::endl;
-            return false;
-        }
-
-        std::cout << "✓ Published successfully!" << std::endl;
-        std::cout << "  Stream:   " << ack.stream() << std::endl;
-        std::cout << "  Sequence: " << ack.sequence() << std::endl;
-        std::cout << "  Subject:  " << ack.subject() << std::endl;
-
-        return true;
-    }
-
-    // Fetch messages from NATS via HTTP
-    bool fetch_messages(const std::string& subject, int limit = 10) {
-        std::string url = base_url_ + "/api/proto/ProtobufMessages/" + subject + "?limit=" + std::to_string(limit);
-        std::string response_data;
-
-        // Set up the request
-        curl_easy_reset(curl_);
-        curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl_, CURLOPT_HTTPGET, 1L);
-
-        // Set headers
-        struct curl_slist* headers = nullptr;
-        headers = curl_slist_append(headers, "Accept: application/x-protobuf");
-        curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers);
-
-        // Set response callback
-        curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl_, CURLOPT_WRITEDATA, &response_data);
-
-        // Perform the request
-        CURLcode res = curl_easy_perform(curl_);
-        curl_slist_free_all(headers);
-
-        if (res != CURLE_OK) {
-            std::cerr << "✗ HTTP request failed: " << curl_easy_strerror(res) << std::endl;
-            return false;
-        }
-
-        // Check response code
-        long response_code;
-        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &response_code);
-        if (response_code != 200) {
-            std::cerr << "✗ Server returned status: " << response_code << std::endl;
-            return false;
-        }
-
-        // Parse the response
-        nats::messages::FetchResponse fetch_response;
-        if (!fetch_response.ParseFromString(response_data)) {
-            std::cerr << "✗ Failed to parse response" << std::endl;
-            return false;
-        }
-
-        std::cout << "✓ Fetched " << fetch_response.count() << " messages from " << fetch_response.stream() << std::endl;
-        std::cout << "  Subject: " << fetch_response.subject() << std::endl;
-        std::cout << "  Messages:" << std::endl;
-
-        for (const auto& msg : fetch_response.messages()) {
-            std::cout << "    [" << msg.sequence() << "] " << msg.subject() << std::endl;
-            std::cout << "        Size: " << msg.size_bytes() << " bytes" << std::endl;
-
-            if (msg.has_timestamp()) {
-                auto seconds = msg.timestamp().seconds();
-                auto time_t_val = static_cast<time_t>(seconds);
-                std::cout << "        Time: "
-                          << std::put_time(std::localtime(&time_t_val), "%Y-%m-%d %H:%M:%S")
-                          << std::endl;
-            }
-
-            // Try to display data
-            if (!msg.data().empty()) {
-                std::string data_str = msg.data();
-                if (data_str.length() > 50) {
-                    data_str = data_str.substr(0, 50) + "...";
-                }
-
-                bool printable = true;
-                for (char c : data_str) {
-                    if (!isprint(static_cast<unsigned char>(c)) && !isspace(static_cast<unsigned char>(c))) {
-                        printable = false;
-                        break;
-                    }
-                }
-
-                if (printable) {
-                    std::cout << "        Data: " << data_str << std::endl;
-                } else {
-                    std::cout << "        Data: [binary, " << msg.data().length() << " bytes]" << std::endl;
-                }
-            }
-        }
-
-        return true;
-    }
-};
+#include "http_client.h"
+#include "priority_publisher.h"
+#include "conflating_publisher.h"
+#include "multi_fetch.h"
+#include "claim_check.h"
 
 // Helper to generate UUID (simple version)
 std::string generate_uuid() {
@@ -309,6 +142,157 @@ void example4_fetch_messages(HttpClient& client, const std::string& subject, int
     std::cout << std::endl;
 }
 
+void example5_priority_lanes(const std::string& base_url) {
+    std::cout << "=== Example 5: Priority Lanes (payments vs bulk events) ===" << std::endl;
+
+    PriorityPublisherConfig config;
+    config.base_url = base_url;
+    config.classes = {
+        {"critical", 2, 4, 1000},
+        {"bulk", 4, 1, 100000},
+    };
+
+    // Subject -> class mapping, overridable via NATS_PRIORITY_CLASSES
+    const char* env_classes = std::getenv("NATS_PRIORITY_CLASSES");
+    config.subject_classes = parse_subject_classes(env_classes ? env_classes : "payments.>=critical,events.>=bulk");
+    // 6 connections, 4 gateway requests at a time: payments go first
+    config.max_in_flight = 4;
+    config.scheduling = LaneScheduling::StrictPriority;
+
+    PriorityPublisher publisher(config);
+
+    // Saturate the bulk lane with a backfill, interleaving payments
+    const int bulk_messages = 500;
+    const int payment_messages = 25;
+    for (int i = 0; i < bulk_messages; ++i) {
+        nats::messages::PublishMessage message;
+        message.set_message_id(generate_uuid());
+        message.set_subject("events.backfill");
+        message.set_source("cpp-client");
+        message.set_data(R"({"backfill": )" + std::to_string(i) + "}");
+        publisher.publish("events.backfill", std::move(message));
+
+        if (i % (bulk_messages / payment_messages) == 0) {
+            nats::messages::PublishMessage payment;
+            payment.set_message_id(generate_uuid());
+            payment.set_subject("payments.credit_card.approved");
+            payment.set_source("cpp-client");
+            payment.set_data(R"({"amount": 149.99})");
+            publisher.publish("payments.credit_card.approved", std::move(payment));
+        }
+    }
+
+    publisher.flush();
+
+    for (const auto& lane : publisher.stats()) {
+        std::cout << "  Lane " << std::left << std::setw(9) << lane.name << std::right
+                  << " sent=" << lane.sent
+                  << " failed=" << lane.failed
+                  << " rejected=" << lane.rejected
+                  << std::fixed << std::setprecision(2)
+                  << " p50=" << lane.p50_ms << "ms"
+                  << " p99=" << lane.p99_ms << "ms"
+                  << " max=" << lane.max_ms << "ms"
+                  << std::defaultfloat << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+void example6_conflated_state_updates(const std::string& base_url) {
+    std::cout << "=== Example 6: Last-Value-Wins Conflation (state.>) ===" << std::endl;
+
+    ConflatingPublisher publisher(base_url, {"state.>"}, std::chrono::milliseconds(20));
+
+    // A chatty producer: 1000 snapshots spread over 5 sensors
+    for (int i = 0; i < 1000; ++i) {
+        std::string subject = "state.sensor." + std::to_string(i % 5);
+
+        nats::messages::PublishMessage message;
+        message.set_message_id(generate_uuid());
+        message.set_subject(subject);
+        message.set_source("cpp-client");
+        message.set_data(R"({"reading": )" + std::to_string(i) + "}");
+        publisher.publish(subject, std::move(message));
+    }
+
+    publisher.flush();
+
+    auto stats = publisher.stats();
+    std::cout << "✓ Submitted " << stats.submitted << " updates" << std::endl;
+    std::cout << "  Sent:      " << stats.sent << std::endl;
+    std::cout << "  Conflated: " << stats.conflated << std::endl;
+    std::cout << "  Dropped:   " << stats.dropped << std::endl;
+    std::cout << std::endl;
+}
+
+void example7_fetch_many(const std::string& base_url) {
+    std::cout << "=== Example 7: Multi-Subject Timeline (fetch_many) ===" << std::endl;
+
+    MultiFetcher fetcher(base_url);
+    std::vector<FetchSpec> specs = {
+        {"events.test", 5},
+        {"events.user.created", 3},
+        {"payments.credit_card.approved", 5},
+    };
+
+    FetchManyStats stats;
+    auto start = std::chrono::steady_clock::now();
+    fetcher.fetch_many(specs, [](const nats::messages::FetchedMessage& msg) {
+        auto time_t_val = static_cast<time_t>(msg.timestamp().seconds());
+        std::cout << "    " << std::put_time(std::localtime(&time_t_val), "%H:%M:%S")
+                  << "." << std::setfill('0') << std::setw(3) << msg.timestamp().nanos() / 1000000
+                  << std::setfill(' ') << "  " << msg.stream() << " [" << msg.sequence() << "] "
+                  << msg.subject() << std::endl;
+        return true;
+    }, &stats);
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    std::cout << "✓ " << stats.delivered << " messages from " << stats.requested - stats.failed << "/"
+              << stats.requested << " subjects in " << std::fixed << std::setprecision(1) << elapsed.count()
+              << " ms" << std::defaultfloat;
+    if (stats.duplicates) {
+        std::cout << " (" << stats.duplicates << " duplicates skipped)";
+    }
+    std::cout << std::endl << std::endl;
+}
+
+void example8_claim_check(HttpClient& client) {
+    std::cout << "=== Example 8: Claim Check for Large Payloads ===" << std::endl;
+
+    // Publisher and consumer share the blob directory
+    LocalBlobStore store("/tmp/natsgw-blobs");
+    ClaimCheckPublisher publisher(client, store);
+    ClaimCheckResolver resolver(store);
+
+    std::string report = R"({"report": "daily-settlements", "rows": [)";
+    for (int i = 0; i < 20000; ++i) {
+        report += (i ? "," : "") + std::string(R"({"id": )") + std::to_string(i) + R"(, "amount": 125.50})";
+    }
+    report += "]}";
+
+    nats::messages::PublishMessage message;
+    message.set_message_id(generate_uuid());
+    message.set_subject("reports.daily");
+    message.set_source("cpp-client");
+    message.set_data(report);
+    if (!publisher.publish("reports.daily", message)) {
+        return;
+    }
+
+    nats::messages::FetchResponse fetched;
+    if (!client.fetch("reports.daily", 1, &fetched) || fetched.messages_size() == 0) {
+        return;
+    }
+    std::cout << "✓ Published a " << report.size() << "-byte report; the stream holds a "
+              << fetched.messages(0).data().size() << "-byte message with the reference" << std::endl;
+    std::shared_ptr<const Blob> blob;
+    if (resolver.resolve(fetched.messages(0).data(), &blob) && blob) {
+        std::cout << "✓ Resolved " << blob->bytes().size() << " bytes from " << store.directory()
+                  << (blob->bytes() == report ? " (matches)" : " (differs!)") << std::endl;
+    }
+    std::cout << std::endl;
+}
+
 int main(int argc, char* argv[]) {
     // Initialize protobuf library
     GOOGLE_PROTOBUF_VERIFY_VERSION;
@@ -339,6 +323,10 @@ int main(int argc, char* argv[]) {
         example3_publish_payment_event(client);
         example4_fetch_messages(client, "events.test", 5);
         example4_fetch_messages(client, "events.user.created", 3);
+        example5_priority_lanes(base_url);
+        example6_conflated_state_updates(base_url);
+        example7_fetch_many(base_url);
+        example8_claim_check(client);
 
         std::cout << std::string(60, '=') << std::endl;
         std::cout << "✓ All examples completed successfully!" << std::endl;
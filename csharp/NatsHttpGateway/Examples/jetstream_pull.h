@@ -0,0 +1,524 @@
+/*
+ * JetStream pull consumer over the direct NATS transport
+ *
+ * Pulls with $JS.API.CONSUMER.MSG.NEXT.<stream>.<consumer> requests (batch,
+ * expires, idle heartbeats) on a NatsClient and hands messages back as the
+ * same FetchedMessage / FetchResponse the gateway's fetch endpoints return,
+ * without HTTP in the path.
+ *
+ *   fetch()    one pull request, returns what the consumer has (like the
+ *              gateway's fetch)
+ *   consume()  keeps `pipeline` pull requests outstanding, so the server is
+ *              already filling the next batch while the handler processes
+ *              the current one
+ *
+ * All pull requests share one delivery inbox. The server serves waiting
+ * requests in order, so messages and terminal statuses (404/408/409) are
+ * credited to the oldest outstanding request; a request that fails or times
+ * out on the client side drops only its own entry. Requests given up on
+ * after missed heartbeats stay queued (no longer counted as in flight) until
+ * their terminal status or their `expires` has passed, so late traffic for
+ * them is not credited to the requests that replace them. Acks follow the consumer's
+ * ack policy (read from CONSUMER.INFO at bind time) and go through the
+ * client's coalesced writes.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include "message.pb.h"
+#include "nats_client.h"
+#include "nats_json.h"
+#include "nats_protocol.h"
+
+enum class JsAckPolicy { None, All, Explicit };
+
+inline const char* js_ack_policy_name(JsAckPolicy policy) {
+    switch (policy) {
+        case JsAckPolicy::All: return "all";
+        case JsAckPolicy::Explicit: return "explicit";
+        default: return "none";
+    }
+}
+
+// Consumer definition for JetStreamPullConsumer::create()
+struct JsConsumerConfig {
+    std::string name;
+    bool durable = false;                  // false: removed after inactive_threshold
+    std::string filter_subject;
+    JsAckPolicy ack_policy = JsAckPolicy::None;
+    std::string deliver_policy = "all";    // all, last, new, by_start_sequence, by_start_time
+    uint64_t opt_start_seq = 0;
+    std::string opt_start_time;            // RFC 3339, for by_start_time
+    std::chrono::milliseconds inactive_threshold{30000};
+};
+
+struct PullOptions {
+    int batch = 256;
+    std::chrono::milliseconds expires{5000};
+    std::chrono::milliseconds idle_heartbeat{1000};   // 0 disables heartbeats
+    int pipeline = 2;                                 // pull requests kept in flight
+};
+
+struct PullStats {
+    uint64_t pulls = 0;        // MSG.NEXT requests sent
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t heartbeats = 0;
+    uint64_t expired = 0;      // requests ended by 404/408 before filling
+    uint64_t acks = 0;
+};
+
+class JetStreamPullConsumer {
+public:
+    // Return false to stop consume()
+    using BatchHandler = std::function<bool(const nats::messages::FetchResponse&)>;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // An outstanding pull request and the messages still owed to it
+    struct Pull {
+        uint64_t id;
+        int remaining;
+        bool pipelined;              // issued by consume()
+        bool abandoned;              // re-issued after missed heartbeats
+        Clock::time_point deadline;  // server has ended it by now
+    };
+
+    // Slack past `expires` before a request is assumed dead on the server
+    static constexpr std::chrono::seconds kExpiryGrace{2};
+
+    NatsClient& client_;
+    std::string stream_;
+    std::string consumer_;
+    PullOptions options_;
+    JsAckPolicy ack_policy_ = JsAckPolicy::None;
+    std::string next_subject_;
+    std::string inbox_;
+    uint64_t sid_ = 0;
+
+    // Shared with the client's reader thread
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<nats::messages::FetchedMessage> ready_;
+    std::deque<std::string> ack_subjects_;
+    std::deque<Pull> outstanding_;   // oldest first
+    uint64_t next_pull_ = 1;
+    Clock::time_point last_activity_;
+    std::string fatal_;
+    PullStats stats_;
+
+public:
+    JetStreamPullConsumer(NatsClient& client, const std::string& stream, const std::string& consumer,
+                          const PullOptions& options = PullOptions())
+        : client_(client)
+        , stream_(stream)
+        , consumer_(consumer)
+        , options_(options)
+        , next_subject_("$JS.API.CONSUMER.MSG.NEXT." + stream + "." + consumer)
+    {
+        options_.batch = std::max(1, options_.batch);
+        options_.pipeline = std::max(1, options_.pipeline);
+    }
+
+    ~JetStreamPullConsumer() {
+        if (sid_) {
+            client_.unsubscribe(sid_);
+        }
+    }
+
+    JetStreamPullConsumer(const JetStreamPullConsumer&) = delete;
+    JetStreamPullConsumer& operator=(const JetStreamPullConsumer&) = delete;
+
+    // Create (or update) a pull consumer on `stream`
+    static bool create(NatsClient& client, const std::string& stream, const JsConsumerConfig& config) {
+        std::string body = "{\"stream_name\":";
+        append_json_string(body, stream);
+        body.append(",\"config\":{\"name\":");
+        append_json_string(body, config.name);
+        if (config.durable) {
+            body.append(",\"durable_name\":");
+            append_json_string(body, config.name);
+        } else {
+            body.append(",\"inactive_threshold\":");
+            body.append(std::to_string(std::chrono::nanoseconds(config.inactive_threshold).count()));
+        }
+        if (!config.filter_subject.empty()) {
+            body.append(",\"filter_subject\":");
+            append_json_string(body, config.filter_subject);
+        }
+        body.append(",\"ack_policy\":\"").append(js_ack_policy_name(config.ack_policy)).append("\"");
+        body.append(",\"deliver_policy\":");
+        append_json_string(body, config.deliver_policy);
+        if (config.opt_start_seq) {
+            body.append(",\"opt_start_seq\":").append(std::to_string(config.opt_start_seq));
+        }
+        if (!config.opt_start_time.empty()) {
+            body.append(",\"opt_start_time\":");
+            append_json_string(body, config.opt_start_time);
+        }
+        body.append("}}");
+
+        std::string response;
+        return api_request(client, "$JS.API.CONSUMER.CREATE." + stream + "." + config.name, body, &response);
+    }
+
+    static bool remove(NatsClient& client, const std::string& stream, const std::string& name) {
+        std::string response;
+        return api_request(client, "$JS.API.CONSUMER.DELETE." + stream + "." + name, "", &response);
+    }
+
+    // $JS.API request; false (and reported) on no responders or an API error
+    static bool api_request(NatsClient& client, const std::string& subject, const std::string& body,
+                            std::string* response) {
+        int status = 0;
+        if (!client.request(subject, "", body, response, &status)) {
+            return false;
+        }
+        if (status == 503) {
+            std::cerr << "✗ JetStream not enabled (no responders on " << subject << ")" << std::endl;
+            return false;
+        }
+        if (json_field_start(*response, "error") != std::string_view::npos) {
+            std::string description;
+            json_string_field(*response, "description", &description);
+            std::cerr << "✗ JetStream API error: " << (description.empty() ? *response : description) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Look the consumer up, learn its ack policy and subscribe the delivery inbox
+    bool bind() {
+        std::string info;
+        if (!api_request(client_, "$JS.API.CONSUMER.INFO." + stream_ + "." + consumer_, "", &info)) {
+            return false;
+        }
+
+        std::string policy;
+        json_string_field(info, "ack_policy", &policy);
+        ack_policy_ = policy == "explicit" ? JsAckPolicy::Explicit
+                    : policy == "all"      ? JsAckPolicy::All
+                                           : JsAckPolicy::None;
+
+        inbox_ = client_.new_inbox();
+        sid_ = client_.subscribe(inbox_, [this](const NatsFrame& frame) { on_delivery(frame); });
+        return client_.flush();
+    }
+
+    JsAckPolicy ack_policy() const { return ack_policy_; }
+
+    PullStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    // One pull of up to `limit` messages. With no_wait the server answers
+    // immediately with whatever is pending; otherwise it waits up to
+    // `expires` for the batch to fill.
+    bool fetch(int limit, nats::messages::FetchResponse* response, bool no_wait = true) {
+        if (!sid_ && !bind()) {
+            return false;
+        }
+
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            id = next_pull_++;
+            outstanding_.push_back(Pull{id, limit, false, false, deadline()});
+        }
+        if (!send_pull(limit, no_wait)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            forget(id);
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        bool done = cv_.wait_for(lock, options_.expires + kExpiryGrace, [&] {
+            return !pending(id) || !fatal_.empty();
+        });
+        if (!done) {
+            forget(id);
+        }
+        if (!fatal_.empty()) {
+            std::cerr << "✗ " << fatal_ << std::endl;
+            return false;
+        }
+
+        // A timed-out pull still returns (and acks) whatever arrived for it;
+        // only an empty one is a failure, so nothing is acked unprocessed
+        std::deque<std::string> acks;
+        take(static_cast<size_t>(limit), response, &acks);
+        lock.unlock();
+        if (!done) {
+            std::cerr << "✗ Pull request on " << stream_ << "/" << consumer_ << " timed out";
+            if (response->count() == 0) {
+                std::cerr << std::endl;
+                return false;
+            }
+            std::cerr << ", returning " << response->count() << " messages" << std::endl;
+        }
+        ack(acks);
+        return true;
+    }
+
+    // Fetch and print (same output as HttpClient::fetch_messages)
+    bool fetch_messages(int limit = 10) {
+        nats::messages::FetchResponse response;
+        if (!fetch(limit, &response)) {
+            return false;
+        }
+
+        std::cout << "✓ Fetched " << response.count() << " messages from " << response.stream() << std::endl;
+        std::cout << "  Consumer: " << consumer_ << std::endl;
+        std::cout << "  Messages:" << std::endl;
+        for (const auto& msg : response.messages()) {
+            std::cout << "    [" << msg.sequence() << "] " << msg.subject() << std::endl;
+            std::cout << "        Size: " << msg.size_bytes() << " bytes" << std::endl;
+        }
+        return true;
+    }
+
+    // Pull continuously and hand batches of up to `batch` messages to the
+    // handler until it returns false, `max_messages` (0 = unlimited) have
+    // been delivered, or the consumer fails. Returns the messages delivered.
+    //
+    // When consume() returns, pulls that are still outstanding may deliver
+    // further messages that nobody processes; with an explicit ack policy the
+    // server redelivers them after ack_wait.
+    uint64_t consume(BatchHandler handler, uint64_t max_messages = 0) {
+        if (!sid_ && !bind()) {
+            return 0;
+        }
+
+        uint64_t delivered = 0;
+        auto heartbeat_timeout = options_.idle_heartbeat * 2 + std::chrono::milliseconds(500);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            last_activity_ = Clock::now();
+        }
+
+        while (max_messages == 0 || delivered < max_messages) {
+            top_up(max_messages ? max_messages - delivered : 0);
+
+            nats::messages::FetchResponse response;
+            std::deque<std::string> acks;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait_for(lock, std::chrono::milliseconds(100), [&] {
+                    return !ready_.empty() || !fatal_.empty() || pipelined() < options_.pipeline;
+                });
+                if (!fatal_.empty()) {
+                    std::cerr << "✗ " << fatal_ << std::endl;
+                    break;
+                }
+                if (ready_.empty()) {
+                    auto now = Clock::now();
+                    if (options_.idle_heartbeat.count() > 0 && pipelined() > 0 &&
+                        now - last_activity_ > heartbeat_timeout) {
+                        std::cerr << "✗ Missed heartbeats from " << stream_ << "/" << consumer_
+                                  << ", re-issuing pull requests" << std::endl;
+                        for (Pull& pull : outstanding_) {
+                            if (pull.pipelined) pull.abandoned = true;
+                        }
+                        last_activity_ = now;
+                    }
+                    outstanding_.erase(std::remove_if(outstanding_.begin(), outstanding_.end(),
+                                                      [&](const Pull& pull) { return pull.deadline < now; }),
+                                       outstanding_.end());
+                    continue;
+                }
+                size_t limit = static_cast<size_t>(options_.batch);
+                if (max_messages) {
+                    limit = std::min<uint64_t>(limit, max_messages - delivered);
+                }
+                take(limit, &response, &acks);
+            }
+
+            delivered += response.count();
+            bool keep_going = handler(response);
+            ack(acks);
+            if (!keep_going) {
+                break;
+            }
+        }
+        return delivered;
+    }
+
+private:
+    bool send_pull(int batch, bool no_wait) {
+        std::string body = "{\"batch\":" + std::to_string(batch) +
+                           ",\"expires\":" + std::to_string(std::chrono::nanoseconds(options_.expires).count());
+        if (no_wait) {
+            body.append(",\"no_wait\":true");
+        } else if (options_.idle_heartbeat.count() > 0 && options_.idle_heartbeat * 2 <= options_.expires) {
+            body.append(",\"idle_heartbeat\":")
+                .append(std::to_string(std::chrono::nanoseconds(options_.idle_heartbeat).count()));
+        }
+        body.push_back('}');
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.pulls++;
+        }
+        return client_.publish_raw(next_subject_, body, {}, inbox_);
+    }
+
+    // Keep `pipeline` requests in flight without pulling past `remaining`
+    // (0 = unlimited) messages
+    void top_up(uint64_t remaining) {
+        while (true) {
+            int batch;
+            uint64_t id;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (pipelined() >= options_.pipeline || !fatal_.empty()) {
+                    return;
+                }
+                uint64_t credited = ready_.size();
+                for (const Pull& pull : outstanding_) {
+                    if (pull.pipelined && !pull.abandoned) credited += static_cast<uint64_t>(pull.remaining);
+                }
+                batch = options_.batch;
+                if (remaining) {
+                    if (credited >= remaining) return;
+                    batch = static_cast<int>(std::min<uint64_t>(batch, remaining - credited));
+                }
+                id = next_pull_++;
+                outstanding_.push_back(Pull{id, batch, true, false, deadline()});
+            }
+            if (!send_pull(batch, false)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                forget(id);
+                fatal_ = "Lost connection to NATS";
+                return;
+            }
+        }
+    }
+
+    Clock::time_point deadline() const {
+        return Clock::now() + options_.expires + kExpiryGrace;
+    }
+
+    // Caller holds mutex_
+    int pipelined() const {
+        int count = 0;
+        for (const Pull& pull : outstanding_) {
+            if (pull.pipelined && !pull.abandoned) count++;
+        }
+        return count;
+    }
+
+    // Caller holds mutex_
+    bool pending(uint64_t id) const {
+        for (const Pull& pull : outstanding_) {
+            if (pull.id == id) return true;
+        }
+        return false;
+    }
+
+    // Caller holds mutex_; drops one request's entry, leaving the others
+    void forget(uint64_t id) {
+        for (auto it = outstanding_.begin(); it != outstanding_.end(); ++it) {
+            if (it->id == id) {
+                outstanding_.erase(it);
+                return;
+            }
+        }
+    }
+
+    // Caller holds mutex_
+    void take(size_t limit, nats::messages::FetchResponse* response, std::deque<std::string>* acks) {
+        response->set_subject(consumer_);
+        response->set_stream(stream_);
+        size_t n = std::min(limit, ready_.size());
+        for (size_t i = 0; i < n; ++i) {
+            *response->add_messages() = std::move(ready_.front());
+            ready_.pop_front();
+            if (ack_policy_ != JsAckPolicy::None) {
+                acks->push_back(std::move(ack_subjects_.front()));
+                ack_subjects_.pop_front();
+            }
+        }
+        response->set_count(response->messages_size());
+    }
+
+    void ack(const std::deque<std::string>& acks) {
+        if (acks.empty()) {
+            return;
+        }
+        if (ack_policy_ == JsAckPolicy::All) {
+            client_.publish_raw(acks.back(), "+ACK");
+        } else {
+            for (const auto& subject : acks) {
+                client_.publish_raw(subject, "+ACK");
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.acks += ack_policy_ == JsAckPolicy::All ? 1 : acks.size();
+    }
+
+    // Reader thread: messages and status frames on the delivery inbox
+    void on_delivery(const NatsFrame& frame) {
+        int status = header_status(frame.headers);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            last_activity_ = Clock::now();
+
+            if (status == 0) {
+                JsMessageInfo js;
+                nats::messages::FetchedMessage message;
+                message.set_subject(frame.subject.data(), frame.subject.size());
+                message.set_data(frame.payload.data(), frame.payload.size());
+                message.set_size_bytes(static_cast<int32_t>(frame.payload.size()));
+                message.set_stream(stream_);
+                if (parse_js_ack_subject(frame.reply, &js)) {
+                    message.set_sequence(js.stream_sequence);
+                    message.mutable_timestamp()->set_seconds(static_cast<int64_t>(js.timestamp_ns / 1000000000ULL));
+                    message.mutable_timestamp()->set_nanos(static_cast<int32_t>(js.timestamp_ns % 1000000000ULL));
+                }
+                ready_.push_back(std::move(message));
+                if (ack_policy_ != JsAckPolicy::None) {
+                    ack_subjects_.emplace_back(frame.reply);
+                }
+                stats_.messages++;
+                stats_.bytes += frame.payload.size();
+
+                if (!outstanding_.empty() && --outstanding_.front().remaining <= 0) {
+                    outstanding_.pop_front();
+                }
+            } else if (status == 100) {
+                stats_.heartbeats++;
+                return;
+            } else if (status == 404 || status == 408) {
+                // No messages / request expired: the oldest request is finished
+                stats_.expired++;
+                if (!outstanding_.empty()) {
+                    outstanding_.pop_front();
+                }
+            } else {
+                std::string_view line = frame.headers.substr(0, frame.headers.find("\r\n"));
+                std::string description(line.size() > 13 ? line.substr(13) : std::string_view());
+                if (description.find("Consumer Deleted") != std::string::npos ||
+                    description.find("Consumer is push based") != std::string::npos) {
+                    fatal_ = "Pull consumer " + stream_ + "/" + consumer_ + ": " + description;
+                } else {
+                    // 409 Exceeded MaxWaiting / MaxRequestBatch / Leadership Change ...
+                    std::cerr << "✗ Pull request rejected: " << status << " " << description << std::endl;
+                    if (!outstanding_.empty()) {
+                        outstanding_.pop_front();
+                    }
+                }
+            }
+        }
+        cv_.notify_all();
+    }
+};
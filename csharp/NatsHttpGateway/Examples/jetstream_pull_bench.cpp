@@ -0,0 +1,178 @@
+/*
+ * JetStream pull consumer throughput over the direct NATS transport
+ *
+ * Fills a stream (optional), then drains it through fresh ephemeral pull
+ * consumers with pipeline depth 1 (request, wait, process, request again)
+ * and with the configured depth (next batch already requested while the
+ * current one is processed), and reports messages per second for each.
+ * --work-us simulates per-message processing time in the handler, which is
+ * where pipelining pays off: the server fills the next batch meanwhile.
+ * --json writes the results for bench_compare (bench_report.h).
+ *
+ * Works against a real nats-server (`nats-server -js`; the stream must
+ * exist, e.g. `nats stream add BENCH --subjects 'bench.>'`) or
+ * mock_nats_server.cpp.
+ *
+ * Requirements:
+ *   - Boost.Asio, Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 jetstream_pull_bench.cpp message.pb.cc \
+ *       -lprotobuf -lboost_system -pthread -o jetstream_pull_bench
+ *
+ * Usage:
+ *   ./jetstream_pull_bench [nats_url] [--stream BENCH] [--subject bench.pull]
+ *                          [--fill 200000] [--batch 256] [--pipeline 4] [--ack]
+ *                          [--work-us 0] [--json FILE]
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "bench_report.h"
+#include "jetstream_pull.h"
+#include "message.pb.h"
+#include "nats_client.h"
+
+using Clock = std::chrono::steady_clock;
+
+static bool run(NatsClient& client, const std::string& stream, const std::string& subject,
+                uint64_t messages, const PullOptions& options, bool ack, int work_us, int run_id,
+                BenchReport& report) {
+    JsConsumerConfig config;
+    config.name = "pull-bench-" + std::to_string(run_id);
+    config.filter_subject = subject;
+    config.ack_policy = ack ? JsAckPolicy::Explicit : JsAckPolicy::None;
+    if (!JetStreamPullConsumer::create(client, stream, config)) {
+        return false;
+    }
+
+    uint64_t delivered = 0;
+    uint64_t batches = 0;
+    double seconds = 0;
+    PullStats stats;
+    {
+        JetStreamPullConsumer consumer(client, stream, config.name, options);
+        auto start = Clock::now();
+        delivered = consumer.consume([&](const nats::messages::FetchResponse& batch) {
+            batches++;
+            if (work_us > 0) {
+                auto until = Clock::now() + std::chrono::microseconds(work_us) * batch.count();
+                while (Clock::now() < until) {}
+            }
+            return batch.count() > 0;
+        }, messages);
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        stats = consumer.stats();
+    }
+    JetStreamPullConsumer::remove(client, stream, config.name);
+
+    std::cout << std::left << std::setw(10) << options.pipeline
+              << std::right << std::setw(10) << options.batch
+              << std::setw(12) << delivered
+              << std::setw(14) << std::fixed << std::setprecision(0) << delivered / seconds
+              << std::setw(10) << stats.pulls
+              << std::setw(10) << batches
+              << std::setw(10) << stats.acks << std::endl;
+    report.metric("pipeline " + std::to_string(options.pipeline), "msgs_per_s", delivered / seconds, Better::Higher);
+    return delivered == messages;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string url = "nats://localhost:4222";
+    std::string stream = "BENCH";
+    std::string subject = "bench.pull";
+    uint64_t fill = 200000;
+    PullOptions options;
+    options.pipeline = 4;
+    bool ack = false;
+    int work_us = 0;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--stream" && i + 1 < argc) {
+            stream = argv[++i];
+        } else if (arg == "--subject" && i + 1 < argc) {
+            subject = argv[++i];
+        } else if (arg == "--fill" && i + 1 < argc) {
+            fill = std::stoull(argv[++i]);
+        } else if (arg == "--batch" && i + 1 < argc) {
+            options.batch = std::stoi(argv[++i]);
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            options.pipeline = std::stoi(argv[++i]);
+        } else if (arg == "--work-us" && i + 1 < argc) {
+            work_us = std::stoi(argv[++i]);
+        } else if (arg == "--ack") {
+            ack = true;
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            url = arg;
+        }
+    }
+
+    try {
+        NatsClient client(url, 0, "jetstream-pull-bench");
+        client.connect();
+
+        // Fill with fire-and-forget publishes, then one acked publish so the
+        // stream has stored everything before the consumers are created
+        nats::messages::PublishMessage message;
+        message.set_source("jetstream-pull-bench");
+        message.set_data(std::string(256, 'x'));
+        for (uint64_t i = 1; i < fill; ++i) {
+            client.publish(subject, message);
+        }
+        nats::messages::PublishAck last;
+        if (fill > 0 && !client.publish(subject, message, &last)) {
+            return 1;
+        }
+        std::cout << "✓ Stream " << stream << " holds " << last.sequence() << " messages" << std::endl;
+
+        // Same FetchedMessage shape as HttpClient::fetch_messages
+        JsConsumerConfig peek;
+        peek.name = "pull-bench-peek";
+        peek.filter_subject = subject;
+        peek.deliver_policy = "last";
+        if (JetStreamPullConsumer::create(client, stream, peek)) {
+            JetStreamPullConsumer consumer(client, stream, peek.name);
+            consumer.fetch_messages(5);
+            JetStreamPullConsumer::remove(client, stream, peek.name);
+        }
+
+        std::cout << std::endl;
+        std::cout << std::left << std::setw(10) << "pipeline"
+                  << std::right << std::setw(10) << "batch"
+                  << std::setw(12) << "messages"
+                  << std::setw(14) << "msg/s"
+                  << std::setw(10) << "pulls"
+                  << std::setw(10) << "batches"
+                  << std::setw(10) << "acks" << std::endl;
+
+        PullOptions serial = options;
+        serial.pipeline = 1;
+        BenchReport report(argc, argv);
+        bool ok = run(client, stream, subject, fill, serial, ack, work_us, 1, report);
+        ok = run(client, stream, subject, fill, options, ack, work_us, 2, report) && ok;
+
+        client.close();
+        if (!report.write(json_path)) {
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "✗ Not every message was delivered" << std::endl;
+            return 1;
+        }
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * JetStream pull consumer lifetime test
+ *
+ * Starts mock_nats_server on a spare port and checks that a subscription
+ * handler never runs after NatsClient::unsubscribe() has returned: first
+ * with a slow dedicated handler, then by repeatedly creating pull consumers
+ * for new messages on a stream that keeps being published to, consuming a
+ * few and destroying them while their pipelined pulls are still being
+ * filled (build with -fsanitize=address to see a violation reported).
+ *
+ * Requirements:
+ *   - Protobuf, Boost.Asio
+ *   - mock_nats_server (built alongside)
+ *
+ * Usage:
+ *   ./jetstream_pull_test [mock_nats_server path] [port]
+ *   ./jetstream_pull_test ./mock_nats_server 14222
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "jetstream_pull.h"
+#include "message.pb.h"
+#include "nats_client.h"
+
+extern char** environ;
+
+// Runs mock_nats_server until destroyed
+class MockServer {
+    pid_t pid_ = 0;
+
+public:
+    MockServer(const std::string& path, const std::string& port) {
+        std::string quiet = "/dev/null";
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, quiet.c_str(), O_WRONLY, 0);
+        char* argv[] = {const_cast<char*>(path.c_str()), const_cast<char*>(port.c_str()), nullptr};
+        if (posix_spawn(&pid_, path.c_str(), &actions, nullptr, argv, environ) != 0) {
+            pid_ = 0;
+        }
+        posix_spawn_file_actions_destroy(&actions);
+    }
+
+    ~MockServer() {
+        if (pid_ > 0) {
+            kill(pid_, SIGTERM);
+            waitpid(pid_, nullptr, 0);
+        }
+    }
+
+    // False once the server has exited (e.g. the port was taken)
+    bool running() {
+        if (pid_ > 0 && waitpid(pid_, nullptr, WNOHANG) == pid_) {
+            pid_ = 0;
+        }
+        return pid_ > 0;
+    }
+};
+
+// The server needs a moment to bind; retry until it accepts
+static std::unique_ptr<NatsClient> connect(const std::string& url) {
+    for (int attempt = 0; attempt < 50; ++attempt) {
+        try {
+            auto client = std::make_unique<NatsClient>(url, 0, "jetstream-pull-test");
+            client->set_quiet(true);
+            client->connect();
+            return client;
+        } catch (std::exception const&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    return nullptr;
+}
+
+// A slow dedicated handler must have finished once unsubscribe() returns
+static int unsubscribe_while_dispatching(NatsClient& client, int rounds) {
+    std::atomic<int> late{0};
+    for (int i = 0; i < rounds; ++i) {
+        auto calls = std::make_shared<std::atomic<int>>(0);
+        auto released = std::make_shared<std::atomic<bool>>(false);
+        std::string inbox = client.new_inbox();
+        uint64_t sid = client.subscribe(inbox, [calls, released, &late](const NatsFrame&) {
+            (*calls)++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            if (*released) late++;
+        });
+        client.flush();
+        for (int j = 0; j < 20; ++j) {
+            client.publish_raw(inbox, "x");
+        }
+        while (*calls == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        client.unsubscribe(sid);
+        *released = true;
+    }
+    client.flush();
+    return late;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string server_path = argc > 1 ? argv[1] : "./mock_nats_server";
+    std::string port = argc > 2 ? argv[2] : "14222";
+    const std::string stream = "CHURN";
+    const std::string subject = "churn.pull";
+    const int consumers = 200;
+
+    MockServer server(server_path, port);
+    if (!server.running()) {
+        std::cerr << "✗ Could not start " << server_path << std::endl;
+        return 1;
+    }
+    auto client = connect("nats://localhost:" + port);
+    if (!client || !server.running()) {
+        std::cerr << "✗ Could not connect to the mock server on port " << port << std::endl;
+        return 1;
+    }
+
+    nats::messages::PublishMessage message;
+    message.set_source("jetstream-pull-test");
+    message.set_data(std::string(64, 'x'));
+    nats::messages::PublishAck last;
+    if (!client->publish(subject, message, &last)) {
+        return 1;
+    }
+
+    int late = unsubscribe_while_dispatching(*client, 50);
+    if (late > 0) {
+        std::cerr << "✗ " << late << " handler calls finished after unsubscribe() returned" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ unsubscribe() waited for running handlers" << std::endl;
+
+    // Keep new messages arriving while consumers come and go
+    std::atomic<bool> stop{false};
+    std::thread publisher([&] {
+        while (!stop) {
+            client->publish(subject, message);
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    });
+
+    PullOptions options;
+    options.batch = 64;
+    options.pipeline = 4;
+    int failures = 0;
+    for (int i = 1; i <= consumers; ++i) {
+        JsConsumerConfig config;
+        config.name = "churn-" + std::to_string(i);
+        config.filter_subject = subject;
+        config.deliver_policy = "new";
+        if (!JetStreamPullConsumer::create(*client, stream, config)) {
+            failures++;
+            continue;
+        }
+        {
+            // Returns after 10 messages with ~250 more owed to outstanding pulls,
+            // which the publisher keeps filling during the destructor
+            JetStreamPullConsumer consumer(*client, stream, config.name, options);
+            if (consumer.consume([](const nats::messages::FetchResponse&) { return true; }, 10) != 10) {
+                failures++;
+            }
+        }
+        JetStreamPullConsumer::remove(*client, stream, config.name);
+    }
+
+    stop = true;
+    publisher.join();
+    client->close();
+
+    if (failures > 0) {
+        std::cerr << "✗ " << failures << " of " << consumers << " consumers failed" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Destroyed " << consumers << " consumers with pulls in flight" << std::endl;
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,384 @@
+/*
+ * LagAdvisor - backlog forecasts and worker/batch advice from consumer state
+ *
+ * Fed periodic samples of durable consumers' state (ConsumerInfo, from
+ * GET /api/consumers/{stream} or /api/consumers/{stream}/{consumer}), it
+ * estimates for each consumer
+ *
+ *   ingest   msg/s arriving for it        slope of numPending + delivered
+ *   drain    msg/s its workers complete   slope of delivered - ackPending
+ *
+ * as least-squares slopes over the last `window`, and from them how long
+ * the backlog (numPending + ackPending) takes to clear or how fast it
+ * grows. A redelivery bumps `delivered` without completing anything; it
+ * inflates both rates equally and cancels out of their difference.
+ *
+ * Sizing workers needs to know what one worker can do. While a consumer
+ * had undelivered messages throughout the window, its workers were never
+ * idle, so drain / workers is their capacity. The advisor keeps a moving
+ * average of that and sizes for
+ *
+ *   required = ingest * headroom + backlog / drain_target
+ *   workers  = ceil(required / capacity)
+ *
+ * Until it has seen a consumer saturated it can only tell whether the
+ * current workers keep up. The batch size is what one worker needs per
+ * batch_interval at the required rate, capped by the gateway's fetch
+ * limit, by maxAckPending shared between the workers, and by what a worker
+ * finishes within half the ack wait.
+ *
+ * There is no I/O here: the caller fetches and calls observe(). A sample
+ * costs a deque append; advice is O(samples in the window). One list call
+ * returns the state of every consumer on a stream, while the info endpoint
+ * also looks the stream up on each call, so sampling every consumer every
+ * few seconds costs one request per stream.
+ *
+ * Requirements:
+ *   - consumer_api.h (ConsumerInfo, ConsumerHealth; libcurl)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "consumer_api.h"
+
+struct AdvisorOptions {
+    std::chrono::seconds window{60};              // rates are fitted over this much history
+    std::chrono::seconds drain_target{300};       // clear an existing backlog within this
+    double headroom = 1.2;                        // capacity to keep above the ingest rate
+    std::chrono::milliseconds batch_interval{1000};   // time one fetched batch should cover
+    int max_batch = 100;                          // the gateway's fetch limit
+    int max_workers = 256;
+    double capacity_smoothing = 0.3;              // weight of the newest capacity estimate
+};
+
+struct ConsumerAdvice {
+    enum class Trend { Unknown, Idle, Draining, Steady, Growing, Stalled };
+
+    std::string stream;
+    std::string consumer;
+    Trend trend = Trend::Unknown;
+    double ingest_rate = 0;         // msg/s
+    double drain_rate = 0;          // msg/s
+    double backlog_rate = 0;        // msg/s; ingest - drain
+    uint64_t backlog = 0;           // numPending + ackPending
+    double time_to_drain_s = -1;    // -1: not shrinking at the current rates
+    double worker_capacity = 0;     // msg/s per worker; 0 = not measured yet
+    int workers = 1;                // as configured with set_workers()
+    int recommended_workers = 0;    // 0 = no recommendation
+    int recommended_batch = 0;
+    bool healthy = true;
+    std::string health_status;      // from the health endpoint, when sampled
+    size_t samples = 0;
+    double window_s = 0;            // history the rates were fitted over
+    std::string reason;
+
+    static const char* trend_name(Trend trend) {
+        switch (trend) {
+            case Trend::Unknown: return "unknown";
+            case Trend::Idle: return "idle";
+            case Trend::Draining: return "draining";
+            case Trend::Steady: return "steady";
+            case Trend::Growing: return "growing";
+            case Trend::Stalled: return "stalled";
+        }
+        return "?";
+    }
+};
+
+class LagAdvisor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Sample {
+        Clock::time_point at;
+        double arrived;      // numPending + delivered
+        double completed;    // delivered - ackPending
+        uint64_t backlog;
+        bool undelivered;    // numPending > 0
+    };
+
+    struct Track {
+        std::deque<Sample> samples;
+        ConsumerInfo last;
+        ConsumerHealth health;
+        bool have_health = false;
+        int workers = 1;
+        double capacity = 0;
+        Clock::time_point seen;
+    };
+
+    AdvisorOptions options_;
+    int default_workers_ = 1;
+    std::map<std::pair<std::string, std::string>, int> workers_;   // set_workers(), kept across expire()
+    std::map<std::pair<std::string, std::string>, Track> tracks_;
+
+    struct Fit {
+        double ingest = 0;
+        double drain = 0;
+        double span_s = 0;
+        size_t count = 0;
+        bool saturated = true;
+    };
+
+    // Least-squares slopes of the counters over the window
+    Fit fit(const Track& track) const {
+        Fit f;
+        const auto& s = track.samples;
+        f.count = s.size();
+        if (s.size() < 2) return f;
+        double n = static_cast<double>(s.size());
+        double mean_t = 0, mean_a = 0, mean_c = 0;
+        for (const Sample& x : s) {
+            mean_t += std::chrono::duration<double>(x.at - s.front().at).count();
+            mean_a += x.arrived - s.front().arrived;
+            mean_c += x.completed - s.front().completed;
+        }
+        mean_t /= n;
+        mean_a /= n;
+        mean_c /= n;
+        double stt = 0, sta = 0, stc = 0;
+        for (const Sample& x : s) {
+            double t = std::chrono::duration<double>(x.at - s.front().at).count() - mean_t;
+            stt += t * t;
+            sta += t * (x.arrived - s.front().arrived - mean_a);
+            stc += t * (x.completed - s.front().completed - mean_c);
+            f.saturated = f.saturated && x.undelivered;
+        }
+        f.span_s = std::chrono::duration<double>(s.back().at - s.front().at).count();
+        if (stt > 0) {
+            f.ingest = std::max(0.0, sta / stt);
+            f.drain = std::max(0.0, stc / stt);
+        }
+        return f;
+    }
+
+public:
+    explicit LagAdvisor(AdvisorOptions options = {}) : options_(options) {
+        if (options_.window.count() <= 0) options_.window = std::chrono::seconds(1);
+        if (options_.drain_target.count() <= 0) options_.drain_target = std::chrono::seconds(1);
+        options_.max_batch = std::max(1, options_.max_batch);
+        options_.max_workers = std::max(1, options_.max_workers);
+    }
+
+    const AdvisorOptions& options() const { return options_; }
+
+    // Workers currently fetching from a consumer (default 1)
+    void set_default_workers(int workers) { default_workers_ = std::max(1, workers); }
+
+    void set_workers(const std::string& stream, const std::string& consumer, int workers) {
+        workers_[{stream, consumer}] = std::max(1, workers);
+    }
+
+    void observe(const ConsumerInfo& info, Clock::time_point now = Clock::now()) {
+        Track& track = tracks_[{info.stream, info.name}];
+        auto configured = workers_.find({info.stream, info.name});
+        track.workers = configured != workers_.end() ? configured->second : default_workers_;
+        // Counters going back: the consumer was reset or recreated
+        if (!track.samples.empty() && info.delivered < track.last.delivered) {
+            track.samples.clear();
+        }
+        Sample s;
+        s.at = now;
+        s.arrived = static_cast<double>(info.num_pending + info.delivered);
+        s.completed = static_cast<double>(info.delivered - std::min(info.delivered, info.ack_pending));
+        s.backlog = info.num_pending + info.ack_pending;
+        s.undelivered = info.num_pending > 0;
+        track.samples.push_back(s);
+        while (track.samples.size() > 2 && now - track.samples[1].at >= options_.window) {
+            track.samples.pop_front();
+        }
+        track.last = info;
+        track.seen = now;
+
+        // Workers never ran dry over the window: what they drained is what they can do
+        Fit f = fit(track);
+        if (f.saturated && f.count >= 3 && f.span_s >= 0.5 * options_.window.count() && f.drain > 0) {
+            double per_worker = f.drain / track.workers;
+            track.capacity = track.capacity > 0
+                ? options_.capacity_smoothing * per_worker + (1 - options_.capacity_smoothing) * track.capacity
+                : per_worker;
+        }
+    }
+
+    void observe_health(const std::string& stream, const std::string& consumer, const ConsumerHealth& health) {
+        Track& track = tracks_[{stream, consumer}];
+        track.health = health;
+        track.have_health = true;
+    }
+
+    // Drop consumers not sampled since `before` (deleted, or out of scope)
+    size_t expire(Clock::time_point before) {
+        size_t removed = 0;
+        for (auto it = tracks_.begin(); it != tracks_.end();) {
+            if (it->second.seen < before) {
+                it = tracks_.erase(it);
+                removed++;
+            } else {
+                ++it;
+            }
+        }
+        return removed;
+    }
+
+    ConsumerAdvice advise(const std::string& stream, const std::string& consumer) const {
+        ConsumerAdvice a;
+        a.stream = stream;
+        a.consumer = consumer;
+        auto it = tracks_.find({stream, consumer});
+        if (it == tracks_.end() || it->second.samples.empty()) {
+            a.reason = "no samples";
+            return a;
+        }
+        const Track& track = it->second;
+        Fit f = fit(track);
+        a.samples = f.count;
+        a.window_s = f.span_s;
+        a.backlog = track.samples.back().backlog;
+        a.workers = track.workers;
+        a.worker_capacity = track.capacity;
+        a.healthy = track.have_health ? track.health.healthy : track.last.healthy;
+        a.health_status = track.have_health ? track.health.status : "";
+        if (f.count < 2 || f.span_s <= 0) {
+            a.reason = "collecting samples";
+            return a;
+        }
+        a.ingest_rate = f.ingest;
+        a.drain_rate = f.drain;
+        a.backlog_rate = f.ingest - f.drain;
+
+        // Below this the backlog is flat: sampling noise, not a trend
+        double flat = std::max(0.5, 0.02 * f.ingest);
+        if (a.backlog == 0) {
+            a.trend = f.ingest < flat ? ConsumerAdvice::Trend::Idle : ConsumerAdvice::Trend::Steady;
+        } else if (a.backlog > 0 && f.drain == 0) {
+            a.trend = ConsumerAdvice::Trend::Stalled;
+        } else if (a.backlog_rate < -flat) {
+            a.trend = ConsumerAdvice::Trend::Draining;
+        } else if (a.backlog_rate > flat) {
+            a.trend = ConsumerAdvice::Trend::Growing;
+        } else {
+            a.trend = ConsumerAdvice::Trend::Steady;
+        }
+        if (a.backlog == 0) {
+            a.time_to_drain_s = 0;
+        } else if (a.trend == ConsumerAdvice::Trend::Draining) {
+            a.time_to_drain_s = a.backlog / -a.backlog_rate;
+        }
+
+        double required = f.ingest * options_.headroom +
+                          static_cast<double>(a.backlog) / options_.drain_target.count();
+        char text[160];
+        if (a.trend == ConsumerAdvice::Trend::Stalled) {
+            std::snprintf(text, sizeof(text), "nothing completed in %.0f s with %llu waiting: check the workers",
+                          f.span_s, static_cast<unsigned long long>(a.backlog));
+            a.reason = text;
+        } else if (track.capacity > 0) {
+            a.recommended_workers = std::min(options_.max_workers,
+                                             std::max(1, static_cast<int>(std::ceil(required / track.capacity))));
+            std::snprintf(text, sizeof(text), "%.1f msg/s needed (ingest x %.1f + backlog over %llds), "
+                          "%.1f msg/s per worker", required, options_.headroom,
+                          static_cast<long long>(options_.drain_target.count()), track.capacity);
+            a.reason = text;
+        } else if (a.trend == ConsumerAdvice::Trend::Growing) {
+            a.reason = "falling behind; capacity not measured yet";
+        } else {
+            a.reason = "keeping up; capacity not measured yet";
+        }
+
+        int sizing_workers = a.recommended_workers > 0 ? a.recommended_workers : a.workers;
+        double per_worker = required / sizing_workers;
+        double batch = std::ceil(per_worker * std::chrono::duration<double>(options_.batch_interval).count());
+        batch = std::min(batch, static_cast<double>(options_.max_batch));
+        if (track.last.max_ack_pending > 0) {
+            batch = std::min(batch, static_cast<double>(track.last.max_ack_pending / sizing_workers));
+        }
+        if (track.last.ack_wait_s > 0 && track.capacity > 0) {
+            batch = std::min(batch, std::floor(track.capacity * track.last.ack_wait_s / 2));
+        }
+        a.recommended_batch = std::max(1, static_cast<int>(batch));
+        return a;
+    }
+
+    std::vector<ConsumerAdvice> advise_all() const {
+        std::vector<ConsumerAdvice> all;
+        all.reserve(tracks_.size());
+        for (const auto& entry : tracks_) {
+            all.push_back(advise(entry.first.first, entry.first.second));
+        }
+        return all;
+    }
+
+    // Prometheus text exposition of advise_all()
+    void write_metrics(std::string* out) const {
+        std::vector<ConsumerAdvice> all = advise_all();
+        struct Gauge {
+            const char* name;
+            const char* help;
+            double (*value)(const ConsumerAdvice&);
+        };
+        static const Gauge gauges[] = {
+            {"natsgw_advisor_backlog_messages", "Messages pending delivery or acknowledgement",
+             [](const ConsumerAdvice& a) { return static_cast<double>(a.backlog); }},
+            {"natsgw_advisor_ingest_rate", "Messages per second arriving for the consumer",
+             [](const ConsumerAdvice& a) { return a.ingest_rate; }},
+            {"natsgw_advisor_drain_rate", "Messages per second the workers complete",
+             [](const ConsumerAdvice& a) { return a.drain_rate; }},
+            {"natsgw_advisor_time_to_drain_seconds", "Time to clear the backlog at current rates (+Inf: not shrinking)",
+             [](const ConsumerAdvice& a) { return a.time_to_drain_s < 0 ? HUGE_VAL : a.time_to_drain_s; }},
+            {"natsgw_advisor_worker_capacity", "Measured messages per second per worker (0: not measured)",
+             [](const ConsumerAdvice& a) { return a.worker_capacity; }},
+            {"natsgw_advisor_workers", "Workers configured for the consumer",
+             [](const ConsumerAdvice& a) { return static_cast<double>(a.workers); }},
+            {"natsgw_advisor_recommended_workers", "Workers needed for ingest plus backlog (0: no advice)",
+             [](const ConsumerAdvice& a) { return static_cast<double>(a.recommended_workers); }},
+            {"natsgw_advisor_recommended_batch", "Messages per fetch",
+             [](const ConsumerAdvice& a) { return static_cast<double>(a.recommended_batch); }},
+            {"natsgw_advisor_trend", "0 unknown, 1 idle, 2 draining, 3 steady, 4 growing, 5 stalled",
+             [](const ConsumerAdvice& a) { return static_cast<double>(a.trend); }},
+            {"natsgw_advisor_healthy", "Gateway health verdict (1 healthy)",
+             [](const ConsumerAdvice& a) { return a.healthy ? 1.0 : 0.0; }},
+        };
+        for (const Gauge& g : gauges) {
+            *out += std::string("# HELP ") + g.name + " " + g.help + "\n# TYPE " + g.name + " gauge\n";
+            for (const ConsumerAdvice& a : all) {
+                *out += g.name;
+                *out += "{stream=\"" + label(a.stream) + "\",consumer=\"" + label(a.consumer) + "\"} ";
+                *out += number(g.value(a));
+                *out += "\n";
+            }
+        }
+    }
+
+    static std::string number(double value) {
+        if (std::isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+        if (std::isnan(value)) return "NaN";
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.6g", value);
+        return text;
+    }
+
+private:
+    static std::string label(const std::string& value) {
+        std::string out;
+        for (char c : value) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') {
+                out += "\\n";
+                continue;
+            }
+            out += c;
+        }
+        return out;
+    }
+};
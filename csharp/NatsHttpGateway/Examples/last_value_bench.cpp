@@ -0,0 +1,267 @@
+/*
+ * Benchmark: last-value view reads under a concurrent writer, and snapshot
+ * save/restore
+ *
+ * One writer applies updates over --keys keys as fast as it can while
+ * --readers threads look up random keys. This runs once on LastValueView
+ * (last_value_view.h) and once on the obvious alternative, an unordered_map
+ * behind a mutex. Reports reads/s, writes/s and read latency percentiles.
+ * Then saves the view to a snapshot file, loads it into a fresh view, and
+ * checks that both hold the same entries. --json writes the results for
+ * bench_compare (bench_report.h).
+ *
+ * No network: messages are built in memory.
+ *
+ * Requirements:
+ *   - Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 last_value_bench.cpp message.pb.cc \
+ *       -lprotobuf -pthread -o last_value_bench
+ *
+ * Usage:
+ *   ./last_value_bench [--keys 100000] [--readers 4] [--seconds 2]
+ *                      [--payload 256] [--snapshot /tmp/last_value.snap] [--json FILE]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "bench_report.h"
+#include "last_value_view.h"
+#include "message.pb.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double reads_per_sec = 0;
+    double writes_per_sec = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double max_ns = 0;
+    std::vector<double> latencies_ns;
+};
+
+// The baseline: one lock for readers and the writer
+class LockedMap {
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, LastValueView::Entry> entries_;
+
+public:
+    void apply(const nats::messages::StreamMessage& message) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& entry = entries_[message.subject()];
+        if (entry.sequence >= message.sequence()) return;
+        entry.subject = message.subject();
+        entry.sequence = message.sequence();
+        entry.timestamp_ns = message.timestamp().seconds() * 1000000000LL + message.timestamp().nanos();
+        entry.data = message.data();
+    }
+
+    bool get(const std::string& key, LastValueView::Entry* out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) return false;
+        *out = it->second;
+        return true;
+    }
+};
+
+static std::string key_name(size_t i) {
+    return "prices." + std::to_string(i);
+}
+
+static nats::messages::StreamMessage make_message(size_t key, uint64_t sequence, size_t payload_bytes) {
+    nats::messages::StreamMessage message;
+    message.set_subject(key_name(key));
+    message.set_sequence(sequence);
+    message.mutable_timestamp()->set_seconds(1700000000 + static_cast<int64_t>(sequence / 1000));
+    message.set_data(std::string(payload_bytes, static_cast<char>('a' + sequence % 26)));
+    message.set_stream("PRICES");
+    return message;
+}
+
+template <typename Store>
+static Result run(Store& store, size_t keys, int readers, double seconds, size_t payload_bytes,
+                  uint64_t* sequence) {
+    // Pre-built messages so the writer measures apply(), not protobuf setters
+    std::vector<nats::messages::StreamMessage> updates;
+    std::mt19937_64 random(42);
+    for (size_t i = 0; i < 4096; ++i) {
+        updates.push_back(make_message(random() % keys, 0, payload_bytes));
+    }
+    for (size_t i = 0; i < keys; ++i) {
+        store.apply(make_message(i, ++*sequence, payload_bytes));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> writes{0};
+    std::vector<uint64_t> reads(readers, 0);
+    std::vector<std::vector<uint32_t>> latencies(readers);
+
+    std::thread writer([&] {
+        size_t i = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            auto& message = updates[i++ % updates.size()];
+            message.set_sequence(++*sequence);
+            store.apply(message);
+            writes.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::mt19937_64 local(r + 1);
+            std::vector<std::string> names;
+            for (size_t i = 0; i < 1024; ++i) names.push_back(key_name(local() % keys));
+            LastValueView::Entry entry;
+            uint64_t count = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                const std::string& name = names[count % names.size()];
+                // Time every 64th read; the clock costs more than a lookup
+                if (count % 64 == 0) {
+                    auto start = Clock::now();
+                    store.get(name, &entry);
+                    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                    latencies[r].push_back(static_cast<uint32_t>(std::min<int64_t>(ns, UINT32_MAX)));
+                } else {
+                    store.get(name, &entry);
+                }
+                count++;
+            }
+            reads[r] = count;
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    writer.join();
+    for (auto& t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Result result;
+    uint64_t total_reads = 0;
+    std::vector<uint32_t> all;
+    for (int r = 0; r < readers; ++r) {
+        total_reads += reads[r];
+        all.insert(all.end(), latencies[r].begin(), latencies[r].end());
+    }
+    std::sort(all.begin(), all.end());
+    result.reads_per_sec = total_reads / elapsed;
+    result.writes_per_sec = writes.load() / elapsed;
+    if (!all.empty()) {
+        result.p50_ns = all[all.size() / 2];
+        result.p99_ns = all[all.size() * 99 / 100];
+        result.max_ns = all.back();
+    }
+    result.latencies_ns.assign(all.begin(), all.end());
+    return result;
+}
+
+static void print_row(BenchReport& report, const char* name, const Result& r) {
+    report.metric(name, "reads_per_s", r.reads_per_sec, Better::Higher);
+    report.metric(name, "writes_per_s", r.writes_per_sec, Better::Higher);
+    report.samples(name, "read_ns", r.latencies_ns, Better::Lower);
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(14) << r.reads_per_sec << std::setw(14) << r.writes_per_sec
+              << std::setw(10) << r.p50_ns << std::setw(10) << r.p99_ns << std::setw(12) << r.max_ns << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    size_t keys = 100000;
+    int readers = 4;
+    double seconds = 2;
+    size_t payload_bytes = 256;
+    std::string snapshot = "/tmp/last_value.snap";
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--keys" && i + 1 < argc) {
+            keys = std::max<size_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--readers" && i + 1 < argc) {
+            readers = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else if (arg == "--payload" && i + 1 < argc) {
+            payload_bytes = std::stoull(argv[++i]);
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshot = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << keys << " keys, " << readers << " readers + 1 writer, " << payload_bytes << "-byte values, "
+              << seconds << " s per run" << std::endl << std::endl;
+    std::cout << std::left << std::setw(20) << "store" << std::right << std::setw(14) << "reads/s"
+              << std::setw(14) << "writes/s" << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns"
+              << std::setw(12) << "max ns" << std::endl;
+
+    BenchReport report(argc, argv);
+    uint64_t sequence = 0;
+    LockedMap locked;
+    print_row(report, "mutex + hash map", run(locked, keys, readers, seconds, payload_bytes, &sequence));
+
+    sequence = 0;
+    LastValueView view;
+    print_row(report, "LastValueView", run(view, keys, readers, seconds, payload_bytes, &sequence));
+
+    // Snapshot and restore
+    auto start = Clock::now();
+    if (!view.save(snapshot)) {
+        return 1;
+    }
+    double save_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    LastValueView restored;
+    start = Clock::now();
+    if (!restored.load(snapshot)) {
+        return 1;
+    }
+    double load_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    size_t mismatches = 0;
+    view.for_each([&](std::string_view key, const LastValueView::Entry& entry) {
+        LastValueView::Entry copy;
+        if (!restored.get(key, &copy) || copy.sequence != entry.sequence || copy.data != entry.data) {
+            mismatches++;
+        }
+    });
+
+    std::cout << std::endl << std::fixed << std::setprecision(1)
+              << "Snapshot: " << view.size() << " entries, save " << save_ms << " ms, restore " << load_ms
+              << " ms, resume from sequence " << restored.last_sequence() + 1 << std::endl;
+    std::remove(snapshot.c_str());
+    report.metric("snapshot", "save_ms", save_ms, Better::Lower);
+    report.metric("snapshot", "restore_ms", load_ms, Better::Lower);
+    if (!report.write(json_path)) {
+        return 1;
+    }
+
+    if (mismatches != 0 || restored.size() != view.size() || restored.last_sequence() != view.last_sequence()) {
+        std::cerr << "✗ Restored view differs (" << mismatches << " mismatched entries)" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Restored view matches" << std::endl;
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,434 @@
+/*
+ * Materialized last-value view with lock-free reads
+ *
+ * LastValueView keeps the newest message per key, where the key is the
+ * subject by default or anything extracted from the message (for example a
+ * user_id field in the payload). It is fed from a subscriber (WebSocket or
+ * direct NATS) or SnapshotTail, and read from any number of threads
+ * without taking a lock:
+ *
+ *   - Keys live in an open-addressing hash table. Keys are never removed, so
+ *     a reader probes slots that are either empty or hold an immutable node.
+ *     Growing the table publishes a new one with one atomic store.
+ *   - Each node points to an immutable Entry. An update allocates a new
+ *     Entry and swaps the pointer (read-copy-update).
+ *   - Replaced entries and tables are freed after a grace period. Readers
+ *     announce themselves on one of 64 striped counters for the current
+ *     phase. The writer flips the phase and frees what was retired before the
+ *     flip once the old phase's counters have drained. A read costs two
+ *     atomic increments on a cache line the thread rarely shares, and it
+ *     never waits for the writer.
+ *
+ * Updates are serialized by a writer mutex and applied only if newer than
+ * the stored sequence, so replays and overlapping streams are idempotent.
+ *
+ * save() / load() write and read a binary snapshot with the highest sequence
+ * applied. After a restart, load the file and stream from
+ * last_sequence() + 1 (SnapshotTail::set_last_sequence() + resume()). The
+ * service answers reads from the snapshot right away, without fetching
+ * history from the gateway.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "message.pb.h"
+#include "nats_json.h"
+#include "receive_modes.h"
+
+class LastValueView {
+public:
+    struct Entry {
+        std::string subject;
+        uint64_t sequence = 0;
+        int64_t timestamp_ns = 0;
+        std::string data;
+    };
+
+    using KeyFunction = std::function<std::string(const nats::messages::StreamMessage&)>;
+
+    // Key on a top-level string field of the JSON payload (messages
+    // without it fall back to the subject). Messages from the gateway are
+    // unwrapped first, so the field is looked up in the original payload,
+    // not in the envelope.
+    static KeyFunction json_field_key(const std::string& field) {
+        return [field](const nats::messages::StreamMessage& message) {
+            std::string payload;
+            std::string_view json = message.data();
+            if (gateway_envelope_data(json, &payload)) {
+                json = payload;
+            }
+            std::string value;
+            return json_string_field(json, field, &value) ? value : message.subject();
+        };
+    }
+
+private:
+    static constexpr size_t kStripes = 64;
+    static constexpr size_t kReclaimBatch = 256;
+
+    struct Node {
+        std::string key;
+        std::atomic<const Entry*> entry{nullptr};
+    };
+
+    struct Table {
+        size_t mask;
+        std::unique_ptr<std::atomic<Node*>[]> slots;
+
+        explicit Table(size_t capacity) : mask(capacity - 1), slots(new std::atomic<Node*>[capacity]) {
+            for (size_t i = 0; i < capacity; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+    };
+
+    struct alignas(64) Stripe {
+        std::atomic<int64_t> active[2] = {{0}, {0}};
+    };
+
+    // Something freed after a grace period
+    struct Retired {
+        const Entry* entry = nullptr;
+        Table* table = nullptr;
+    };
+
+    KeyFunction key_;
+    std::atomic<Table*> table_;
+    std::atomic<size_t> size_{0};
+    std::atomic<uint64_t> last_sequence_{0};
+
+    mutable Stripe stripes_[kStripes];
+    std::atomic<unsigned> phase_{0};
+
+    // Writer state
+    std::mutex writer_;
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::vector<Retired> current_;    // retired in the current phase
+    std::vector<Retired> waiting_;    // retired before the last flip
+    unsigned waiting_phase_ = 0;
+
+public:
+    explicit LastValueView(KeyFunction key = nullptr, size_t initial_capacity = 1024)
+        : key_(std::move(key))
+    {
+        size_t capacity = 16;
+        while (capacity < initial_capacity * 2) capacity *= 2;
+        table_.store(new Table(capacity), std::memory_order_relaxed);
+    }
+
+    ~LastValueView() {
+        for (auto& node : nodes_) {
+            delete node->entry.load(std::memory_order_relaxed);
+        }
+        free_all(current_);
+        free_all(waiting_);
+        delete table_.load(std::memory_order_relaxed);
+    }
+
+    LastValueView(const LastValueView&) = delete;
+    LastValueView& operator=(const LastValueView&) = delete;
+
+    // Writer side. Returns false when the key already holds this sequence or
+    // a newer one (messages without a sequence always replace).
+    bool apply(const nats::messages::StreamMessage& message) {
+        std::string key = key_ ? key_(message) : message.subject();
+        auto* entry = new Entry;
+        entry->subject = message.subject();
+        entry->sequence = message.sequence();
+        entry->timestamp_ns = message.timestamp().seconds() * 1000000000LL + message.timestamp().nanos();
+        entry->data = message.data();
+        return store(key, entry);
+    }
+
+    // Suitable for MessageSubscriber::set_message_handler
+    std::function<void(const nats::messages::StreamMessage&)> feeder() {
+        return [this](const nats::messages::StreamMessage& message) { apply(message); };
+    }
+
+    // Reader side, any thread, lock-free. `reader` runs on the stored entry
+    // inside the read-side section, so it sees the entry without a copy.
+    template <typename Reader>
+    bool read(std::string_view key, Reader&& reader) const {
+        Guard guard(*this);
+        const Node* node = find(table_.load(std::memory_order_acquire), key);
+        if (!node) {
+            return false;
+        }
+        const Entry* entry = node->entry.load(std::memory_order_acquire);
+        if (!entry) {
+            return false;
+        }
+        reader(*entry);
+        return true;
+    }
+
+    bool get(std::string_view key, Entry* out) const {
+        return read(key, [out](const Entry& entry) { *out = entry; });
+    }
+
+    // Visit every (key, entry); entries may be newer than when the walk began
+    template <typename Visitor>
+    void for_each(Visitor&& visitor) const {
+        Guard guard(*this);
+        const Table* table = table_.load(std::memory_order_acquire);
+        for (size_t i = 0; i <= table->mask; ++i) {
+            const Node* node = table->slots[i].load(std::memory_order_acquire);
+            if (!node) continue;
+            const Entry* entry = node->entry.load(std::memory_order_acquire);
+            if (entry) visitor(std::string_view(node->key), *entry);
+        }
+    }
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    // Highest sequence applied; stream from here + 1 after a restore
+    uint64_t last_sequence() const { return last_sequence_.load(std::memory_order_acquire); }
+
+    // Write a snapshot to `path` (via a temporary file and rename). Runs
+    // beside the writer: entries newer than the recorded sequence may be
+    // included, and replaying them after a restore is a no-op.
+    bool save(const std::string& path) const {
+        std::string temp = path + ".tmp";
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "✗ Cannot write " << temp << std::endl;
+            return false;
+        }
+
+        uint64_t sequence = last_sequence();
+        std::string buffer(kMagic, sizeof(kMagic));
+        put_u64(buffer, sequence);
+        uint64_t count = 0;
+        for_each([&](std::string_view key, const Entry& entry) {
+            put_bytes(buffer, key);
+            put_bytes(buffer, entry.subject);
+            put_u64(buffer, entry.sequence);
+            put_u64(buffer, static_cast<uint64_t>(entry.timestamp_ns));
+            put_bytes(buffer, entry.data);
+            count++;
+            if (buffer.size() >= (1 << 20)) {
+                out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        });
+        put_u64(buffer, count);   // trailer: a truncated file fails to load
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out.close();
+        if (!out || std::rename(temp.c_str(), path.c_str()) != 0) {
+            std::cerr << "✗ Failed to write snapshot " << path << std::endl;
+            std::remove(temp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Merge a snapshot written by save(). Call before feeding the view.
+    bool load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            std::cerr << "✗ Cannot read " << path << std::endl;
+            return false;
+        }
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::string_view rest(data);
+        uint64_t sequence = 0;
+        if (rest.substr(0, sizeof(kMagic)) != std::string_view(kMagic, sizeof(kMagic))) {
+            std::cerr << "✗ " << path << " is not a last-value snapshot" << std::endl;
+            return false;
+        }
+        rest.remove_prefix(sizeof(kMagic));
+        get_u64(rest, &sequence);
+
+        // Parse everything before touching the view
+        std::vector<std::pair<std::string, Entry*>> loaded;
+        bool ok = false;
+        while (true) {
+            // An entry is at least 40 bytes, so 8 left is the trailer
+            if (rest.size() == 8) {
+                uint64_t count = 0;
+                ok = get_u64(rest, &count) && count == loaded.size();
+                break;
+            }
+            std::string_view key, subject, payload;
+            uint64_t entry_sequence = 0, timestamp = 0;
+            if (!get_bytes(rest, &key) || !get_bytes(rest, &subject) || !get_u64(rest, &entry_sequence) ||
+                !get_u64(rest, &timestamp) || !get_bytes(rest, &payload)) {
+                break;
+            }
+            auto* entry = new Entry{std::string(subject), entry_sequence, static_cast<int64_t>(timestamp),
+                                    std::string(payload)};
+            loaded.emplace_back(std::string(key), entry);
+        }
+        if (!ok) {
+            for (auto& item : loaded) delete item.second;
+            std::cerr << "✗ Snapshot " << path << " is truncated or corrupt" << std::endl;
+            return false;
+        }
+
+        for (auto& item : loaded) {
+            store(item.first, item.second);
+        }
+        bump_last_sequence(sequence);
+        return true;
+    }
+
+private:
+    static constexpr char kMagic[8] = {'N', 'G', 'L', 'V', 'V', '0', '0', '1'};
+
+    // Read-side section: count this thread on its stripe in the current phase
+    class Guard {
+    private:
+        const LastValueView& view_;
+        Stripe& stripe_;
+        unsigned phase_;
+
+        static size_t stripe_index() {
+            thread_local size_t index = mix64(std::hash<std::thread::id>()(std::this_thread::get_id())) % kStripes;
+            return index;
+        }
+
+    public:
+        explicit Guard(const LastValueView& view) : view_(view), stripe_(view.stripes_[stripe_index()]) {
+            while (true) {
+                phase_ = view_.phase_.load(std::memory_order_acquire);
+                stripe_.active[phase_].fetch_add(1, std::memory_order_seq_cst);
+                if (view_.phase_.load(std::memory_order_seq_cst) == phase_) break;
+                // The writer flipped meanwhile; join the new phase instead
+                stripe_.active[phase_].fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        ~Guard() {
+            stripe_.active[phase_].fetch_sub(1, std::memory_order_release);
+        }
+    };
+
+    static size_t hash(std::string_view key) {
+        return static_cast<size_t>(mix64(fnv1a64(key)));
+    }
+
+    static Node* find(const Table* table, std::string_view key) {
+        for (size_t i = hash(key) & table->mask;; i = (i + 1) & table->mask) {
+            Node* node = table->slots[i].load(std::memory_order_acquire);
+            if (!node || node->key == key) return node;
+        }
+    }
+
+    // Caller holds writer_
+    static void place(Table* table, Node* node) {
+        size_t i = hash(node->key) & table->mask;
+        while (table->slots[i].load(std::memory_order_relaxed)) i = (i + 1) & table->mask;
+        table->slots[i].store(node, std::memory_order_release);
+    }
+
+    bool store(const std::string& key, const Entry* entry) {
+        std::lock_guard<std::mutex> lock(writer_);
+        Table* table = table_.load(std::memory_order_relaxed);
+        Node* node = find(table, key);
+        if (!node) {
+            // Keep the load factor under 1/2; readers move to the new table
+            // with one store and the old one is retired
+            if ((nodes_.size() + 1) * 2 > table->mask + 1) {
+                auto* grown = new Table((table->mask + 1) * 2);
+                for (auto& existing : nodes_) place(grown, existing.get());
+                table_.store(grown, std::memory_order_release);
+                retire(Retired{nullptr, table});
+                table = grown;
+            }
+            nodes_.push_back(std::make_unique<Node>());
+            node = nodes_.back().get();
+            node->key = key;
+            node->entry.store(entry, std::memory_order_relaxed);
+            place(table, node);
+            size_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            const Entry* old = node->entry.load(std::memory_order_relaxed);
+            if (old && entry->sequence != 0 && old->sequence >= entry->sequence) {
+                delete entry;
+                reclaim();
+                return false;
+            }
+            node->entry.store(entry, std::memory_order_release);
+            if (old) retire(Retired{old, nullptr});
+        }
+        bump_last_sequence(entry->sequence);
+        reclaim();
+        return true;
+    }
+
+    void bump_last_sequence(uint64_t sequence) {
+        uint64_t current = last_sequence_.load(std::memory_order_relaxed);
+        while (sequence > current &&
+               !last_sequence_.compare_exchange_weak(current, sequence, std::memory_order_release)) {
+        }
+    }
+
+    // Caller holds writer_
+    void retire(Retired item) {
+        current_.push_back(item);
+    }
+
+    // Caller holds writer_. Never waits: frees the previous batch once the
+    // readers of its phase are gone, then starts a new grace period.
+    void reclaim() {
+        if (!waiting_.empty()) {
+            int64_t active = 0;
+            for (const auto& stripe : stripes_) {
+                active += stripe.active[waiting_phase_].load(std::memory_order_seq_cst);
+            }
+            if (active != 0) {
+                return;
+            }
+            free_all(waiting_);
+        }
+        if (current_.size() >= kReclaimBatch) {
+            waiting_phase_ = phase_.load(std::memory_order_relaxed);
+            waiting_.swap(current_);
+            phase_.store(waiting_phase_ ^ 1u, std::memory_order_seq_cst);
+        }
+    }
+
+    static void free_all(std::vector<Retired>& items) {
+        for (const auto& item : items) {
+            delete item.entry;
+            delete item.table;
+        }
+        items.clear();
+    }
+
+    static void put_u64(std::string& out, uint64_t value) {
+        for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+
+    static void put_bytes(std::string& out, std::string_view bytes) {
+        put_u64(out, bytes.size());
+        out.append(bytes);
+    }
+
+    static bool get_u64(std::string_view& in, uint64_t* value) {
+        if (in.size() < 8) return false;
+        *value = 0;
+        for (int i = 0; i < 8; ++i) *value |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+        in.remove_prefix(8);
+        return true;
+    }
+
+    static bool get_bytes(std::string_view& in, std::string_view* bytes) {
+        uint64_t size = 0;
+        if (!get_u64(in, &size) || in.size() < size) return false;
+        *bytes = in.substr(0, size);
+        in.remove_prefix(size);
+        return true;
+    }
+};
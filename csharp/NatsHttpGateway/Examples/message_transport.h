@@ -0,0 +1,62 @@
+/*
+ * Transport-neutral publish and subscribe interfaces
+ *
+ *   MessagePublisher   HttpClient (gateway REST) or NatsClient (direct NATS)
+ *   MessageSubscriber  WebSocketClient (gateway WebSocket) or NatsClient
+ *
+ * Code written against these interfaces can switch between the gateway and
+ * the direct NATS path by configuration alone; see transport.h for the
+ * URL-based factories.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "message.pb.h"
+#include "receive_modes.h"
+
+class MessagePublisher {
+public:
+    virtual ~MessagePublisher() = default;
+
+    // Publish without printing anything on success. Fills `ack` (when given)
+    // with the stream and sequence the message was stored at.
+    virtual bool publish(const std::string& subject, const nats::messages::PublishMessage& message,
+                         nats::messages::PublishAck* ack = nullptr) = 0;
+
+    // Publish `envelope` (data left empty) with the concatenation of
+    // `fragments` as its data. This default joins the fragments and calls
+    // publish(); HttpClient streams them to the socket instead.
+    virtual bool publish_fragments(const std::string& subject, const nats::messages::PublishMessage& envelope,
+                                   const std::vector<std::string_view>& fragments,
+                                   nats::messages::PublishAck* ack = nullptr) {
+        nats::messages::PublishMessage message = envelope;
+        std::string* data = message.mutable_data();
+        size_t size = 0;
+        for (auto fragment : fragments) size += fragment.size();
+        data->clear();
+        data->reserve(size);
+        for (auto fragment : fragments) data->append(fragment);
+        return publish(subject, message, ack);
+    }
+};
+
+class MessageSubscriber {
+public:
+    using MessageHandler = std::function<void(const nats::messages::StreamMessage&)>;
+
+    virtual ~MessageSubscriber() = default;
+
+    virtual void connect() = 0;
+    virtual void set_message_handler(MessageHandler handler) = 0;
+    virtual void set_receive_options(const ReceiveOptions& options) = 0;
+    virtual const ReceiveStats& stats() const = 0;
+
+    // Deliver messages until the configured message count is reached or
+    // the connection closes
+    virtual void stream_messages() = 0;
+    virtual void close() = 0;
+};
@@ -0,0 +1,157 @@
+/*
+ * Per-connection metadata dictionary encoding for PublishMessage
+ *
+ * PublishMessage.metadata repeats the same pairs (client=cpp, version=1.0,
+ * ...) on every message. The encoder assigns small integer IDs to pairs it
+ * has seen `promote_after` times, sends each definition once per connection
+ * in `metadata_definitions`, and afterwards only sends the IDs in
+ * `metadata_refs`. Pairs that are not (yet) in the dictionary stay inline in
+ * `metadata`.
+ *
+ * The decoder (one per connection on the server side) learns definitions as
+ * they arrive and restores the original metadata map. A reference to an
+ * unknown ID means the peer lost the connection state; the server rejects the
+ * message (HTTP 409) and the client re-sends with definitions after
+ * reset_connection().
+ *
+ * NatsHttpGateway does not implement the decoder: its protobuf publish keeps
+ * MessageId, Source and Data only and answers 200, so nothing on the client
+ * side can tell the metadata was lost. Encode only for servers known to
+ * decode (mock_gateway.cpp).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "message.pb.h"
+
+class MetadataDictionaryEncoder {
+private:
+    using ValueIds = std::unordered_map<std::string, uint32_t>;
+
+    size_t capacity_;
+    uint32_t promote_after_;
+    // key -> value -> id; nested so the hot path looks up without copying strings
+    std::unordered_map<std::string, ValueIds> ids_;
+    std::unordered_map<std::string, ValueIds> seen_;
+    size_t seen_count_ = 0;
+    std::vector<std::pair<std::string, std::string>> entries_;
+    std::vector<bool> defined_;   // entry has been sent on the current connection
+
+public:
+    explicit MetadataDictionaryEncoder(size_t capacity = 256, uint32_t promote_after = 2)
+        : capacity_(capacity)
+        , promote_after_(promote_after == 0 ? 1 : promote_after)
+    {
+    }
+
+    // The server lost (or never had) our definitions: send them again
+    void reset_connection() {
+        defined_.assign(defined_.size(), false);
+    }
+
+    size_t size() const { return entries_.size(); }
+
+    // Encode `metadata` into `out` (refs, definitions and leftover inline pairs).
+    // `out` must not already contain metadata.
+    void encode(const google::protobuf::Map<std::string, std::string>& metadata,
+                nats::messages::PublishMessage* out) {
+        for (const auto& kv : metadata) {
+            const uint32_t* id_ptr = lookup(kv.first, kv.second);
+            if (!id_ptr) {
+                if (!promote(kv.first, kv.second)) {
+                    (*out->mutable_metadata())[kv.first] = kv.second;
+                    continue;
+                }
+                id_ptr = lookup(kv.first, kv.second);
+            }
+
+            uint32_t id = *id_ptr;
+            if (!defined_[id]) {
+                auto* definition = out->add_metadata_definitions();
+                definition->set_id(id);
+                definition->set_key(kv.first);
+                definition->set_value(kv.second);
+                defined_[id] = true;
+            }
+            out->add_metadata_refs(id);
+        }
+    }
+
+    // Convenience: copy `message` into `out` with its metadata encoded
+    void encode(const nats::messages::PublishMessage& message, nats::messages::PublishMessage* out) {
+        out->set_message_id(message.message_id());
+        out->set_subject(message.subject());
+        if (message.has_timestamp()) {
+            *out->mutable_timestamp() = message.timestamp();
+        }
+        out->set_source(message.source());
+        out->set_data(message.data());
+        encode(message.metadata(), out);
+    }
+
+private:
+    const uint32_t* lookup(const std::string& key, const std::string& value) const {
+        auto by_key = ids_.find(key);
+        if (by_key == ids_.end()) return nullptr;
+        auto by_value = by_key->second.find(value);
+        return by_value == by_key->second.end() ? nullptr : &by_value->second;
+    }
+
+    // Count an occurrence of a pair; assign it an ID once it is frequent enough
+    bool promote(const std::string& key, const std::string& value) {
+        if (entries_.size() >= capacity_) return false;
+
+        // Candidate counts for one-off values (trace IDs, ...) must not grow forever
+        if (seen_count_ >= capacity_ * 4) {
+            seen_.clear();
+            seen_count_ = 0;
+        }
+        auto& counts = seen_[key];
+        auto inserted = counts.emplace(value, 0);
+        if (inserted.second) seen_count_++;
+        if (++inserted.first->second < promote_after_) return false;
+
+        counts.erase(inserted.first);
+        seen_count_--;
+        ids_[key][value] = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back(key, value);
+        defined_.push_back(false);
+        return true;
+    }
+};
+
+class MetadataDictionaryDecoder {
+private:
+    std::unordered_map<uint32_t, std::pair<std::string, std::string>> entries_;
+
+public:
+    size_t size() const { return entries_.size(); }
+
+    // Learn new definitions and restore referenced pairs into metadata.
+    // Returns false (leaving refs in place) if a reference is unknown.
+    bool decode(nats::messages::PublishMessage* message) {
+        for (const auto& definition : message->metadata_definitions()) {
+            entries_[definition.id()] = {definition.key(), definition.value()};
+        }
+        message->clear_metadata_definitions();
+
+        for (uint32_t id : message->metadata_refs()) {
+            if (entries_.find(id) == entries_.end()) {
+                return false;
+            }
+        }
+
+        auto* metadata = message->mutable_metadata();
+        for (uint32_t id : message->metadata_refs()) {
+            const auto& entry = entries_[id];
+            (*metadata)[entry.first] = entry.second;
+        }
+        message->clear_metadata_refs();
+        return true;
+    }
+};
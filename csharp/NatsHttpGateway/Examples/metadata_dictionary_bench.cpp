@@ -0,0 +1,173 @@
+/*
+ * Benchmark: per-connection metadata dictionary vs inline metadata map
+ *
+ * Builds PublishMessages with the metadata pairs our clients send on every
+ * message (client, version, source, region) and measures, per message:
+ *   - bytes on the wire (steady state, after definitions were sent once)
+ *   - client CPU: encode + serialize
+ *   - server CPU: parse + decode back into the metadata map
+ *
+ * --json writes the results for bench_compare (bench_report.h).
+ *
+ * Requirements:
+ *   - Protobuf
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 metadata_dictionary_bench.cpp message.pb.cc \
+ *       -lprotobuf -o metadata_dictionary_bench
+ *
+ * Usage:
+ *   ./metadata_dictionary_bench [iterations] [--json FILE]
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench_report.h"
+#include "message.pb.h"
+#include "metadata_dictionary.h"
+
+using Clock = std::chrono::steady_clock;
+
+static nats::messages::PublishMessage make_message(size_t payload_bytes, int i) {
+    nats::messages::PublishMessage message;
+    message.set_message_id("msg-" + std::to_string(i));
+    message.set_subject("events.test");
+    message.set_source("cpp-client");
+    message.mutable_timestamp()->set_seconds(1700000000 + i);
+    message.set_data(std::string(payload_bytes, 'x'));
+    (*message.mutable_metadata())["client"] = "cpp";
+    (*message.mutable_metadata())["version"] = "1.0";
+    (*message.mutable_metadata())["source"] = "cpp-client";
+    (*message.mutable_metadata())["region"] = "us-east-1";
+    return message;
+}
+
+struct Result {
+    double bytes_per_msg = 0;
+    double encode_ns = 0;
+    double decode_ns = 0;
+};
+
+static Result run_plain(const std::vector<nats::messages::PublishMessage>& messages) {
+    Result result;
+    std::vector<std::string> wire(messages.size());
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < messages.size(); ++i) {
+        messages[i].SerializeToString(&wire[i]);
+    }
+    auto encoded = Clock::now();
+
+    size_t total = 0;
+    for (const auto& body : wire) {
+        nats::messages::PublishMessage parsed;
+        parsed.ParseFromString(body);
+        total += body.size();
+    }
+    auto decoded = Clock::now();
+
+    result.bytes_per_msg = static_cast<double>(total) / messages.size();
+    result.encode_ns = std::chrono::duration<double, std::nano>(encoded - start).count() / messages.size();
+    result.decode_ns = std::chrono::duration<double, std::nano>(decoded - encoded).count() / messages.size();
+    return result;
+}
+
+static Result run_dictionary(const std::vector<nats::messages::PublishMessage>& messages) {
+    Result result;
+    std::vector<std::string> wire(messages.size());
+    MetadataDictionaryEncoder encoder;
+    MetadataDictionaryDecoder decoder;
+
+    // Warm up: promote the pairs and send their definitions once
+    for (int i = 0; i < 2; ++i) {
+        nats::messages::PublishMessage warm;
+        encoder.encode(messages[0], &warm);
+        decoder.decode(&warm);
+    }
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < messages.size(); ++i) {
+        nats::messages::PublishMessage out;
+        encoder.encode(messages[i], &out);
+        out.SerializeToString(&wire[i]);
+    }
+    auto encoded = Clock::now();
+
+    size_t total = 0;
+    for (const auto& body : wire) {
+        nats::messages::PublishMessage parsed;
+        parsed.ParseFromString(body);
+        if (!decoder.decode(&parsed) || parsed.metadata_size() != 4) {
+            std::cerr << "✗ Dictionary round trip failed" << std::endl;
+            std::exit(1);
+        }
+        total += body.size();
+    }
+    auto decoded = Clock::now();
+
+    result.bytes_per_msg = static_cast<double>(total) / messages.size();
+    result.encode_ns = std::chrono::duration<double, std::nano>(encoded - start).count() / messages.size();
+    result.decode_ns = std::chrono::duration<double, std::nano>(decoded - encoded).count() / messages.size();
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    int iterations = 200000;
+    std::string json_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            iterations = std::atoi(argv[i]);
+        }
+    }
+    BenchReport report(argc, argv);
+
+    std::cout << "Metadata dictionary benchmark (" << iterations << " messages per run)" << std::endl;
+    std::cout << std::string(80, '=') << std::endl;
+    std::cout << std::left << std::setw(10) << "payload"
+              << std::setw(12) << "mode"
+              << std::right << std::setw(12) << "bytes/msg"
+              << std::setw(14) << "encode ns"
+              << std::setw(14) << "decode ns"
+              << std::setw(12) << "saved" << std::endl;
+
+    for (size_t payload : {32, 128, 512}) {
+        std::vector<nats::messages::PublishMessage> messages;
+        messages.reserve(iterations);
+        for (int i = 0; i < iterations; ++i) {
+            messages.push_back(make_message(payload, i));
+        }
+
+        Result plain = run_plain(messages);
+        Result dict = run_dictionary(messages);
+
+        auto row = [&](const char* mode, const Result& r, double saved) {
+            std::string name = std::to_string(payload) + " B " + mode;
+            report.metric(name, "bytes_per_msg", r.bytes_per_msg, Better::Lower);
+            report.metric(name, "encode_ns", r.encode_ns, Better::Lower);
+            report.metric(name, "decode_ns", r.decode_ns, Better::Lower);
+            std::cout << std::left << std::setw(10) << (std::to_string(payload) + " B")
+                      << std::setw(12) << mode
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << r.bytes_per_msg
+                      << std::setw(14) << r.encode_ns
+                      << std::setw(14) << r.decode_ns
+                      << std::setw(11) << saved << "%" << std::endl;
+        };
+        row("inline", plain, 0.0);
+        row("dictionary", dict, 100.0 * (1.0 - dict.bytes_per_msg / plain.bytes_per_msg));
+    }
+    if (!report.write(json_path)) {
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
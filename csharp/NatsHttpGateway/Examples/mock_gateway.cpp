@@ -0,0 +1,739 @@
+/*
+ * Local stand-in for NatsHttpGateway's protobuf REST endpoints
+ *
+ * Keeps messages in memory (one stream per first subject token, case kept,
+ * like the gateway's auto-created streams) so the C++ clients, tools and
+ * benchmarks can run without NATS or .NET.
+ *
+ * Messages are stored the way the gateway stores them: as the JSON envelope
+ *   {"message_id":..., "timestamp":..., "source":..., "data":<base64>}
+ * (nats_json.h). Fetches and WebSocket frames return that envelope as the
+ * message data, and size_bytes is its size; the JSON consumer endpoint
+ * embeds it as an object. Metadata is not stored, as the gateway drops it.
+ * The mock also understands the per-connection metadata dictionary
+ * (metadata_refs / metadata_definitions), an extension the gateway does
+ * not have: it says so with an X-Metadata-Dictionary header on publish
+ * responses and rejects unknown references with 409.
+ *
+ * Endpoints:
+ *   POST /api/proto/ProtobufMessages/{subject}   PublishMessage -> PublishAck
+ *   GET  /api/proto/ProtobufMessages/{subject}?limit=N   -> FetchResponse
+ *   WS   /ws/websocketmessages/{subject}[?startSequence=N]   WebSocketFrames
+ *   GET  /health
+ *
+ * and, in JSON, the durable consumer endpoints (consumer_api.h):
+ *
+ *   POST/GET /api/consumers/{stream}, GET/DELETE /api/consumers/{stream}/{name},
+ *   GET /api/consumers/{stream}/{name}/health,
+ *   GET /api/messages/{stream}/consumer/{name}?limit=N&timeout=S   (acks what it returns)
+ *
+ * Requirements:
+ *   - Boost.Beast, Boost.Asio
+ *   - Protobuf
+ *
+ * Build:
+ *   g++ -std=c++17 mock_gateway.cpp message.pb.cc \
+ *       -lprotobuf -lboost_system -pthread -o mock_gateway
+ *
+ * Usage:
+ *   ./mock_gateway [port] [--fetch-delay-ms N]
+ *   ./mock_gateway 8080
+ *
+ * --fetch-delay-ms adds N ms to every fetch, standing in for the ephemeral
+ * consumer the real gateway creates per fetch.
+ */
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <poll.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "message.pb.h"
+#include "metadata_dictionary.h"
+#include "nats_json.h"
+#include "nats_subject.h"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+struct StoredMessage {
+    std::string subject;
+    uint64_t sequence;
+    google::protobuf::Timestamp timestamp;
+    std::string data;
+};
+
+// A durable consumer: a cursor into its stream. Fetches ack at once, as
+// the gateway does, so nothing is ever pending acknowledgment.
+struct MockConsumer {
+    std::string name;
+    std::string filter;
+    uint64_t created_ns = 0;
+    uint64_t next = 1;              // next stream sequence to examine
+    uint64_t delivered = 0;         // consumer sequence
+    uint64_t last_stream_seq = 0;   // stream sequence of the last delivery
+    uint64_t last_delivered_ns = 0;
+};
+
+class MessageStore {
+private:
+    std::mutex mutex_;
+    std::condition_variable appended_;
+    std::map<std::string, std::vector<StoredMessage>> streams_;
+    std::map<std::string, std::map<std::string, MockConsumer>> consumers_;   // stream -> name -> consumer
+
+public:
+    // "events.test" -> "events", like the gateway's auto-created streams
+    static std::string stream_for(const std::string& subject) {
+        return subject.substr(0, subject.find('.'));
+    }
+
+    // `data` is the gateway envelope
+    StoredMessage append(const std::string& subject, const std::string& data) {
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& stream = streams_[stream_for(subject)];
+        StoredMessage message;
+        message.subject = subject;
+        message.sequence = stream.size() + 1;
+        message.timestamp.set_seconds(nanos / 1000000000);
+        message.timestamp.set_nanos(static_cast<int32_t>(nanos % 1000000000));
+        message.data = data;
+        stream.push_back(message);
+        appended_.notify_all();
+        return message;
+    }
+
+    // Last `limit` messages matching the subject filter. `last_sequence`
+    // receives the stream's last sequence at the time.
+    std::vector<StoredMessage> last(const std::string& filter, size_t limit, uint64_t* last_sequence = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<StoredMessage> result;
+        auto it = streams_.find(stream_for(filter));
+        if (last_sequence) *last_sequence = it == streams_.end() ? 0 : it->second.size();
+        if (it == streams_.end()) return result;
+
+        for (auto m = it->second.rbegin(); m != it->second.rend() && result.size() < limit; ++m) {
+            if (subject_matches(filter, m->subject)) result.push_back(*m);
+        }
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    uint64_t last_sequence(const std::string& filter) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = streams_.find(stream_for(filter));
+        return it == streams_.end() ? 0 : it->second.size();
+    }
+
+    // Messages matching the filter from sequence `*next` on, waiting up to
+    // `timeout` for the first one; advances `*next` past what was examined
+    std::vector<StoredMessage> read_from(const std::string& filter, uint64_t* next,
+                                         std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const std::string name = stream_for(filter);
+        auto available = [&] {
+            auto it = streams_.find(name);
+            return it != streams_.end() && it->second.size() >= *next;
+        };
+        std::vector<StoredMessage> result;
+        if (!appended_.wait_for(lock, timeout, available)) {
+            return result;
+        }
+        const auto& stream = streams_[name];
+        for (uint64_t seq = std::max<uint64_t>(*next, 1); seq <= stream.size(); ++seq) {
+            if (subject_matches(filter, stream[seq - 1].subject)) result.push_back(stream[seq - 1]);
+        }
+        *next = stream.size() + 1;
+        return result;
+    }
+
+    enum class CreateResult { Created, Exists, Conflict, NoStream };
+
+    // Like JetStream: creating an existing consumer with the same filter is
+    // a no-op, with another filter an error
+    CreateResult create_consumer(const std::string& stream, const std::string& name, const std::string& filter,
+                                 const std::string& deliver_policy) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto s = streams_.find(stream);
+        if (s == streams_.end()) return CreateResult::NoStream;
+        auto& consumers = consumers_[stream];
+        auto it = consumers.find(name);
+        if (it != consumers.end()) {
+            return it->second.filter == filter ? CreateResult::Exists : CreateResult::Conflict;
+        }
+        MockConsumer c;
+        c.name = name;
+        c.filter = filter.empty() ? ">" : filter;
+        c.created_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        if (deliver_policy == "new") c.next = s->second.size() + 1;
+        if (deliver_policy == "last") c.next = std::max<size_t>(s->second.size(), 1);
+        consumers.emplace(name, std::move(c));
+        return CreateResult::Created;
+    }
+
+    bool delete_consumer(const std::string& stream, const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = consumers_.find(stream);
+        return it != consumers_.end() && it->second.erase(name) > 0;
+    }
+
+    // ConsumerDetails JSON, as GET /api/consumers/{stream}/{name} returns it
+    bool consumer_json(const std::string& stream, const std::string& name, std::string* out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const MockConsumer* c = find_consumer(stream, name);
+        if (!c) return false;
+        *out = details_json(stream, *c, true);
+        return true;
+    }
+
+    bool list_json(const std::string& stream, std::string* out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!streams_.count(stream)) return false;
+        const auto& consumers = consumers_[stream];
+        *out = "{\"streamName\":";
+        append_json_string(*out, stream);
+        *out += ",\"count\":" + std::to_string(consumers.size()) + ",\"consumers\":[";
+        bool first = true;
+        for (const auto& entry : consumers) {
+            if (!first) *out += ",";
+            first = false;
+            *out += details_json(stream, entry.second, false);
+        }
+        *out += "]}";
+        return true;
+    }
+
+    bool health_json(const std::string& stream, const std::string& name, std::string* out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const MockConsumer* c = find_consumer(stream, name);
+        if (!c) return false;
+        uint64_t pending = pending_for(stream, *c);
+        bool lagging = pending > 10000;
+        *out = "{\"consumerName\":";
+        append_json_string(*out, name);
+        *out += ",\"streamName\":";
+        append_json_string(*out, stream);
+        *out += std::string(",\"isHealthy\":") + (lagging ? "false" : "true") + ",\"status\":\"" +
+                (lagging ? "Lagging" : "Healthy") + "\",\"lastActivity\":\"" +
+                format_rfc3339(c->last_delivered_ns ? c->last_delivered_ns : c->created_ns) +
+                "\",\"pendingMessages\":" + std::to_string(pending) + ",\"ackPending\":0,\"issue\":" +
+                (lagging ? "\"High pending messages: " + std::to_string(pending) + "\"" : std::string("null")) +
+                "}";
+        return true;
+    }
+
+    // Up to `limit` matching messages past the consumer's cursor, waiting
+    // up to `timeout` for the first. False if there is no such consumer.
+    bool consume(const std::string& stream, const std::string& name, size_t limit, std::chrono::milliseconds timeout,
+                 std::vector<StoredMessage>* out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        out->clear();
+        while (true) {
+            MockConsumer* c = find_consumer(stream, name);
+            if (!c) return false;
+            const auto& messages = streams_[stream];
+            while (c->next <= messages.size() && out->size() < limit) {
+                const StoredMessage& m = messages[c->next - 1];
+                c->next++;
+                if (!subject_matches(c->filter, m.subject)) continue;
+                out->push_back(m);
+                c->delivered++;
+                c->last_stream_seq = m.sequence;
+            }
+            if (!out->empty()) {
+                c->last_delivered_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count());
+                return true;
+            }
+            if (appended_.wait_until(lock, deadline) == std::cv_status::timeout) return true;
+        }
+    }
+
+private:
+    MockConsumer* find_consumer(const std::string& stream, const std::string& name) {
+        auto s = consumers_.find(stream);
+        if (s == consumers_.end()) return nullptr;
+        auto c = s->second.find(name);
+        return c == s->second.end() ? nullptr : &c->second;
+    }
+
+    uint64_t pending_for(const std::string& stream, const MockConsumer& c) {
+        const auto& messages = streams_[stream];
+        uint64_t pending = 0;
+        for (uint64_t seq = c.next; seq <= messages.size(); ++seq) {
+            if (subject_matches(c.filter, messages[seq - 1].subject)) pending++;
+        }
+        return pending;
+    }
+
+    std::string details_json(const std::string& stream, const MockConsumer& c, bool with_metrics) {
+        uint64_t pending = pending_for(stream, c);
+        uint64_t lag = streams_[stream].size() - c.last_stream_seq;
+        std::string out = "{\"streamName\":";
+        append_json_string(out, stream);
+        out += ",\"name\":";
+        append_json_string(out, c.name);
+        out += ",\"description\":null,\"created\":\"" + format_rfc3339(c.created_ns) +
+               "\",\"config\":{\"filterSubject\":";
+        append_json_string(out, c.filter);
+        out += ",\"deliverPolicy\":\"All\",\"ackPolicy\":\"Explicit\",\"ackWait\":\"00:00:30\",\"maxDeliver\":-1,\"maxAckPending\":1000}"
+               ",\"state\":{\"delivered\":" + std::to_string(c.delivered) +
+               ",\"ackPending\":0,\"redelivered\":0,\"numPending\":" + std::to_string(pending) +
+               ",\"numWaiting\":0,\"lastDelivered\":" +
+               (c.last_delivered_ns ? "\"" + format_rfc3339(c.last_delivered_ns) + "\"" : std::string("null")) + "}";
+        if (with_metrics) {
+            out += ",\"metrics\":{\"consumerLag\":" + std::to_string(lag) + ",\"pendingMessages\":" +
+                   std::to_string(pending) + ",\"acknowledgedMessages\":" + std::to_string(c.delivered) +
+                   ",\"redeliveredMessages\":0,\"averageAckTime\":0,\"isHealthy\":" +
+                   (lag < 1000 ? "true" : "false") + ",\"healthStatus\":\"" + (lag > 1000 ? "Lagging" : "Healthy") +
+                   "\"}";
+        }
+        out += "}";
+        return out;
+    }
+};
+
+static std::string url_decode(const std::string& in) {
+    std::string out;
+    for (size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '%' && i + 2 < in.size()) {
+            out += static_cast<char>(std::stoi(in.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return out;
+}
+
+static std::string query_param(const std::string& query, const std::string& name) {
+    size_t pos = 0;
+    while (pos < query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) end = query.size();
+        std::string pair = query.substr(pos, end - pos);
+        auto eq = pair.find('=');
+        if (eq != std::string::npos && pair.substr(0, eq) == name) {
+            return url_decode(pair.substr(eq + 1));
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+// Decimal sequence number, 1 or more, that fits in 64 bits
+static bool parse_sequence(const std::string& text, uint64_t* out) {
+    if (text.empty() || text.size() > 20) return false;
+    uint64_t value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (value > (UINT64_MAX - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    if (value == 0) return false;
+    *out = value;
+    return true;
+}
+
+class Session {
+private:
+    tcp::socket socket_;
+    MessageStore& store_;
+    std::chrono::milliseconds fetch_delay_;
+    MetadataDictionaryDecoder dictionary_;   // per connection
+
+public:
+    Session(tcp::socket socket, MessageStore& store, std::chrono::milliseconds fetch_delay)
+        : socket_(std::move(socket))
+        , store_(store)
+        , fetch_delay_(fetch_delay)
+    {
+    }
+
+    void run() {
+        beast::error_code ec;
+        beast::flat_buffer buffer;
+
+        while (true) {
+            // Kestrel's default request body limit, not Beast's 1 MB
+            http::request_parser<http::string_body> parser;
+            parser.body_limit(30000000);
+            http::read(socket_, buffer, parser, ec);
+            if (ec) break;
+            http::request<http::string_body> req = parser.release();
+
+            const std::string ws_prefix = "/ws/websocketmessages/";
+            std::string target(req.target());
+            if (websocket::is_upgrade(req) && target.compare(0, ws_prefix.size(), ws_prefix) == 0) {
+                std::string query;
+                auto qpos = target.find('?');
+                if (qpos != std::string::npos) {
+                    query = target.substr(qpos + 1);
+                    target.resize(qpos);
+                }
+                // A bad startSequence is refused before the upgrade
+                std::string subject;
+                std::string start;
+                uint64_t start_sequence = 0;
+                try {
+                    subject = url_decode(target.substr(ws_prefix.size()));
+                    start = query_param(query, "startSequence");
+                } catch (std::exception const&) {
+                    start = "invalid";
+                }
+                if (start.empty() || parse_sequence(start, &start_sequence)) {
+                    stream(req, subject, start_sequence);
+                    return;
+                }
+                auto res = reply(http::status::bad_request, "application/json",
+                                 R"({"error":"startSequence must be a positive integer"})");
+                res.version(req.version());
+                res.keep_alive(false);
+                res.prepare_payload();
+                http::write(socket_, res, ec);
+                break;
+            }
+
+            http::response<http::string_body> res;
+            try {
+                res = handle(req);
+            } catch (std::exception const&) {
+                res = reply(http::status::bad_request, "application/json", R"({"error":"Bad request"})");
+            }
+            res.version(req.version());
+            res.keep_alive(req.keep_alive());
+            res.prepare_payload();
+            http::write(socket_, res, ec);
+            if (ec || !req.keep_alive()) break;
+        }
+
+        socket_.shutdown(tcp::socket::shutdown_send, ec);
+    }
+
+private:
+    static http::response<http::string_body> reply(http::status status, const std::string& content_type,
+                                                   std::string body) {
+        http::response<http::string_body> res{status, 11};
+        res.set(http::field::content_type, content_type);
+        res.body() = std::move(body);
+        return res;
+    }
+
+    http::response<http::string_body> handle(const http::request<http::string_body>& req) {
+        std::string target(req.target());
+        std::string query;
+        auto qpos = target.find('?');
+        if (qpos != std::string::npos) {
+            query = target.substr(qpos + 1);
+            target = target.substr(0, qpos);
+        }
+
+        if (target == "/health") {
+            return reply(http::status::ok, "application/json",
+                         R"({"status":"healthy","nats_connected":true,"jetstream_available":true})");
+        }
+
+        const std::string consumers_prefix = "/api/consumers/";
+        if (target.compare(0, consumers_prefix.size(), consumers_prefix) == 0) {
+            return consumers(req, split_path(target.substr(consumers_prefix.size())));
+        }
+        const std::string messages_prefix = "/api/messages/";
+        if (target.compare(0, messages_prefix.size(), messages_prefix) == 0) {
+            auto parts = split_path(target.substr(messages_prefix.size()));
+            if (parts.size() == 3 && parts[1] == "consumer" && req.method() == http::verb::get) {
+                std::string limit = query_param(query, "limit");
+                std::string timeout = query_param(query, "timeout");
+                return consume(parts[0], parts[2], limit.empty() ? 10 : std::stoi(limit),
+                               timeout.empty() ? 5 : std::stoi(timeout));
+            }
+            return reply(http::status::not_found, "application/json", R"({"error":"Not found"})");
+        }
+
+        const std::string prefix = "/api/proto/ProtobufMessages/";
+        if (target.compare(0, prefix.size(), prefix) != 0) {
+            return reply(http::status::not_found, "application/json", R"({"error":"Not found"})");
+        }
+        std::string subject = url_decode(target.substr(prefix.size()));
+
+        if (req.method() == http::verb::post) {
+            return publish(subject, req.body());
+        }
+        if (req.method() == http::verb::get) {
+            std::string limit = query_param(query, "limit");
+            return fetch(subject, limit.empty() ? 10 : std::stoi(limit));
+        }
+        return reply(http::status::method_not_allowed, "application/json", R"({"error":"Method not allowed"})");
+    }
+
+    http::response<http::string_body> publish(std::string subject, const std::string& body) {
+        if (body.empty()) {
+            return reply(http::status::bad_request, "application/json", R"({"error":"Request body is empty"})");
+        }
+
+        // The typed helper routes wrap the posted event body. (The gateway
+        // puts the event in the envelope as a JSON object, not base64.)
+        std::string typed;
+        for (const std::string suffix : {"/user-event", "/payment-event"}) {
+            if (subject.size() > suffix.size() &&
+                subject.compare(subject.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                subject.resize(subject.size() - suffix.size());
+                typed = suffix == "/user-event" ? "user-service" : "payment-service";
+            }
+        }
+
+        nats::messages::PublishMessage message;
+        if (!typed.empty()) {
+            message.set_data(body);
+            message.set_source(typed);
+        } else if (!message.ParseFromString(body)) {
+            return reply(http::status::bad_request, "application/json", R"({"error":"Invalid protobuf format"})");
+        }
+        if (!dictionary_.decode(&message)) {
+            return reply(http::status::conflict, "application/json",
+                         R"({"error":"Unknown metadata dictionary reference"})");
+        }
+
+        std::string envelope;
+        append_gateway_envelope(envelope, message.message_id(),
+                                message.source().empty() ? "protobuf-gateway" : message.source(), message.data());
+        StoredMessage stored = store_.append(subject, envelope);
+
+        nats::messages::PublishAck ack;
+        ack.set_published(true);
+        ack.set_subject(subject);
+        ack.set_stream(MessageStore::stream_for(subject));
+        ack.set_sequence(stored.sequence);
+        *ack.mutable_timestamp() = stored.timestamp;
+
+        std::string out;
+        ack.SerializeToString(&out);
+        auto res = reply(http::status::ok, "application/x-protobuf", std::move(out));
+        res.set("X-Metadata-Dictionary", "1");   // HttpClient waits for this before sending refs
+        return res;
+    }
+
+    http::response<http::string_body> fetch(const std::string& subject, int limit) {
+        if (limit < 1 || limit > 100) {
+            return reply(http::status::bad_request, "application/json",
+                         R"({"error":"Limit must be between 1 and 100"})");
+        }
+        if (fetch_delay_.count() > 0) {
+            std::this_thread::sleep_for(fetch_delay_);
+        }
+
+        nats::messages::FetchResponse response;
+        response.set_subject(subject);
+        response.set_stream(MessageStore::stream_for(subject));
+        uint64_t last_sequence = 0;
+        for (const auto& stored : store_.last(subject, static_cast<size_t>(limit), &last_sequence)) {
+            auto* msg = response.add_messages();
+            msg->set_subject(stored.subject);
+            msg->set_sequence(stored.sequence);
+            *msg->mutable_timestamp() = stored.timestamp;
+            msg->set_data(stored.data);
+            msg->set_size_bytes(static_cast<int32_t>(stored.data.size()));
+            msg->set_stream(response.stream());
+        }
+        response.set_count(response.messages_size());
+        response.set_last_sequence(last_sequence);
+
+        std::string out;
+        response.SerializeToString(&out);
+        return reply(http::status::ok, "application/x-protobuf", std::move(out));
+    }
+
+    static std::vector<std::string> split_path(const std::string& path) {
+        std::vector<std::string> parts;
+        size_t pos = 0;
+        while (pos <= path.size()) {
+            size_t end = path.find('/', pos);
+            if (end == std::string::npos) end = path.size();
+            if (end > pos) parts.push_back(url_decode(path.substr(pos, end - pos)));
+            pos = end + 1;
+        }
+        return parts;
+    }
+
+    static http::response<http::string_body> problem(http::status status, const std::string& title) {
+        std::string body = "{\"title\":";
+        append_json_string(body, title);
+        body += ",\"status\":" + std::to_string(static_cast<int>(status)) + "}";
+        return reply(status, "application/problem+json", std::move(body));
+    }
+
+    http::response<http::string_body> consumers(const http::request<http::string_body>& req,
+                                                const std::vector<std::string>& parts) {
+        std::string json;
+        if (parts.size() == 1 && req.method() == http::verb::post) {
+            nats_json::Value body;
+            const nats_json::Value* name = nullptr;
+            if (!nats_json::Parser(req.body()).parse(&body) || !(name = body.get("name")) || name->text.empty()) {
+                return problem(http::status::bad_request, "Invalid consumer name");
+            }
+            const nats_json::Value* filter = body.get("filterSubject");
+            const nats_json::Value* policy = body.get("deliverPolicy");
+            switch (store_.create_consumer(parts[0], name->text, filter ? filter->text : "",
+                                           policy ? policy->text : "all")) {
+                case MessageStore::CreateResult::NoStream:
+                    return problem(http::status::not_found, "Stream not found");
+                case MessageStore::CreateResult::Conflict:
+                    return problem(http::status::internal_server_error, "Failed to create consumer");
+                default:
+                    store_.consumer_json(parts[0], name->text, &json);
+                    return reply(http::status::created, "application/json", std::move(json));
+            }
+        }
+        if (parts.size() == 1 && req.method() == http::verb::get) {
+            if (!store_.list_json(parts[0], &json)) return problem(http::status::not_found, "Stream not found");
+            return reply(http::status::ok, "application/json", std::move(json));
+        }
+        if (parts.size() == 2 && req.method() == http::verb::get) {
+            if (!store_.consumer_json(parts[0], parts[1], &json)) {
+                return problem(http::status::not_found, "Consumer not found");
+            }
+            return reply(http::status::ok, "application/json", std::move(json));
+        }
+        if (parts.size() == 2 && req.method() == http::verb::delete_) {
+            if (!store_.delete_consumer(parts[0], parts[1])) {
+                return problem(http::status::not_found, "Consumer not found");
+            }
+            return reply(http::status::ok, "application/json", R"({"success":true,"message":"Consumer deleted"})");
+        }
+        if (parts.size() == 3 && parts[2] == "health" && req.method() == http::verb::get) {
+            if (!store_.health_json(parts[0], parts[1], &json)) {
+                return problem(http::status::not_found, "Consumer not found");
+            }
+            return reply(http::status::ok, "application/json", std::move(json));
+        }
+        return reply(http::status::not_found, "application/json", R"({"error":"Not found"})");
+    }
+
+    http::response<http::string_body> consume(const std::string& stream, const std::string& name, int limit,
+                                              int timeout_s) {
+        if (limit < 1 || limit > 100) {
+            return reply(http::status::bad_request, "application/json",
+                         R"({"error":"Limit must be between 1 and 100"})");
+        }
+        if (timeout_s < 1 || timeout_s > 30) {
+            return reply(http::status::bad_request, "application/json",
+                         R"({"error":"Timeout must be between 1 and 30 seconds"})");
+        }
+        std::vector<StoredMessage> messages;
+        if (!store_.consume(stream, name, static_cast<size_t>(limit), std::chrono::seconds(timeout_s), &messages)) {
+            return reply(http::status::not_found, "application/json", R"({"error":"Consumer does not exist"})");
+        }
+        std::string json = "{\"subject\":\"\",\"count\":" + std::to_string(messages.size()) + ",\"messages\":[";
+        for (size_t i = 0; i < messages.size(); ++i) {
+            const StoredMessage& m = messages[i];
+            if (i > 0) json += ",";
+            json += "{\"subject\":";
+            append_json_string(json, m.subject);
+            json += ",\"sequence\":" + std::to_string(m.sequence) + ",\"timestamp\":\"" +
+                    format_rfc3339(static_cast<uint64_t>(m.timestamp.seconds()) * 1000000000ULL +
+                                   static_cast<uint64_t>(m.timestamp.nanos())) +
+                    "\",\"data\":" + m.data + ",\"size_bytes\":" + std::to_string(m.data.size()) + "}";
+        }
+        json += "],\"stream\":";
+        append_json_string(json, stream);
+        json += "}";
+        return reply(http::status::ok, "application/json", std::move(json));
+    }
+
+    // Subject stream: new messages only (start_sequence 0), or from
+    // ?startSequence=N. Client frames (close, ping) are read between batches.
+    void stream(const http::request<http::string_body>& req, const std::string& subject, uint64_t start_sequence) {
+        websocket::stream<tcp::socket> ws(std::move(socket_));
+        try {
+            ws.accept(req);
+            ws.binary(true);
+
+            nats::messages::WebSocketFrame ack;
+            ack.set_type(nats::messages::CONTROL);
+            ack.mutable_control()->set_type(nats::messages::SUBSCRIBE_ACK);
+            ack.mutable_control()->set_message("Subscribed to " + subject);
+            ws.write(net::buffer(ack.SerializeAsString()));
+
+            uint64_t next = start_sequence == 0 ? store_.last_sequence(subject) + 1 : start_sequence;
+            std::string out;
+            while (true) {
+                for (const auto& stored : store_.read_from(subject, &next, std::chrono::milliseconds(100))) {
+                    nats::messages::WebSocketFrame frame;
+                    frame.set_type(nats::messages::MESSAGE);
+                    auto* msg = frame.mutable_message();
+                    msg->set_subject(stored.subject);
+                    msg->set_sequence(stored.sequence);
+                    *msg->mutable_timestamp() = stored.timestamp;
+                    msg->set_data(stored.data);
+                    msg->set_size_bytes(static_cast<int32_t>(stored.data.size()));
+                    frame.SerializeToString(&out);
+                    ws.write(net::buffer(out));
+                }
+
+                // A close frame (or EOF) ends the session; read() answers it
+                pollfd pfd{ws.next_layer().native_handle(), POLLIN, 0};
+                if (::poll(&pfd, 1, 0) > 0) {
+                    beast::flat_buffer ignored;
+                    ws.read(ignored);
+                }
+            }
+        } catch (std::exception const&) {
+            // Client went away
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    unsigned short port = 8080;
+    std::chrono::milliseconds fetch_delay(0);
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--fetch-delay-ms" && i + 1 < argc) {
+            fetch_delay = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else {
+            port = static_cast<unsigned short>(std::atoi(argv[i]));
+        }
+    }
+
+    try {
+        net::io_context ioc;
+        tcp::acceptor acceptor(ioc, {tcp::v4(), port});
+        MessageStore store;
+
+        std::cout << "Mock NatsHttpGateway listening on http://localhost:" << port << std::endl;
+
+        while (true) {
+            tcp::socket socket(ioc);
+            acceptor.accept(socket);
+            std::thread([socket = std::move(socket), &store, fetch_delay]() mutable {
+                Session(std::move(socket), store, fetch_delay).run();
+            }).detach();
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,642 @@
+/*
+ * Minimal NATS server for testing the direct transport (nats_client.h)
+ *
+ * Speaks enough of the NATS client protocol for NatsClient and other simple
+ * clients: INFO/CONNECT, PING/PONG, SUB/UNSUB (with queue groups), PUB/HPUB
+ * routed as MSG/HMSG. Requests nobody can answer get a 503 no-responders
+ * status.
+ *
+ * A small JetStream emulation sits on top: every published subject outside
+ * _INBOX.> and $JS.> is stored in an in-memory stream named after its first
+ * token (like the gateway's auto-created streams), a publish with a reply
+ * subject gets a PubAck, and these API subjects are answered:
+ *
+ *   $JS.API.STREAM.INFO.<stream>
+ *   $JS.API.STREAM.MSG.GET.<stream>              seq, next_by_subj, last_by_subj
+ *   $JS.API.CONSUMER.CREATE.<stream>.<name>      (also DURABLE.CREATE)
+ *   $JS.API.CONSUMER.INFO.<stream>.<name>
+ *   $JS.API.CONSUMER.DELETE.<stream>.<name>
+ *   $JS.API.CONSUMER.MSG.NEXT.<stream>.<name>    batch, expires, no_wait,
+ *                                                idle_heartbeat
+ *
+ * Pull consumers deliver with $JS.ACK.<stream>.<consumer>... reply subjects,
+ * end requests with 404/408 statuses and send 100 idle heartbeats. Acks are
+ * accepted but not tracked (nothing is redelivered).
+ *
+ * Requirements:
+ *   - Boost.Asio
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 mock_nats_server.cpp -lboost_system -pthread -o mock_nats_server
+ *
+ * Usage:
+ *   ./mock_nats_server [port]
+ *   ./mock_nats_server 4222
+ */
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "nats_json.h"
+#include "nats_protocol.h"
+#include "nats_subject.h"
+
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+// Outgoing data is queued in routing order (under the router lock) and
+// written later by whichever thread flushes, so deliveries to one client
+// never overtake each other.
+class Connection {
+private:
+    tcp::socket socket_;
+    std::mutex queue_mutex_;
+    std::mutex write_mutex_;
+    std::string queued_;
+    std::string writing_;
+
+public:
+    explicit Connection(tcp::socket socket) : socket_(std::move(socket)) {}
+
+    tcp::socket& socket() { return socket_; }
+
+    template <typename Write>
+    void enqueue(Write&& write) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        write(queued_);
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            writing_.swap(queued_);
+        }
+        if (writing_.empty()) return;
+        boost::system::error_code ec;
+        net::write(socket_, net::buffer(writing_), ec);
+        writing_.clear();
+    }
+};
+
+using Touched = std::set<std::shared_ptr<Connection>>;
+
+struct StoredMessage {
+    std::string subject;
+    std::string headers;
+    std::string data;
+    uint64_t sequence;
+    uint64_t timestamp_ns;
+};
+
+struct PullRequest {
+    uint64_t id;
+    std::string reply;
+    int remaining;
+    Clock::time_point expires_at;
+    Clock::duration heartbeat;
+    Clock::time_point next_heartbeat;
+};
+
+struct Consumer {
+    std::string name;
+    std::string filter;
+    std::string ack_policy;
+    size_t next_index = 0;          // next stream position to consider
+    uint64_t delivered = 0;         // consumer sequence
+    std::deque<PullRequest> waiting;
+};
+
+struct Stream {
+    std::vector<StoredMessage> messages;
+    std::map<std::string, Consumer> consumers;
+};
+
+static uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+class Router {
+private:
+    struct Subscription {
+        std::shared_ptr<Connection> connection;
+        std::string subject;
+        std::string queue;
+        std::string sid;
+    };
+
+    std::mutex mutex_;
+    std::vector<Subscription> subscriptions_;
+    std::unordered_map<std::string, size_t> queue_cursor_;
+    std::map<std::string, Stream> streams_;
+    uint64_t next_request_ = 1;
+
+public:
+    // "events.test" -> "EVENTS"
+    static std::string stream_for(std::string_view subject) {
+        std::string name(subject.substr(0, subject.find('.')));
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        return name;
+    }
+
+    static bool stored(std::string_view subject) {
+        return subject.substr(0, 7) != "_INBOX." && subject.substr(0, 4) != "$JS.";
+    }
+
+    void subscribe(const std::shared_ptr<Connection>& connection, std::string_view subject,
+                   std::string_view queue, std::string_view sid) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscriptions_.push_back({connection, std::string(subject), std::string(queue), std::string(sid)});
+    }
+
+    void unsubscribe(const std::shared_ptr<Connection>& connection, std::string_view sid) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscriptions_.erase(std::remove_if(subscriptions_.begin(), subscriptions_.end(),
+                                            [&](const Subscription& s) {
+                                                return s.connection == connection && s.sid == sid;
+                                            }),
+                             subscriptions_.end());
+    }
+
+    void remove(const std::shared_ptr<Connection>& connection) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscriptions_.erase(std::remove_if(subscriptions_.begin(), subscriptions_.end(),
+                                            [&](const Subscription& s) { return s.connection == connection; }),
+                             subscriptions_.end());
+    }
+
+    void publish(const NatsFrame& frame, Touched& touched) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (frame.subject.substr(0, 8) == "$JS.API.") {
+            if (!frame.reply.empty()) {
+                api(frame, touched);
+            }
+            return;
+        }
+        if (frame.subject.substr(0, 8) == "$JS.ACK.") {
+            return;
+        }
+
+        size_t delivered = route(frame.subject, frame.reply, frame.headers, frame.payload, touched);
+
+        if (stored(frame.subject)) {
+            std::string name = stream_for(frame.subject);
+            Stream& stream = streams_[name];
+            uint64_t sequence = stream.messages.size() + 1;
+            stream.messages.push_back({std::string(frame.subject), std::string(frame.headers),
+                                       std::string(frame.payload), sequence, now_ns()});
+            if (!frame.reply.empty()) {
+                std::string ack = "{\"stream\":\"" + name + "\",\"seq\":" + std::to_string(sequence) + "}";
+                route(frame.reply, {}, {}, ack, touched);
+            }
+            for (auto& entry : stream.consumers) {
+                dispatch(name, stream, entry.second, touched);
+            }
+        } else if (!frame.reply.empty() && delivered == 0) {
+            route(frame.reply, {}, "NATS/1.0 503\r\n\r\n", {}, touched);
+        }
+    }
+
+    // Expire pull requests and send idle heartbeats
+    void tick(Touched& touched) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = Clock::now();
+        for (auto& stream : streams_) {
+            for (auto& entry : stream.second.consumers) {
+                auto& waiting = entry.second.waiting;
+                for (auto it = waiting.begin(); it != waiting.end();) {
+                    if (now >= it->expires_at) {
+                        status(it->reply, "408 Request Timeout", it->remaining, touched);
+                        it = waiting.erase(it);
+                        continue;
+                    }
+                    if (it->heartbeat.count() > 0 && now >= it->next_heartbeat) {
+                        route(it->reply, {}, "NATS/1.0 100 Idle Heartbeat\r\n\r\n", {}, touched);
+                        it->next_heartbeat = now + it->heartbeat;
+                    }
+                    ++it;
+                }
+            }
+        }
+    }
+
+private:
+    // Caller holds mutex_. One member per queue group receives the message.
+    // JetStream deliveries are routed to the pull inbox but carry the stored
+    // message's own subject (`shown`).
+    size_t route(std::string_view subject, std::string_view reply, std::string_view headers,
+                 std::string_view payload, Touched& touched, std::string_view shown = {}) {
+        size_t delivered = 0;
+        if (shown.empty()) shown = subject;
+        std::unordered_map<std::string, std::vector<const Subscription*>> groups;
+
+        for (const auto& sub : subscriptions_) {
+            if (!subject_matches(sub.subject, subject)) continue;
+            if (!sub.queue.empty()) {
+                groups[sub.queue].push_back(&sub);
+                continue;
+            }
+            sub.connection->enqueue([&](std::string& out) {
+                append_msg(out, shown, sub.sid, reply, headers, payload);
+            });
+            touched.insert(sub.connection);
+            delivered++;
+        }
+
+        for (auto& group : groups) {
+            size_t& cursor = queue_cursor_[group.first];
+            const Subscription* sub = group.second[cursor++ % group.second.size()];
+            sub->connection->enqueue([&](std::string& out) {
+                append_msg(out, shown, sub->sid, reply, headers, payload);
+            });
+            touched.insert(sub->connection);
+            delivered++;
+        }
+        return delivered;
+    }
+
+    void status(const std::string& reply, const std::string& text, int pending, Touched& touched) {
+        std::string headers = "NATS/1.0 " + text + "\r\nNats-Pending-Messages: " + std::to_string(pending) +
+                              "\r\nNats-Pending-Bytes: 0\r\n\r\n";
+        route(reply, {}, headers, {}, touched);
+    }
+
+    void reply_json(std::string_view reply, const std::string& json, Touched& touched) {
+        route(reply, {}, {}, json, touched);
+    }
+
+    void reply_error(std::string_view reply, int code, int err_code, const std::string& description,
+                     Touched& touched) {
+        reply_json(reply, "{\"error\":{\"code\":" + std::to_string(code) + ",\"err_code\":" +
+                              std::to_string(err_code) + ",\"description\":\"" + description + "\"}}",
+                   touched);
+    }
+
+    // Feed waiting pull requests from the stream
+    void dispatch(const std::string& stream_name, Stream& stream, Consumer& consumer, Touched& touched) {
+        while (!consumer.waiting.empty() && consumer.next_index < stream.messages.size()) {
+            const StoredMessage& message = stream.messages[consumer.next_index++];
+            if (!consumer.filter.empty() && !subject_matches(consumer.filter, message.subject)) {
+                continue;
+            }
+
+            PullRequest& request = consumer.waiting.front();
+            consumer.delivered++;
+            std::string ack = "$JS.ACK." + stream_name + "." + consumer.name + ".1." +
+                              std::to_string(message.sequence) + "." + std::to_string(consumer.delivered) +
+                              "." + std::to_string(message.timestamp_ns) + "." +
+                              std::to_string(stream.messages.size() - consumer.next_index);
+            route(request.reply, ack, message.headers, message.data, touched, message.subject);
+            request.next_heartbeat = Clock::now() + request.heartbeat;
+            if (--request.remaining == 0) {
+                consumer.waiting.pop_front();
+            }
+        }
+    }
+
+    static uint64_t pending(const Stream& stream, const Consumer& consumer) {
+        uint64_t count = 0;
+        for (size_t i = consumer.next_index; i < stream.messages.size(); ++i) {
+            if (consumer.filter.empty() || subject_matches(consumer.filter, stream.messages[i].subject)) count++;
+        }
+        return count;
+    }
+
+    // $JS.API.<...>
+    void api(const NatsFrame& frame, Touched& touched) {
+        std::vector<std::string> tokens;
+        size_t begin = 0;
+        while (begin <= frame.subject.size()) {
+            size_t dot = frame.subject.find('.', begin);
+            if (dot == std::string_view::npos) dot = frame.subject.size();
+            tokens.emplace_back(frame.subject.substr(begin, dot - begin));
+            begin = dot + 1;
+        }
+        // $JS API STREAM INFO <stream>
+        // $JS API STREAM MSG GET <stream>
+        // $JS API CONSUMER {CREATE|INFO|DELETE} <stream> <name>
+        // $JS API CONSUMER {DURABLE.CREATE|MSG.NEXT} <stream> <name>
+        std::string op = tokens.size() > 3 ? tokens[2] + "." + tokens[3] : "";
+        std::string body(frame.payload);
+
+        if (op == "STREAM.INFO" && tokens.size() == 5) {
+            auto it = streams_.find(tokens[4]);
+            if (it == streams_.end()) {
+                return reply_error(frame.reply, 404, 10059, "stream not found", touched);
+            }
+            const auto& messages = it->second.messages;
+            std::string state = "{\"config\":{\"name\":\"" + tokens[4] + "\"},\"state\":{\"messages\":" +
+                                std::to_string(messages.size()) + ",\"first_seq\":" +
+                                std::to_string(messages.empty() ? 0 : 1) + ",\"last_seq\":" +
+                                std::to_string(messages.size());
+            if (!messages.empty()) {
+                state += ",\"first_ts\":\"" + format_rfc3339(messages.front().timestamp_ns) +
+                         "\",\"last_ts\":\"" + format_rfc3339(messages.back().timestamp_ns) + "\"";
+            }
+            state += ",\"consumer_count\":" + std::to_string(it->second.consumers.size()) + "}}";
+            reply_json(frame.reply, state, touched);
+            return;
+        }
+        if (op == "STREAM.MSG" && tokens.size() == 6 && tokens[4] == "GET") {
+            auto it = streams_.find(tokens[5]);
+            if (it == streams_.end()) {
+                return reply_error(frame.reply, 404, 10059, "stream not found", touched);
+            }
+            return get_message(frame.reply, it->second, body, touched);
+        }
+
+        size_t first = (op == "CONSUMER.DURABLE" || op == "CONSUMER.MSG") ? 5 : 4;
+        if (tokens.size() != first + 2 || tokens[0] != "$JS" || tokens[2] != "CONSUMER") {
+            return reply_error(frame.reply, 400, 10003, "unsupported API request", touched);
+        }
+        const std::string& stream_name = tokens[first];
+        const std::string& name = tokens[first + 1];
+
+        auto stream = streams_.find(stream_name);
+        if (stream == streams_.end()) {
+            return reply_error(frame.reply, 404, 10059, "stream not found", touched);
+        }
+        if (op == "CONSUMER.CREATE" || op == "CONSUMER.DURABLE") {
+            return create_consumer(frame.reply, stream_name, stream->second, name, body, touched);
+        }
+
+        auto consumer = stream->second.consumers.find(name);
+        if (consumer == stream->second.consumers.end()) {
+            return reply_error(frame.reply, 404, 10014, "consumer not found", touched);
+        }
+
+        if (op == "CONSUMER.INFO") {
+            reply_json(frame.reply, consumer_info(stream_name, stream->second, consumer->second), touched);
+        } else if (op == "CONSUMER.DELETE") {
+            for (const auto& request : consumer->second.waiting) {
+                status(request.reply, "409 Consumer Deleted", request.remaining, touched);
+            }
+            stream->second.consumers.erase(consumer);
+            reply_json(frame.reply, "{\"success\":true}", touched);
+        } else if (op == "CONSUMER.MSG") {
+            pull(frame.reply, stream_name, stream->second, consumer->second, body, touched);
+        } else {
+            reply_error(frame.reply, 400, 10003, "unsupported API request", touched);
+        }
+    }
+
+    // {"seq":N}, {"seq":N,"next_by_subj":"..."} or {"last_by_subj":"..."}
+    void get_message(std::string_view reply, const Stream& stream, const std::string& body, Touched& touched) {
+        const auto& messages = stream.messages;
+        uint64_t seq = 0;
+        std::string next_by;
+        std::string last_by;
+        json_uint_field(body, "seq", &seq);
+        json_string_field(body, "next_by_subj", &next_by);
+        json_string_field(body, "last_by_subj", &last_by);
+
+        const StoredMessage* found = nullptr;
+        if (!last_by.empty()) {
+            for (size_t i = messages.size(); i-- > 0 && !found;) {
+                if (subject_matches(last_by, messages[i].subject)) found = &messages[i];
+            }
+        } else if (!next_by.empty()) {
+            for (size_t i = seq > 0 ? seq - 1 : 0; i < messages.size() && !found; ++i) {
+                if (subject_matches(next_by, messages[i].subject)) found = &messages[i];
+            }
+        } else if (seq >= 1 && seq <= messages.size()) {
+            found = &messages[seq - 1];
+        }
+        if (!found) {
+            return reply_error(reply, 404, 10037, "no message found", touched);
+        }
+
+        std::string json = "{\"type\":\"io.nats.jetstream.api.v1.stream_msg_get_response\",\"message\":{\"subject\":";
+        append_json_string(json, found->subject);
+        json += ",\"seq\":" + std::to_string(found->sequence);
+        if (!found->headers.empty()) {
+            json += ",\"hdrs\":\"" + base64_encode(found->headers) + "\"";
+        }
+        json += ",\"data\":\"" + base64_encode(found->data) + "\",\"time\":\"" +
+                format_rfc3339(found->timestamp_ns) + "\"}}";
+        reply_json(reply, json, touched);
+    }
+
+    std::string consumer_info(const std::string& stream_name, const Stream& stream, const Consumer& consumer) {
+        return "{\"stream_name\":\"" + stream_name + "\",\"name\":\"" + consumer.name +
+               "\",\"config\":{\"name\":\"" + consumer.name + "\",\"filter_subject\":\"" + consumer.filter +
+               "\",\"ack_policy\":\"" + consumer.ack_policy + "\"},\"delivered\":{\"consumer_seq\":" +
+               std::to_string(consumer.delivered) + "},\"num_pending\":" +
+               std::to_string(pending(stream, consumer)) + ",\"num_waiting\":" +
+               std::to_string(consumer.waiting.size()) + "}";
+    }
+
+    void create_consumer(std::string_view reply, const std::string& stream_name, Stream& stream,
+                         const std::string& name, const std::string& body, Touched& touched) {
+        Consumer consumer;
+        consumer.name = name;
+        json_string_field(body, "filter_subject", &consumer.filter);
+        if (!json_string_field(body, "ack_policy", &consumer.ack_policy)) {
+            consumer.ack_policy = "none";
+        }
+
+        std::string deliver = "all";
+        json_string_field(body, "deliver_policy", &deliver);
+        const auto& messages = stream.messages;
+        auto matches = [&](const StoredMessage& m) {
+            return consumer.filter.empty() || subject_matches(consumer.filter, m.subject);
+        };
+
+        if (deliver == "new") {
+            consumer.next_index = messages.size();
+        } else if (deliver == "last") {
+            consumer.next_index = messages.size();
+            for (size_t i = messages.size(); i-- > 0;) {
+                if (matches(messages[i])) { consumer.next_index = i; break; }
+            }
+        } else if (deliver == "by_start_sequence") {
+            uint64_t start = 1;
+            json_uint_field(body, "opt_start_seq", &start);
+            consumer.next_index = std::min<size_t>(start > 0 ? start - 1 : 0, messages.size());
+        } else if (deliver == "by_start_time") {
+            std::string start;
+            json_string_field(body, "opt_start_time", &start);
+            uint64_t t = parse_rfc3339(start);
+            consumer.next_index = std::lower_bound(messages.begin(), messages.end(), t,
+                                                   [](const StoredMessage& m, uint64_t v) {
+                                                       return m.timestamp_ns < v;
+                                                   }) - messages.begin();
+        }
+
+        auto existing = stream.consumers.find(name);
+        if (existing != stream.consumers.end()) {
+            // Same name: keep position, like an idempotent create
+            existing->second.filter = consumer.filter;
+            existing->second.ack_policy = consumer.ack_policy;
+        } else {
+            stream.consumers.emplace(name, std::move(consumer));
+        }
+        reply_json(reply, consumer_info(stream_name, stream, stream.consumers[name]), touched);
+    }
+
+    void pull(std::string_view reply, const std::string& stream_name, Stream& stream, Consumer& consumer,
+              const std::string& body, Touched& touched) {
+        uint64_t batch = 1;
+        uint64_t expires_ns = 0;
+        uint64_t heartbeat_ns = 0;
+        if (!body.empty() && body[0] == '{') {
+            json_uint_field(body, "batch", &batch);
+            json_uint_field(body, "expires", &expires_ns);
+            json_uint_field(body, "idle_heartbeat", &heartbeat_ns);
+        } else if (!body.empty()) {
+            batch = std::strtoull(body.c_str(), nullptr, 10);
+        }
+        bool no_wait = json_bool_field(body, "no_wait");
+
+        auto now = Clock::now();
+        PullRequest request;
+        request.id = next_request_++;
+        request.reply = std::string(reply);
+        request.remaining = static_cast<int>(std::max<uint64_t>(batch, 1));
+        request.expires_at = now + (expires_ns ? std::chrono::nanoseconds(expires_ns)
+                                               : std::chrono::nanoseconds(std::chrono::hours(24)));
+        request.heartbeat = std::chrono::nanoseconds(heartbeat_ns);
+        request.next_heartbeat = now + request.heartbeat;
+        consumer.waiting.push_back(request);
+        dispatch(stream_name, stream, consumer, touched);
+
+        if (no_wait && !consumer.waiting.empty() && consumer.waiting.back().id == request.id) {
+            status(consumer.waiting.back().reply, "404 No Messages", consumer.waiting.back().remaining, touched);
+            consumer.waiting.pop_back();
+        }
+    }
+};
+
+static void flush_all(Touched& touched) {
+    for (const auto& connection : touched) {
+        connection->flush();
+    }
+    touched.clear();
+}
+
+class Session {
+private:
+    std::shared_ptr<Connection> connection_;
+    Router& router_;
+
+public:
+    Session(tcp::socket socket, Router& router)
+        : connection_(std::make_shared<Connection>(std::move(socket)))
+        , router_(router)
+    {
+    }
+
+    void run() {
+        connection_->enqueue([](std::string& out) {
+            out.append("INFO {\"server_id\":\"MOCK\",\"server_name\":\"mock_nats_server\","
+                       "\"version\":\"2.10.0\",\"proto\":1,\"headers\":true,"
+                       "\"max_payload\":1048576,\"jetstream\":true}\r\n");
+        });
+        connection_->flush();
+
+        NatsParser parser(1024 * 1024);
+        std::string buffer(64 * 1024, '\0');
+        size_t used = 0;
+        Touched touched;
+
+        while (true) {
+            if (used == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+            boost::system::error_code ec;
+            size_t n = connection_->socket().read_some(net::buffer(&buffer[used], buffer.size() - used), ec);
+            if (ec) break;
+            used += n;
+
+            size_t consumed = parser.parse(std::string_view(buffer.data(), used), [&](const NatsFrame& frame) {
+                handle(frame, touched);
+            });
+            if (!parser.error().empty()) {
+                connection_->enqueue([&](std::string& out) { out.append("-ERR '" + parser.error() + "'\r\n"); });
+                connection_->flush();
+                break;
+            }
+            std::memmove(&buffer[0], buffer.data() + consumed, used - consumed);
+            used -= consumed;
+            flush_all(touched);
+        }
+
+        router_.remove(connection_);
+        boost::system::error_code ec;
+        connection_->socket().shutdown(tcp::socket::shutdown_both, ec);
+    }
+
+private:
+    void handle(const NatsFrame& frame, Touched& touched) {
+        switch (frame.op) {
+            case NatsOp::Ping:
+                connection_->enqueue([](std::string& out) { out.append("PONG\r\n"); });
+                touched.insert(connection_);
+                break;
+            case NatsOp::Sub:
+                router_.subscribe(connection_, frame.subject, frame.queue, frame.sid);
+                break;
+            case NatsOp::Unsub:
+                router_.unsubscribe(connection_, frame.sid);
+                break;
+            case NatsOp::Pub:
+            case NatsOp::HPub:
+                router_.publish(frame, touched);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    unsigned short port = static_cast<unsigned short>(argc > 1 ? std::atoi(argv[1]) : 4222);
+
+    try {
+        net::io_context ioc;
+        tcp::acceptor acceptor(ioc, {tcp::v4(), port});
+        Router router;
+
+        std::thread([&router] {
+            Touched touched;
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                router.tick(touched);
+                flush_all(touched);
+            }
+        }).detach();
+
+        std::cout << "Mock NATS server listening on nats://localhost:" << port << std::endl;
+
+        while (true) {
+            tcp::socket socket(ioc);
+            acceptor.accept(socket);
+            socket.set_option(tcp::no_delay(true));
+            std::thread([socket = std::move(socket), &router]() mutable {
+                Session(std::move(socket), router).run();
+            }).detach();
+        }
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
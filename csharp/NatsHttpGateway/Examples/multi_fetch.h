@@ -0,0 +1,344 @@
+/*
+ * Concurrent multi-subject fetch, streamed or merged into a timeline
+ *
+ * MultiFetcher sends one gateway fetch per subject at the same time (libcurl
+ * multi interface, one thread) instead of fetching them one by one.
+ *
+ *   fetch_many()      (timestamp, sequence) order across all subjects. Any
+ *                     pending fetch could hold the earliest message, so this
+ *                     waits for every fetch, then merges the responses with a
+ *                     heap of one cursor per response (k-way merge, O(log k)
+ *                     per message) instead of concatenating and sorting.
+ *   fetch_streamed()  streams: each fetch is handed to the callback as soon
+ *                     as it and every fetch before it in `specs` have
+ *                     answered. Only fetches that finish ahead of an earlier
+ *                     one are held (parsed), so the first message waits for
+ *                     the first fetch, not the slowest, and the callback can
+ *                     stop the remaining transfers.
+ *
+ * Each fetch returns its messages in stream order. The same message fetched
+ * through overlapping filters (events.> and events.test) is delivered once.
+ *
+ * Requirements:
+ *   - libcurl (multi interface)
+ *   - Protobuf (message parsing)
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "http_client.h"
+#include "message.pb.h"
+
+struct FetchSpec {
+    std::string subject;
+    int limit = 10;
+};
+
+struct FetchManyStats {
+    size_t requested = 0;
+    size_t failed = 0;
+    size_t fetched = 0;       // messages across all responses
+    size_t duplicates = 0;    // same (stream, sequence) from overlapping filters
+    size_t delivered = 0;
+};
+
+// Merges FetchResponses whose messages are each in stream order
+class FetchMerger {
+public:
+    // Return false to stop the merge
+    using Handler = std::function<bool(const nats::messages::FetchedMessage&)>;
+
+private:
+    struct Cursor {
+        const nats::messages::FetchResponse* response;
+        int index;
+    };
+
+    std::vector<const nats::messages::FetchResponse*> sources_;
+
+    using Key = std::tuple<int64_t, int32_t, uint64_t, const std::string&>;
+
+    static Key key(const nats::messages::FetchedMessage& m) {
+        return Key(m.timestamp().seconds(), m.timestamp().nanos(), m.sequence(), m.stream());
+    }
+
+public:
+    void add(const nats::messages::FetchResponse* response) {
+        sources_.push_back(response);
+    }
+
+    // Returns the messages delivered; `duplicates` counts skipped repeats
+    size_t merge(const Handler& handler, size_t* duplicates = nullptr) const {
+        auto later = [](const Cursor& a, const Cursor& b) {
+            return key(a.response->messages(a.index)) > key(b.response->messages(b.index));
+        };
+        std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heap(later);
+        for (const auto* response : sources_) {
+            if (response->messages_size() > 0) {
+                heap.push(Cursor{response, 0});
+            }
+        }
+
+        size_t delivered = 0;
+        const nats::messages::FetchedMessage* previous = nullptr;
+        while (!heap.empty()) {
+            Cursor cursor = heap.top();
+            heap.pop();
+            const auto& message = cursor.response->messages(cursor.index);
+            if (++cursor.index < cursor.response->messages_size()) {
+                heap.push(cursor);
+            }
+
+            // Equal keys are adjacent, so one comparison finds repeats
+            if (previous && key(*previous) == key(message)) {
+                if (duplicates) ++*duplicates;
+                continue;
+            }
+            previous = &message;
+            delivered++;
+            if (!handler(message)) {
+                break;
+            }
+        }
+        return delivered;
+    }
+};
+
+class MultiFetcher {
+private:
+    std::string base_url_;
+    size_t max_concurrency_;
+    CURLM* multi_;
+
+    struct Request {
+        CURL* easy = nullptr;
+        std::string body;
+        bool ok = false;
+    };
+
+public:
+    // Up to `max_concurrency` fetches in flight; connections are kept open
+    // between calls
+    explicit MultiFetcher(const std::string& base_url, size_t max_concurrency = 16)
+        : base_url_(base_url)
+        , max_concurrency_(max_concurrency == 0 ? 1 : max_concurrency)
+    {
+        curl_global_once();
+        multi_ = curl_multi_init();
+        if (!multi_) {
+            throw std::runtime_error("Failed to initialize CURL multi handle");
+        }
+        curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(max_concurrency_));
+    }
+
+    ~MultiFetcher() {
+        curl_multi_cleanup(multi_);
+    }
+
+    MultiFetcher(const MultiFetcher&) = delete;
+    MultiFetcher& operator=(const MultiFetcher&) = delete;
+
+    // Fetch every spec concurrently, then deliver all messages in
+    // (timestamp, sequence) order. Fetches that fail are reported and
+    // skipped; returns false if any failed.
+    bool fetch_many(const std::vector<FetchSpec>& specs, const FetchMerger::Handler& handler,
+                    FetchManyStats* stats = nullptr) {
+        FetchManyStats local;
+        FetchManyStats& s = stats ? *stats : local;
+        s = FetchManyStats();
+        s.requested = specs.size();
+
+        std::vector<nats::messages::FetchResponse> responses(specs.size());
+        FetchMerger merger;
+        s.failed += transfer(specs, [&](size_t index, Request& request) {
+            if (parse(specs[index], request, &responses[index], s)) {
+                merger.add(&responses[index]);
+            }
+            return true;
+        });
+
+        s.delivered = merger.merge(handler, &s.duplicates);
+        return s.failed == 0;
+    }
+
+    // Fetch every spec concurrently and deliver each fetch's messages in
+    // `specs` order, as soon as that fetch and all earlier ones are done.
+    // Fetches that fail are reported and skipped; returns false if any
+    // failed. Returning false from the handler stops the remaining fetches.
+    bool fetch_streamed(const std::vector<FetchSpec>& specs, const FetchMerger::Handler& handler,
+                        FetchManyStats* stats = nullptr) {
+        FetchManyStats local;
+        FetchManyStats& s = stats ? *stats : local;
+        s = FetchManyStats();
+        s.requested = specs.size();
+
+        // Completed out of order, waiting for an earlier fetch
+        std::map<size_t, nats::messages::FetchResponse> held;
+        std::set<std::pair<std::string, uint64_t>> seen;
+        size_t emit_next = 0;
+        bool stopped = false;
+
+        auto emit = [&](const nats::messages::FetchResponse& response) {
+            for (const auto& message : response.messages()) {
+                if (specs.size() > 1 && !seen.emplace(message.stream(), message.sequence()).second) {
+                    s.duplicates++;
+                    continue;
+                }
+                s.delivered++;
+                if (!handler(message)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        s.failed += transfer(specs, [&](size_t index, Request& request) {
+            // A failed fetch is emitted as empty so later ones are not held
+            nats::messages::FetchResponse response;
+            if (!parse(specs[index], request, &response, s)) {
+                response.Clear();
+            }
+            if (index != emit_next) {
+                held.emplace(index, std::move(response));
+                return true;
+            }
+
+            if (!emit(response)) {
+                stopped = true;
+                return false;
+            }
+            for (++emit_next; !held.empty() && held.begin()->first == emit_next; ++emit_next) {
+                bool keep_going = emit(held.begin()->second);
+                held.erase(held.begin());
+                if (!keep_going) {
+                    stopped = true;
+                    return false;
+                }
+            }
+            return true;
+        });
+
+        return s.failed == 0 && (stopped || emit_next == specs.size());
+    }
+
+private:
+    // Run the fetches with up to max_concurrency_ in flight, calling
+    // on_done(index, request) as each finishes (request.ok tells success).
+    // on_done returning false abandons the fetches still running. Returns
+    // the number of fetches that never finished because of an error.
+    template <typename OnDone>
+    size_t transfer(const std::vector<FetchSpec>& specs, OnDone&& on_done) {
+        std::vector<Request> requests(specs.size());
+        struct curl_slist* headers = curl_slist_append(nullptr, "Accept: application/x-protobuf");
+        size_t next = 0;
+        int running = 0;
+        size_t finished = 0;
+        bool stop = false;
+
+        auto start_next = [&] {
+            size_t index = next++;
+            Request& request = requests[index];
+            std::string url = base_url_ + "/api/proto/ProtobufMessages/" + specs[index].subject +
+                              "?limit=" + std::to_string(specs[index].limit);
+            request.easy = curl_easy_init();
+            curl_easy_setopt(request.easy, CURLOPT_URL, url.c_str());
+            curl_easy_setopt(request.easy, CURLOPT_HTTPGET, 1L);
+            curl_easy_setopt(request.easy, CURLOPT_HTTPHEADER, headers);
+            curl_easy_setopt(request.easy, CURLOPT_WRITEFUNCTION, write_callback);
+            curl_easy_setopt(request.easy, CURLOPT_WRITEDATA, &request.body);
+            curl_easy_setopt(request.easy, CURLOPT_PRIVATE, reinterpret_cast<char*>(index));
+            curl_multi_add_handle(multi_, request.easy);
+        };
+
+        while (next < specs.size() && next < max_concurrency_) {
+            start_next();
+        }
+
+        do {
+            CURLMcode mc = curl_multi_perform(multi_, &running);
+            if (mc == CURLM_OK && running) {
+                mc = curl_multi_wait(multi_, nullptr, 0, 1000, nullptr);
+            }
+            if (mc != CURLM_OK) {
+                std::cerr << "✗ HTTP multi request failed: " << curl_multi_strerror(mc) << std::endl;
+                break;
+            }
+
+            int queued = 0;
+            while (!stop) {
+                CURLMsg* msg = curl_multi_info_read(multi_, &queued);
+                if (!msg) break;
+                if (msg->msg != CURLMSG_DONE) continue;
+                char* tag = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &tag);
+                size_t index = reinterpret_cast<size_t>(tag);
+                finish(specs[index], requests[index], msg->data.result);
+                finished++;
+                if (!on_done(index, requests[index])) {
+                    stop = true;
+                    break;
+                }
+                if (next < specs.size()) {
+                    start_next();
+                    running++;
+                }
+            }
+        } while (!stop && (running > 0 || next < specs.size()));
+
+        // Anything still attached after an error or a stop
+        for (auto& request : requests) {
+            if (request.easy) {
+                curl_multi_remove_handle(multi_, request.easy);
+                curl_easy_cleanup(request.easy);
+                request.easy = nullptr;
+            }
+        }
+        curl_slist_free_all(headers);
+        return stop ? 0 : specs.size() - finished;
+    }
+
+    // Parse a finished fetch and release its body; false (counted) if it failed
+    bool parse(const FetchSpec& spec, Request& request, nats::messages::FetchResponse* response,
+               FetchManyStats& stats) {
+        if (!request.ok) {
+            stats.failed++;
+            return false;
+        }
+        bool parsed = response->ParseFromString(request.body);
+        std::string().swap(request.body);
+        if (!parsed) {
+            std::cerr << "✗ Failed to parse response for " << spec.subject << std::endl;
+            stats.failed++;
+            return false;
+        }
+        stats.fetched += static_cast<size_t>(response->messages_size());
+        return true;
+    }
+
+    void finish(const FetchSpec& spec, Request& request, CURLcode result) {
+        long status = 0;
+        curl_easy_getinfo(request.easy, CURLINFO_RESPONSE_CODE, &status);
+        curl_multi_remove_handle(multi_, request.easy);
+        curl_easy_cleanup(request.easy);
+        request.easy = nullptr;
+
+        if (result != CURLE_OK) {
+            std::cerr << "✗ HTTP request for " << spec.subject << " failed: " << curl_easy_strerror(result) << std::endl;
+        } else if (status != 200) {
+            std::cerr << "✗ Server returned status " << status << " for " << spec.subject << std::endl;
+        } else {
+            request.ok = true;
+        }
+    }
+};
@@ -0,0 +1,326 @@
+/*
+ * Multi-pattern literal search for payload filtering
+ *
+ * MultiPatternMatcher answers "does this payload contain any of these
+ * strings?" in one pass over the payload, whatever the number of patterns.
+ * Engines:
+ *
+ *   find          a single case-sensitive pattern: std::string_view::find,
+ *                 which the C library already vectorizes.
+ *   teddy         SSSE3 prefilter (the Teddy algorithm from Hyperscan): 16
+ *                 payload positions at a time are tested against nibble
+ *                 tables built from the first 1-3 bytes of every pattern,
+ *                 with the patterns spread over 8 buckets. Only positions
+ *                 that pass are verified byte by byte. Used for up to 32
+ *                 patterns when the CPU has SSSE3 (checked at run time, so
+ *                 the binary needs no -march flag).
+ *   aho-corasick  dense DFA with one table lookup per payload byte. Used for
+ *                 larger pattern sets, where Teddy's candidate verification
+ *                 starts to dominate, and on CPUs without SSSE3.
+ *
+ * With ignore_case, ASCII letters match either case.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define MULTI_PATTERN_TEDDY 1
+#endif
+
+class MultiPatternMatcher {
+public:
+    enum class Engine { Any, Find, Teddy, AhoCorasick };
+
+    static constexpr size_t kTeddyMaxPatterns = 32;
+
+    // Engine::Any picks the fastest engine for the pattern set and CPU.
+    // An empty pattern (or an empty set) matches every payload.
+    explicit MultiPatternMatcher(std::vector<std::string> patterns = {}, bool ignore_case = false,
+                                 Engine engine = Engine::Any)
+        : ignore_case_(ignore_case)
+    {
+        for (auto& pattern : patterns) {
+            if (pattern.empty()) {
+                match_all_ = true;
+                continue;
+            }
+            if (ignore_case_) {
+                for (char& c : pattern) c = fold(static_cast<unsigned char>(c));
+            }
+            patterns_.push_back(std::move(pattern));
+        }
+        if (patterns_.empty()) {
+            match_all_ = true;
+        }
+        if (match_all_) {
+            return;
+        }
+
+        // An engine that can't serve the pattern set falls back to Aho-Corasick
+        find_ = (engine == Engine::Any || engine == Engine::Find) && patterns_.size() == 1 && !ignore_case_;
+        bool teddy = (engine == Engine::Any || engine == Engine::Teddy) &&
+                     patterns_.size() <= kTeddyMaxPatterns && cpu_has_ssse3();
+        if (find_) {
+            return;
+        } else if (teddy) {
+            build_teddy();
+        } else {
+            build_aho_corasick();
+        }
+    }
+
+    bool matches(std::string_view text, size_t* which = nullptr) const {
+        if (match_all_) {
+            return true;
+        }
+        if (find_) {
+            if (which) *which = 0;
+            return text.find(patterns_[0]) != std::string_view::npos;
+        }
+        auto* data = reinterpret_cast<const uint8_t*>(text.data());
+#ifdef MULTI_PATTERN_TEDDY
+        if (teddy_) {
+            return teddy_scan(data, text.size(), which);
+        }
+#endif
+        return aho_corasick_scan(data, text.size(), which);
+    }
+
+    // Index into the patterns given to the constructor, skipping empty ones
+    const std::string& pattern(size_t index) const { return patterns_[index]; }
+    size_t size() const { return patterns_.size(); }
+
+    const char* engine() const {
+        return match_all_ ? "match-all" : find_ ? "find" : teddy_ ? "teddy-ssse3" : "aho-corasick";
+    }
+
+    static bool cpu_has_ssse3() {
+#ifdef MULTI_PATTERN_TEDDY
+        return __builtin_cpu_supports("ssse3");
+#else
+        return false;
+#endif
+    }
+
+private:
+    std::vector<std::string> patterns_;
+    bool ignore_case_;
+    bool match_all_ = false;
+    bool find_ = false;
+
+    // Teddy: lo_[k][n] / hi_[k][n] hold the buckets whose patterns can have
+    // low / high nibble n at offset k
+    bool teddy_ = false;
+    int fingerprint_ = 0;
+    alignas(16) uint8_t lo_[3][16] = {};
+    alignas(16) uint8_t hi_[3][16] = {};
+    std::vector<uint32_t> buckets_[8];
+
+    // Aho-Corasick: dfa_[row + byte] is the next state's row (state * 256),
+    // plus 1 when a pattern ends in that state; match_[state] = pattern index
+    std::vector<uint32_t> dfa_;
+    std::vector<int32_t> match_;
+
+    static char fold(unsigned char c) {
+        return static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+    }
+
+    bool verify(const uint8_t* text, size_t n, size_t pos, uint32_t index) const {
+        const std::string& p = patterns_[index];
+        if (pos + p.size() > n) {
+            return false;
+        }
+        if (!ignore_case_) {
+            return std::memcmp(text + pos, p.data(), p.size()) == 0;
+        }
+        for (size_t i = 0; i < p.size(); ++i) {
+            if (fold(text[pos + i]) != p[i]) return false;
+        }
+        return true;
+    }
+
+    void build_teddy() {
+        teddy_ = true;
+        size_t shortest = patterns_[0].size();
+        for (const auto& p : patterns_) shortest = std::min(shortest, p.size());
+        fingerprint_ = static_cast<int>(std::min<size_t>(3, shortest));
+
+        // Patterns with the same leading bytes share a bucket, which keeps
+        // unrelated prefixes from producing each other's false positives
+        std::vector<uint32_t> order(patterns_.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return patterns_[a].compare(0, fingerprint_, patterns_[b], 0, fingerprint_) < 0;
+        });
+
+        for (size_t i = 0; i < order.size(); ++i) {
+            size_t bucket = std::min<size_t>(7, i * 8 / order.size());
+            buckets_[bucket].push_back(order[i]);
+            uint8_t bit = static_cast<uint8_t>(1u << bucket);
+            const std::string& p = patterns_[order[i]];
+            for (int k = 0; k < fingerprint_; ++k) {
+                auto c = static_cast<unsigned char>(p[k]);
+                lo_[k][c & 15] |= bit;
+                hi_[k][c >> 4] |= bit;
+                if (ignore_case_ && c >= 'a' && c <= 'z') {
+                    unsigned char upper = static_cast<unsigned char>(c - 32);
+                    lo_[k][upper & 15] |= bit;
+                    hi_[k][upper >> 4] |= bit;
+                }
+            }
+        }
+    }
+
+    bool verify_buckets(const uint8_t* text, size_t n, size_t pos, uint32_t bits, size_t* which) const {
+        while (bits) {
+            int bucket = __builtin_ctz(bits);
+            bits &= bits - 1;
+            for (uint32_t index : buckets_[bucket]) {
+                if (verify(text, n, pos, index)) {
+                    if (which) *which = index;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+#ifdef MULTI_PATTERN_TEDDY
+    __attribute__((target("ssse3")))
+    bool teddy_scan(const uint8_t* text, size_t n, size_t* which) const {
+        const __m128i nibble = _mm_set1_epi8(0x0f);
+        const int m = fingerprint_;
+        __m128i lo[3], hi[3];
+        for (int k = 0; k < m; ++k) {
+            lo[k] = _mm_load_si128(reinterpret_cast<const __m128i*>(lo_[k]));
+            hi[k] = _mm_load_si128(reinterpret_cast<const __m128i*>(hi_[k]));
+        }
+
+        size_t i = 0;
+        alignas(16) uint8_t lanes[16];
+        for (; i + 15 + m <= n; i += 16) {
+            __m128i candidates = _mm_set1_epi8(-1);
+            for (int k = 0; k < m; ++k) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + k));
+                __m128i l = _mm_shuffle_epi8(lo[k], _mm_and_si128(v, nibble));
+                __m128i h = _mm_shuffle_epi8(hi[k], _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+                candidates = _mm_and_si128(candidates, _mm_and_si128(l, h));
+            }
+            unsigned mask = ~static_cast<unsigned>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(candidates, _mm_setzero_si128()))) & 0xffffu;
+            if (!mask) {
+                continue;
+            }
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), candidates);
+            while (mask) {
+                int lane = __builtin_ctz(mask);
+                mask &= mask - 1;
+                if (verify_buckets(text, n, i + lane, lanes[lane], which)) {
+                    return true;
+                }
+            }
+        }
+
+        // Fewer than 16 positions left: same tables, one position at a time
+        for (; i + m <= n; ++i) {
+            uint32_t bits = 0xff;
+            for (int k = 0; k < m; ++k) {
+                bits &= lo_[k][text[i + k] & 15] & hi_[k][text[i + k] >> 4];
+            }
+            if (bits && verify_buckets(text, n, i, bits, which)) {
+                return true;
+            }
+        }
+        return false;
+    }
+#endif
+
+    void build_aho_corasick() {
+        // Trie, with -1 for missing edges
+        std::vector<int32_t> next(256, -1);
+        match_.assign(1, -1);
+        for (size_t index = 0; index < patterns_.size(); ++index) {
+            int32_t state = 0;
+            for (unsigned char c : patterns_[index]) {
+                int32_t& edge = next[static_cast<size_t>(state) * 256 + c];
+                if (edge < 0) {
+                    edge = static_cast<int32_t>(match_.size());
+                    match_.push_back(-1);
+                    next.resize(next.size() + 256, -1);
+                }
+                state = next[static_cast<size_t>(state) * 256 + c];
+            }
+            if (match_[state] < 0) {
+                match_[state] = static_cast<int32_t>(index);
+            }
+        }
+
+        // Breadth-first: fill missing edges from the failure state, so the
+        // scan never backtracks
+        std::vector<int32_t> fail(match_.size(), 0);
+        std::deque<int32_t> queue;
+        for (int c = 0; c < 256; ++c) {
+            int32_t& edge = next[c];
+            if (edge < 0) {
+                edge = 0;
+            } else {
+                queue.push_back(edge);
+            }
+        }
+        while (!queue.empty()) {
+            int32_t state = queue.front();
+            queue.pop_front();
+            if (match_[state] < 0) {
+                match_[state] = match_[fail[state]];
+            }
+            for (int c = 0; c < 256; ++c) {
+                int32_t& edge = next[static_cast<size_t>(state) * 256 + c];
+                int32_t via_fail = next[static_cast<size_t>(fail[state]) * 256 + c];
+                if (edge < 0) {
+                    edge = via_fail;
+                } else {
+                    fail[edge] = via_fail;
+                    queue.push_back(edge);
+                }
+            }
+        }
+
+        if (ignore_case_) {
+            for (size_t state = 0; state < match_.size(); ++state) {
+                for (int c = 'A'; c <= 'Z'; ++c) {
+                    next[state * 256 + c] = next[state * 256 + c + 32];
+                }
+            }
+        }
+
+        // Row offsets with the match flag folded in: the scan loop is one
+        // load and one test per byte
+        dfa_.resize(next.size());
+        for (size_t i = 0; i < next.size(); ++i) {
+            uint32_t target = static_cast<uint32_t>(next[i]);
+            dfa_[i] = target * 256 + (match_[target] >= 0 ? 1 : 0);
+        }
+    }
+
+    bool aho_corasick_scan(const uint8_t* text, size_t n, size_t* which) const {
+        const uint32_t* dfa = dfa_.data();
+        uint32_t row = 0;
+        for (size_t i = 0; i < n; ++i) {
+            row = dfa[row + text[i]];
+            if (row & 1) {
+                if (which) *which = static_cast<size_t>(match_[row >> 8]);
+                return true;
+            }
+        }
+        return false;
+    }
+};
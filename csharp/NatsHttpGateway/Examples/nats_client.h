@@ -0,0 +1,891 @@
+/*
+ * NatsClient - direct NATS transport that bypasses the HTTP gateway
+ *
+ * Speaks the NATS client protocol over one TCP connection and implements the
+ * same MessagePublisher / MessageSubscriber interfaces as HttpClient and
+ * WebSocketClient, so callers pick the gateway or the direct path by URL
+ * (see transport.h).
+ *
+ *   - Publishes the same JSON envelope the gateway stores, so consumers
+ *     cannot tell which path a message took. message_id goes out as
+ *     Nats-Msg-Id (JetStream de-duplication), metadata as headers.
+ *   - publish() without `ack` is fire-and-forget; with `ack` it waits for the
+ *     JetStream PubAck (the stream must already exist; the gateway creates
+ *     streams on demand, this client does not).
+ *   - Writes are coalesced: publishers append commands to a buffer and one
+ *     flusher thread writes everything queued since its last write in a
+ *     single call.
+ *   - A reader thread parses with NatsParser (no copies until a message is
+ *     turned into a StreamMessage) and answers server PINGs. Message
+ *     handlers run on that thread; use set_raw_handler() to see frames
+ *     without any conversion. A handler must not wait for the server: a
+ *     publish() with `ack`, request() or flush() called from a handler
+ *     fails at once, since the reply would be read by the thread that is
+ *     waiting for it. Hand such work to another thread.
+ *   - message_id and metadata keys and values must not contain CR or LF,
+ *     and keys must not contain ':' or be empty; publish() rejects them
+ *     rather than let them inject headers or break the frame.
+ *   - Subjects, reply subjects and queue groups must be non-empty, free of
+ *     whitespace and control characters, and (subjects) have no empty
+ *     '.'-separated token; publish() and subscribe() reject anything else
+ *     for the same reason.
+ *
+ * Requirements:
+ *   - Boost.Asio (TCP)
+ *   - Protobuf (message types)
+ *   - pthread
+ */
+
+#pragma once
+
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include "message.pb.h"
+#include "message_transport.h"
+#include "nats_json.h"
+#include "nats_protocol.h"
+#include "natsgw_probes.h"
+#include "receive_modes.h"
+
+// Parse nats://host[:port] (default port 4222)
+struct NatsURL {
+    std::string host;
+    std::string port;
+
+    static NatsURL parse(const std::string& url) {
+        NatsURL result;
+        std::string remaining = url;
+        size_t scheme = remaining.find("://");
+        if (scheme != std::string::npos) {
+            remaining = remaining.substr(scheme + 3);
+        }
+        size_t slash = remaining.find('/');
+        if (slash != std::string::npos) {
+            remaining = remaining.substr(0, slash);
+        }
+        size_t colon = remaining.rfind(':');
+        if (colon != std::string::npos) {
+            result.host = remaining.substr(0, colon);
+            result.port = remaining.substr(colon + 1);
+        } else {
+            result.host = remaining;
+            result.port = "4222";
+        }
+        return result;
+    }
+};
+
+struct NatsWriteStats {
+    uint64_t commands = 0;   // PUB/HPUB/SUB/... queued
+    uint64_t writes = 0;     // socket writes that carried them
+    uint64_t bytes = 0;
+};
+
+// The gateway's JSON envelope for a PublishMessage (nats_json.h)
+inline void append_gateway_envelope(std::string& out, const nats::messages::PublishMessage& message) {
+    append_gateway_envelope(out, message.message_id(), message.source().empty() ? "nats-direct" : message.source(),
+                            message.data());
+}
+
+class NatsClient : public MessagePublisher, public MessageSubscriber {
+public:
+    // Called with the parsed frame; views are only valid during the call
+    using RawHandler = std::function<void(const NatsFrame&)>;
+
+private:
+    static constexpr uint64_t kInboxSid = 1;
+
+    struct Subscription {
+        std::string subject;
+        std::string queue;
+        std::shared_ptr<RawHandler> handler;   // set for dedicated subscriptions
+    };
+
+    struct Reply {
+        bool done = false;
+        int status = 0;
+        std::string payload;
+    };
+
+    NatsURL url_;
+    std::string name_;
+    int max_messages_;
+    std::chrono::milliseconds request_timeout_{5000};
+    size_t max_pending_bytes_ = 8 * 1024 * 1024;
+    size_t max_payload_ = 1024 * 1024;
+
+    boost::asio::io_context ioc_;
+    boost::asio::ip::tcp::socket socket_;
+    std::thread reader_;
+    std::thread flusher_;
+    std::atomic<bool> connected_{false};
+
+    // Outgoing commands, written by the flusher thread
+    std::mutex write_mutex_;
+    std::condition_variable write_cv_;
+    std::condition_variable space_cv_;
+    std::string out_;
+    bool stopping_ = false;
+    NatsWriteStats write_stats_;
+
+    // Subscriptions (sid 1 is the request inbox)
+    std::mutex sub_mutex_;
+    std::unordered_map<uint64_t, Subscription> subscriptions_;
+    uint64_t next_sid_ = 2;
+    std::atomic<int> dedicated_{0};
+    std::atomic<uint64_t> next_inbox_{1};
+    uint64_t dispatching_ = 0;              // sid whose handler the reader is running
+    std::condition_variable dispatch_cv_;
+
+    // Request/reply over the shared inbox
+    std::string inbox_prefix_;
+    std::mutex request_mutex_;
+    std::condition_variable request_cv_;
+    std::unordered_map<uint64_t, Reply*> pending_;
+    uint64_t next_request_ = 1;
+    uint64_t pings_sent_ = 0;
+    uint64_t pongs_received_ = 0;
+
+    // Delivery (reader thread)
+    MessageHandler handler_;
+    RawHandler raw_handler_;
+    ReceiveOptions options_;
+    ReceiveStats stats_;
+    HashSampler sampler_{1};
+    LatestPerSubject latest_;
+    int message_count_ = 0;
+
+    // Reader state, guarded by request_mutex_
+    bool reader_done_ = false;
+    bool limit_reached_ = false;
+    std::string last_error_;
+    bool quiet_ = false;
+
+public:
+    // max_messages <= 0 streams until the connection closes
+    NatsClient(const std::string& url, int max_messages = 10, const std::string& name = "cpp-nats-client")
+        : url_(NatsURL::parse(url))
+        , name_(name)
+        , max_messages_(max_messages)
+        , socket_(ioc_)
+    {
+        std::mt19937_64 rng(std::random_device{}());
+        char token[17];
+        std::snprintf(token, sizeof(token), "%016llx", static_cast<unsigned long long>(rng()));
+        inbox_prefix_ = std::string("_INBOX.") + token + ".";
+    }
+
+    ~NatsClient() override {
+        shutdown();
+    }
+
+    NatsClient(const NatsClient&) = delete;
+    NatsClient& operator=(const NatsClient&) = delete;
+
+    void set_request_timeout(std::chrono::milliseconds timeout) { request_timeout_ = timeout; }
+
+    // Print errors only (no connect/receive/close progress lines), as
+    // WebSocketClient::set_quiet, for library and retrying callers
+    void set_quiet(bool quiet) { quiet_ = quiet; }
+
+    // Bound on queued-but-unwritten bytes; publishers block beyond it
+    void set_max_pending_bytes(size_t bytes) { max_pending_bytes_ = bytes; }
+
+    void set_message_handler(MessageHandler handler) override {
+        handler_ = std::move(handler);
+    }
+
+    // Receive MSG/HMSG frames as parsed, skipping StreamMessage conversion
+    void set_raw_handler(RawHandler handler) {
+        raw_handler_ = std::move(handler);
+    }
+
+    void set_receive_options(const ReceiveOptions& options) override {
+        options_ = options;
+        sampler_ = HashSampler(options.sample_every);
+    }
+
+    const ReceiveStats& stats() const override { return stats_; }
+
+    NatsWriteStats write_stats() {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        return write_stats_;
+    }
+
+    bool is_connected() const { return connected_; }
+
+    void connect() override {
+        try {
+            if (!quiet_) std::cout << "Connecting to nats://" << url_.host << ":" << url_.port << std::endl;
+
+            boost::asio::ip::tcp::resolver resolver(ioc_);
+            boost::asio::connect(socket_, resolver.resolve(url_.host, url_.port));
+            socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+
+            // The server speaks first: INFO {...}
+            std::string buffer(4096, '\0');
+            size_t used = 0;
+            bool have_info = false;
+            NatsParser parser;
+            size_t consumed = 0;
+            while (!have_info) {
+                if (used == buffer.size()) buffer.resize(buffer.size() * 2);
+                used += socket_.read_some(boost::asio::buffer(&buffer[used], buffer.size() - used));
+                consumed = parser.parse(std::string_view(buffer.data(), used), [&](const NatsFrame& frame) {
+                    if (frame.op == NatsOp::Info && !have_info) {
+                        have_info = true;
+                        uint64_t max_payload = 0;
+                        if (json_uint_field(frame.args, "max_payload", &max_payload)) {
+                            max_payload_ = max_payload;
+                        }
+                    }
+                });
+                if (!parser.error().empty()) {
+                    throw std::runtime_error("Not a NATS server: " + parser.error());
+                }
+            }
+
+            std::string hello = "CONNECT {\"verbose\":false,\"pedantic\":false,\"lang\":\"cpp\","
+                                "\"version\":\"1.0\",\"protocol\":1,\"headers\":true,\"no_responders\":true,"
+                                "\"name\":";
+            append_json_string(hello, name_);
+            hello.append("}\r\n");
+            append_sub(hello, inbox_prefix_ + "*", kInboxSid);
+            {
+                std::lock_guard<std::mutex> lock(sub_mutex_);
+                for (const auto& entry : subscriptions_) {
+                    append_sub(hello, entry.second.subject, entry.first, entry.second.queue);
+                }
+            }
+            boost::asio::write(socket_, boost::asio::buffer(hello));
+
+            connected_ = true;
+            std::string leftover = buffer.substr(consumed, used - consumed);
+            reader_ = std::thread([this, leftover] { read_loop(leftover); });
+            flusher_ = std::thread([this] { flush_loop(); });
+
+            // PING/PONG round trip: the server has processed CONNECT and SUBs
+            if (!flush()) {
+                std::string error = this->last_error();
+                shutdown();
+                throw std::runtime_error(error.empty() ? "No PONG from server" : error);
+            }
+
+            if (!quiet_) std::cout << "✓ NATS connected" << std::endl;
+
+        } catch (std::exception const& e) {
+            std::cerr << "✗ Connection error: " << e.what() << std::endl;
+            throw;
+        }
+    }
+
+    // Subscribe to `subject` (optionally in a queue group). May be called
+    // before connect(); returns the subscription ID, 0 if `subject` or
+    // `queue` is invalid.
+    uint64_t subscribe(const std::string& subject, const std::string& queue = "") {
+        if (!valid_queue(queue)) {
+            std::cerr << "✗ Invalid queue group '" << queue << "'" << std::endl;
+            return 0;
+        }
+        return add_subscription(Subscription{subject, queue, nullptr});
+    }
+
+    // Subscribe with a handler of its own. Its messages skip the client's
+    // message handler, receive options and stats (used by JetStream pull
+    // consumers for their delivery inbox).
+    uint64_t subscribe(const std::string& subject, RawHandler handler) {
+        if (!valid_subject(subject)) {
+            std::cerr << "✗ Invalid subject '" << subject << "'" << std::endl;
+            return 0;
+        }
+        dedicated_++;
+        return add_subscription(Subscription{subject, "", std::make_shared<RawHandler>(std::move(handler))});
+    }
+
+    // New `_INBOX.` subject that no other subscription or request uses
+    // (request replies use one token after the prefix, these use two)
+    std::string new_inbox() {
+        return inbox_prefix_ + "sub." + std::to_string(next_inbox_++);
+    }
+
+    // Once this returns the subscription's handler is not running and will
+    // not be called again, so whatever it captured may be destroyed
+    void unsubscribe(uint64_t sid) {
+        {
+            std::unique_lock<std::mutex> lock(sub_mutex_);
+            auto it = subscriptions_.find(sid);
+            if (it == subscriptions_.end()) {
+                return;
+            }
+            if (it->second.handler) {
+                dedicated_--;
+            }
+            subscriptions_.erase(it);
+            if (!on_reader_thread()) {
+                dispatch_cv_.wait(lock, [&] { return dispatching_ != sid; });
+            }
+        }
+        if (connected_) {
+            enqueue([&](std::string& out) { append_unsub(out, sid); });
+        }
+    }
+
+    bool publish(const std::string& subject, const nats::messages::PublishMessage& message,
+                 nats::messages::PublishAck* ack = nullptr) override {
+        std::string headers;
+        if (!message.message_id().empty() || !message.metadata().empty()) {
+            if (!valid_header_value(message.message_id())) {
+                std::cerr << "✗ message_id contains CR or LF" << std::endl;
+                return false;
+            }
+            for (const auto& entry : message.metadata()) {
+                if (!valid_header_key(entry.first) || !valid_header_value(entry.second)) {
+                    std::cerr << "✗ Invalid metadata header '" << entry.first
+                              << "' (empty, ':' in the key, or CR/LF)" << std::endl;
+                    return false;
+                }
+            }
+            headers = "NATS/1.0\r\n";
+            if (!message.message_id().empty()) {
+                headers.append("Nats-Msg-Id: ").append(message.message_id()).append("\r\n");
+            }
+            for (const auto& entry : message.metadata()) {
+                headers.append(entry.first).append(": ").append(entry.second).append("\r\n");
+            }
+            headers.append("\r\n");
+        }
+
+        int64_t start = NATSGW_PROBE_CLOCK(publish_end);
+        NATSGW_PROBE(publish_start, subject.c_str(), 0, message.data().size(), 0);
+
+        std::string payload;
+        payload.reserve(96 + message.data().size() * 4 / 3);
+        append_gateway_envelope(payload, message);
+
+        // Without an ack, publish_end fires once the PUB is queued
+        if (!ack) {
+            bool queued = publish_raw(subject, payload, headers);
+            if (queued) {
+                NATSGW_PROBE(publish_end, subject.c_str(), 0, message.data().size(), natsgw_probe_since(start));
+            }
+            return queued;
+        }
+
+        Reply reply;
+        if (!request(subject, headers, payload, &reply) || !parse_pub_ack(subject, reply, ack)) {
+            return false;
+        }
+        NATSGW_PROBE(publish_end, subject.c_str(), ack->sequence(), message.data().size(), natsgw_probe_since(start));
+        return true;
+    }
+
+    // Publish and print the acknowledgement (same output as HttpClient)
+    bool publish_message(const std::string& subject, const nats::messages::PublishMessage& message) {
+        nats::messages::PublishAck ack;
+        if (!publish(subject, message, &ack)) {
+            return false;
+        }
+
+        std::cout << "✓ Published successfully!" << std::endl;
+        std::cout << "  Stream:   " << ack.stream() << std::endl;
+        std::cout << "  Sequence: " << ack.sequence() << std::endl;
+        std::cout << "  Subject:  " << ack.subject() << std::endl;
+
+        return true;
+    }
+
+    // Queue a PUB (or HPUB when `headers` is set) for the next coalesced write
+    bool publish_raw(std::string_view subject, std::string_view payload, std::string_view headers = {},
+                     std::string_view reply = {}) {
+        if (!valid_subject(subject) || (!reply.empty() && !valid_subject(reply))) {
+            std::cerr << "✗ Invalid subject '" << subject << "'"
+                      << (reply.empty() ? "" : " or reply subject") << std::endl;
+            return false;
+        }
+        if (payload.size() + headers.size() > max_payload_) {
+            std::cerr << "✗ Message exceeds server max_payload (" << max_payload_ << " bytes)" << std::endl;
+            return false;
+        }
+        bool queued = enqueue([&](std::string& out) {
+            if (headers.empty()) {
+                append_pub(out, subject, reply, payload);
+            } else {
+                append_hpub(out, subject, reply, headers, payload);
+            }
+        });
+        if (!queued) {
+            std::cerr << "✗ Not connected to NATS" << std::endl;
+        }
+        return queued;
+    }
+
+    // Send a request on the shared inbox and wait for its reply. `status`
+    // receives the reply's header status (503 = no responders).
+    bool request(std::string_view subject, std::string_view headers, std::string_view payload,
+                 std::string* response, int* status = nullptr) {
+        Reply reply;
+        if (!request(subject, headers, payload, &reply)) {
+            return false;
+        }
+        response->swap(reply.payload);
+        if (status) *status = reply.status;
+        return true;
+    }
+
+    // Round trip a PING: everything queued before it has reached the server
+    bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+        if (on_reader_thread()) {
+            std::cerr << "✗ flush() called from a message handler would wait for itself" << std::endl;
+            return false;
+        }
+        uint64_t target;
+        {
+            std::lock_guard<std::mutex> lock(request_mutex_);
+            target = ++pings_sent_;
+        }
+        if (!enqueue([](std::string& out) { out.append("PING\r\n"); })) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(request_mutex_);
+        return request_cv_.wait_for(lock, timeout, [&] { return pongs_received_ >= target || reader_done_; }) &&
+               pongs_received_ >= target;
+    }
+
+    void stream_messages() override {
+        if (options_.latest_per_subject) {
+            std::vector<nats::messages::StreamMessage> batch;
+            while (latest_.take(batch)) {
+                for (const auto& message : batch) {
+                    deliver(message);
+                }
+            }
+            stats_.conflated = latest_.conflated();
+        } else {
+            std::unique_lock<std::mutex> lock(request_mutex_);
+            request_cv_.wait(lock, [&] { return reader_done_ || limit_reached_; });
+        }
+
+        if (!quiet_) std::cout << "✓ Received " << message_count_ << " messages" << std::endl;
+    }
+
+    void close() override {
+        if (!connected_) {
+            return;
+        }
+        flush(std::chrono::milliseconds(2000));
+        shutdown();
+        if (!quiet_) std::cout << "✓ Connection closed" << std::endl;
+    }
+
+    std::string last_error() {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        return last_error_;
+    }
+
+private:
+    // Handlers run here; this thread reads the replies others wait for
+    bool on_reader_thread() const { return std::this_thread::get_id() == reader_.get_id(); }
+
+    static bool valid_header_value(std::string_view value) {
+        return value.find_first_of("\r\n") == std::string_view::npos;
+    }
+
+    static bool valid_header_key(std::string_view key) {
+        return !key.empty() && key.find_first_of("\r\n:") == std::string_view::npos;
+    }
+
+    // Non-empty tokens separated by '.', with no whitespace or control
+    // characters that would split or end the protocol line
+    static bool valid_subject(std::string_view subject) {
+        if (subject.empty() || subject.front() == '.' || subject.back() == '.') {
+            return false;
+        }
+        char previous = 0;
+        for (char c : subject) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (u <= ' ' || u == 0x7f || (c == '.' && previous == '.')) {
+                return false;
+            }
+            previous = c;
+        }
+        return true;
+    }
+
+    // Empty means no queue group
+    static bool valid_queue(std::string_view queue) {
+        for (char c : queue) {
+            unsigned char u = static_cast<unsigned char>(c);
+            if (u <= ' ' || u == 0x7f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t add_subscription(Subscription subscription) {
+        if (!valid_subject(subscription.subject)) {
+            std::cerr << "✗ Invalid subject '" << subscription.subject << "'" << std::endl;
+            return 0;
+        }
+        uint64_t sid;
+        {
+            std::lock_guard<std::mutex> lock(sub_mutex_);
+            sid = next_sid_++;
+            subscriptions_[sid] = subscription;
+        }
+        if (connected_) {
+            enqueue([&](std::string& out) { append_sub(out, subscription.subject, sid, subscription.queue); });
+        }
+        return sid;
+    }
+
+    bool request(std::string_view subject, std::string_view headers, std::string_view payload, Reply* reply) {
+        if (on_reader_thread()) {
+            std::cerr << "✗ Request on " << subject << " from a message handler would wait for itself" << std::endl;
+            return false;
+        }
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(request_mutex_);
+            id = next_request_++;
+            pending_[id] = reply;
+        }
+
+        std::string inbox = inbox_prefix_ + std::to_string(id);
+        if (!publish_raw(subject, payload, headers, inbox)) {
+            std::lock_guard<std::mutex> lock(request_mutex_);
+            pending_.erase(id);
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(request_mutex_);
+        request_cv_.wait_for(lock, request_timeout_, [&] { return reply->done || reader_done_; });
+        if (!reply->done) {
+            pending_.erase(id);
+            std::cerr << (reader_done_ ? "✗ Connection closed before reply on " : "✗ Request timed out on ")
+                      << subject << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void record_error(const std::string& error) {
+        {
+            std::lock_guard<std::mutex> lock(request_mutex_);
+            if (last_error_.empty()) {
+                last_error_ = error;
+            }
+        }
+        request_cv_.notify_all();
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            stopping_ = true;
+        }
+        write_cv_.notify_all();
+        space_cv_.notify_all();
+
+        // The flusher writes whatever is still queued before it exits
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+        connected_ = false;
+
+        boost::system::error_code ec;
+        socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        if (reader_.joinable()) {
+            reader_.join();
+        }
+        socket_.close(ec);
+    }
+
+    template <typename Write>
+    bool enqueue(Write&& write) {
+        std::unique_lock<std::mutex> lock(write_mutex_);
+        space_cv_.wait(lock, [&] { return out_.size() < max_pending_bytes_ || stopping_ || !connected_; });
+        if (stopping_ || !connected_) {
+            return false;
+        }
+        bool wake = out_.empty();
+        write(out_);
+        write_stats_.commands++;
+        if (wake) {
+            write_cv_.notify_one();
+        }
+        return true;
+    }
+
+    // Double-buffered: while one buffer is on the socket, publishers fill the other
+    void flush_loop() {
+        std::string writing;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(write_mutex_);
+                write_cv_.wait(lock, [&] { return !out_.empty() || stopping_; });
+                if (out_.empty()) {
+                    break;
+                }
+                writing.swap(out_);
+                write_stats_.writes++;
+                write_stats_.bytes += writing.size();
+            }
+            space_cv_.notify_all();
+
+            boost::system::error_code ec;
+            boost::asio::write(socket_, boost::asio::buffer(writing), ec);
+            writing.clear();
+            if (ec) {
+                record_error("Write failed: " + ec.message());
+                break;
+            }
+        }
+    }
+
+    void read_loop(std::string buffer) {
+        NatsParser parser(max_payload_ + 64 * 1024);
+        size_t used = buffer.size();
+        buffer.resize(std::max<size_t>(64 * 1024, used * 2));
+
+        while (true) {
+            if (used > 0) {
+                size_t consumed = parser.parse(std::string_view(buffer.data(), used),
+                                               [this](const NatsFrame& frame) { on_frame(frame); });
+                if (!parser.error().empty()) {
+                    record_error("Protocol error: " + parser.error());
+                    break;
+                }
+                if (consumed > 0) {
+                    std::memmove(&buffer[0], buffer.data() + consumed, used - consumed);
+                    used -= consumed;
+                }
+            }
+            if (used == buffer.size()) {
+                if (buffer.size() > max_payload_ + 128 * 1024) {
+                    record_error("Protocol error: frame exceeds max_payload");
+                    break;
+                }
+                buffer.resize(buffer.size() * 2);
+            }
+
+            boost::system::error_code ec;
+            size_t n = socket_.read_some(boost::asio::buffer(&buffer[used], buffer.size() - used), ec);
+            if (ec) {
+                if (connected_ && ec != boost::asio::error::eof) {
+                    record_error("Read failed: " + ec.message());
+                }
+                break;
+            }
+            used += n;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(request_mutex_);
+            reader_done_ = true;
+        }
+        request_cv_.notify_all();
+        latest_.close();
+
+        // Wake publishers blocked on a full buffer
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            connected_ = false;
+        }
+        space_cv_.notify_all();
+        write_cv_.notify_all();
+    }
+
+    void on_frame(const NatsFrame& frame) {
+        switch (frame.op) {
+            case NatsOp::Msg:
+            case NatsOp::HMsg:
+                if (frame.sid.size() == 1 && frame.sid[0] == '1') {
+                    on_reply(frame);
+                } else {
+                    on_message(frame);
+                }
+                break;
+            case NatsOp::Ping:
+                enqueue([](std::string& out) { out.append("PONG\r\n"); });
+                break;
+            case NatsOp::Pong:
+                {
+                    std::lock_guard<std::mutex> lock(request_mutex_);
+                    pongs_received_++;
+                }
+                request_cv_.notify_all();
+                break;
+            case NatsOp::Err:
+                std::cerr << "✗ NATS error: " << frame.args << std::endl;
+                record_error("NATS error: " + std::string(frame.args));
+                break;
+            default:
+                break;
+        }
+    }
+
+    void on_reply(const NatsFrame& frame) {
+        std::string_view token = frame.subject.substr(std::min(frame.subject.size(), inbox_prefix_.size()));
+        uint64_t id = 0;
+        for (char c : token) {
+            if (c < '0' || c > '9') return;
+            id = id * 10 + (c - '0');
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(request_mutex_);
+            auto it = pending_.find(id);
+            if (it == pending_.end()) {
+                return;   // timed out already
+            }
+            it->second->done = true;
+            it->second->status = header_status(frame.headers);
+            it->second->payload.assign(frame.payload.data(), frame.payload.size());
+            pending_.erase(it);
+        }
+        request_cv_.notify_all();
+    }
+
+    void on_message(const NatsFrame& frame) {
+        if (dedicated_ > 0) {
+            uint64_t sid = 0;
+            for (char c : frame.sid) {
+                sid = sid * 10 + static_cast<uint64_t>(c - '0');
+            }
+            std::shared_ptr<RawHandler> handler;
+            {
+                std::lock_guard<std::mutex> lock(sub_mutex_);
+                auto it = subscriptions_.find(sid);
+                if (it != subscriptions_.end() && it->second.handler) {
+                    handler = it->second.handler;
+                    dispatching_ = sid;
+                }
+            }
+            if (handler) {
+                struct Done {
+                    NatsClient* client;
+                    ~Done() {
+                        {
+                            std::lock_guard<std::mutex> lock(client->sub_mutex_);
+                            client->dispatching_ = 0;
+                        }
+                        client->dispatch_cv_.notify_all();
+                    }
+                } done{this};
+                (*handler)(frame);
+                return;
+            }
+        }
+
+        if (max_messages_ > 0 && message_count_ >= max_messages_) {
+            return;
+        }
+        message_count_++;
+        stats_.received++;
+
+        if (raw_handler_) {
+            stats_.delivered++;
+            raw_handler_(frame);
+        } else {
+            nats::messages::StreamMessage message;
+            int64_t decode_start = NATSGW_PROBE_CLOCK(decode_done);
+            to_stream_message(frame, &message);
+            NATSGW_PROBE(decode_done, message.subject().c_str(), message.sequence(), frame.payload.size(),
+                         natsgw_probe_since(decode_start));
+            if (!sampler_.keep(message)) {
+                stats_.sampled_out++;
+            } else if (options_.latest_per_subject) {
+                latest_.offer(std::move(message));
+            } else {
+                deliver(message);
+            }
+        }
+
+        if (max_messages_ > 0 && message_count_ >= max_messages_) {
+            {
+                std::lock_guard<std::mutex> lock(request_mutex_);
+                limit_reached_ = true;
+            }
+            request_cv_.notify_all();
+            latest_.close();
+        }
+    }
+
+    static void to_stream_message(const NatsFrame& frame, nats::messages::StreamMessage* message) {
+        message->set_subject(frame.subject.data(), frame.subject.size());
+        message->set_data(frame.payload.data(), frame.payload.size());
+        message->set_size_bytes(static_cast<int32_t>(frame.payload.size()));
+
+        JsMessageInfo js;
+        if (parse_js_ack_subject(frame.reply, &js)) {
+            message->set_sequence(js.stream_sequence);
+            message->set_stream(js.stream.data(), js.stream.size());
+            message->set_consumer(js.consumer.data(), js.consumer.size());
+            message->mutable_timestamp()->set_seconds(static_cast<int64_t>(js.timestamp_ns / 1000000000ULL));
+            message->mutable_timestamp()->set_nanos(static_cast<int32_t>(js.timestamp_ns % 1000000000ULL));
+        }
+    }
+
+    void deliver(const nats::messages::StreamMessage& message) {
+        stats_.delivered++;
+        NATSGW_PROBE(handler_start, message.subject().c_str(), message.sequence(), message.data().size(),
+                     natsgw_probe_age(message));
+        int64_t start = NATSGW_PROBE_CLOCK(handler_end);
+        if (handler_) {
+            handler_(message);
+        } else {
+            std::cout << "  Message received:" << std::endl;
+            std::cout << "    Subject:  " << message.subject() << std::endl;
+            std::cout << "    Sequence: " << message.sequence() << std::endl;
+            std::cout << "    Size:     " << message.size_bytes() << " bytes" << std::endl;
+        }
+        NATSGW_PROBE(handler_end, message.subject().c_str(), message.sequence(), message.data().size(),
+                     natsgw_probe_since(start));
+    }
+
+    bool parse_pub_ack(const std::string& subject, const Reply& reply, nats::messages::PublishAck* ack) {
+        if (reply.status == 503) {
+            std::cerr << "✗ No stream bound to " << subject << " (no responders)" << std::endl;
+            return false;
+        }
+
+        std::string error;
+        if (json_field_start(reply.payload, "error") != std::string_view::npos) {
+            json_string_field(reply.payload, "description", &error);
+            std::cerr << "✗ Publish rejected: " << (error.empty() ? reply.payload : error) << std::endl;
+            return false;
+        }
+
+        std::string stream;
+        uint64_t sequence = 0;
+        if (!json_string_field(reply.payload, "stream", &stream) ||
+            !json_uint_field(reply.payload, "seq", &sequence)) {
+            std::cerr << "✗ Failed to parse PubAck: " << reply.payload << std::endl;
+            return false;
+        }
+
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        ack->set_published(true);
+        ack->set_subject(subject);
+        ack->set_stream(stream);
+        ack->set_sequence(sequence);
+        ack->mutable_timestamp()->set_seconds(std::chrono::duration_cast<std::chrono::seconds>(now).count());
+        return true;
+    }
+};
@@ -0,0 +1,437 @@
+/*
+ * Minimal JSON helpers for the direct NATS path
+ *
+ * JetStream API replies and INFO lines are small, flat JSON objects; these
+ * helpers read single fields out of them without pulling in a JSON library.
+ * They also build and unwrap the JSON envelope the gateway stores, which is
+ * what every fetched or streamed message carries as its data. Nested
+ * documents go through the small tree reader at the end (nats_json::Parser).
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+inline void append_json_string(std::string& out, std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (c < 0x20) {
+                    out.append("\\u00");
+                    out.push_back(hex[c >> 4]);
+                    out.push_back(hex[c & 0xf]);
+                } else {
+                    out.push_back(static_cast<char>(c));
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+inline std::string base64_encode(std::string_view data) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t n = static_cast<uint8_t>(data[i]) << 16 | static_cast<uint8_t>(data[i + 1]) << 8 |
+                     static_cast<uint8_t>(data[i + 2]);
+        out.push_back(table[n >> 18]);
+        out.push_back(table[(n >> 12) & 63]);
+        out.push_back(table[(n >> 6) & 63]);
+        out.push_back(table[n & 63]);
+    }
+    if (i < data.size()) {
+        uint32_t n = static_cast<uint8_t>(data[i]) << 16;
+        if (i + 1 < data.size()) n |= static_cast<uint8_t>(data[i + 1]) << 8;
+        out.push_back(table[n >> 18]);
+        out.push_back(table[(n >> 12) & 63]);
+        out.push_back(i + 1 < data.size() ? table[(n >> 6) & 63] : '=');
+        out.push_back('=');
+    }
+    return out;
+}
+
+// Appends the decoded bytes to `out`; false on characters outside the
+// base64 alphabet (padding and line breaks are skipped)
+inline bool base64_decode(std::string_view text, std::string* out) {
+    static const auto table = [] {
+        std::array<int8_t, 256> t{};
+        t.fill(-1);
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 64; ++i) t[static_cast<uint8_t>(alphabet[i])] = static_cast<int8_t>(i);
+        return t;
+    }();
+
+    out->reserve(out->size() + text.size() / 4 * 3);
+    uint32_t bits = 0;
+    int count = 0;
+    for (unsigned char c : text) {
+        if (c == '=' || c == '\r' || c == '\n') continue;
+        int8_t v = table[c];
+        if (v < 0) return false;
+        bits = bits << 6 | static_cast<uint32_t>(v);
+        if (++count == 4) {
+            out->push_back(static_cast<char>(bits >> 16));
+            out->push_back(static_cast<char>(bits >> 8));
+            out->push_back(static_cast<char>(bits));
+            bits = 0;
+            count = 0;
+        }
+    }
+    if (count == 3) {
+        out->push_back(static_cast<char>(bits >> 10));
+        out->push_back(static_cast<char>(bits >> 2));
+    } else if (count == 2) {
+        out->push_back(static_cast<char>(bits >> 4));
+    } else if (count == 1) {
+        return false;
+    }
+    return true;
+}
+
+// Position just after `"key":` (and any whitespace), npos if absent
+inline size_t json_field_start(std::string_view json, std::string_view key) {
+    std::string pattern = "\"" + std::string(key) + "\"";
+    size_t pos = 0;
+    while ((pos = json.find(pattern, pos)) != std::string_view::npos) {
+        size_t i = pos + pattern.size();
+        while (i < json.size() && (json[i] == ' ' || json[i] == '\t')) ++i;
+        if (i < json.size() && json[i] == ':') {
+            ++i;
+            while (i < json.size() && (json[i] == ' ' || json[i] == '\t')) ++i;
+            return i;
+        }
+        pos = i;
+    }
+    return std::string_view::npos;
+}
+
+// First string field named `key`; escape sequences other than \" and \\ are kept as-is
+inline bool json_string_field(std::string_view json, std::string_view key, std::string* out) {
+    size_t i = json_field_start(json, key);
+    if (i == std::string_view::npos || i >= json.size() || json[i] != '"') return false;
+    out->clear();
+    for (++i; i < json.size(); ++i) {
+        if (json[i] == '\\' && i + 1 < json.size()) {
+            char next = json[++i];
+            out->push_back(next == '"' || next == '\\' ? next : '\\');
+            if (next != '"' && next != '\\') out->push_back(next);
+        } else if (json[i] == '"') {
+            return true;
+        } else {
+            out->push_back(json[i]);
+        }
+    }
+    return false;
+}
+
+// First unsigned integer field named `key`
+inline bool json_uint_field(std::string_view json, std::string_view key, uint64_t* out) {
+    size_t i = json_field_start(json, key);
+    if (i == std::string_view::npos || i >= json.size() || json[i] < '0' || json[i] > '9') return false;
+    uint64_t value = 0;
+    for (; i < json.size() && json[i] >= '0' && json[i] <= '9'; ++i) {
+        value = value * 10 + (json[i] - '0');
+    }
+    *out = value;
+    return true;
+}
+
+inline bool json_bool_field(std::string_view json, std::string_view key) {
+    size_t i = json_field_start(json, key);
+    return i != std::string_view::npos && json.substr(i, 4) == "true";
+}
+
+// "2025-12-01T10:00:00[.123456789]Z" -> ns since epoch (0 if malformed).
+// Offsets other than Z are not applied; JetStream always writes UTC.
+inline uint64_t parse_rfc3339(std::string_view text) {
+    std::tm tm{};
+    std::string head(text.substr(0, 19));
+    if (std::sscanf(head.c_str(), "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                    &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6) {
+        return 0;
+    }
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    uint64_t ns = static_cast<uint64_t>(timegm(&tm)) * 1000000000ULL;
+    if (text.size() > 19 && text[19] == '.') {
+        uint64_t scale = 100000000ULL;
+        for (size_t i = 20; i < text.size() && text[i] >= '0' && text[i] <= '9' && scale; ++i, scale /= 10) {
+            ns += static_cast<uint64_t>(text[i] - '0') * scale;
+        }
+    }
+    return ns;
+}
+
+// ns since epoch -> "2025-12-01T10:00:00.123456789Z"
+inline std::string format_rfc3339(uint64_t ns) {
+    time_t seconds = static_cast<time_t>(ns / 1000000000ULL);
+    std::tm tm{};
+    gmtime_r(&seconds, &tm);
+    char text[40];
+    size_t n = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::snprintf(text + n, sizeof(text) - n, ".%09lluZ", static_cast<unsigned long long>(ns % 1000000000ULL));
+    return text;
+}
+
+// UUID v4 string for message IDs the caller did not set
+inline std::string random_message_id() {
+    thread_local std::mt19937_64 rng(std::random_device{}());
+    uint64_t hi = rng();
+    uint64_t lo = rng();
+    hi = (hi & 0xffffffffffff0fffULL) | 0x0000000000004000ULL;
+    lo = (lo & 0x3fffffffffffffffULL) | 0x8000000000000000ULL;
+    char buffer[37];
+    std::snprintf(buffer, sizeof(buffer), "%08x-%04x-%04x-%04x-%012llx",
+                  static_cast<unsigned>(hi >> 32), static_cast<unsigned>((hi >> 16) & 0xffff),
+                  static_cast<unsigned>(hi & 0xffff), static_cast<unsigned>(lo >> 48),
+                  static_cast<unsigned long long>(lo & 0xffffffffffffULL));
+    return buffer;
+}
+
+// The JSON the gateway stores for a published message, and returns as the
+// data of every fetched or streamed message:
+//   {"message_id":..., "timestamp":..., "source":..., "data":<base64>}
+// An empty message_id gets a random one. '+' in the base64 is written as
+// \u002B, as System.Text.Json does.
+inline void append_gateway_envelope(std::string& out, std::string_view message_id, std::string_view source,
+                                    std::string_view data) {
+    auto now = std::chrono::system_clock::now();
+    auto ticks = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count() / 100;
+    time_t seconds = static_cast<time_t>(ticks / 10000000);
+    std::tm tm{};
+    gmtime_r(&seconds, &tm);
+    char timestamp[40];
+    size_t n = std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &tm);
+    std::snprintf(timestamp + n, sizeof(timestamp) - n, ".%07lldZ", static_cast<long long>(ticks % 10000000));
+
+    out.append("{\"message_id\":");
+    append_json_string(out, message_id.empty() ? random_message_id() : std::string(message_id));
+    out.append(",\"timestamp\":");
+    append_json_string(out, timestamp);
+    out.append(",\"source\":");
+    append_json_string(out, source);
+    out.append(",\"data\":\"");
+    for (char c : base64_encode(data)) {
+        if (c == '+') {
+            out.append("\\u002B");
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.append("\"}");
+}
+
+// The original payload from a gateway envelope (the decoded "data" field).
+// False when `payload` is not an envelope. Handles the \u002B and \/
+// escapes System.Text.Json writes into base64 strings.
+inline bool gateway_envelope_data(std::string_view payload, std::string* data) {
+    if (payload.empty() || payload.front() != '{' || json_field_start(payload, "message_id") == std::string_view::npos) {
+        return false;
+    }
+    size_t start = json_field_start(payload, "data");
+    if (start == std::string_view::npos || start >= payload.size() || payload[start] != '"') {
+        return false;
+    }
+    size_t end = payload.find('"', ++start);
+    if (end == std::string_view::npos) {
+        return false;
+    }
+
+    std::string_view encoded = payload.substr(start, end - start);
+    data->clear();
+    if (encoded.find('\\') == std::string_view::npos) {
+        return base64_decode(encoded, data);
+    }
+    std::string unescaped;
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        if (encoded.compare(i, 6, "\\u002B") == 0 || encoded.compare(i, 6, "\\u002b") == 0) {
+            unescaped.push_back('+');
+            i += 5;
+        } else if (encoded.compare(i, 2, "\\/") == 0) {
+            unescaped.push_back('/');
+            i += 1;
+        } else {
+            unescaped.push_back(encoded[i]);
+        }
+    }
+    return base64_decode(unescaped, data);
+}
+
+// Just enough of a JSON reader for benchmark reports (bench_report.h) and
+// the gateway's JSON endpoints (consumer_api.h): whole documents into a
+// tree, numbers as double
+namespace nats_json {
+
+struct Value {
+    enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+    double number = 0;
+    std::string text;
+    std::vector<Value> items;
+    std::vector<std::pair<std::string, Value>> fields;
+
+    const Value* get(std::string_view key) const {
+        for (const auto& field : fields) {
+            if (field.first == key) return &field.second;
+        }
+        return nullptr;
+    }
+};
+
+class Parser {
+private:
+    std::string_view s_;
+    size_t i_ = 0;
+
+public:
+    explicit Parser(std::string_view text) : s_(text) {}
+
+    bool parse(Value* out) {
+        if (!value(out, 0)) return false;
+        skip();
+        return i_ == s_.size();
+    }
+
+private:
+    void skip() {
+        while (i_ < s_.size() && (s_[i_] == ' ' || s_[i_] == '\n' || s_[i_] == '\r' || s_[i_] == '\t')) i_++;
+    }
+
+    bool literal(std::string_view word) {
+        if (s_.substr(i_, word.size()) != word) return false;
+        i_ += word.size();
+        return true;
+    }
+
+    bool string(std::string* out) {
+        if (i_ >= s_.size() || s_[i_] != '"') return false;
+        i_++;
+        while (i_ < s_.size() && s_[i_] != '"') {
+            char c = s_[i_++];
+            if (c != '\\') {
+                out->push_back(c);
+                continue;
+            }
+            if (i_ >= s_.size()) return false;
+            char e = s_[i_++];
+            switch (e) {
+                case 'n': out->push_back('\n'); break;
+                case 'r': out->push_back('\r'); break;
+                case 't': out->push_back('\t'); break;
+                case 'b': out->push_back('\b'); break;
+                case 'f': out->push_back('\f'); break;
+                case 'u': {
+                    // \uXXXX as UTF-8; surrogate pairs are encoded one by one
+                    if (i_ + 4 > s_.size()) return false;
+                    unsigned long code = std::strtoul(std::string(s_.substr(i_, 4)).c_str(), nullptr, 16);
+                    i_ += 4;
+                    if (code < 0x80) {
+                        out->push_back(static_cast<char>(code));
+                    } else if (code < 0x800) {
+                        out->push_back(static_cast<char>(0xc0 | (code >> 6)));
+                        out->push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                    } else {
+                        out->push_back(static_cast<char>(0xe0 | (code >> 12)));
+                        out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                        out->push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                    }
+                    break;
+                }
+                default: out->push_back(e); break;
+            }
+        }
+        if (i_ >= s_.size()) return false;
+        i_++;
+        return true;
+    }
+
+    bool value(Value* out, int depth) {
+        if (depth > 32) return false;
+        skip();
+        if (i_ >= s_.size()) return false;
+        char c = s_[i_];
+        if (c == '{') {
+            out->type = Value::Object;
+            i_++;
+            skip();
+            if (i_ < s_.size() && s_[i_] == '}') {
+                i_++;
+                return true;
+            }
+            while (true) {
+                skip();
+                std::pair<std::string, Value> field;
+                if (!string(&field.first)) return false;
+                skip();
+                if (i_ >= s_.size() || s_[i_++] != ':') return false;
+                if (!value(&field.second, depth + 1)) return false;
+                out->fields.push_back(std::move(field));
+                skip();
+                if (i_ < s_.size() && s_[i_] == ',') {
+                    i_++;
+                    continue;
+                }
+                return i_ < s_.size() && s_[i_++] == '}';
+            }
+        }
+        if (c == '[') {
+            out->type = Value::Array;
+            i_++;
+            skip();
+            if (i_ < s_.size() && s_[i_] == ']') {
+                i_++;
+                return true;
+            }
+            while (true) {
+                out->items.emplace_back();
+                if (!value(&out->items.back(), depth + 1)) return false;
+                skip();
+                if (i_ < s_.size() && s_[i_] == ',') {
+                    i_++;
+                    continue;
+                }
+                return i_ < s_.size() && s_[i_++] == ']';
+            }
+        }
+        if (c == '"') {
+            out->type = Value::String;
+            return string(&out->text);
+        }
+        if (literal("null")) {
+            out->type = Value::Null;
+            return true;
+        }
+        if (literal("true") || literal("false")) {
+            out->type = Value::Bool;
+            out->number = s_[i_ - 2] == 'u';   // tr(u)e
+            return true;
+        }
+        size_t end = i_;
+        while (end < s_.size() && std::string_view("+-0123456789.eE").find(s_[end]) != std::string_view::npos) end++;
+        if (end == i_) return false;
+        out->type = Value::Number;
+        out->number = std::strtod(std::string(s_.substr(i_, end - i_)).c_str(), nullptr);
+        i_ = end;
+        return true;
+    }
+};
+
+}  // namespace nats_json
@@ -0,0 +1,387 @@
+/*
+ * NATS client protocol: zero-copy parser and command writers
+ *
+ * NatsParser walks a caller-owned read buffer and reports every complete
+ * operation (INFO, MSG, HMSG, PING, ... and the client-side PUB, HPUB, SUB,
+ * UNSUB, CONNECT used by mock_nats_server.cpp). Subjects, headers and
+ * payloads are string_views into that buffer: nothing is copied, and the
+ * views are only valid inside the callback. A partial operation at the end
+ * of the buffer is left unconsumed for the next read. Sizes above
+ * max_payload and bodies not followed by CRLF are protocol errors.
+ *
+ * The append_* writers format commands into an output buffer so that many
+ * of them go out in one socket write.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+enum class NatsOp {
+    Info,
+    Connect,
+    Pub,
+    HPub,
+    Sub,
+    Unsub,
+    Msg,
+    HMsg,
+    Ping,
+    Pong,
+    Ok,
+    Err
+};
+
+// One parsed operation. All views point into the parser's input buffer.
+struct NatsFrame {
+    NatsOp op = NatsOp::Ping;
+    std::string_view subject;
+    std::string_view reply;
+    std::string_view sid;
+    std::string_view queue;
+    std::string_view headers;   // HMSG/HPUB: "NATS/1.0 ...\r\n...\r\n\r\n"
+    std::string_view payload;
+    std::string_view args;      // INFO/CONNECT JSON, -ERR text, UNSUB max
+};
+
+class NatsParser {
+private:
+    size_t max_payload_;
+    std::string error_;
+
+public:
+    explicit NatsParser(size_t max_payload = 64 * 1024 * 1024)
+        : max_payload_(std::min<size_t>(max_payload, SIZE_MAX - 10)) {}
+
+    // Empty unless the last parse() hit a protocol error
+    const std::string& error() const { return error_; }
+
+    // Parse every complete operation in `buffer`, calling on_frame(const
+    // NatsFrame&) for each. Returns the number of bytes consumed; on a
+    // protocol error stops and sets error().
+    template <typename OnFrame>
+    size_t parse(std::string_view buffer, OnFrame&& on_frame) {
+        size_t pos = 0;
+        while (pos < buffer.size()) {
+            const char* start = buffer.data() + pos;
+            const char* eol = static_cast<const char*>(std::memchr(start, '\n', buffer.size() - pos));
+            if (!eol) {
+                break;
+            }
+
+            std::string_view line(start, eol - start);
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            size_t next = pos + (eol - start) + 1;
+
+            NatsFrame frame;
+            size_t header_bytes = 0;
+            size_t total_bytes = 0;
+            bool has_body = false;
+            if (!parse_control(line, &frame, &header_bytes, &total_bytes, &has_body)) {
+                return pos;
+            }
+
+            if (has_body) {
+                // Body is `total_bytes` followed by CRLF
+                if (buffer.size() - next < total_bytes + 2) {
+                    break;
+                }
+                if (buffer[next + total_bytes] != '\r' || buffer[next + total_bytes + 1] != '\n') {
+                    fail("Missing CRLF after message body", line);
+                    return pos;
+                }
+                std::string_view body(buffer.data() + next, total_bytes);
+                frame.headers = body.substr(0, header_bytes);
+                frame.payload = body.substr(header_bytes);
+                next += total_bytes + 2;
+            }
+
+            on_frame(static_cast<const NatsFrame&>(frame));
+            pos = next;
+        }
+        return pos;
+    }
+
+private:
+    static bool iequals(std::string_view a, const char* b) {
+        size_t n = std::strlen(b);
+        if (a.size() != n) return false;
+        for (size_t i = 0; i < n; ++i) {
+            char c = a[i];
+            if (c >= 'a' && c <= 'z') c -= 32;
+            if (c != b[i]) return false;
+        }
+        return true;
+    }
+
+    // Decimal size; anything above max_payload_ comes back as max_payload_ + 1
+    // (caught by the limit check) instead of overflowing
+    bool parse_size(std::string_view text, size_t* out) const {
+        if (text.empty()) return false;
+        size_t value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return false;
+            if (value > max_payload_ / 10) {
+                value = max_payload_ + 1;
+                continue;
+            }
+            value = std::min(value * 10 + static_cast<size_t>(c - '0'), max_payload_ + 1);
+        }
+        *out = value;
+        return true;
+    }
+
+    // Split on spaces/tabs; returns the number of tokens (at most N)
+    template <size_t N>
+    static size_t split(std::string_view text, std::string_view (&tokens)[N]) {
+        size_t count = 0;
+        size_t i = 0;
+        while (i < text.size() && count < N) {
+            while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) ++i;
+            size_t begin = i;
+            while (i < text.size() && text[i] != ' ' && text[i] != '\t') ++i;
+            if (i > begin) tokens[count++] = text.substr(begin, i - begin);
+        }
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) ++i;
+        return i < text.size() ? N + 1 : count;
+    }
+
+    bool fail(const std::string& message, std::string_view line) {
+        error_ = message + ": '" + std::string(line.substr(0, 80)) + "'";
+        return false;
+    }
+
+    bool parse_control(std::string_view line, NatsFrame* frame, size_t* header_bytes,
+                       size_t* total_bytes, bool* has_body) {
+        size_t space = line.find_first_of(" \t");
+        std::string_view verb = line.substr(0, space);
+        std::string_view rest = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+        std::string_view t[5];
+
+        if (iequals(verb, "MSG") || iequals(verb, "PUB")) {
+            bool msg = iequals(verb, "MSG");
+            frame->op = msg ? NatsOp::Msg : NatsOp::Pub;
+            size_t n = split(rest, t);
+            // MSG <subject> <sid> [reply] <#bytes> / PUB <subject> [reply] <#bytes>
+            size_t fixed = msg ? 3 : 2;
+            if (n != fixed && n != fixed + 1) return fail("Malformed " + std::string(verb), line);
+            frame->subject = t[0];
+            if (msg) frame->sid = t[1];
+            if (n == fixed + 1) frame->reply = t[fixed - 1];
+            if (!parse_size(t[n - 1], total_bytes)) return fail("Bad size", line);
+            *header_bytes = 0;
+            *has_body = true;
+        } else if (iequals(verb, "HMSG") || iequals(verb, "HPUB")) {
+            bool msg = iequals(verb, "HMSG");
+            frame->op = msg ? NatsOp::HMsg : NatsOp::HPub;
+            size_t n = split(rest, t);
+            // HMSG <subject> <sid> [reply] <#hdr> <#total> / HPUB <subject> [reply] <#hdr> <#total>
+            size_t fixed = msg ? 4 : 3;
+            if (n != fixed && n != fixed + 1) return fail("Malformed " + std::string(verb), line);
+            frame->subject = t[0];
+            if (msg) frame->sid = t[1];
+            if (n == fixed + 1) frame->reply = t[fixed - 2];
+            if (!parse_size(t[n - 2], header_bytes) || !parse_size(t[n - 1], total_bytes) ||
+                *header_bytes > *total_bytes) {
+                return fail("Bad size", line);
+            }
+            *has_body = true;
+        } else if (iequals(verb, "PING")) {
+            frame->op = NatsOp::Ping;
+        } else if (iequals(verb, "PONG")) {
+            frame->op = NatsOp::Pong;
+        } else if (iequals(verb, "+OK")) {
+            frame->op = NatsOp::Ok;
+        } else if (iequals(verb, "-ERR")) {
+            frame->op = NatsOp::Err;
+            frame->args = rest;
+        } else if (iequals(verb, "INFO")) {
+            frame->op = NatsOp::Info;
+            frame->args = rest;
+        } else if (iequals(verb, "CONNECT")) {
+            frame->op = NatsOp::Connect;
+            frame->args = rest;
+        } else if (iequals(verb, "SUB")) {
+            frame->op = NatsOp::Sub;
+            size_t n = split(rest, t);
+            // SUB <subject> [queue] <sid>
+            if (n != 2 && n != 3) return fail("Malformed SUB", line);
+            frame->subject = t[0];
+            if (n == 3) frame->queue = t[1];
+            frame->sid = t[n - 1];
+        } else if (iequals(verb, "UNSUB")) {
+            frame->op = NatsOp::Unsub;
+            size_t n = split(rest, t);
+            // UNSUB <sid> [max]
+            if (n != 1 && n != 2) return fail("Malformed UNSUB", line);
+            frame->sid = t[0];
+            if (n == 2) frame->args = t[1];
+        } else {
+            return fail("Unknown protocol operation", line);
+        }
+
+        if (*has_body && *total_bytes > max_payload_) {
+            return fail("Payload exceeds limit", line);
+        }
+        return true;
+    }
+};
+
+// ---- Command writers ------------------------------------------------------
+
+inline void append_number(std::string& out, size_t value) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n) out.push_back(digits[--n]);
+}
+
+// PUB <subject> [reply] <#bytes>\r\n<payload>\r\n
+inline void append_pub(std::string& out, std::string_view subject, std::string_view reply,
+                       std::string_view payload) {
+    out.append("PUB ").append(subject).push_back(' ');
+    if (!reply.empty()) out.append(reply).push_back(' ');
+    append_number(out, payload.size());
+    out.append("\r\n").append(payload).append("\r\n");
+}
+
+// HPUB <subject> [reply] <#hdr> <#total>\r\n<headers><payload>\r\n
+inline void append_hpub(std::string& out, std::string_view subject, std::string_view reply,
+                        std::string_view headers, std::string_view payload) {
+    out.append("HPUB ").append(subject).push_back(' ');
+    if (!reply.empty()) out.append(reply).push_back(' ');
+    append_number(out, headers.size());
+    out.push_back(' ');
+    append_number(out, headers.size() + payload.size());
+    out.append("\r\n").append(headers).append(payload).append("\r\n");
+}
+
+// MSG/HMSG as sent by a server (used by mock_nats_server.cpp)
+inline void append_msg(std::string& out, std::string_view subject, std::string_view sid,
+                       std::string_view reply, std::string_view headers, std::string_view payload) {
+    out.append(headers.empty() ? "MSG " : "HMSG ").append(subject).push_back(' ');
+    out.append(sid).push_back(' ');
+    if (!reply.empty()) out.append(reply).push_back(' ');
+    if (!headers.empty()) {
+        append_number(out, headers.size());
+        out.push_back(' ');
+    }
+    append_number(out, headers.size() + payload.size());
+    out.append("\r\n").append(headers).append(payload).append("\r\n");
+}
+
+inline void append_sub(std::string& out, std::string_view subject, uint64_t sid, std::string_view queue = {}) {
+    out.append("SUB ").append(subject).push_back(' ');
+    if (!queue.empty()) out.append(queue).push_back(' ');
+    append_number(out, sid);
+    out.append("\r\n");
+}
+
+inline void append_unsub(std::string& out, uint64_t sid) {
+    out.append("UNSUB ");
+    append_number(out, sid);
+    out.append("\r\n");
+}
+
+// ---- Headers -------------------------------------------------------------
+
+// Status code from a header block's first line ("NATS/1.0 503"), 0 if none
+inline int header_status(std::string_view headers) {
+    if (headers.size() < 12 || headers.substr(0, 9) != "NATS/1.0 ") return 0;
+    int status = 0;
+    for (size_t i = 9; i < 12; ++i) {
+        if (headers[i] < '0' || headers[i] > '9') return 0;
+        status = status * 10 + (headers[i] - '0');
+    }
+    return status;
+}
+
+// Value of header `key` (case-sensitive, as NATS sends it), empty if absent
+inline std::string_view header_value(std::string_view headers, std::string_view key) {
+    size_t pos = headers.find("\r\n");
+    while (pos != std::string_view::npos && pos + 2 < headers.size()) {
+        size_t begin = pos + 2;
+        size_t end = headers.find("\r\n", begin);
+        if (end == std::string_view::npos) end = headers.size();
+        std::string_view line = headers.substr(begin, end - begin);
+        if (line.size() > key.size() && line.substr(0, key.size()) == key && line[key.size()] == ':') {
+            std::string_view value = line.substr(key.size() + 1);
+            while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+            return value;
+        }
+        pos = end;
+    }
+    return {};
+}
+
+// ---- JetStream delivery metadata ------------------------------------------
+
+// Parsed from the reply subject of a JetStream-delivered message:
+//   $JS.ACK.<stream>.<consumer>.<delivered>.<sseq>.<cseq>.<ts>.<pending>
+//   $JS.ACK.<domain>.<hash>.<stream>.<consumer>.<delivered>.<sseq>.<cseq>.<ts>.<pending>[.<token>]
+struct JsMessageInfo {
+    std::string_view stream;
+    std::string_view consumer;
+    uint64_t delivered = 0;
+    uint64_t stream_sequence = 0;
+    uint64_t consumer_sequence = 0;
+    uint64_t timestamp_ns = 0;
+    uint64_t pending = 0;
+};
+
+inline bool parse_js_ack_subject(std::string_view reply, JsMessageInfo* info) {
+    if (reply.substr(0, 8) != "$JS.ACK.") return false;
+
+    std::string_view tokens[12];
+    size_t count = 0;
+    size_t begin = 8;
+    while (begin <= reply.size() && count < 12) {
+        size_t dot = reply.find('.', begin);
+        if (dot == std::string_view::npos) dot = reply.size();
+        tokens[count++] = reply.substr(begin, dot - begin);
+        begin = dot + 1;
+    }
+    if (begin <= reply.size()) return false;   // more than 12 tokens
+
+    // v1 has 7 tokens after $JS.ACK, v2 has 9 or 10 (domain and account hash first)
+    size_t first;
+    if (count == 7) {
+        first = 0;
+    } else if (count == 9 || count == 10) {
+        first = 2;
+    } else {
+        return false;
+    }
+
+    uint64_t numbers[5];
+    for (size_t i = 0; i < 5; ++i) {
+        std::string_view token = tokens[first + 2 + i];
+        if (token.empty()) return false;
+        uint64_t value = 0;
+        for (char c : token) {
+            if (c < '0' || c > '9') return false;
+            uint64_t digit = static_cast<uint64_t>(c - '0');
+            if (value > (UINT64_MAX - digit) / 10) return false;   // overflow
+            value = value * 10 + digit;
+        }
+        numbers[i] = value;
+    }
+
+    info->stream = tokens[first];
+    info->consumer = tokens[first + 1];
+    info->delivered = numbers[0];
+    info->stream_sequence = numbers[1];
+    info->consumer_sequence = numbers[2];
+    info->timestamp_ns = numbers[3];
+    info->pending = numbers[4];
+    return true;
+}
@@ -0,0 +1,47 @@
+/*
+ * NATS subject helpers
+ *
+ * Token-wise matching of subjects against NATS wildcard patterns:
+ *   *  matches exactly one token     (events.*      ~ events.test)
+ *   >  matches one or more tokens    (events.>      ~ events.user.created)
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Returns true if `subject` matches the NATS subject `pattern`
+inline bool subject_matches(std::string_view pattern, std::string_view subject) {
+    size_t p = 0;
+    size_t s = 0;
+
+    while (p < pattern.size()) {
+        size_t p_end = pattern.find('.', p);
+        if (p_end == std::string_view::npos) p_end = pattern.size();
+        std::string_view p_token = pattern.substr(p, p_end - p);
+
+        if (s > subject.size()) {
+            return false;
+        }
+
+        // '>' must be the last token and needs at least one subject token
+        if (p_token == ">" && p_end == pattern.size()) {
+            return s < subject.size();
+        }
+
+        size_t s_end = subject.find('.', s);
+        if (s_end == std::string_view::npos) s_end = subject.size();
+        std::string_view s_token = subject.substr(s, s_end - s);
+
+        if (s_token.empty() || (p_token != "*" && p_token != s_token)) {
+            return false;
+        }
+
+        p = p_end + 1;
+        s = s_end + 1;
+    }
+
+    // Both must be exhausted at the same token boundary
+    return p >= pattern.size() && s == subject.size() + 1;
+}
@@ -0,0 +1,389 @@
+/*
+ * natsgw-advisor: lag-driven scaling advice for the gateway's durable
+ * consumers (lag_advisor.h)
+ *
+ *   ./natsgw-advisor http://gateway:8080 orders --workers 2 --workers orders/billing-p0=4
+ *   curl http://localhost:9464/metrics
+ *
+ * Every --interval-ms it samples consumer state: one list call per STREAM
+ * target covers all of that stream's consumers, and STREAM/CONSUMER
+ * samples a single consumer through its info endpoint. Health is sampled
+ * every --health-every rounds (0: never). From the samples it estimates
+ * ingest and drain rates, when each backlog will clear, and how many
+ * workers and what batch size would keep up with ingest plus headroom
+ * while clearing the backlog within --drain-target-s.
+ *
+ * The advice is printed every --print-every rounds and served as
+ * Prometheus gauges on http://0.0.0.0:<--listen>/metrics (0: no endpoint),
+ * together with what sampling itself costs (requests, wall and CPU time).
+ * Ctrl-C (or --rounds) stops and prints the sampling cost.
+ *
+ * --workers tells the advisor how many workers fetch from each consumer
+ * (default 1); capacity per worker, and so the advice, depends on it.
+ *
+ * Requirements:
+ *   - libcurl, Boost.Beast, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 natsgw_advisor.cpp -lcurl -lboost_system -pthread -o natsgw-advisor
+ *
+ * Usage:
+ *   ./natsgw-advisor <url> <stream>[/<consumer>]... [--interval-ms 5000] [--window-s 60]
+ *                    [--drain-target-s 300] [--headroom 1.2] [--batch-interval-ms 1000]
+ *                    [--workers N | --workers STREAM/CONSUMER=N]... [--health-every 6]
+ *                    [--listen 9464] [--print-every 1] [--rounds 0]
+ */
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "consumer_api.h"
+#include "lag_advisor.h"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) {
+    g_stop = true;
+}
+
+// Serves GET /metrics from `render`, one connection at a time
+class MetricsServer {
+private:
+    net::io_context ioc_;
+    tcp::acceptor acceptor_;
+    std::function<std::string()> render_;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+
+public:
+    // Binds the listening socket; throws std::runtime_error if it can't
+    MetricsServer(unsigned short port, std::function<std::string()> render)
+        : acceptor_(ioc_), render_(std::move(render))
+    {
+        boost::system::error_code ec;
+        tcp::endpoint endpoint(tcp::v4(), port);
+        acceptor_.open(endpoint.protocol(), ec);
+        if (!ec) acceptor_.set_option(tcp::acceptor::reuse_address(true), ec);
+        if (!ec) acceptor_.bind(endpoint, ec);
+        if (!ec) acceptor_.listen(tcp::acceptor::max_listen_connections, ec);
+        if (ec) {
+            throw std::runtime_error("Cannot listen on port " + std::to_string(port) + ": " + ec.message());
+        }
+        thread_ = std::thread([this] { serve(); });
+    }
+
+    ~MetricsServer() {
+        stopping_ = true;
+        // A blocking accept() isn't interrupted by close(); connect to wake it
+        boost::system::error_code ec;
+        tcp::socket wake(ioc_);
+        wake.connect({net::ip::make_address("127.0.0.1"), acceptor_.local_endpoint().port()}, ec);
+        if (thread_.joinable()) thread_.join();
+    }
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+private:
+    void serve() {
+        while (!stopping_) {
+            tcp::socket socket(ioc_);
+            boost::system::error_code ec;
+            acceptor_.accept(socket, ec);
+            if (stopping_) break;
+            if (ec) continue;
+
+            beast::flat_buffer buffer;
+            http::request<http::string_body> req;
+            http::read(socket, buffer, req, ec);
+            if (ec) continue;
+
+            http::response<http::string_body> res;
+            res.version(req.version());
+            std::string target(req.target());
+            if (req.method() == http::verb::get && target.substr(0, target.find('?')) == "/metrics") {
+                res.result(http::status::ok);
+                res.set(http::field::content_type, "text/plain; version=0.0.4");
+                res.body() = render_();
+            } else {
+                res.result(http::status::not_found);
+                res.set(http::field::content_type, "text/plain");
+                res.body() = "Not found: try /metrics\n";
+            }
+            res.keep_alive(false);
+            res.prepare_payload();
+            http::write(socket, res, ec);
+            socket.shutdown(tcp::socket::shutdown_both, ec);
+        }
+    }
+};
+
+struct Target {
+    std::string stream;
+    std::string consumer;   // empty: every consumer on the stream
+};
+
+struct SamplingCost {
+    uint64_t rounds = 0;
+    uint64_t samples = 0;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    double wall_s = 0;
+    double cpu_s = 0;
+    double last_round_s = 0;
+};
+
+static double thread_cpu_seconds() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string format_duration(double seconds) {
+    if (seconds < 0) return "never";
+    std::ostringstream out;
+    long s = static_cast<long>(seconds + 0.5);
+    if (s < 60) {
+        out << s << " s";
+    } else if (s < 3600) {
+        out << s / 60 << "m" << std::setw(2) << std::setfill('0') << s % 60 << "s";
+    } else {
+        out << s / 3600 << "h" << std::setw(2) << std::setfill('0') << s / 60 % 60 << "m";
+    }
+    return out.str();
+}
+
+static void print_advice(const std::vector<ConsumerAdvice>& all) {
+    std::cout << std::left << std::setw(28) << "consumer" << std::right << std::setw(10) << "backlog"
+              << std::setw(10) << "in/s" << std::setw(10) << "out/s" << "  " << std::left << std::setw(10)
+              << "trend" << std::right << std::setw(9) << "clears" << std::setw(9) << "workers"
+              << std::setw(7) << "batch" << "  reason" << std::endl;
+    for (const ConsumerAdvice& a : all) {
+        std::string workers = std::to_string(a.workers);
+        if (a.recommended_workers > 0 && a.recommended_workers != a.workers) {
+            workers += "->" + std::to_string(a.recommended_workers);
+        }
+        std::cout << std::left << std::setw(28) << (a.stream + "/" + a.consumer) << std::right << std::setw(10)
+                  << a.backlog << std::fixed << std::setprecision(1) << std::setw(10) << a.ingest_rate
+                  << std::setw(10) << a.drain_rate << "  " << std::left << std::setw(10)
+                  << ConsumerAdvice::trend_name(a.trend) << std::right << std::setw(9)
+                  << format_duration(a.time_to_drain_s) << std::setw(9) << workers << std::setw(7)
+                  << a.recommended_batch << "  " << a.reason
+                  << (a.healthy ? "" : " [" + (a.health_status.empty() ? "unhealthy" : a.health_status) + "]")
+                  << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <url> <stream>[/<consumer>]... [--interval-ms 5000] [--window-s 60]\n"
+                  << "           [--drain-target-s 300] [--headroom 1.2] [--batch-interval-ms 1000]\n"
+                  << "           [--workers N | --workers STREAM/CONSUMER=N]... [--health-every 6]\n"
+                  << "           [--listen 9464] [--print-every 1] [--rounds 0]" << std::endl;
+        return 1;
+    }
+
+    std::string url = argv[1];
+    std::vector<Target> targets;
+    AdvisorOptions options;
+    std::chrono::milliseconds interval(5000);
+    std::vector<std::pair<Target, int>> worker_overrides;
+    int default_workers = 1;
+    int health_every = 6;
+    int listen_port = 9464;
+    int print_every = 1;
+    uint64_t max_rounds = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--interval-ms" && i + 1 < argc) {
+            interval = std::chrono::milliseconds(std::max(100, std::stoi(argv[++i])));
+        } else if (arg == "--window-s" && i + 1 < argc) {
+            options.window = std::chrono::seconds(std::stoi(argv[++i]));
+        } else if (arg == "--drain-target-s" && i + 1 < argc) {
+            options.drain_target = std::chrono::seconds(std::stoi(argv[++i]));
+        } else if (arg == "--headroom" && i + 1 < argc) {
+            options.headroom = std::max(1.0, std::stod(argv[++i]));
+        } else if (arg == "--batch-interval-ms" && i + 1 < argc) {
+            options.batch_interval = std::chrono::milliseconds(std::stoi(argv[++i]));
+        } else if (arg == "--workers" && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t eq = value.find('=');
+            size_t slash = value.find('/');
+            if (eq == std::string::npos) {
+                default_workers = std::max(1, std::stoi(value));
+            } else if (slash != std::string::npos && slash < eq) {
+                Target t{value.substr(0, slash), value.substr(slash + 1, eq - slash - 1)};
+                worker_overrides.emplace_back(t, std::stoi(value.substr(eq + 1)));
+            } else {
+                std::cerr << "✗ --workers takes N or STREAM/CONSUMER=N, not '" << value << "'" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--health-every" && i + 1 < argc) {
+            health_every = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--listen" && i + 1 < argc) {
+            listen_port = std::stoi(argv[++i]);
+        } else if (arg == "--print-every" && i + 1 < argc) {
+            print_every = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            max_rounds = std::stoull(argv[++i]);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "✗ Unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            size_t slash = arg.find('/');
+            targets.push_back(slash == std::string::npos ? Target{arg, ""}
+                                                         : Target{arg.substr(0, slash), arg.substr(slash + 1)});
+        }
+    }
+    if (targets.empty()) {
+        std::cerr << "✗ No stream or consumer to sample" << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    try {
+        ConsumerApi api(url);
+        LagAdvisor advisor(options);
+        advisor.set_default_workers(default_workers);
+        for (const auto& o : worker_overrides) advisor.set_workers(o.first.stream, o.first.consumer, o.second);
+
+        std::mutex mutex;   // advisor and cost, shared with the metrics server
+        SamplingCost cost;
+        std::unique_ptr<MetricsServer> server;
+        if (listen_port > 0) {
+            server = std::make_unique<MetricsServer>(static_cast<unsigned short>(listen_port), [&] {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::string out;
+                advisor.write_metrics(&out);
+                out += "# HELP natsgw_advisor_sampling_rounds_total Sampling rounds\n"
+                       "# TYPE natsgw_advisor_sampling_rounds_total counter\n"
+                       "natsgw_advisor_sampling_rounds_total " + std::to_string(cost.rounds) + "\n"
+                       "# HELP natsgw_advisor_sampling_requests_total Gateway requests made while sampling\n"
+                       "# TYPE natsgw_advisor_sampling_requests_total counter\n"
+                       "natsgw_advisor_sampling_requests_total " + std::to_string(cost.requests) + "\n"
+                       "# HELP natsgw_advisor_sampling_errors_total Failed sampling requests\n"
+                       "# TYPE natsgw_advisor_sampling_errors_total counter\n"
+                       "natsgw_advisor_sampling_errors_total " + std::to_string(cost.errors) + "\n"
+                       "# HELP natsgw_advisor_sampling_cpu_seconds_total CPU time spent sampling and advising\n"
+                       "# TYPE natsgw_advisor_sampling_cpu_seconds_total counter\n"
+                       "natsgw_advisor_sampling_cpu_seconds_total " + LagAdvisor::number(cost.cpu_s) + "\n"
+                       "# HELP natsgw_advisor_sampling_round_seconds Wall time of the last sampling round\n"
+                       "# TYPE natsgw_advisor_sampling_round_seconds gauge\n"
+                       "natsgw_advisor_sampling_round_seconds " + LagAdvisor::number(cost.last_round_s) + "\n";
+                return out;
+            });
+        }
+
+        std::cout << "Advising on " << targets.size() << " target(s) at " << url << " every " << interval.count()
+                  << " ms (window " << options.window.count() << " s, drain target "
+                  << options.drain_target.count() << " s, headroom " << options.headroom << ")";
+        if (server) std::cout << "; metrics on http://localhost:" << listen_port << "/metrics";
+        std::cout << std::endl;
+
+        std::vector<ConsumerInfo> infos;
+        std::vector<ConsumerInfo> batch;
+        auto next_round = std::chrono::steady_clock::now();
+        while (!g_stop && (max_rounds == 0 || cost.rounds < max_rounds)) {
+            auto round_start = std::chrono::steady_clock::now();
+            double cpu_start = thread_cpu_seconds();
+            uint64_t requests = 0;
+            uint64_t errors = 0;
+
+            infos.clear();
+            for (const Target& t : targets) {
+                requests++;
+                if (t.consumer.empty()) {
+                    if (api.list(t.stream, &batch)) {
+                        infos.insert(infos.end(), batch.begin(), batch.end());
+                    } else {
+                        errors++;
+                    }
+                } else {
+                    ConsumerInfo info;
+                    if (api.get(t.stream, t.consumer, &info)) {
+                        infos.push_back(info);
+                    } else {
+                        errors++;
+                    }
+                }
+            }
+            auto sampled_at = std::chrono::steady_clock::now();
+
+            std::vector<std::pair<ConsumerInfo, ConsumerHealth>> healths;
+            if (health_every > 0 && cost.rounds % health_every == 0) {
+                for (const ConsumerInfo& info : infos) {
+                    ConsumerHealth health;
+                    requests++;
+                    if (api.health(info.stream, info.name, &health)) {
+                        healths.emplace_back(info, health);
+                    } else {
+                        errors++;
+                    }
+                }
+            }
+
+            std::vector<ConsumerAdvice> advice;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (const ConsumerInfo& info : infos) advisor.observe(info, sampled_at);
+                for (const auto& h : healths) advisor.observe_health(h.first.stream, h.first.name, h.second);
+                // Consumers gone from a complete round were deleted
+                if (errors == 0) advisor.expire(round_start);
+                if (print_every > 0 && cost.rounds % print_every == 0) advice = advisor.advise_all();
+
+                cost.rounds++;
+                cost.samples += infos.size();
+                cost.requests += requests;
+                cost.errors += errors;
+                cost.last_round_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - round_start).count();
+                cost.wall_s += cost.last_round_s;
+                cost.cpu_s += thread_cpu_seconds() - cpu_start;
+            }
+            if (!advice.empty()) {
+                std::cout << std::endl;
+                print_advice(advice);
+            }
+
+            next_round += interval;
+            while (!g_stop && std::chrono::steady_clock::now() < next_round) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+
+        server.reset();
+        std::lock_guard<std::mutex> lock(mutex);
+        double rounds = std::max<uint64_t>(1, cost.rounds);
+        std::cout << std::endl << "✓ " << cost.rounds << " rounds, " << cost.samples << " consumer samples, "
+                  << cost.requests << " requests (" << cost.errors << " failed)" << std::endl
+                  << std::fixed << std::setprecision(2) << "  Per round: " << cost.wall_s * 1000 / rounds
+                  << " ms wall, " << cost.cpu_s * 1000 / rounds << " ms CPU; "
+                  << (cost.samples ? cost.cpu_s * 1e6 / cost.samples : 0) << " us CPU per consumer sample"
+                  << std::endl;
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,367 @@
+/*
+ * natsgw-group: partitioned consumer groups over the gateway's durable
+ * consumers (consumer_group.h)
+ *
+ *   # producers: orders.<key...> is published as orders.<partition>.<key...>
+ *   ./natsgw-group publish http://gateway:8080 'orders.{partition}.>' --partitions 8 -n 10000
+ *
+ *   # on each worker host (or several on one host with a shared lease dir)
+ *   ./natsgw-group run http://gateway:8080 orders 'orders.{partition}.>' \
+ *       --partitions 8 --group billing --member $(hostname)
+ *
+ *   ./natsgw-group status http://gateway:8080 orders 'orders.{partition}.>' --partitions 8 --group billing
+ *
+ * run creates or reuses the partition consumers, joins the group and
+ * fetches from the partitions it is assigned, one thread per partition.
+ * Assignment changes are printed as they happen (+p3 / -p3). Members find
+ * each other through heartbeats on <coordination prefix>.<group>.<member>
+ * (default prefix "groups"), or through lease files with --lease-dir.
+ * Ctrl-C leaves the group, and the others take over at once.
+ *
+ * publish sends -n messages over --keys keys, each to its partition.
+ * status lists the partition consumers with their backlog and, given the
+ * same membership settings, the current members and their assignment.
+ *
+ * Requirements:
+ *   - libcurl, Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 natsgw_group.cpp message.pb.cc -lprotobuf -lcurl -pthread -o natsgw-group
+ *
+ * Usage:
+ *   ./natsgw-group run <url> <stream> <template> --partitions N --group G --member M
+ *                  [--lease-dir DIR | --coordination PREFIX] [--ttl-ms 6000] [--heartbeat-ms 2000]
+ *                  [--settle-ms 3000] [--batch 50] [--work-us 0]
+ *   ./natsgw-group publish <url> <template> --partitions N [-n 10000] [--keys 1000] [--size 64]
+ *   ./natsgw-group status <url> <stream> <template> --partitions N --group G
+ *                  [--lease-dir DIR | --coordination PREFIX]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "consumer_api.h"
+#include "consumer_group.h"
+#include "http_client.h"
+#include "message.pb.h"
+
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) {
+    g_stop = true;
+}
+
+static void usage(const char* program) {
+    std::cerr << "Usage: " << program << " run <url> <stream> <template> --partitions N --group G --member M\n"
+              << "           [--lease-dir DIR | --coordination PREFIX] [--ttl-ms 6000] [--heartbeat-ms 2000]\n"
+              << "           [--settle-ms 3000] [--batch 50] [--work-us 0]\n"
+              << "       " << program << " publish <url> <template> --partitions N [-n 10000] [--keys 1000]"
+              << " [--size 64]\n"
+              << "       " << program << " status <url> <stream> <template> --partitions N --group G\n"
+              << "           [--lease-dir DIR | --coordination PREFIX]" << std::endl;
+}
+
+struct Settings {
+    PartitionScheme scheme;
+    std::string url;
+    std::string member;
+    std::string lease_dir;
+    std::string coordination = "groups";
+    GroupOptions options;
+    int batch = 50;
+    int work_us = 0;
+    uint64_t count = 10000;
+    int keys = 1000;
+    size_t size = 64;
+};
+
+static void parse_flags(int argc, char* argv[], int first, Settings* s) {
+    for (int i = first; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--partitions" && i + 1 < argc) {
+            s->scheme.partitions = std::stoi(argv[++i]);
+        } else if (arg == "--group" && i + 1 < argc) {
+            s->scheme.group = argv[++i];
+        } else if (arg == "--member" && i + 1 < argc) {
+            s->member = argv[++i];
+        } else if (arg == "--lease-dir" && i + 1 < argc) {
+            s->lease_dir = argv[++i];
+        } else if (arg == "--coordination" && i + 1 < argc) {
+            s->coordination = argv[++i];
+        } else if (arg == "--ttl-ms" && i + 1 < argc) {
+            s->options.ttl = std::chrono::milliseconds(std::stoi(argv[++i]));
+        } else if (arg == "--heartbeat-ms" && i + 1 < argc) {
+            s->options.heartbeat = std::chrono::milliseconds(std::stoi(argv[++i]));
+        } else if (arg == "--settle-ms" && i + 1 < argc) {
+            s->options.settle = std::chrono::milliseconds(std::stoi(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            s->batch = std::max(1, std::min(100, std::stoi(argv[++i])));
+        } else if (arg == "--work-us" && i + 1 < argc) {
+            s->work_us = std::stoi(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            s->count = std::stoull(argv[++i]);
+        } else if (arg == "--keys" && i + 1 < argc) {
+            s->keys = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--size" && i + 1 < argc) {
+            s->size = std::stoull(argv[++i]);
+        }
+    }
+}
+
+static std::unique_ptr<Membership> make_membership(const Settings& s, const std::string& member) {
+    if (!s.lease_dir.empty()) {
+        return std::make_unique<LeaseFileMembership>(s.lease_dir, s.scheme.group, member, s.options.ttl);
+    }
+    return std::make_unique<SubjectMembership>(s.url, s.coordination, s.scheme.group, member, s.options.ttl);
+}
+
+// One fetch loop per owned partition
+class PartitionWorker {
+private:
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+
+public:
+    std::atomic<uint64_t> consumed{0};
+    std::atomic<uint64_t> out_of_order{0};
+
+    PartitionWorker(const Settings& s, const std::string& consumer) {
+        auto api = std::make_shared<ConsumerApi>(s.url);
+        std::string stream = s.scheme.stream;
+        int batch = s.batch;
+        int work_us = s.work_us;
+        thread_ = std::thread([this, api, stream, consumer, batch, work_us] {
+            std::vector<ConsumedMessage> messages;
+            uint64_t last = 0;
+            while (!stop_) {
+                if (!api->fetch(stream, consumer, batch, 1, &messages)) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                    continue;
+                }
+                for (const auto& m : messages) {
+                    if (m.sequence <= last) out_of_order++;
+                    last = m.sequence;
+                    if (work_us > 0) std::this_thread::sleep_for(std::chrono::microseconds(work_us));
+                    consumed++;
+                }
+            }
+        });
+    }
+
+    // Let the loop end after the fetch in flight (at most the 1 s fetch timeout)
+    void request_stop() { stop_ = true; }
+
+    void stop() {
+        request_stop();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    ~PartitionWorker() { stop(); }
+};
+
+static int run(const Settings& s) {
+    ConsumerApi api(s.url);
+    std::map<int, std::unique_ptr<PartitionWorker>> workers;
+    uint64_t finished = 0;        // consumed by workers already stopped
+    uint64_t out_of_order = 0;
+    std::map<int, uint64_t> per_partition;
+
+    auto on_assign = [&](int partition, const std::string& consumer) {
+        workers[partition] = std::make_unique<PartitionWorker>(s, consumer);
+        std::cout << "  +p" << partition << " (" << s.scheme.filter(partition) << ")" << std::endl;
+    };
+    auto on_revoke = [&](int partition) {
+        auto it = workers.find(partition);
+        if (it == workers.end()) return;
+        it->second->stop();
+        finished += it->second->consumed;
+        out_of_order += it->second->out_of_order;
+        per_partition[partition] += it->second->consumed;
+        workers.erase(it);
+        std::cout << "  -p" << partition << std::endl;
+    };
+
+    ConsumerGroup group(s.scheme, s.member, make_membership(s, s.member), s.options, on_assign, on_revoke);
+    group.on_members([](const std::vector<std::string>& members, uint64_t) {
+        std::cout << "Members (" << members.size() << "):";
+        for (const auto& m : members) std::cout << " " << m;
+        std::cout << std::endl;
+    });
+    if (!group.ensure_consumers(api)) {
+        return 1;
+    }
+    std::cout << "Member " << s.member << " of " << s.scheme.group << " ("
+              << (s.lease_dir.empty() ? "subject " + s.coordination + "." + s.scheme.group + ".*"
+                                      : "leases in " + s.lease_dir)
+              << ")" << std::endl;
+
+    auto consumed_now = [&] {
+        uint64_t total = finished;
+        for (const auto& w : workers) total += w.second->consumed;
+        return total;
+    };
+
+    uint64_t last_total = 0;
+    auto last_report = std::chrono::steady_clock::now();
+    while (!g_stop) {
+        if (!group.tick()) {
+            std::cerr << "⚠ Heartbeat failed; keeping the current assignment" << std::endl;
+        }
+
+        auto wake = std::chrono::steady_clock::now() + s.options.heartbeat;
+        while (!g_stop && std::chrono::steady_clock::now() < wake) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(10)) {
+            uint64_t total = consumed_now();
+            double seconds = std::chrono::duration<double>(now - last_report).count();
+            std::cout << "  " << total << " consumed (" << std::fixed << std::setprecision(0)
+                      << (total - last_total) / seconds << " msg/s), partitions:";
+            for (int p : group.owned()) std::cout << " " << p;
+            std::cout << std::endl;
+            last_total = total;
+            last_report = now;
+        }
+    }
+
+    // Wind all partitions down together, then hand them over
+    for (auto& w : workers) w.second->request_stop();
+    group.leave();
+    std::cout << "✓ Left " << s.scheme.group << " after consuming " << finished << " messages";
+    if (out_of_order > 0) std::cout << " (" << out_of_order << " out of order)";
+    std::cout << std::endl << "  Per partition:";
+    for (const auto& entry : per_partition) std::cout << " p" << entry.first << "=" << entry.second;
+    std::cout << std::endl;
+    return 0;
+}
+
+static int publish(const Settings& s) {
+    HttpClient client(s.url);
+    std::string prefix = s.scheme.filter_template.substr(0, s.scheme.filter_template.find("{partition}"));
+    std::vector<uint64_t> per_partition(static_cast<size_t>(s.scheme.partitions));
+    uint64_t failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < s.count && !g_stop; ++i) {
+        std::string key_subject = prefix + "key" + std::to_string(i % s.keys);
+        std::string subject = s.scheme.subject_for(key_subject);
+        nats::messages::PublishMessage message;
+        message.set_subject(subject);
+        message.set_source("natsgw-group");
+        message.set_data(std::string(s.size, 'x'));
+        if (client.publish(subject, message)) {
+            per_partition[static_cast<size_t>(s.scheme.partition_of(key_subject))]++;
+        } else {
+            failed++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t sent = 0;
+    for (uint64_t n : per_partition) sent += n;
+    std::cout << "✓ Published " << sent << " messages in " << std::fixed << std::setprecision(2) << seconds
+              << " s, " << failed << " failed" << std::endl << "  Per partition:";
+    for (size_t p = 0; p < per_partition.size(); ++p) std::cout << " p" << p << "=" << per_partition[p];
+    std::cout << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+static int status(const Settings& s) {
+    ConsumerApi api(s.url);
+    std::vector<std::string> members;
+    {
+        // Read the membership under a throwaway name that leaves at once
+        auto membership = make_membership(s, "status-" + std::to_string(::getpid()));
+        if (membership->heartbeat(false, &members)) {
+            std::vector<std::string> ignored;
+            membership->heartbeat(true, &ignored);
+        }
+        members.erase(std::remove_if(members.begin(), members.end(), [](const std::string& m) {
+            return m.compare(0, 7, "status-") == 0;
+        }), members.end());
+    }
+    auto assignment = ConsumerGroup::assign(members, s.scheme.partitions);
+    std::map<int, std::string> owner;
+    for (const auto& entry : assignment) {
+        for (int p : entry.second) owner[p] = entry.first;
+    }
+
+    std::cout << std::left << std::setw(16) << "consumer" << std::setw(24) << "filter" << std::right
+              << std::setw(10) << "pending" << std::setw(12) << "delivered" << "  owner" << std::endl;
+    bool ok = true;
+    for (int p = 0; p < s.scheme.partitions; ++p) {
+        ConsumerInfo info;
+        bool not_found = false;
+        std::string name = s.scheme.consumer(p);
+        bool found = api.get(s.scheme.stream, name, &info, &not_found);
+        std::cout << std::left << std::setw(16) << name << std::setw(24) << s.scheme.filter(p) << std::right;
+        if (found) {
+            std::cout << std::setw(10) << info.num_pending << std::setw(12) << info.delivered;
+        } else {
+            std::cout << std::setw(22) << (not_found ? "(missing)" : "(error)");
+            ok = ok && not_found;
+        }
+        std::cout << "  " << (owner.count(p) ? owner[p] : "-") << std::endl;
+    }
+    std::cout << "Members (" << members.size() << "):";
+    for (const auto& m : members) std::cout << " " << m;
+    std::cout << std::endl;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string mode = argc > 1 ? argv[1] : "";
+    Settings s;
+    int first_flag = 0;
+    if (mode == "publish" && argc >= 4) {
+        s.url = argv[2];
+        s.scheme.filter_template = argv[3];
+        s.scheme.stream = "-";
+        s.scheme.group = "publish";
+        first_flag = 4;
+    } else if ((mode == "run" || mode == "status") && argc >= 5) {
+        s.url = argv[2];
+        s.scheme.stream = argv[3];
+        s.scheme.filter_template = argv[4];
+        first_flag = 5;
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+    parse_flags(argc, argv, first_flag, &s);
+
+    std::string error;
+    if (!s.scheme.valid(&error)) {
+        std::cerr << "✗ " << error << std::endl;
+        return 1;
+    }
+    if (mode == "run" && s.member.empty()) {
+        std::cerr << "✗ --member is required" << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    int result;
+    try {
+        result = mode == "run" ? run(s) : mode == "publish" ? publish(s) : status(s);
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return result;
+}
@@ -0,0 +1,134 @@
+/*
+ * USDT probes on the client hot paths
+ *
+ * Static tracepoints (provider "natsgw") that bpftrace, perf or SystemTap
+ * can attach to in a running process without a rebuild:
+ *
+ *   bpftrace -e 'usdt:./natsgw-tail:natsgw:handler_end { @[str(arg0)] = hist(arg3); }'
+ *   perf probe -x ./http_client sdt_natsgw:publish_end
+ *
+ * Every probe has the same four arguments:
+ *
+ *   arg0  const char*  subject (the URL for http_response, the stream path
+ *                      for ws_frame)
+ *   arg1  uint64       sequence (the HTTP status for http_response, the
+ *                      frame count for ws_frame)
+ *   arg2  uint64       size in bytes
+ *   arg3  int64        latency in ns (0 when there is none)
+ *
+ *   probe           fired by                        latency
+ *   publish_start   HttpClient, NatsClient publish  -
+ *   publish_end     same, after the ack (or queue)  publish call
+ *   http_response   every HttpClient request        curl total time
+ *   ws_frame        WebSocketClient per frame       blocked in read
+ *   decode_done     WebSocket and NATS receive      frame parse
+ *   handler_start   before the message handler      publish to handler (age)
+ *   handler_end     after the message handler       handler run time
+ *   reconnect       HttpClient new connection,      HttpClient: connect time
+ *                   SnapshotTail::resume(),         resume: 0
+ *                   RedundantSubscription legs      leg: 0
+ *
+ * Each probe has an SDT semaphore (natsgw_<name>_semaphore, in the
+ * .probes section) that bpftrace, perf and SystemTap raise while they are
+ * attached. NATSGW_PROBE checks it first, so an idle probe costs one load
+ * and a predicted branch, and its arguments are not evaluated. The
+ * steady_clock reads (about 20 ns each) around probed sections go through
+ * NATSGW_PROBE_CLOCK(name) and natsgw_probe_since(), so they too happen only
+ * while a tracer is attached. A latency that spans the moment of attaching
+ * is reported as 0.
+ *
+ * Probes are compiled in when <sys/sdt.h> is available (systemtap-sdt-dev /
+ * systemtap-sdt-devel). Define NATSGW_NO_USDT (make USDT=0, cmake
+ * -DNATSGW_USDT=OFF) to leave them out. Without probes, NATSGW_PROBE and
+ * the clock reads compile to nothing. Include this header before anything
+ * else that includes <sys/sdt.h>, so the probes are built with semaphores.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if !defined(NATSGW_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#ifndef _SDT_HAS_SEMAPHORES
+#define _SDT_HAS_SEMAPHORES 1
+#endif
+#include <sys/sdt.h>
+#define NATSGW_USDT 1
+#endif
+#endif
+
+#ifdef NATSGW_USDT
+
+// One semaphore per probe, named as sys/sdt.h expects. Inline variables,
+// so every translation unit that includes this header shares them.
+#define NATSGW_PROBE_SEMAPHORE(name) \
+    __extension__ inline volatile unsigned short natsgw_##name##_semaphore __attribute__((unused, section(".probes")))
+
+NATSGW_PROBE_SEMAPHORE(publish_start);
+NATSGW_PROBE_SEMAPHORE(publish_end);
+NATSGW_PROBE_SEMAPHORE(http_response);
+NATSGW_PROBE_SEMAPHORE(ws_frame);
+NATSGW_PROBE_SEMAPHORE(decode_done);
+NATSGW_PROBE_SEMAPHORE(handler_start);
+NATSGW_PROBE_SEMAPHORE(handler_end);
+NATSGW_PROBE_SEMAPHORE(reconnect);
+
+// True while a tracer is attached to the probe
+#define NATSGW_PROBE_ENABLED(name) __builtin_expect(natsgw_##name##_semaphore != 0, 0)
+
+#define NATSGW_PROBE(name, subject, sequence, size, latency_ns)                                                 \
+    do {                                                                                                      \
+        if (NATSGW_PROBE_ENABLED(name)) {                                                                     \
+            DTRACE_PROBE4(natsgw, name, static_cast<const char*>(subject), static_cast<uint64_t>(sequence),   \
+                          static_cast<uint64_t>(size), static_cast<int64_t>(latency_ns));                     \
+        }                                                                                                     \
+    } while (0)
+
+// Timestamp for probe latencies
+inline int64_t natsgw_probe_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#else
+
+#define NATSGW_PROBE_ENABLED(name) false
+
+// Never defined: only named in sizeof, so the arguments count as used
+// without being evaluated
+template <typename... Args>
+int natsgw_probe_unused(const Args&...);
+
+#define NATSGW_PROBE(name, subject, sequence, size, latency_ns) \
+    static_cast<void>(sizeof(natsgw_probe_unused(subject, sequence, size, latency_ns)))
+
+inline constexpr int64_t natsgw_probe_now() {
+    return 0;
+}
+
+#endif
+
+// Start of a section timed for probe `name`: a timestamp while the probe is
+// attached, 0 otherwise
+#define NATSGW_PROBE_CLOCK(name) (NATSGW_PROBE_ENABLED(name) ? natsgw_probe_now() : int64_t{0})
+
+// Nanoseconds since a NATSGW_PROBE_CLOCK() start (0 if there was none)
+inline int64_t natsgw_probe_since(int64_t start) {
+    return start != 0 ? natsgw_probe_now() - start : 0;
+}
+
+// Nanoseconds from a message's publish timestamp to now (0 without one)
+template <typename Message>
+inline int64_t natsgw_probe_age(const Message& message) {
+#ifdef NATSGW_USDT
+    if (message.has_timestamp()) {
+        int64_t published = message.timestamp().seconds() * 1000000000LL + message.timestamp().nanos();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count() - published;
+    }
+#endif
+    static_cast<void>(message);
+    return 0;
+}
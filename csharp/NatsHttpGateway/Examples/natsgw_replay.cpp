@@ -0,0 +1,268 @@
+/*
+ * natsgw-replay: capture production traffic and replay it against a gateway
+ *
+ *   ./natsgw-replay record ws://prod-gateway:8080 'events.>' events.cap -n 100000
+ *   ./natsgw-replay play events.cap http://staging-gateway:8080 --speed 2 --connections 8
+ *
+ * record subscribes (gateway WebSocket, or nats:// for direct NATS) and
+ * writes every message with its subject, stream position and original
+ * timestamp to a capture file (traffic_capture.h). With --fetch LIMIT it
+ * fetches the last LIMIT stored messages over HTTP instead of following
+ * the subject. Stop with -n or Ctrl-C; the file is usable either way.
+ *
+ * play republishes a capture through ReplayPublisher (replay_publisher.h):
+ * the original gaps between messages are kept, divided by --speed (0 = as
+ * fast as possible), over --connections parallel publishers. Each subject
+ * stays on one connection, so per-subject order matches the capture.
+ * --prefix rewrites subjects into a test namespace. The summary compares
+ * the replayed rate with the captured one and shows how late messages
+ * went out. --json writes it in the benchmark format (bench_report.h).
+ *
+ * Requirements:
+ *   - Boost.Beast/Asio, Protobuf, libcurl, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 natsgw_replay.cpp message.pb.cc \
+ *       -lprotobuf -lcurl -lboost_system -pthread -o natsgw-replay
+ *
+ * Usage:
+ *   ./natsgw-replay record <url> <subject> <capture> [-n MAX] [--fetch LIMIT]
+ *   ./natsgw-replay play <capture> <url> [--speed 1] [--connections 4]
+ *                   [--limit N] [--prefix P] [--queue-depth 1024] [--json FILE]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_report.h"
+#include "message.pb.h"
+#include "replay_publisher.h"
+#include "traffic_capture.h"
+#include "transport.h"
+
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) {
+    g_stop = true;
+}
+
+static void usage(const char* program) {
+    std::cerr << "Usage: " << program << " record <url> <subject> <capture> [-n MAX] [--fetch LIMIT]\n"
+              << "       " << program << " play <capture> <url> [--speed X] [--connections N] [--limit N]"
+              << " [--prefix P] [--queue-depth N] [--json FILE]" << std::endl;
+}
+
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static std::string format_speed(double speed) {
+    std::ostringstream out;
+    out << speed;
+    return out.str();
+}
+
+static int record(int argc, char* argv[]) {
+    std::string url = argv[2];
+    std::string subject = argv[3];
+    std::string path = argv[4];
+    uint64_t max_messages = 0;
+    int fetch_limit = 0;
+    for (int i = 5; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            max_messages = std::stoull(argv[++i]);
+        } else if (arg == "--fetch" && i + 1 < argc) {
+            fetch_limit = std::stoi(argv[++i]);
+        }
+    }
+
+    CaptureWriter writer(path);
+    if (!writer.ok()) {
+        return 1;
+    }
+
+    if (fetch_limit > 0) {
+        HttpClient client(url);
+        nats::messages::FetchResponse response;
+        if (!client.fetch(subject, fetch_limit, &response)) {
+            return 1;
+        }
+        for (const auto& message : response.messages()) {
+            writer.append(message);
+        }
+        if (!writer.flush()) {
+            return 1;
+        }
+        std::cerr << "✓ Captured " << writer.count() << " messages to " << path << std::endl;
+        return 0;
+    }
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    auto finish = [&] {
+        g_stop = true;
+        done_cv.notify_all();
+    };
+
+    auto subscriber = make_subscriber(url, subject, 0);
+    subscriber->set_message_handler([&](const nats::messages::StreamMessage& message) {
+        if (g_stop) {
+            return;
+        }
+        if (!writer.append(message) || (max_messages && writer.count() >= max_messages)) {
+            finish();
+        }
+    });
+    subscriber->connect();
+
+    // Periodic flushes, and the exit path for -n and Ctrl-C. The receive
+    // loops have no cancellation, so unless the stream has ended the
+    // process exits here once the capture is on disk.
+    std::atomic<bool> stream_ended{false};
+    std::thread flusher([&] {
+        {
+            std::unique_lock<std::mutex> lock(done_mutex);
+            while (!g_stop) {
+                done_cv.wait_for(lock, std::chrono::milliseconds(500));
+                writer.flush();
+            }
+        }
+        bool ok = writer.flush();
+        std::cerr << (ok ? "✓ Captured " : "✗ Capture incomplete: ") << writer.count() << " messages to "
+                  << path << std::endl;
+        if (!stream_ended) {
+            std::_Exit(ok ? 0 : 1);
+        }
+    });
+
+    subscriber->stream_messages();
+    stream_ended = true;
+    finish();
+    flusher.join();
+    return writer.ok() ? 0 : 1;
+}
+
+static int play(int argc, char* argv[]) {
+    std::string path = argv[2];
+    std::string url = argv[3];
+    std::string json_path;
+    ReplayOptions options;
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--speed" && i + 1 < argc) {
+            options.speed = std::stod(argv[++i]);
+        } else if (arg == "--connections" && i + 1 < argc) {
+            options.connections = std::stoi(argv[++i]);
+        } else if (arg == "--limit" && i + 1 < argc) {
+            options.limit = std::stoull(argv[++i]);
+        } else if (arg == "--prefix" && i + 1 < argc) {
+            options.subject_prefix = argv[++i];
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            options.queue_depth = std::stoul(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        }
+    }
+
+    CaptureReader reader(path);
+    if (!reader.ok()) {
+        return 1;
+    }
+
+    std::cout << "Replaying " << path << " to " << url << " (speed "
+              << (options.speed > 0 ? "x" + format_speed(options.speed) : std::string("max")) << ", "
+              << options.connections << " connections)" << std::endl;
+
+    ReplayPublisher replay(url, options);
+    std::atomic<bool> done{false};
+    std::thread watcher([&] {
+        while (!done && !g_stop) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (g_stop) replay.stop();
+    });
+
+    ReplayStats stats;
+    bool ok = replay.run([&](nats::messages::StreamMessage* message) { return reader.next(message); }, &stats);
+    done = true;
+    watcher.join();
+    if (!ok) {
+        return 1;
+    }
+    if (reader.truncated()) {
+        std::cerr << "⚠ " << path << " ends inside a record; replayed the " << reader.count()
+                  << " complete ones" << std::endl;
+    }
+
+    double captured_rate = stats.capture_seconds > 0 ? (stats.messages - 1) / stats.capture_seconds : 0;
+    double replayed_rate = stats.elapsed_seconds > 0 ? stats.published / stats.elapsed_seconds : 0;
+    std::cout << std::fixed << std::setprecision(2)
+              << "✓ " << stats.published << " published, " << stats.failed << " failed, "
+              << stats.bytes / 1048576.0 << " MB in " << stats.elapsed_seconds << " s"
+              << " (capture spans " << stats.capture_seconds << " s)" << std::endl
+              << std::setprecision(0)
+              << "  Rate:      " << replayed_rate << " msg/s replayed, " << captured_rate << " msg/s captured";
+    if (options.speed > 0) {
+        std::cout << " x " << std::setprecision(2) << options.speed << std::setprecision(0)
+                  << " = " << captured_rate * options.speed << " msg/s target";
+    }
+    std::cout << std::endl << std::setprecision(1);
+    // Without timing every message is due at the start, so lateness is
+    // just queueing
+    if (options.speed > 0) {
+        std::cout << "  Lateness:  p50 " << percentile(stats.lateness_us, 0.5) / 1000 << " ms, p99 "
+                  << percentile(stats.lateness_us, 0.99) / 1000 << " ms, max "
+                  << (stats.lateness_us.empty() ? 0 : stats.lateness_us.back() / 1000) << " ms" << std::endl;
+    }
+    std::cout << "  Publish:   p50 " << percentile(stats.publish_us, 0.5) / 1000 << " ms, p99 "
+              << percentile(stats.publish_us, 0.99) / 1000 << " ms" << std::endl
+              << "  Per connection:";
+    for (uint64_t n : stats.per_connection) std::cout << " " << n;
+    std::cout << std::endl;
+
+    if (!json_path.empty()) {
+        BenchReport report(argc, argv);
+        report.metric("replay", "msgs_per_s", replayed_rate, Better::Higher);
+        report.metric("replay", "failed", static_cast<double>(stats.failed), Better::Lower);
+        if (options.speed > 0) {
+            report.samples("replay", "lateness_us", stats.lateness_us, Better::Lower);
+        }
+        report.samples("replay", "publish_us", stats.publish_us, Better::Lower);
+        report.write(json_path);
+    }
+    return stats.failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (!((mode == "record" && argc >= 5) || (mode == "play" && argc >= 4))) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    int status;
+    try {
+        status = mode == "record" ? record(argc, argv) : play(argc, argv);
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return status;
+}
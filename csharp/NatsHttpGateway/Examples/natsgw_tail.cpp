@@ -0,0 +1,413 @@
+/*
+ * natsgw-tail: follow a subject and print matching messages one per line
+ *
+ *   ./natsgw-tail ws://localhost:8080 'events.>' -e declined -e user-4242
+ *   14:03:07.123 events#1042 events.payments 301B {"transaction_id":"txn-...
+ *
+ * Messages come from the gateway's WebSocket endpoint (ws:// or http:// URL)
+ * or straight from NATS (nats:// URL), via make_subscriber(). Either way the
+ * payload arrives in the gateway's JSON envelope (base64 "data") and is
+ * unwrapped first; data that isn't an envelope is used as-is. Each payload
+ * is checked against all -e patterns in one pass (multi_pattern.h: Teddy
+ * SSSE3 prefilter or Aho-Corasick). Matching messages are formatted into a
+ * 64 KB buffer that is written to stdout when full and at least every
+ * 100 ms, so output keeps up at 100k+ msg/s. Connection status goes to stderr, keeping stdout
+ * pipe-friendly.
+ *
+ * --profile switches to profiler mode (payload_profiler.h): matching
+ * messages are recorded instead of printed, grouped by the --group subject
+ * patterns, and the report goes to stdout when the tail stops (-n, Ctrl-C
+ * or end of stream). With --fetch LIMIT the last LIMIT messages are
+ * fetched over HTTP (http:// URL) and profiled instead of following the
+ * subject.
+ *
+ * Requirements:
+ *   - Boost.Beast/Asio, Protobuf, libcurl, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 natsgw_tail.cpp message.pb.cc \
+ *       -lprotobuf -lcurl -lboost_system -pthread -o natsgw-tail
+ *
+ * Usage:
+ *   ./natsgw-tail <url> <subject> [-e PATTERN]... [-f PATTERN_FILE] [-i] [-v]
+ *                 [-n MAX] [--width 160] [--no-data] [--sample N] [--stats]
+ *                 [--profile [--group PATTERN]... [--profile-sample 16]
+ *                  [--fetch LIMIT]]
+ */
+
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "message.pb.h"
+#include "multi_pattern.h"
+#include "payload_profiler.h"
+#include "transport.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Buffered stdout: one write(2) per 64 KB, or per interval when traffic is light
+class LineSink {
+private:
+    static constexpr size_t kFlushBytes = 64 * 1024;
+
+    int fd_;
+    std::mutex mutex_;
+    std::string buffer_;
+    bool broken_ = false;
+
+public:
+    explicit LineSink(int fd) : fd_(fd) {
+        buffer_.reserve(kFlushBytes * 2);
+    }
+
+    // False once the reader has gone away (EPIPE)
+    bool append(std::string_view line) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_.append(line);
+        if (buffer_.size() >= kFlushBytes) {
+            write_locked();
+        }
+        return !broken_;
+    }
+
+    bool flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_locked();
+        return !broken_;
+    }
+
+private:
+    void write_locked() {
+        size_t done = 0;
+        while (!broken_ && done < buffer_.size()) {
+            ssize_t n = ::write(fd_, buffer_.data() + done, buffer_.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                broken_ = true;
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        buffer_.clear();
+    }
+};
+
+// One compact line per message: time, stream#sequence, subject, size, data
+class LineFormatter {
+private:
+    size_t width_;
+    bool show_data_;
+    int64_t cached_second_ = -1;
+    char cached_hms_[16] = {};
+
+public:
+    LineFormatter(size_t width, bool show_data) : width_(width), show_data_(show_data) {}
+
+    // Messages without a stored timestamp (core NATS) show the receive time
+    void format(const nats::messages::StreamMessage& message, std::string_view data, std::string& out) {
+        out.clear();
+        int64_t seconds;
+        int millis;
+        if (message.has_timestamp()) {
+            seconds = message.timestamp().seconds();
+            millis = message.timestamp().nanos() / 1000000;
+        } else {
+            auto now = std::chrono::system_clock::now().time_since_epoch();
+            seconds = std::chrono::duration_cast<std::chrono::seconds>(now).count();
+            millis = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count() % 1000);
+        }
+        if (seconds != cached_second_) {
+            time_t t = static_cast<time_t>(seconds);
+            std::tm tm{};
+            localtime_r(&t, &tm);
+            std::strftime(cached_hms_, sizeof(cached_hms_), "%H:%M:%S", &tm);
+            cached_second_ = seconds;
+        }
+        out.append(cached_hms_);
+        out.push_back('.');
+        out.push_back(static_cast<char>('0' + millis / 100));
+        out.push_back(static_cast<char>('0' + millis / 10 % 10));
+        out.push_back(static_cast<char>('0' + millis % 10));
+
+        out.push_back(' ');
+        if (message.stream().empty() && message.sequence() == 0) {
+            out.push_back('-');     // core NATS: not stored in a stream
+        } else {
+            out.append(message.stream());
+            out.push_back('#');
+            append_number(out, message.sequence());
+        }
+        out.push_back(' ');
+        out.append(message.subject());
+        out.push_back(' ');
+        append_number(out, data.size());
+        out.push_back('B');
+
+        if (show_data_ && !data.empty()) {
+            out.push_back(' ');
+            size_t n = std::min(width_, data.size());
+            for (size_t i = 0; i < n; ++i) {
+                unsigned char c = static_cast<unsigned char>(data[i]);
+                out.push_back(c < 0x20 || c == 0x7f ? '.' : static_cast<char>(c));
+            }
+            if (n < data.size()) {
+                out.append("...");
+            }
+        }
+        out.push_back('\n');
+    }
+
+private:
+    static void append_number(std::string& out, uint64_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+};
+
+static std::atomic<bool> g_stop{false};
+
+static void on_signal(int) {
+    g_stop = true;
+}
+
+static int usage(const char* argv0) {
+    std::cerr << "Usage: " << argv0 << " <ws://gateway|http://gateway|nats://server> <subject>"
+              << " [-e PATTERN]... [-f FILE] [-i] [-v] [-n MAX] [--width N] [--no-data]"
+              << " [--sample N] [--stats] [--profile [--group PATTERN]... [--profile-sample N]"
+              << " [--fetch LIMIT]]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    if (argc < 3) {
+        return usage(argv[0]);
+    }
+
+    std::string url = argv[1];
+    std::string subject = argv[2];
+    std::vector<std::string> patterns;
+    bool ignore_case = false;
+    bool invert = false;
+    uint64_t max_matches = 0;
+    size_t width = 160;
+    bool show_data = true;
+    bool show_stats = false;
+    bool profile = false;
+    int fetch_limit = 0;
+    ProfilerOptions profiler_options;
+    ReceiveOptions options;
+    std::string profile_only;   // a --profile option given without --profile
+
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "-e" && i + 1 < argc) {
+                patterns.push_back(argv[++i]);
+            } else if (arg == "-f" && i + 1 < argc) {
+                std::ifstream file(argv[++i]);
+                if (!file) {
+                    std::cerr << "✗ Cannot read " << argv[i] << std::endl;
+                    return 1;
+                }
+                for (std::string line; std::getline(file, line);) {
+                    if (!line.empty()) patterns.push_back(line);
+                }
+            } else if (arg == "-i") {
+                ignore_case = true;
+            } else if (arg == "-v") {
+                invert = true;
+            } else if (arg == "-n" && i + 1 < argc) {
+                max_matches = std::stoull(argv[++i]);
+            } else if (arg == "--width" && i + 1 < argc) {
+                width = std::stoul(argv[++i]);
+            } else if (arg == "--no-data") {
+                show_data = false;
+            } else if (arg == "--sample" && i + 1 < argc) {
+                options.sample_every = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--stats") {
+                show_stats = true;
+            } else if (arg == "--profile") {
+                profile = true;
+            } else if (arg == "--group" && i + 1 < argc) {
+                profiler_options.patterns.push_back(argv[++i]);
+                profile_only = arg;
+            } else if (arg == "--profile-sample" && i + 1 < argc) {
+                profiler_options.sample_every = static_cast<uint32_t>(std::stoul(argv[++i]));
+                profile_only = arg;
+            } else if (arg == "--fetch" && i + 1 < argc) {
+                fetch_limit = std::stoi(argv[++i]);
+                if (fetch_limit < 1) {
+                    std::cerr << "✗ --fetch needs a LIMIT of at least 1" << std::endl;
+                    return usage(argv[0]);
+                }
+                profile_only = arg;
+            } else {
+                std::cerr << "✗ Unknown option or missing value: " << arg << std::endl;
+                return usage(argv[0]);
+            }
+        } catch (std::exception const&) {
+            std::cerr << "✗ Invalid value for " << arg << ": " << argv[i] << std::endl;
+            return usage(argv[0]);
+        }
+    }
+    if (!profile_only.empty() && !profile) {
+        std::cerr << "✗ " << profile_only << " only applies with --profile" << std::endl;
+        return usage(argv[0]);
+    }
+
+    // Client status lines go to stderr; stdout carries only messages
+    std::cout.rdbuf(std::cerr.rdbuf());
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    MultiPatternMatcher matcher(patterns, ignore_case);
+    LineSink sink(STDOUT_FILENO);
+    LineFormatter formatter(width, show_data);
+    PayloadProfiler profiler(profiler_options);
+
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> matched{0};
+    std::string line;
+    std::string unwrapped;
+
+    // Rate over the span between the first and last message, so time spent
+    // waiting for traffic doesn't count
+    std::atomic<int64_t> first_ns{0};
+    std::atomic<int64_t> last_ns{0};
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    auto finish = [&] {
+        g_stop = true;
+        done_cv.notify_all();
+    };
+
+    auto report = [&] {
+        if (profile) {
+            std::ostringstream out;
+            profiler.report(out);
+            sink.append(out.str());
+        }
+        sink.flush();
+        if (show_stats) {
+            double seconds = (last_ns - first_ns) / 1e9;
+            double cpu = static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+            std::cerr << "✓ " << received << " received, " << matched << " matched in "
+                      << std::fixed << std::setprecision(2) << seconds << " s ("
+                      << std::setprecision(0) << received / std::max(seconds, 1e-9) << " msg/s, "
+                      << std::setprecision(2) << cpu * 1e6 / std::max<uint64_t>(received, 1)
+                      << " µs CPU/msg, " << matcher.size() << " patterns, " << matcher.engine() << ")"
+                      << std::endl;
+        }
+    };
+
+    try {
+        if (profile && fetch_limit > 0) {
+            HttpClient client(url);
+            nats::messages::FetchResponse response;
+            if (!client.fetch(subject, fetch_limit, &response)) {
+                return 1;
+            }
+            for (const auto& message : response.messages()) {
+                received++;
+                std::string_view data = message.data();
+                if (gateway_envelope_data(data, &unwrapped)) {
+                    data = unwrapped;
+                }
+                if (matcher.matches(data) != invert) {
+                    matched++;
+                    profiler.record(message);
+                }
+            }
+            report();
+            google::protobuf::ShutdownProtobufLibrary();
+            return 0;
+        }
+
+        auto subscriber = make_subscriber(url, subject, 0);
+        subscriber->set_receive_options(options);
+        subscriber->set_message_handler([&](const nats::messages::StreamMessage& message) {
+            if (g_stop) {
+                return;
+            }
+            received++;
+            int64_t now = Clock::now().time_since_epoch().count();
+            if (first_ns == 0) first_ns = now;
+            last_ns = now;
+
+            std::string_view data = message.data();
+            if (gateway_envelope_data(data, &unwrapped)) {
+                data = unwrapped;
+            }
+            if (matcher.matches(data) == invert) {
+                return;
+            }
+
+            uint64_t n = ++matched;
+            if (profile) {
+                profiler.record(message.subject(), data,
+                                message.has_timestamp() ? message.timestamp().seconds() * 1000000000LL +
+                                                              message.timestamp().nanos()
+                                                        : 0);
+                if (max_matches && n >= max_matches) finish();
+                return;
+            }
+            formatter.format(message, data, line);
+            if (!sink.append(line) || (max_matches && n >= max_matches)) {
+                finish();
+            }
+        });
+        subscriber->connect();
+
+        // Interval flushes, and the exit path for -n, Ctrl-C and closed pipes.
+        // The receive loops have no cancellation, so unless the stream has
+        // ended the process exits here rather than unwinding the subscriber.
+        std::atomic<bool> stream_ended{false};
+        std::thread flusher([&] {
+            {
+                std::unique_lock<std::mutex> lock(done_mutex);
+                while (!g_stop) {
+                    done_cv.wait_for(lock, std::chrono::milliseconds(100));
+                    if (!sink.flush()) {
+                        g_stop = true;
+                    }
+                }
+            }
+            report();
+            if (!stream_ended) {
+                std::_Exit(0);
+            }
+        });
+
+        subscriber->stream_messages();
+        stream_ended = true;
+        finish();
+        flusher.join();
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        sink.flush();
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,486 @@
+/*
+ * PayloadProfiler - size and shape profile of live traffic
+ *
+ * Batch sizes, compression thresholds and dictionaries are only as good as
+ * what we know about the payloads. Feed the profiler the messages a client
+ * receives (WebSocket stream, NATS subscription or fetch responses). It
+ * keeps, per subject pattern:
+ *
+ *   - payload sizes: log2 histogram plus percentiles;
+ *   - inter-arrival times from the message timestamps (the stream's
+ *     publish rate, not this client's receive rate);
+ *   - key frequency: metadata keys when the message carries them
+ *     (PublishMessage), and top-level JSON field names of the payload;
+ *   - compressibility: zstd level 1 on sampled payloads, by size bucket.
+ *     Builds without libzstd (PAYLOAD_PROFILER_ZSTD undefined) fall back
+ *     to an order-0 entropy bound. zstd usually does better than that on
+ *     text.
+ *
+ * Sizes and arrival times are recorded for every message, which costs a
+ * few increments. Percentiles come from fixed-size reservoirs. Key parsing
+ * and compression run only on 1 in `sample_every` messages.
+ *
+ * Received messages (StreamMessage, FetchedMessage) carry the gateway's
+ * JSON envelope; those overloads profile the payload unwrapped from it, not
+ * the base64 text and envelope fields.
+ *
+ * report() prints the profile and derived suggestions: messages per 64 KiB
+ * batch and the linger needed to fill it, the smallest payload size worth
+ * compressing, and whether a trained dictionary is likely to help.
+ */
+
+#pragma once
+
+#ifdef PAYLOAD_PROFILER_ZSTD
+#include <zstd.h>
+#endif
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "message.pb.h"
+#include "nats_json.h"
+#include "nats_subject.h"
+
+struct ProfilerOptions {
+    // Subjects are grouped by the first matching pattern; unmatched
+    // subjects by their first two tokens
+    std::vector<std::string> patterns;
+    uint32_t sample_every = 16;   // key parsing and compression sampling
+    size_t max_keys = 256;        // distinct keys tracked per group
+};
+
+class PayloadProfiler {
+private:
+    static constexpr size_t kBuckets = 24;   // log2 buckets: <64 B ... >= 256 MiB
+    static constexpr size_t kReservoir = 2048;
+
+    // Percentiles from a uniform sample of everything recorded
+    class Reservoir {
+    private:
+        std::vector<double> values_;
+        uint64_t seen_ = 0;
+
+    public:
+        void add(double value, std::mt19937_64& random) {
+            seen_++;
+            if (values_.size() < kReservoir) {
+                values_.push_back(value);
+            } else {
+                uint64_t slot = random() % seen_;
+                if (slot < kReservoir) values_[slot] = value;
+            }
+        }
+
+        uint64_t seen() const { return seen_; }
+
+        // q in [0, 1]; sorts a copy
+        std::vector<double> quantiles(std::initializer_list<double> qs) const {
+            std::vector<double> sorted = values_;
+            std::sort(sorted.begin(), sorted.end());
+            std::vector<double> out;
+            for (double q : qs) {
+                out.push_back(sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1,
+                                                                   static_cast<size_t>(q * sorted.size()))]);
+            }
+            return out;
+        }
+    };
+
+    struct Compression {
+        uint64_t samples = 0;
+        uint64_t in = 0;
+        uint64_t out = 0;
+    };
+
+    struct Group {
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        uint64_t min_size = UINT64_MAX;
+        uint64_t max_size = 0;
+        std::array<uint64_t, kBuckets> histogram{};
+        Reservoir sizes;
+
+        int64_t first_ns = 0;
+        int64_t last_ns = 0;
+        Reservoir gaps_us;             // inter-arrival
+        double gap_sum = 0;
+        double gap_sum_squares = 0;
+
+        uint64_t sampled = 0;
+        std::unordered_map<std::string, uint64_t> metadata_keys;
+        std::unordered_map<std::string, uint64_t> payload_keys;
+        uint64_t metadata_samples = 0;
+        uint64_t json_samples = 0;
+        std::array<Compression, kBuckets> compression{};
+    };
+
+    ProfilerOptions options_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Group> groups_;
+    uint64_t counter_ = 0;
+    std::mt19937_64 random_{0x5eed};
+#ifdef PAYLOAD_PROFILER_ZSTD
+    ZSTD_CCtx* cctx_ = nullptr;
+    std::string compress_buffer_;
+#endif
+
+public:
+    explicit PayloadProfiler(ProfilerOptions options = ProfilerOptions()) : options_(std::move(options)) {
+        options_.sample_every = std::max<uint32_t>(1, options_.sample_every);
+#ifdef PAYLOAD_PROFILER_ZSTD
+        cctx_ = ZSTD_createCCtx();
+#endif
+    }
+
+    ~PayloadProfiler() {
+#ifdef PAYLOAD_PROFILER_ZSTD
+        ZSTD_freeCCtx(cctx_);
+#endif
+    }
+
+    PayloadProfiler(const PayloadProfiler&) = delete;
+    PayloadProfiler& operator=(const PayloadProfiler&) = delete;
+
+    static const char* compression_method() {
+#ifdef PAYLOAD_PROFILER_ZSTD
+        return "zstd -1";
+#else
+        return "order-0 entropy bound";
+#endif
+    }
+
+    // `timestamp_ns` is the publish time (0: now). `metadata`, when given,
+    // is the message's metadata map.
+    template <typename MetadataMap = google::protobuf::Map<std::string, std::string>>
+    void record(std::string_view subject, std::string_view data, int64_t timestamp_ns,
+                const MetadataMap* metadata = nullptr) {
+        if (timestamp_ns == 0) {
+            timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Group& group = groups_[group_for(subject)];
+        size_t size = data.size();
+        group.messages++;
+        group.bytes += size;
+        group.min_size = std::min<uint64_t>(group.min_size, size);
+        group.max_size = std::max<uint64_t>(group.max_size, size);
+        group.histogram[bucket(size)]++;
+        group.sizes.add(static_cast<double>(size), random_);
+
+        // Fetches and replays can deliver out of order; count only forward
+        // steps as gaps
+        if (group.last_ns != 0 && timestamp_ns >= group.last_ns) {
+            double gap = (timestamp_ns - group.last_ns) / 1e3;
+            group.gaps_us.add(gap, random_);
+            group.gap_sum += gap;
+            group.gap_sum_squares += gap * gap;
+        }
+        if (group.first_ns == 0) group.first_ns = timestamp_ns;
+        group.last_ns = std::max(group.last_ns, timestamp_ns);
+
+        if (counter_++ % options_.sample_every != 0) {
+            return;
+        }
+        group.sampled++;
+        if (metadata && !metadata->empty()) {
+            group.metadata_samples++;
+            for (const auto& entry : *metadata) count_key(group.metadata_keys, entry.first);
+        }
+        if (json_keys(data, [&](std::string_view key) { count_key(group.payload_keys, key); })) {
+            group.json_samples++;
+        }
+        Compression& c = group.compression[bucket(size)];
+        c.samples++;
+        c.in += size;
+        c.out += compressed_size(data);
+    }
+
+    void record(const nats::messages::StreamMessage& message) {
+        record_received(message.subject(), message.data(), message.timestamp());
+    }
+
+    void record(const nats::messages::FetchedMessage& message) {
+        record_received(message.subject(), message.data(), message.timestamp());
+    }
+
+    void record(const nats::messages::FetchResponse& response) {
+        for (const auto& message : response.messages()) record(message);
+    }
+
+    void record(const std::string& subject, const nats::messages::PublishMessage& message) {
+        record(subject, message.data(), timestamp_ns(message.timestamp()), &message.metadata());
+    }
+
+    uint64_t messages() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t total = 0;
+        for (const auto& entry : groups_) total += entry.second.messages;
+        return total;
+    }
+
+    void report(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto flags = out.flags();
+        out << "Payload profile (" << compression_method() << ", 1 in " << options_.sample_every
+            << " sampled for keys and compression)" << std::endl;
+        for (const auto& entry : groups_) {
+            report_group(out, entry.first, entry.second);
+        }
+        out.flags(flags);
+    }
+
+private:
+    static int64_t timestamp_ns(const google::protobuf::Timestamp& t) {
+        return t.seconds() * 1000000000LL + t.nanos();
+    }
+
+    // Data that is not an envelope (other sources) is profiled as-is
+    void record_received(std::string_view subject, std::string_view data, const google::protobuf::Timestamp& t) {
+        std::string payload;
+        if (gateway_envelope_data(data, &payload)) {
+            data = payload;
+        }
+        record(subject, data, timestamp_ns(t));
+    }
+
+    // Bucket i holds sizes in [2^(i+5), 2^(i+6)); bucket 0 everything < 64
+    static size_t bucket(size_t size) {
+        size_t b = 0;
+        for (size_t s = size >> 6; s != 0 && b + 1 < kBuckets; s >>= 1) b++;
+        return b;
+    }
+
+    static uint64_t bucket_floor(size_t b) {
+        return b == 0 ? 0 : uint64_t(32) << b;
+    }
+
+    static std::string format_bytes(double bytes) {
+        const char* unit = "B";
+        if (bytes >= 1024 * 1024) {
+            bytes /= 1024 * 1024;
+            unit = "MiB";
+        } else if (bytes >= 1024) {
+            bytes /= 1024;
+            unit = "KiB";
+        }
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(unit[0] != 'B' && bytes < 10 ? 1 : 0) << bytes << " " << unit;
+        return s.str();
+    }
+
+    static std::string format_us(double us) {
+        std::ostringstream s;
+        s << std::fixed << std::setprecision(us < 10 ? 1 : 0);
+        if (us < 1000) s << us << " µs";
+        else if (us < 1e6) s << std::setprecision(1) << us / 1e3 << " ms";
+        else s << std::setprecision(2) << us / 1e6 << " s";
+        return s.str();
+    }
+
+    std::string group_for(std::string_view subject) const {
+        for (const auto& pattern : options_.patterns) {
+            if (subject_matches(pattern, subject)) return pattern;
+        }
+        size_t first = subject.find('.');
+        size_t second = first == std::string_view::npos ? first : subject.find('.', first + 1);
+        return second == std::string_view::npos ? std::string(subject)
+                                                : std::string(subject.substr(0, second)) + ".>";
+    }
+
+    void count_key(std::unordered_map<std::string, uint64_t>& keys, std::string_view key) {
+        auto it = keys.find(std::string(key));
+        if (it != keys.end()) {
+            it->second++;
+        } else if (keys.size() < options_.max_keys) {
+            keys.emplace(std::string(key), 1);
+        } else {
+            keys["(other)"]++;
+        }
+    }
+
+    // Calls `visit` with each top-level field name of a JSON object; false
+    // when `data` isn't one
+    template <typename Visit>
+    static bool json_keys(std::string_view data, Visit&& visit) {
+        size_t i = 0;
+        while (i < data.size() && std::isspace(static_cast<unsigned char>(data[i]))) i++;
+        if (i == data.size() || data[i] != '{') return false;
+        int depth = 0;
+        bool expect_key = false;
+        int keys = 0;
+        for (; i < data.size(); ++i) {
+            char c = data[i];
+            if (c == '"') {
+                size_t start = ++i;
+                while (i < data.size() && data[i] != '"') {
+                    if (data[i] == '\\') i++;
+                    i++;
+                }
+                if (i >= data.size()) return keys > 0;
+                if (depth == 1 && expect_key) {
+                    visit(data.substr(start, i - start));
+                    expect_key = false;
+                    if (++keys == 64) return true;
+                }
+            } else if (c == '{' || c == '[') {
+                if (++depth == 1) expect_key = true;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) return true;
+            } else if (c == ',' && depth == 1) {
+                expect_key = true;
+            }
+        }
+        return keys > 0;
+    }
+
+    size_t compressed_size(std::string_view data) {
+        if (data.empty()) return 0;
+#ifdef PAYLOAD_PROFILER_ZSTD
+        compress_buffer_.resize(ZSTD_compressBound(data.size()));
+        size_t n = ZSTD_compressCCtx(cctx_, &compress_buffer_[0], compress_buffer_.size(), data.data(),
+                                     data.size(), 1);
+        return ZSTD_isError(n) ? data.size() : n;
+#else
+        std::array<uint32_t, 256> counts{};
+        for (unsigned char c : data) counts[c]++;
+        double bits = 0;
+        for (uint32_t count : counts) {
+            if (count) bits -= count * std::log2(static_cast<double>(count) / data.size());
+        }
+        return static_cast<size_t>(std::ceil(bits / 8));
+#endif
+    }
+
+    void report_group(std::ostream& out, const std::string& name, const Group& g) const {
+        double span_s = (g.last_ns - g.first_ns) / 1e9;
+        double rate = span_s > 0 ? (g.messages - 1) / span_s : 0;
+        double mean_size = g.messages ? static_cast<double>(g.bytes) / g.messages : 0;
+
+        out << std::endl << "== " << name << ": " << g.messages << " messages, " << format_bytes(g.bytes);
+        if (rate > 0) out << ", " << std::fixed << std::setprecision(1) << rate << " msg/s";
+        out << std::endl;
+
+        auto s = g.sizes.quantiles({0.5, 0.9, 0.99});
+        out << "  size       min " << format_bytes(g.min_size) << "  p50 " << format_bytes(s[0]) << "  p90 "
+            << format_bytes(s[1]) << "  p99 " << format_bytes(s[2]) << "  max " << format_bytes(g.max_size)
+            << "  mean " << format_bytes(mean_size) << std::endl;
+        uint64_t peak = *std::max_element(g.histogram.begin(), g.histogram.end());
+        for (size_t b = 0; b < kBuckets; ++b) {
+            if (!g.histogram[b]) continue;
+            out << "    >= " << std::left << std::setw(10) << format_bytes(bucket_floor(b)) << std::right
+                << std::setw(9) << g.histogram[b] << " " << std::string(1 + 40 * g.histogram[b] / peak, '#')
+                << std::endl;
+        }
+
+        double mean_gap = 0;
+        if (g.gaps_us.seen() > 0) {
+            auto q = g.gaps_us.quantiles({0.5, 0.9, 0.99});
+            mean_gap = g.gap_sum / g.gaps_us.seen();
+            double variance = std::max(0.0, g.gap_sum_squares / g.gaps_us.seen() - mean_gap * mean_gap);
+            double cv = mean_gap > 0 ? std::sqrt(variance) / mean_gap : 0;
+            out << "  arrivals   p50 " << format_us(q[0]) << "  p90 " << format_us(q[1]) << "  p99 "
+                << format_us(q[2]) << "  mean " << format_us(mean_gap) << "  cv " << std::fixed
+                << std::setprecision(2) << cv << (cv > 1.5 ? " (bursty)" : "") << std::endl;
+        }
+
+        auto print_keys = [&](const char* label, const std::unordered_map<std::string, uint64_t>& keys,
+                              uint64_t samples) {
+            if (keys.empty() || samples == 0) return;
+            std::vector<std::pair<std::string, uint64_t>> sorted(keys.begin(), keys.end());
+            std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+            out << "  " << label << " (" << samples << " sampled)";
+            for (size_t i = 0; i < sorted.size() && i < 12; ++i) {
+                out << (i % 4 == 0 ? "\n    " : "  ") << sorted[i].first << " " << std::fixed
+                    << std::setprecision(0) << 100.0 * sorted[i].second / samples << "%";
+            }
+            if (sorted.size() > 12) out << "  (+" << sorted.size() - 12 << " more)";
+            out << std::endl;
+        };
+        print_keys("metadata keys", g.metadata_keys, g.metadata_samples);
+        print_keys("payload fields", g.payload_keys, g.json_samples);
+
+        // Compression by size bucket; the threshold is the smallest bucket
+        // from which every sampled bucket compresses by 20% or more
+        Compression total;
+        uint64_t threshold = UINT64_MAX;
+        bool all_good_above = true;
+        for (size_t b = kBuckets; b-- > 0;) {
+            const Compression& c = g.compression[b];
+            if (!c.samples) continue;
+            total.samples += c.samples;
+            total.in += c.in;
+            total.out += c.out;
+            bool good = c.out > 0 && static_cast<double>(c.in) / c.out >= 1.25;
+            all_good_above = all_good_above && good;
+            if (all_good_above) threshold = bucket_floor(b);
+        }
+        if (total.samples && total.out) {
+            out << "  compress   ratio " << std::fixed << std::setprecision(2)
+                << static_cast<double>(total.in) / total.out << " over " << total.samples << " samples;";
+            for (size_t b = 0; b < kBuckets; ++b) {
+                const Compression& c = g.compression[b];
+                if (!c.samples || !c.out) continue;
+                out << "  >=" << format_bytes(bucket_floor(b)) << " " << static_cast<double>(c.in) / c.out;
+            }
+            out << std::endl;
+        }
+
+        // Suggestions
+        out << "  suggest" << std::endl;
+        if (mean_size > 0) {
+            double per_batch = std::floor(64 * 1024 / mean_size);
+            if (per_batch < 2) {
+                out << "    batching: payloads average " << format_bytes(mean_size)
+                    << "; batching saves little, send them individually" << std::endl;
+            } else {
+                out << "    batching: " << std::fixed << std::setprecision(0) << per_batch
+                    << " messages fill a 64 KiB batch";
+                if (mean_gap > 0) {
+                    double fill_us = per_batch * mean_gap;
+                    out << ", which takes " << format_us(fill_us) << " at the mean rate";
+                    if (fill_us > 10000) {
+                        out << "; cap linger at 10 ms (~" << std::max(1.0, std::floor(10000 / mean_gap))
+                            << " messages)";
+                    }
+                }
+                out << std::endl;
+            }
+        }
+        if (total.samples) {
+            if (threshold == UINT64_MAX) {
+                out << "    compression: not worth it (under 20% saved at every size)" << std::endl;
+            } else {
+                out << "    compression: compress payloads >= " << format_bytes(threshold) << std::endl;
+            }
+        }
+        if (g.json_samples && s[0] < 2048) {
+            uint64_t common = 0;
+            uint64_t fields = 0;
+            for (const auto& key : g.payload_keys) {
+                fields++;
+                if (key.second * 10 >= g.json_samples * 8) common++;
+            }
+            if (common >= 3) {
+                out << "    dictionary: small JSON payloads sharing " << common << "/" << fields
+                    << " fields; train one with zstd_dict_train" << std::endl;
+            }
+        }
+    }
+};
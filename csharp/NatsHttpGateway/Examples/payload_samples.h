@@ -0,0 +1,83 @@
+/*
+ * Synthetic PaymentEvent / UserEvent payloads
+ *
+ * Realistic 200-500 byte JSON payloads shaped like the events our services
+ * publish. Used by the compression tooling and benchmarks when no captured
+ * traffic is available.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+inline std::string sample_payment_event(std::mt19937_64& rng) {
+    static const char* statuses[] = {"approved", "declined", "pending"};
+    static const char* currencies[] = {"USD", "EUR", "GBP"};
+    static const char* merchants[] = {"acme-books", "northwind-foods", "contoso-travel", "fabrikam-tools"};
+
+    char buffer[512];
+    std::snprintf(buffer, sizeof(buffer),
+        R"({"transaction_id":"txn-%08llx-%04llx","status":"%s","amount":%llu.%02llu,)"
+        R"("currency":"%s","card_last_four":"%04llu","merchant_id":"%s",)"
+        R"("processed_at":"2025-12-%02lluT%02llu:%02llu:%02llu.%03lluZ","card_type":"credit_card",)"
+        R"("risk_score":%llu,"gateway":"stripe","attempt":%llu})",
+        static_cast<unsigned long long>(rng() & 0xffffffff),
+        static_cast<unsigned long long>(rng() & 0xffff),
+        statuses[rng() % 3],
+        static_cast<unsigned long long>(rng() % 2000),
+        static_cast<unsigned long long>(rng() % 100),
+        currencies[rng() % 3],
+        static_cast<unsigned long long>(rng() % 10000),
+        merchants[rng() % 4],
+        static_cast<unsigned long long>(rng() % 28 + 1),
+        static_cast<unsigned long long>(rng() % 24),
+        static_cast<unsigned long long>(rng() % 60),
+        static_cast<unsigned long long>(rng() % 60),
+        static_cast<unsigned long long>(rng() % 1000),
+        static_cast<unsigned long long>(rng() % 100),
+        static_cast<unsigned long long>(rng() % 3 + 1));
+    return buffer;
+}
+
+inline std::string sample_user_event(std::mt19937_64& rng) {
+    static const char* types[] = {"created", "updated", "deleted"};
+    static const char* plans[] = {"free", "premium", "enterprise"};
+    static const char* languages[] = {"cpp", "python", "csharp", "go"};
+    static const char* regions[] = {"us-east-1", "eu-west-1", "ap-southeast-2"};
+
+    char buffer[512];
+    std::snprintf(buffer, sizeof(buffer),
+        R"({"user_id":"user-%llu","event_type":"%s","email":"user%llu@example.com",)"
+        R"("occurred_at":"2025-12-%02lluT%02llu:%02llu:%02llu.%03lluZ",)"
+        R"("attributes":{"plan":"%s","language":"%s","region":"%s",)"
+        R"("signup_source":"web","marketing_opt_in":"%s","session_id":"%016llx"}})",
+        static_cast<unsigned long long>(rng() % 9000 + 1000),
+        types[rng() % 3],
+        static_cast<unsigned long long>(rng() % 100000),
+        static_cast<unsigned long long>(rng() % 28 + 1),
+        static_cast<unsigned long long>(rng() % 24),
+        static_cast<unsigned long long>(rng() % 60),
+        static_cast<unsigned long long>(rng() % 60),
+        static_cast<unsigned long long>(rng() % 1000),
+        plans[rng() % 3],
+        languages[rng() % 4],
+        regions[rng() % 3],
+        (rng() & 1) ? "true" : "false",
+        static_cast<unsigned long long>(rng()));
+    return buffer;
+}
+
+// A deterministic mix of both event types
+inline std::vector<std::string> sample_payloads(size_t count, uint64_t seed = 42) {
+    std::mt19937_64 rng(seed);
+    std::vector<std::string> samples;
+    samples.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        samples.push_back((i & 1) ? sample_user_event(rng) : sample_payment_event(rng));
+    }
+    return samples;
+}
@@ -0,0 +1,360 @@
+/*
+ * PriorityPublisher - priority lanes for latency-critical vs bulk publishes
+ *
+ * Each priority class ("lane") owns a dedicated set of HttpClient
+ * connections, a bounded queue and one worker thread per connection, so a
+ * bulk backfill on `events.*` never queues in front of `payments.*`.
+ *
+ * Subjects are mapped to classes by NATS wildcard patterns (first match
+ * wins, unmatched subjects go to the default class). When the lanes share a
+ * gateway concurrency budget (max_in_flight > 0) a scheduler arbitrates the
+ * budget between lanes with either strict priority or weighted fair sharing.
+ *
+ * Each lane has its own lock and condition variables for its queue, so
+ * publishes on one lane never contend with or wake another lane's workers;
+ * only the scheduler's budget is shared, under its own lock.
+ *
+ * Requirements:
+ *   - libcurl, Protobuf (via http_client.h)
+ *   - pthread
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "http_client.h"
+#include "nats_subject.h"
+
+// A priority class. Classes are listed highest priority first.
+struct PriorityClass {
+    std::string name;
+    int connections = 1;          // dedicated HttpClient connections (one worker each)
+    int weight = 1;               // share of the in-flight budget under weighted scheduling
+    size_t max_queue = 10000;     // publish() fails fast once this many are queued
+};
+
+enum class LaneScheduling {
+    Independent,     // no shared budget: every lane publishes at its own pace
+    StrictPriority,  // a lower class only gets a slot when no higher class is waiting
+    Weighted,        // slots are shared in proportion to PriorityClass::weight
+};
+
+struct PriorityPublisherConfig {
+    std::string base_url;
+    std::vector<PriorityClass> classes;
+    // Subject pattern -> class name, evaluated in order
+    std::vector<std::pair<std::string, std::string>> subject_classes;
+    std::string default_class;    // empty = last (lowest priority) class
+    LaneScheduling scheduling = LaneScheduling::Independent;
+    int max_in_flight = 0;        // shared gateway budget, required by StrictPriority/Weighted
+};
+
+// Parse "payments.>=critical,events.>=bulk" into subject -> class pairs
+inline std::vector<std::pair<std::string, std::string>> parse_subject_classes(const std::string& spec) {
+    std::vector<std::pair<std::string, std::string>> result;
+    size_t pos = 0;
+    while (pos < spec.size()) {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos) end = spec.size();
+        std::string entry = spec.substr(pos, end - pos);
+        auto eq = entry.rfind('=');
+        if (eq == std::string::npos || eq == 0 || eq + 1 == entry.size()) {
+            throw std::invalid_argument("Invalid subject class mapping: '" + entry + "'");
+        }
+        result.emplace_back(entry.substr(0, eq), entry.substr(eq + 1));
+        pos = end + 1;
+    }
+    return result;
+}
+
+struct LaneStats {
+    std::string name;
+    uint64_t sent = 0;
+    uint64_t failed = 0;
+    uint64_t rejected = 0;        // publish() calls refused because the queue was full
+    size_t queued = 0;
+    double p50_ms = 0;
+    double p99_ms = 0;
+    double max_ms = 0;
+};
+
+class PriorityPublisher {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        std::string subject;
+        nats::messages::PublishMessage message;
+        Clock::time_point enqueued;
+    };
+
+    // Enqueue-to-ack latencies are kept in a fixed ring so percentiles
+    // reflect recent traffic without unbounded growth.
+    static constexpr size_t kLatencySamples = 4096;
+
+    struct Lane {
+        PriorityClass config;
+        std::vector<std::unique_ptr<HttpClient>> clients;
+        std::vector<std::thread> workers;
+
+        // Guarded by mutex
+        std::mutex mutex;
+        std::condition_variable work_cv;  // queue non-empty / shutdown
+        std::condition_variable idle_cv;  // queue drained, nothing in progress
+        std::deque<Pending> queue;
+        size_t busy = 0;
+        bool stopping = false;
+        uint64_t sent = 0;
+        uint64_t failed = 0;
+        uint64_t rejected = 0;
+        std::vector<double> latencies_ms;
+        size_t latency_next = 0;
+
+        // Scheduler state, guarded by PriorityPublisher::sched_mutex_
+        size_t waiting = 0;
+        double virtual_time = 0;
+    };
+
+    PriorityPublisherConfig config_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    size_t default_lane_ = 0;
+
+    // Shared in-flight budget (only used when max_in_flight > 0)
+    std::mutex sched_mutex_;
+    std::condition_variable slot_cv_;     // budget released / shutdown
+    int in_flight_ = 0;
+    bool stopping_ = false;
+
+public:
+    explicit PriorityPublisher(PriorityPublisherConfig config) : config_(std::move(config)) {
+        if (config_.classes.empty()) {
+            throw std::invalid_argument("PriorityPublisher requires at least one priority class");
+        }
+        if ((config_.scheduling != LaneScheduling::Independent) != (config_.max_in_flight > 0)) {
+            throw std::invalid_argument(config_.max_in_flight > 0
+                ? "max_in_flight needs StrictPriority or Weighted scheduling to share it"
+                : "StrictPriority and Weighted scheduling need max_in_flight > 0");
+        }
+
+        for (const auto& cls : config_.classes) {
+            auto lane = std::make_unique<Lane>();
+            lane->config = cls;
+            lane->config.connections = std::max(1, cls.connections);
+            lane->config.weight = std::max(1, cls.weight);
+            for (int i = 0; i < lane->config.connections; ++i) {
+                lane->clients.push_back(std::make_unique<HttpClient>(config_.base_url));
+            }
+            lanes_.push_back(std::move(lane));
+        }
+
+        default_lane_ = lanes_.size() - 1;
+        if (!config_.default_class.empty()) {
+            default_lane_ = lane_index(config_.default_class);
+        }
+        for (const auto& mapping : config_.subject_classes) {
+            lane_index(mapping.second);  // validate class names up front
+        }
+
+        for (size_t l = 0; l < lanes_.size(); ++l) {
+            for (size_t c = 0; c < lanes_[l]->clients.size(); ++c) {
+                lanes_[l]->workers.emplace_back(&PriorityPublisher::worker_loop, this, l, c);
+            }
+        }
+    }
+
+    ~PriorityPublisher() {
+        for (auto& lane : lanes_) {
+            {
+                std::lock_guard<std::mutex> lock(lane->mutex);
+                lane->stopping = true;
+            }
+            lane->work_cv.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lock(sched_mutex_);
+            stopping_ = true;
+        }
+        slot_cv_.notify_all();
+        for (auto& lane : lanes_) {
+            for (auto& worker : lane->workers) {
+                worker.join();
+            }
+        }
+    }
+
+    PriorityPublisher(const PriorityPublisher&) = delete;
+    PriorityPublisher& operator=(const PriorityPublisher&) = delete;
+
+    // Name of the class a subject is routed to
+    const std::string& class_for(const std::string& subject) const {
+        return lanes_[route(subject)]->config.name;
+    }
+
+    // Queue a message on its subject's lane. Returns false if the lane is full.
+    bool publish(const std::string& subject, nats::messages::PublishMessage message) {
+        Lane& lane = *lanes_[route(subject)];
+        {
+            std::lock_guard<std::mutex> lock(lane.mutex);
+            if (lane.stopping || lane.queue.size() >= lane.config.max_queue) {
+                lane.rejected++;
+                return false;
+            }
+            lane.queue.push_back(Pending{subject, std::move(message), Clock::now()});
+        }
+        lane.work_cv.notify_one();
+        return true;
+    }
+
+    // Block until every lane's queue is empty and no publish is in progress
+    void flush() {
+        for (auto& lane : lanes_) {
+            std::unique_lock<std::mutex> lock(lane->mutex);
+            lane->idle_cv.wait(lock, [&] { return lane->queue.empty() && lane->busy == 0; });
+        }
+    }
+
+    std::vector<LaneStats> stats() {
+        std::vector<LaneStats> result;
+        for (const auto& lane : lanes_) {
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            LaneStats s;
+            s.name = lane->config.name;
+            s.sent = lane->sent;
+            s.failed = lane->failed;
+            s.rejected = lane->rejected;
+            s.queued = lane->queue.size();
+
+            std::vector<double> sorted = lane->latencies_ms;
+            std::sort(sorted.begin(), sorted.end());
+            if (!sorted.empty()) {
+                s.p50_ms = sorted[(sorted.size() - 1) / 2];
+                s.p99_ms = sorted[(sorted.size() - 1) * 99 / 100];
+                s.max_ms = sorted.back();
+            }
+            result.push_back(std::move(s));
+        }
+        return result;
+    }
+
+private:
+    size_t lane_index(const std::string& name) const {
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            if (lanes_[i]->config.name == name) return i;
+        }
+        throw std::invalid_argument("Unknown priority class: '" + name + "'");
+    }
+
+    size_t route(const std::string& subject) const {
+        for (const auto& mapping : config_.subject_classes) {
+            if (subject_matches(mapping.first, subject)) {
+                return lane_index(mapping.second);
+            }
+        }
+        return default_lane_;
+    }
+
+    // Caller holds sched_mutex_. Is lane `l` the one that should receive the
+    // next free in-flight slot?
+    bool scheduled_next(size_t l) const {
+        if (in_flight_ >= config_.max_in_flight) return false;
+
+        if (config_.scheduling == LaneScheduling::StrictPriority) {
+            for (size_t h = 0; h < l; ++h) {
+                if (lanes_[h]->waiting > 0) return false;
+            }
+            return true;
+        }
+
+        // Weighted: the waiting lane with the least virtual time goes first
+        for (size_t o = 0; o < lanes_.size(); ++o) {
+            if (o != l && lanes_[o]->waiting > 0 &&
+                lanes_[o]->virtual_time < lanes_[l]->virtual_time) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void acquire_slot(size_t l) {
+        std::unique_lock<std::mutex> lock(sched_mutex_);
+        Lane& lane = *lanes_[l];
+        if (lane.waiting == 0 && config_.scheduling == LaneScheduling::Weighted) {
+            // A lane returning from idle must not bank credit while it was away
+            double floor = lane.virtual_time;
+            bool any = false;
+            for (const auto& other : lanes_) {
+                if (other.get() != &lane && other->waiting > 0) {
+                    floor = any ? std::min(floor, other->virtual_time) : other->virtual_time;
+                    any = true;
+                }
+            }
+            if (any) lane.virtual_time = std::max(lane.virtual_time, floor);
+        }
+
+        lane.waiting++;
+        slot_cv_.wait(lock, [&] { return stopping_ || scheduled_next(l); });
+        lane.waiting--;
+        in_flight_++;
+        lane.virtual_time += 1.0 / lane.config.weight;
+    }
+
+    void release_slot() {
+        {
+            std::lock_guard<std::mutex> lock(sched_mutex_);
+            in_flight_--;
+        }
+        slot_cv_.notify_all();
+    }
+
+    void worker_loop(size_t l, size_t c) {
+        Lane& lane = *lanes_[l];
+        HttpClient& client = *lane.clients[c];
+        bool budgeted = config_.max_in_flight > 0;
+
+        std::unique_lock<std::mutex> lock(lane.mutex);
+        while (true) {
+            lane.work_cv.wait(lock, [&] { return lane.stopping || !lane.queue.empty(); });
+            if (lane.queue.empty()) {
+                return;  // stopping and drained
+            }
+
+            Pending item = std::move(lane.queue.front());
+            lane.queue.pop_front();
+            lane.busy++;
+            lock.unlock();
+
+            if (budgeted) acquire_slot(l);
+            bool ok = client.publish(item.subject, item.message);
+            double latency_ms = std::chrono::duration<double, std::milli>(Clock::now() - item.enqueued).count();
+            if (budgeted) release_slot();
+
+            lock.lock();
+            lane.busy--;
+            if (ok) {
+                lane.sent++;
+            } else {
+                lane.failed++;
+            }
+            if (lane.latencies_ms.size() < kLatencySamples) {
+                lane.latencies_ms.push_back(latency_ms);
+            } else {
+                lane.latencies_ms[lane.latency_next] = latency_ms;
+                lane.latency_next = (lane.latency_next + 1) % kLatencySamples;
+            }
+            if (lane.queue.empty() && lane.busy == 0) {
+                lane.idle_cv.notify_all();
+            }
+        }
+    }
+};
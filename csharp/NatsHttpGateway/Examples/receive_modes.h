@@ -0,0 +1,134 @@
+/*
+ * Receive-side modes for slow consumers
+ *
+ *   HashSampler       deterministic 1-in-N sampling keyed on (subject, sequence),
+ *                     so every replica keeps the same messages
+ *   LatestPerSubject  keeps only the newest message per subject between
+ *                     handler invocations (bounded by the number of subjects)
+ *
+ * Both run on the socket read path in O(1), so the read rate does not depend
+ * on how fast the handler is. ReceiveOptions/ReceiveStats configure and
+ * report them for every subscriber transport.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "message.pb.h"
+
+// 64-bit FNV-1a, stable across platforms and runs
+inline uint64_t fnv1a64(std::string_view data, uint64_t hash = 14695981039346656037ULL) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Final avalanche step (splitmix64) so modulo-N picks well-mixed bits
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+class HashSampler {
+private:
+    uint32_t every_n_;
+
+public:
+    explicit HashSampler(uint32_t every_n = 1) : every_n_(every_n == 0 ? 1 : every_n) {}
+
+    uint32_t every_n() const { return every_n_; }
+
+    bool keep(std::string_view subject, uint64_t sequence) const {
+        if (every_n_ == 1) return true;
+        return mix64(fnv1a64(subject) ^ sequence) % every_n_ == 0;
+    }
+
+    bool keep(const nats::messages::StreamMessage& message) const {
+        return keep(message.subject(), message.sequence());
+    }
+};
+
+// Latest-value buffer between a producer (socket reader) and a consumer
+// (handler thread). take() hands over everything collected since the last
+// call in first-arrival order of subjects.
+class LatestPerSubject {
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, size_t> index_;
+    std::vector<nats::messages::StreamMessage> latest_;
+    uint64_t conflated_ = 0;
+    bool closed_ = false;
+
+public:
+    void offer(nats::messages::StreamMessage message) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(message.subject());
+            if (it != index_.end()) {
+                latest_[it->second] = std::move(message);
+                conflated_++;
+                return;
+            }
+            index_.emplace(message.subject(), latest_.size());
+            latest_.push_back(std::move(message));
+        }
+        cv_.notify_one();
+    }
+
+    // Blocks until at least one message is buffered or close() was called.
+    // Returns false once closed and fully drained.
+    bool take(std::vector<nats::messages::StreamMessage>& out) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return closed_ || !latest_.empty(); });
+        if (latest_.empty()) {
+            return false;
+        }
+        out.clear();
+        out.swap(latest_);
+        index_.clear();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    uint64_t conflated() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return conflated_;
+    }
+};
+
+// How received messages reach the handler
+struct ReceiveOptions {
+    // Keep only the newest message per subject while the handler is busy.
+    // The handler runs on its own thread so socket reads never wait for it.
+    bool latest_per_subject = false;
+    // Deterministic 1-in-N sampling on (subject, sequence); 1 = every message
+    uint32_t sample_every = 1;
+};
+
+struct ReceiveStats {
+    uint64_t received = 0;      // messages read from the socket
+    uint64_t sampled_out = 0;   // skipped by 1-in-N sampling
+    uint64_t conflated = 0;     // replaced by a newer message for the same subject
+    uint64_t delivered = 0;     // handler invocations
+};
@@ -0,0 +1,276 @@
+/*
+ * Benchmark: failover latency and CPU cost of redundant subscriptions
+ *
+ * Subscribes to --subject through one or two gateway endpoints with
+ * RedundantSubscription (redundant_subscriber.h) while a publisher sends
+ * --rate msg/s for --seconds. The endpoints are in-process FaultProxy
+ * hops (fault_proxy.h) in front of one gateway, so both legs see the same
+ * stream and sequences, as two gateway instances on one NATS cluster
+ * would. --kill-at S stops endpoint A (all its connections reset) for
+ * --down-ms, then brings it back on the same port: a gateway instance
+ * dying and restarting.
+ *
+ * Four runs:
+ *
+ *   single          one leg, no failure
+ *   dual            two legs, no failure
+ *   single+failover one leg; it reconnects and catches up after the outage
+ *   dual+failover   two legs; the second one carries on
+ *
+ * For each run the table shows the end-to-end latency of delivered
+ * messages (gateway timestamp to handler: p50, p99, max) and messages
+ * lost or delivered twice. It also shows the duplicates the window dropped
+ * and the CPU time of the leg threads per delivered message. The last
+ * lines compare dual with single: the CPU overhead of the second stream
+ * and the worst latency saved in the failover.
+ *
+ * Requirements:
+ *   - Boost.Beast/Asio, libcurl, Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 redundant_bench.cpp message.pb.cc \
+ *       -lprotobuf -lcurl -lboost_system -pthread -o redundant_bench
+ *
+ * Usage:
+ *   ./redundant_bench [base_url] [--subject bench.redundant] [--rate 1000] [--seconds 6]
+ *                     [--payload 256] [--kill-at 2] [--down-ms 2000] [--window 4096]
+ *                     [--json FILE]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "bench_report.h"
+#include "fault_proxy.h"
+#include "http_client.h"
+#include "message.pb.h"
+#include "redundant_subscriber.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string subject = "bench.redundant";
+    int rate = 1000;
+    double seconds = 6;
+    size_t payload = 256;
+    double kill_at = 2;
+    int down_ms = 2000;
+    size_t window = 4096;
+};
+
+struct Result {
+    uint64_t published = 0;
+    uint64_t delivered = 0;
+    uint64_t repeated = 0;   // delivered more than once
+    std::vector<double> latencies_ms;
+    RedundantStats stats;
+    double cpu_seconds = 0;
+};
+
+static double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()))];
+}
+
+static std::unique_ptr<FaultProxy> start_proxy(const std::string& host, unsigned short port,
+                                               unsigned short listen_port) {
+    FaultProxyConfig config;
+    config.upstream_host = host;
+    config.upstream_port = port;
+    config.listen_port = listen_port;
+    auto proxy = std::make_unique<FaultProxy>(config);
+    proxy->start();
+    return proxy;
+}
+
+static Result run(const std::string& base_url, const std::string& host, unsigned short port, int legs,
+                  bool failover, const Options& options) {
+    std::vector<std::unique_ptr<FaultProxy>> proxies;
+    std::vector<std::string> urls;
+    for (int i = 0; i < legs; ++i) {
+        proxies.push_back(start_proxy(host, port, 0));
+        urls.push_back("ws://127.0.0.1:" + std::to_string(proxies.back()->port()));
+    }
+
+    Result result;
+    std::mutex mutex;
+    std::unordered_set<uint64_t> seen;
+    RedundantOptions redundant;
+    redundant.window = options.window;
+    redundant.verbose = false;
+    RedundantSubscription subscription(urls, options.subject, 0, redundant);
+    subscription.set_message_handler([&](const nats::messages::StreamMessage& message) {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        int64_t published = message.timestamp().seconds() * 1000000000LL + message.timestamp().nanos();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!seen.insert(message.sequence()).second) {
+            result.repeated++;
+            return;
+        }
+        result.latencies_ms.push_back((now - published) / 1e6);
+    });
+    subscription.connect();
+    // Every leg live before the first publish
+    for (int i = 0; i < 50; ++i) {
+        auto stats = subscription.redundant_stats();
+        if (std::all_of(stats.legs.begin(), stats.legs.end(), [](const auto& l) { return l.connected; })) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    std::thread killer;
+    if (failover) {
+        killer = std::thread([&] {
+            std::this_thread::sleep_for(std::chrono::duration<double>(options.kill_at));
+            unsigned short listen_port = proxies[0]->port();
+            proxies[0]->stop();
+            proxies[0].reset();
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.down_ms));
+            proxies[0] = start_proxy(host, port, listen_port);
+        });
+    }
+
+    HttpClient publisher(base_url);
+    nats::messages::PublishMessage message;
+    message.set_source("redundant-bench");
+    message.set_data(std::string(options.payload, 'x'));
+    auto start = Clock::now();
+    auto total = static_cast<uint64_t>(options.rate * options.seconds);
+    for (uint64_t i = 0; i < total; ++i) {
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds(static_cast<int64_t>(i * 1e9 / options.rate)));
+        if (publisher.publish(options.subject, message)) {
+            result.published++;
+        }
+    }
+    if (killer.joinable()) killer.join();
+
+    // Drain: the last messages, or the catch-up after the outage
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (Clock::now() < deadline) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (seen.size() >= result.published) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    result.stats = subscription.redundant_stats();
+    for (const auto& leg : result.stats.legs) result.cpu_seconds += leg.cpu_seconds;
+    subscription.close();
+    // Resetting the endpoints ends the legs' streams, so they join
+    for (auto& proxy : proxies) proxy->stop();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    result.delivered = seen.size();
+    std::sort(result.latencies_ms.begin(), result.latencies_ms.end());
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string base_url = "http://localhost:8080";
+    Options options;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--subject" && i + 1 < argc) {
+            options.subject = argv[++i];
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rate = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = std::stod(argv[++i]);
+        } else if (arg == "--payload" && i + 1 < argc) {
+            options.payload = std::stoul(argv[++i]);
+        } else if (arg == "--kill-at" && i + 1 < argc) {
+            options.kill_at = std::stod(argv[++i]);
+        } else if (arg == "--down-ms" && i + 1 < argc) {
+            options.down_ms = std::stoi(argv[++i]);
+        } else if (arg == "--window" && i + 1 < argc) {
+            options.window = std::stoul(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            base_url = arg;
+        }
+    }
+
+    // http://host:port -> host, port
+    std::string authority = base_url.substr(base_url.find("://") == std::string::npos ? 0 : base_url.find("://") + 3);
+    authority = authority.substr(0, authority.find('/'));
+    size_t colon = authority.rfind(':');
+    std::string host = authority.substr(0, colon);
+    unsigned short port = colon == std::string::npos ? 80 : static_cast<unsigned short>(std::stoi(authority.substr(colon + 1)));
+    std::signal(SIGPIPE, SIG_IGN);
+
+    try {
+        std::cout << options.rate << " msg/s for " << options.seconds << " s, " << options.payload
+                  << " B payloads, window " << options.window << "; failover: endpoint A down at "
+                  << options.kill_at << " s for " << options.down_ms << " ms" << std::endl << std::endl;
+        std::cout << std::left << std::setw(16) << "run" << std::right << std::setw(10) << "delivered"
+                  << std::setw(6) << "lost" << std::setw(7) << "twice" << std::setw(8) << "dupes"
+                  << std::setw(9) << "p50 ms" << std::setw(9) << "p99 ms" << std::setw(9) << "max ms"
+                  << std::setw(10) << "reconn" << std::setw(12) << "CPU µs/msg" << std::endl;
+
+        struct Run {
+            const char* name;
+            int legs;
+            bool failover;
+        };
+        const Run runs[] = {
+            {"single", 1, false}, {"dual", 2, false}, {"single+failover", 1, true}, {"dual+failover", 2, true}};
+
+        BenchReport report(argc, argv);
+        std::vector<Result> results;
+        for (const auto& r : runs) {
+            Result result = run(base_url, host, port, r.legs, r.failover, options);
+            const auto& l = result.latencies_ms;
+            uint64_t reconnects = 0;
+            for (const auto& leg : result.stats.legs) reconnects += leg.connects - 1;
+            double cpu_us = result.cpu_seconds * 1e6 / std::max<uint64_t>(result.delivered, 1);
+            std::cout << std::left << std::setw(16) << r.name << std::right << std::setw(10) << result.delivered
+                      << std::setw(6) << result.published - std::min(result.published, result.delivered)
+                      << std::setw(7) << result.repeated << std::setw(8) << result.stats.duplicates
+                      << std::fixed << std::setprecision(2) << std::setw(9) << percentile(l, 0.50)
+                      << std::setw(9) << percentile(l, 0.99) << std::setw(9) << (l.empty() ? 0 : l.back())
+                      << std::setw(10) << reconnects << std::setw(12) << cpu_us << std::endl;
+
+            report.metric(r.name, "lost", static_cast<double>(result.published - std::min(result.published, result.delivered)),
+                          Better::Lower);
+            report.metric(r.name, "cpu_us_per_msg", cpu_us, Better::Lower);
+            report.samples(r.name, "latency_ms", result.latencies_ms, Better::Lower);
+            results.push_back(std::move(result));
+        }
+
+        auto cpu_per_msg = [](const Result& r) { return r.cpu_seconds / std::max<uint64_t>(r.delivered, 1); };
+        auto worst = [](const Result& r) { return r.latencies_ms.empty() ? 0.0 : r.latencies_ms.back(); };
+        std::cout << std::endl << std::fixed << std::setprecision(0)
+                  << "CPU overhead of the second stream: +"
+                  << (cpu_per_msg(results[1]) / std::max(cpu_per_msg(results[0]), 1e-12) - 1) * 100
+                  << "% per delivered message (" << std::setprecision(2)
+                  << (cpu_per_msg(results[1]) - cpu_per_msg(results[0])) * 1e6 << " µs)" << std::endl
+                  << "Worst failover latency: " << worst(results[2]) << " ms single, " << worst(results[3])
+                  << " ms dual" << std::endl;
+
+        if (!report.write(json_path)) {
+            return 1;
+        }
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
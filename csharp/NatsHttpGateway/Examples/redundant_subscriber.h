@@ -0,0 +1,419 @@
+/*
+ * Redundant subscriptions: the same subscription on several gateway
+ * instances at once, first copy of each message wins
+ *
+ * A WebSocket subscriber notices that its gateway instance died only when
+ * the read fails. It then reconnects and catches up, and every message
+ * published in between arrives seconds late. RedundantSubscription keeps
+ * the subscription open on every endpoint it is given (two is the usual
+ * setup):
+ *
+ *   - one leg per endpoint: a WebSocketClient on its own thread that
+ *     reconnects after a drop (backoff 100 ms doubling to 5 s while
+ *     connects fail). A leg that comes back asks for ?startSequence=H+1,
+ *     where H is the highest sequence delivered so far. It rejoins at the
+ *     live point, or catches up everything missed while all legs were down;
+ *   - messages are deduplicated by (stream, sequence) in a sliding window
+ *     of the last `window` sequences per stream (SequenceWindow, a ring
+ *     indexed by sequence % window). The first copy goes to the handler,
+ *     later copies are counted as duplicates. Sequences that fell out of
+ *     the window are dropped as stale, so the window has to cover the
+ *     worst skew between legs (4096 is 0.4 s at 10k msg/s). Messages
+ *     without a sequence (0) are delivered from every leg. NatsHttpGateway
+ *     never sets StreamMessage.stream on WebSocket frames, so there all
+ *     messages share the "" window. That is still exact: one WebSocket
+ *     subscription reads from one stream, so its sequences are unique.
+ *
+ * While one leg is down the other is already streaming, so a failover
+ * adds no latency. The cost is that every message is received, parsed
+ * and deduplicated once per leg. stats() reports each leg's thread CPU
+ * time so that cost can be measured (redundant_bench.cpp).
+ *
+ * As a MessageSubscriber it fits wherever make_subscriber() is used:
+ * a comma-separated URL list ("ws://gw-a:8080,ws://gw-b:8080") selects it.
+ * The handler runs on the leg threads, one call at a time, under the
+ * subscription's lock (it must not call stats() or close()). stream_messages()
+ * blocks until the message limit is reached or close() is called, because
+ * the legs reconnect rather than end.
+ *
+ * The receive loops have no cancellation: after close() a leg stops when
+ * its current stream ends, and the destructor detaches legs still blocked
+ * in a read. They deliver nothing after close().
+ *
+ * Requirements:
+ *   - Boost.Beast/Asio, Protobuf, pthread
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "message.pb.h"
+#include "message_transport.h"
+#include "natsgw_probes.h"
+#include "receive_modes.h"
+#include "websocket_client.h"
+
+// Dedupe window over one stream's sequences: remembers the last `size`
+// sequences below the highest one seen
+class SequenceWindow {
+public:
+    enum class Verdict { First, Duplicate, Stale };
+
+    explicit SequenceWindow(size_t size) : slots_(std::max<size_t>(size, 1)) {}
+
+    // `now_ns` is kept with a first copy and handed back for its duplicates
+    Verdict offer(uint64_t sequence, int64_t now_ns, int64_t* first_ns = nullptr) {
+        uint64_t size = slots_.size();
+        if (high_ >= size && sequence <= high_ - size) {
+            return Verdict::Stale;
+        }
+        // Within the window a slot holds this sequence or an older one
+        Slot& slot = slots_[sequence % size];
+        if (slot.sequence == sequence) {
+            if (first_ns) *first_ns = slot.first_ns;
+            return Verdict::Duplicate;
+        }
+        slot.sequence = sequence;
+        slot.first_ns = now_ns;
+        high_ = std::max(high_, sequence);
+        return Verdict::First;
+    }
+
+    uint64_t high() const { return high_; }
+
+private:
+    struct Slot {
+        uint64_t sequence = 0;
+        int64_t first_ns = 0;
+    };
+    std::vector<Slot> slots_;
+    uint64_t high_ = 0;
+};
+
+struct RedundantOptions {
+    size_t window = 4096;            // sequences remembered per stream
+    int backoff_initial_ms = 100;    // wait before reconnecting a leg
+    int backoff_max_ms = 5000;       // cap while connects keep failing
+    bool resume = true;              // reconnect with ?startSequence=H+1
+    bool verbose = true;             // leg connects and drops on stderr
+};
+
+struct RedundantLegStats {
+    std::string endpoint;
+    bool connected = false;
+    uint64_t connects = 0;         // successful connects
+    uint64_t failures = 0;         // failed connect attempts
+    uint64_t drops = 0;            // streams that ended before close()
+    uint64_t received = 0;         // messages from this leg
+    uint64_t first = 0;            // ... delivered (this leg's copy was first)
+    uint64_t duplicates = 0;       // ... already delivered from another leg
+    uint64_t stale = 0;            // ... older than the window
+    double behind_ms_total = 0;    // duplicates: time since the first copy
+    double behind_ms_max = 0;
+    double cpu_seconds = 0;        // leg thread CPU time, handler included
+};
+
+struct RedundantStats {
+    uint64_t delivered = 0;
+    uint64_t duplicates = 0;
+    uint64_t stale = 0;
+    uint64_t unsequenced = 0;      // sequence 0, delivered from every leg
+    std::vector<RedundantLegStats> legs;
+};
+
+class RedundantSubscription : public MessageSubscriber {
+private:
+    struct Leg {
+        WebSocketURL url;
+        RedundantLegStats stats;
+        ReceiveStats receive;      // of finished streams
+        clockid_t cpu_clock{};
+        bool has_cpu_clock = false;
+        bool running = true;       // cleared by the leg thread as it exits
+        bool attempted = false;    // first connect attempt finished
+    };
+
+    // Shared with the leg threads, which may outlive the subscription
+    struct State {
+        std::string subject;
+        RedundantOptions options;
+        ReceiveOptions receive_options;
+        int max_messages = 0;
+        MessageHandler handler;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool stopping = false;
+        std::vector<Leg> legs;
+        std::unordered_map<std::string, SequenceWindow> windows;
+        RedundantStats totals;
+    };
+
+    std::shared_ptr<State> state_;
+    std::vector<std::thread> threads_;
+    mutable ReceiveStats receive_stats_;
+
+public:
+    // `urls` are gateway URLs (ws:// or http://), one leg each. `max_messages`
+    // <= 0 streams until close().
+    RedundantSubscription(const std::vector<std::string>& urls, const std::string& subject,
+                          int max_messages = 0, const RedundantOptions& options = {})
+        : state_(std::make_shared<State>())
+    {
+        if (urls.empty()) {
+            throw std::runtime_error("RedundantSubscription needs at least one endpoint");
+        }
+        state_->subject = subject;
+        state_->options = options;
+        state_->max_messages = max_messages;
+        for (const auto& url : urls) {
+            Leg leg;
+            leg.url = gateway_stream_url(url, subject);
+            leg.stats.endpoint = leg.url.host + ":" + leg.url.port;
+            state_->legs.push_back(std::move(leg));
+        }
+    }
+
+    ~RedundantSubscription() override {
+        close();
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        for (size_t i = 0; i < threads_.size(); ++i) {
+            if (!threads_[i].joinable()) continue;
+            // An exited leg joins at once; one still blocked in a read can't
+            if (state_->legs[i].running) {
+                threads_[i].detach();
+            } else {
+                threads_[i].join();
+            }
+        }
+    }
+
+    void set_message_handler(MessageHandler handler) override {
+        state_->handler = std::move(handler);
+    }
+
+    // Applied on every leg; 1-in-N sampling keeps the same messages on each
+    void set_receive_options(const ReceiveOptions& options) override {
+        state_->receive_options = options;
+    }
+
+    // Starts the legs and returns once one of them is connected. Throws when
+    // every endpoint failed its first connect (the legs are stopped).
+    void connect() override {
+        if (!threads_.empty()) return;
+        for (size_t i = 0; i < state_->legs.size(); ++i) {
+            threads_.emplace_back(run_leg, state_, i);
+        }
+
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        state_->cv.wait(lock, [&] {
+            bool all_failed = true;
+            for (const auto& leg : state_->legs) {
+                if (leg.stats.connected) return true;
+                all_failed = all_failed && leg.attempted;
+            }
+            return all_failed;
+        });
+        for (const auto& leg : state_->legs) {
+            if (leg.stats.connected) return;
+        }
+        state_->stopping = true;
+        state_->cv.notify_all();
+        throw std::runtime_error("no endpoint of " + state_->subject + " subscription is reachable");
+    }
+
+    void stream_messages() override {
+        std::unique_lock<std::mutex> lock(state_->mutex);
+        state_->cv.wait(lock, [&] { return state_->stopping; });
+    }
+
+    // Stops delivery and reconnects; legs end with their current stream
+    void close() override {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->stopping = true;
+        state_->cv.notify_all();
+    }
+
+    // Summed over the legs; delivered counts first copies
+    const ReceiveStats& stats() const override {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        receive_stats_ = ReceiveStats{};
+        for (const auto& leg : state_->legs) {
+            receive_stats_.received += leg.stats.received + leg.receive.sampled_out;
+            receive_stats_.sampled_out += leg.receive.sampled_out;
+            receive_stats_.conflated += leg.receive.conflated;
+        }
+        receive_stats_.delivered = state_->totals.delivered + state_->totals.unsequenced;
+        return receive_stats_;
+    }
+
+    RedundantStats redundant_stats() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        RedundantStats stats = state_->totals;
+        for (auto& leg : state_->legs) {
+            RedundantLegStats leg_stats = leg.stats;
+            // A running leg's clock is valid until it clears `running`,
+            // which needs this lock
+            if (leg.running && leg.has_cpu_clock) {
+                timespec ts;
+                if (clock_gettime(leg.cpu_clock, &ts) == 0) {
+                    leg_stats.cpu_seconds = ts.tv_sec + ts.tv_nsec / 1e9;
+                }
+            }
+            stats.legs.push_back(std::move(leg_stats));
+        }
+        return stats;
+    }
+
+private:
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static double own_cpu_seconds() {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+
+    static void offer(State& state, size_t index, const nats::messages::StreamMessage& message) {
+        int64_t now = now_ns();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        RedundantLegStats& leg = state.legs[index].stats;
+        leg.received++;
+        if (state.stopping) {
+            return;
+        }
+
+        if (message.sequence() == 0) {
+            state.totals.unsequenced++;
+            deliver(state, message);
+            return;
+        }
+        auto window = state.windows.find(message.stream());
+        if (window == state.windows.end()) {
+            window = state.windows.emplace(message.stream(), SequenceWindow(state.options.window)).first;
+        }
+        int64_t first_ns = 0;
+        switch (window->second.offer(message.sequence(), now, &first_ns)) {
+            case SequenceWindow::Verdict::First:
+                leg.first++;
+                state.totals.delivered++;
+                deliver(state, message);
+                break;
+            case SequenceWindow::Verdict::Duplicate: {
+                double behind_ms = (now - first_ns) / 1e6;
+                leg.duplicates++;
+                leg.behind_ms_total += behind_ms;
+                leg.behind_ms_max = std::max(leg.behind_ms_max, behind_ms);
+                state.totals.duplicates++;
+                break;
+            }
+            case SequenceWindow::Verdict::Stale:
+                leg.stale++;
+                state.totals.stale++;
+                break;
+        }
+    }
+
+    static void deliver(State& state, const nats::messages::StreamMessage& message) {
+        if (state.handler) {
+            state.handler(message);
+        }
+        uint64_t delivered = state.totals.delivered + state.totals.unsequenced;
+        if (state.max_messages > 0 && delivered >= static_cast<uint64_t>(state.max_messages)) {
+            state.stopping = true;
+            state.cv.notify_all();
+        }
+    }
+
+    // Reconnect from the sequence after the last one delivered. Sequences
+    // only compare within a stream, so not when the subject spans several.
+    static uint64_t resume_sequence(const State& state) {
+        if (!state.options.resume || state.windows.size() != 1) {
+            return 0;
+        }
+        uint64_t high = state.windows.begin()->second.high();
+        return high == 0 ? 0 : high + 1;
+    }
+
+    static void run_leg(std::shared_ptr<State> state, size_t index) {
+        const auto& options = state->options;
+        std::unique_lock<std::mutex> lock(state->mutex);
+        Leg& leg = state->legs[index];
+        leg.has_cpu_clock = pthread_getcpuclockid(pthread_self(), &leg.cpu_clock) == 0;
+        auto backoff = std::chrono::milliseconds(options.backoff_initial_ms);
+
+        while (!state->stopping) {
+            std::string path = leg.url.path;
+            uint64_t start_sequence = resume_sequence(*state);
+            if (start_sequence > 0) {
+                path += "?startSequence=" + std::to_string(start_sequence);
+                NATSGW_PROBE(reconnect, state->subject.c_str(), start_sequence, 0, 0);
+            }
+            lock.unlock();
+
+            WebSocketClient client(leg.url.host, leg.url.port, path, 0);
+            client.set_quiet(true);
+            client.set_receive_options(state->receive_options);
+            client.set_message_handler([&state, index](const nats::messages::StreamMessage& message) {
+                offer(*state, index, message);
+            });
+            bool connected = true;
+            try {
+                client.connect();
+            } catch (std::exception const&) {
+                connected = false;   // reported by connect()
+            }
+
+            lock.lock();
+            leg.attempted = true;
+            if (!connected) {
+                leg.stats.failures++;
+                state->cv.notify_all();
+                state->cv.wait_for(lock, backoff, [&] { return state->stopping; });
+                backoff = std::min(backoff * 2, std::chrono::milliseconds(options.backoff_max_ms));
+                continue;
+            }
+            leg.stats.connects++;
+            leg.stats.connected = true;
+            backoff = std::chrono::milliseconds(options.backoff_initial_ms);
+            if (options.verbose) {
+                std::cerr << "✓ Leg " << index + 1 << " connected: ws://" << leg.stats.endpoint << path
+                          << std::endl;
+            }
+            state->cv.notify_all();
+            lock.unlock();
+
+            client.stream_messages();
+
+            lock.lock();
+            leg.stats.connected = false;
+            leg.receive.sampled_out += client.stats().sampled_out;
+            leg.receive.conflated += client.stats().conflated;
+            if (state->stopping) break;
+            leg.stats.drops++;
+            if (options.verbose) {
+                std::cerr << "✗ Leg " << index + 1 << " dropped: " << leg.stats.endpoint << ", reconnecting"
+                          << std::endl;
+            }
+            state->cv.wait_for(lock, backoff, [&] { return state->stopping; });
+        }
+
+        leg.stats.cpu_seconds = own_cpu_seconds();
+        leg.running = false;
+    }
+};
@@ -0,0 +1,256 @@
+/*
+ * Benchmark: ordered delivery through ReorderBuffer behind parallel fetchers
+ *
+ * Simulates --fetchers threads pulling batches of --batch consecutive
+ * sequences from one stream, the way concurrent range fetches or several
+ * pull requests on one consumer do. Each batch arrives after a random delay
+ * of up to --jitter-us, so batches finish out of order. A fraction of
+ * batches is lost (--loss) and a fraction is delivered twice (--dup, a
+ * redelivery after a reconnect).
+ *
+ *   unordered   fetchers call the handler directly (under a mutex)
+ *   reordered   fetchers push into ReorderBuffer (reorder_buffer.h)
+ *
+ * The reordered run checks that every sequence is delivered at most once
+ * and in increasing order, and that the reported gaps cover exactly the
+ * lost sequences. Reports messages/s, how long messages were held back
+ * (push to handler), how deep the buffer got, and the gaps. --json writes
+ * the results for bench_compare (bench_report.h).
+ *
+ * Needs no gateway: the fetch side is synthetic, so the numbers are the
+ * cost of ordering itself.
+ *
+ * Requirements:
+ *   - Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 reorder_bench.cpp message.pb.cc -lprotobuf -pthread -o reorder_bench
+ *
+ * Usage:
+ *   ./reorder_bench [--count 200000] [--fetchers 4] [--batch 100] [--jitter-us 200]
+ *                   [--loss 0.001] [--dup 0.01] [--gap-timeout-ms 50]
+ *                   [--max-messages 10000] [--json FILE]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_report.h"
+#include "message.pb.h"
+#include "reorder_buffer.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Workload {
+    uint64_t count = 200000;
+    int fetchers = 4;
+    int batch = 100;
+    int jitter_us = 200;
+    double loss = 0.001;
+    double dup = 0.01;
+};
+
+// Sequences 1..count in batches, shared by the fetchers. Which batches are
+// lost or duplicated is decided up front, so both runs see the same stream.
+struct Plan {
+    std::vector<bool> lost;
+    std::vector<bool> duplicated;
+    uint64_t lost_messages = 0;
+    uint64_t lost_tail = 0;   // lost after the last delivered batch: no later message reveals the gap
+
+    Plan(const Workload& w) {
+        uint64_t batches = (w.count + w.batch - 1) / w.batch;
+        lost.resize(batches);
+        duplicated.resize(batches);
+        std::mt19937_64 random(42);
+        std::uniform_real_distribution<double> unit(0, 1);
+        for (uint64_t b = 0; b < batches; ++b) {
+            lost[b] = unit(random) < w.loss;
+            duplicated[b] = !lost[b] && unit(random) < w.dup;
+        }
+        for (uint64_t b = 0; b < batches; ++b) {
+            if (lost[b]) lost_messages += batch_size(w, b);
+        }
+        for (uint64_t b = batches; b-- > 0 && lost[b];) {
+            lost_tail += batch_size(w, b);
+        }
+    }
+
+    static uint64_t batch_size(const Workload& w, uint64_t b) {
+        return std::min<uint64_t>(w.batch, w.count - b * w.batch);
+    }
+};
+
+// Run the fetchers; `deliver` gets every message a fetcher receives
+template <typename Deliver>
+static double run_fetchers(const Workload& w, const Plan& plan, std::vector<int64_t>* pushed_ns, Deliver deliver) {
+    std::atomic<uint64_t> next_batch{0};
+    uint64_t batches = plan.lost.size();
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int f = 0; f < w.fetchers; ++f) {
+        threads.emplace_back([&, f] {
+            std::mt19937_64 random(f + 1);
+            std::uniform_int_distribution<int> jitter(0, std::max(0, w.jitter_us));
+            nats::messages::StreamMessage message;
+            message.set_subject("events.bench");
+            message.set_data(std::string(64, 'x'));
+            for (uint64_t b; (b = next_batch.fetch_add(1)) < batches;) {
+                if (w.jitter_us > 0) std::this_thread::sleep_for(std::chrono::microseconds(jitter(random)));
+                if (plan.lost[b]) continue;
+                int copies = plan.duplicated[b] ? 2 : 1;
+                for (int copy = 0; copy < copies; ++copy) {
+                    uint64_t first = b * w.batch + 1;
+                    for (uint64_t i = 0; i < Plan::batch_size(w, b); ++i) {
+                        uint64_t seq = first + i;
+                        if (copy == 0) {
+                            (*pushed_ns)[seq] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                Clock::now() - start).count();
+                        }
+                        message.set_sequence(seq);
+                        deliver(message);
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double percentile(std::vector<double>& values, double q) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = static_cast<size_t>(q * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    Workload w;
+    ReorderOptions options;
+    options.gap_timeout = std::chrono::milliseconds(50);
+    options.start_sequence = 1;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) {
+            w.count = std::max<uint64_t>(1, std::stoull(argv[++i]));
+        } else if (arg == "--fetchers" && i + 1 < argc) {
+            w.fetchers = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--batch" && i + 1 < argc) {
+            w.batch = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--jitter-us" && i + 1 < argc) {
+            w.jitter_us = std::stoi(argv[++i]);
+        } else if (arg == "--loss" && i + 1 < argc) {
+            w.loss = std::stod(argv[++i]);
+        } else if (arg == "--dup" && i + 1 < argc) {
+            w.dup = std::stod(argv[++i]);
+        } else if (arg == "--gap-timeout-ms" && i + 1 < argc) {
+            options.gap_timeout = std::chrono::milliseconds(std::stoi(argv[++i]));
+        } else if (arg == "--max-messages" && i + 1 < argc) {
+            options.max_messages = std::stoull(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        }
+    }
+
+    Plan plan(w);
+    std::cout << "Reorder benchmark: " << w.count << " messages, " << w.fetchers << " fetchers x " << w.batch
+              << ", jitter " << w.jitter_us << " us, " << plan.lost_messages << " lost, gap timeout "
+              << options.gap_timeout.count() << " ms, bound " << options.max_messages << " messages" << std::endl;
+
+    std::vector<int64_t> pushed_ns(w.count + 1);
+    BenchReport report(argc, argv);
+
+    // Unordered: what the handler would see without the buffer
+    std::mutex handler_mutex;
+    uint64_t received = 0;
+    uint64_t out_of_order = 0;
+    uint64_t last = 0;
+    double seconds = run_fetchers(w, plan, &pushed_ns, [&](const nats::messages::StreamMessage& m) {
+        std::lock_guard<std::mutex> lock(handler_mutex);
+        received++;
+        if (m.sequence() < last) out_of_order++;
+        last = std::max(last, m.sequence());
+    });
+    double unordered_rate = received / seconds;
+    std::cout << std::fixed << std::setprecision(0)
+              << "  unordered   " << std::setw(10) << unordered_rate << " msg/s, " << received << " received, "
+              << out_of_order << " out of order" << std::endl;
+    report.metric("unordered", "msgs_per_s", unordered_rate, Better::Higher);
+
+    // Reordered
+    uint64_t delivered = 0;
+    uint64_t violations = 0;
+    uint64_t gap_missing = 0;
+    uint64_t gaps = 0;
+    std::chrono::microseconds max_gap_wait{0};
+    last = 0;
+    std::vector<double> held_us;
+    held_us.reserve(w.count);
+    Clock::time_point start;
+    auto on_message = [&](const nats::messages::StreamMessage& m) {
+        delivered++;
+        if (m.sequence() <= last) violations++;
+        last = m.sequence();
+        int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        held_us.push_back((now_ns - pushed_ns[m.sequence()]) / 1000.0);
+    };
+    auto on_gap = [&](const ReorderGap& gap) {
+        gaps++;
+        gap_missing += gap.size();
+        max_gap_wait = std::max(max_gap_wait, gap.waited);
+        if (gap.first <= last) violations++;
+        last = gap.last;
+    };
+
+    ReorderStats stats;
+    {
+        ReorderBuffer buffer(on_message, on_gap, options);
+        start = Clock::now();
+        seconds = run_fetchers(w, plan, &pushed_ns, [&](const nats::messages::StreamMessage& m) { buffer.push(m); });
+        buffer.flush();
+        stats = buffer.stats();
+    }
+    double reordered_rate = delivered / seconds;
+    uint64_t expected_missing = plan.lost_messages - plan.lost_tail;
+    bool ok = violations == 0 && delivered == w.count - plan.lost_messages && gap_missing == expected_missing;
+
+    std::cout << "  reordered   " << std::setw(10) << reordered_rate << " msg/s, " << delivered << " delivered, "
+              << stats.duplicates << " duplicates dropped, " << violations << " order violations" << std::endl
+              << std::setprecision(1)
+              << "  Held:       p50 " << percentile(held_us, 0.5) << " us, p99 " << percentile(held_us, 0.99)
+              << " us, max " << (held_us.empty() ? 0 : held_us.back() / 1000) << " ms ("
+              << stats.held << " messages waited)" << std::endl
+              << "  Buffer:     max " << stats.max_buffered << " messages, "
+              << stats.max_buffered_bytes / 1024.0 << " KB" << std::endl
+              << "  Gaps:       " << gaps << " (" << gap_missing << " sequences, " << stats.overflows
+              << " by overflow, longest wait " << max_gap_wait.count() / 1000.0 << " ms); "
+              << expected_missing << " expected" << std::endl;
+    if (plan.lost_tail > 0) {
+        std::cout << "  (" << plan.lost_tail << " lost at the end of the stream are never revealed as a gap)"
+                  << std::endl;
+    }
+
+    report.metric("reordered", "msgs_per_s", reordered_rate, Better::Higher);
+    report.samples("reordered", "held_us", held_us, Better::Lower);
+    report.metric("reordered", "max_buffered", static_cast<double>(stats.max_buffered), Better::Lower);
+    if (!json_path.empty() && !report.write(json_path)) {
+        return 1;
+    }
+
+    std::cout << (ok ? "✓ Delivery was strictly ordered, gaps match the lost batches"
+                     : "✗ Ordered delivery check failed") << std::endl;
+    google::protobuf::ShutdownProtobufLibrary();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,353 @@
+/*
+ * ReorderBuffer - strictly ordered delivery on top of parallel receivers
+ *
+ * Several concurrent fetchers, a hedged request or a resubscribe after a
+ * reconnect all hand messages over out of stream order, and the overlap
+ * between them hands some over twice. ReorderBuffer sits between those
+ * receivers and the application: push() from any thread, and the handler
+ * sees each sequence at most once, in increasing order, one call at a time.
+ *
+ *   - A message whose sequence is the next one expected is released at
+ *     once, together with whatever was buffered behind it.
+ *   - A message further ahead waits. If the missing sequences have not
+ *     arrived within gap_timeout, the gap handler is told which ones were
+ *     given up on (ReorderGap::first..last) and delivery moves on.
+ *   - The buffer is bounded by max_messages and max_bytes. When a push
+ *     takes it past either, the oldest hole is given up at once (reported as
+ *     an Overflow gap) rather than growing without limit.
+ *   - Sequences at or below the last released one are dropped: duplicates
+ *     from overlapping receivers, or stragglers that arrive after their gap
+ *     was reported (counted separately as late).
+ *
+ * Gaps are reported in line with the messages, so a handler sees e.g.
+ * 41, 42, gap 43..45, 46 and can resync, refetch or alert at the right
+ * point. Whichever pushing thread finds the buffer idle delivers everything
+ * that is ready, including what other threads push meanwhile; the others
+ * return immediately. Gap timeouts fire from a small timer thread, so a
+ * stalled stream still moves on without further pushes.
+ *
+ * Holes are only meaningful when the sequence space is dense. The stream
+ * sequence is dense for a subscription that sees the whole stream; for a
+ * subject-filtered view use a key the producer makes dense (options.key),
+ * otherwise every unrelated message shows up as a gap.
+ *
+ * Requirements:
+ *   - Protobuf (message types)
+ *   - pthread
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "message.pb.h"
+
+struct ReorderOptions {
+    // Sequence to start from; 0 = the lowest one seen in the first
+    // gap_timeout (the first one pushed when there is no timeout)
+    uint64_t start_sequence = 0;
+    // How long a hole may hold back later messages (0 = until overflow or flush)
+    std::chrono::milliseconds gap_timeout{1000};
+    size_t max_messages = 10000;
+    size_t max_bytes = 64 * 1024 * 1024;
+    // Ordering key; defaults to the stream sequence
+    std::function<uint64_t(const nats::messages::StreamMessage&)> key;
+};
+
+struct ReorderGap {
+    enum class Reason { Timeout, Overflow, Flush };
+
+    uint64_t first = 0;    // first missing sequence
+    uint64_t last = 0;     // last missing sequence (inclusive)
+    Reason reason = Reason::Timeout;
+    std::chrono::microseconds waited{0};   // how long the hole held delivery
+
+    uint64_t size() const { return last - first + 1; }
+
+    static const char* reason_name(Reason reason) {
+        switch (reason) {
+            case Reason::Timeout: return "timeout";
+            case Reason::Overflow: return "overflow";
+            case Reason::Flush: return "flush";
+        }
+        return "?";
+    }
+};
+
+struct ReorderStats {
+    uint64_t pushed = 0;
+    uint64_t released = 0;      // delivered to the message handler
+    uint64_t held = 0;          // released after waiting for an earlier sequence
+    uint64_t duplicates = 0;    // already buffered or released
+    uint64_t unsequenced = 0;   // no sequence (0), dropped
+    uint64_t late = 0;          // arrived after its gap was reported
+    uint64_t gaps = 0;
+    uint64_t missing = 0;       // sequences covered by the reported gaps
+    uint64_t overflows = 0;     // gaps forced by the memory bound
+    size_t buffered = 0;        // waiting now
+    size_t max_buffered = 0;
+    size_t max_buffered_bytes = 0;
+};
+
+class ReorderBuffer {
+public:
+    using Clock = std::chrono::steady_clock;
+    using MessageHandler = std::function<void(const nats::messages::StreamMessage&)>;
+    using GapHandler = std::function<void(const ReorderGap&)>;
+
+private:
+    struct Entry {
+        nats::messages::StreamMessage message;
+        Clock::time_point arrived;
+        size_t bytes = 0;
+        bool held = false;
+    };
+
+    // A message or a gap, in release order
+    struct Release {
+        bool is_gap = false;
+        ReorderGap gap;
+        nats::messages::StreamMessage message;
+    };
+
+    // Reported gaps kept to tell late arrivals from duplicates
+    static constexpr size_t kGapHistory = 64;
+
+    ReorderOptions options_;
+    MessageHandler on_message_;
+    GapHandler on_gap_;
+
+    std::mutex mutex_;
+    std::condition_variable timer_cv_;
+    std::map<uint64_t, Entry> pending_;
+    // (arrival, key) in arrival order; entries below next_ are stale. The
+    // oldest live one tells how long the current hole has been known.
+    std::deque<std::pair<Clock::time_point, uint64_t>> arrivals_;
+    std::deque<std::pair<uint64_t, uint64_t>> recent_gaps_;
+    uint64_t next_ = 0;          // next key to release; 0 = not known yet
+    size_t pending_bytes_ = 0;
+    bool delivering_ = false;
+    bool flush_requested_ = false;   // picked up by whichever thread delivers
+    bool timer_idle_ = false;    // the timer waits without a deadline
+    bool stopping_ = false;
+    ReorderStats stats_;
+    std::thread timer_;
+
+public:
+    ReorderBuffer(MessageHandler on_message, GapHandler on_gap, ReorderOptions options = {})
+        : options_(std::move(options))
+        , on_message_(std::move(on_message))
+        , on_gap_(std::move(on_gap))
+        , next_(options_.start_sequence)
+    {
+        if (!options_.key) {
+            options_.key = [](const nats::messages::StreamMessage& m) { return m.sequence(); };
+        }
+        if (options_.max_messages == 0) options_.max_messages = 1;
+        if (options_.gap_timeout.count() > 0) {
+            timer_ = std::thread([this] { run_timer(); });
+        }
+    }
+
+    ~ReorderBuffer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        timer_cv_.notify_all();
+        if (timer_.joinable()) timer_.join();
+    }
+
+    ReorderBuffer(const ReorderBuffer&) = delete;
+    ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+
+    // Hand over a received message. Safe from any number of threads; may
+    // run the handlers on the calling thread.
+    void push(nats::messages::StreamMessage message) {
+        uint64_t key = options_.key(message);
+        std::unique_lock<std::mutex> lock(mutex_);
+        stats_.pushed++;
+        if (key == 0) {
+            stats_.unsequenced++;
+            return;
+        }
+        if (next_ != 0 && key < next_) {
+            if (was_given_up(key)) {
+                stats_.late++;
+            } else {
+                stats_.duplicates++;
+            }
+            return;
+        }
+        if (pending_.count(key)) {
+            stats_.duplicates++;
+            return;
+        }
+
+        bool entry_held = key != next_;
+        Entry entry;
+        entry.arrived = Clock::now();
+        entry.bytes = message.ByteSizeLong() + sizeof(Entry);
+        entry.held = entry_held;
+        entry.message = std::move(message);
+        pending_bytes_ += entry.bytes;
+        arrivals_.emplace_back(entry.arrived, key);
+        pending_.emplace(key, std::move(entry));
+        stats_.max_buffered = std::max(stats_.max_buffered, pending_.size());
+        stats_.max_buffered_bytes = std::max(stats_.max_buffered_bytes, pending_bytes_);
+
+        if (entry_held && timer_idle_) timer_cv_.notify_one();
+        drain(lock, Clock::now());
+    }
+
+    // Release everything buffered, reporting the holes between as Flush
+    // gaps: end of stream, or before tearing down the receivers. If another
+    // thread (or the gap timer) is delivering, the flush is left to it and
+    // happens as soon as its current batch has been handed over.
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        flush_requested_ = true;
+        drain(lock, Clock::now());
+    }
+
+    // Next key to be released (0 until the start is known)
+    uint64_t next_sequence() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return next_;
+    }
+
+    ReorderStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ReorderStats s = stats_;
+        s.buffered = pending_.size();
+        return s;
+    }
+
+private:
+    bool was_given_up(uint64_t key) const {
+        for (const auto& range : recent_gaps_) {
+            if (key >= range.first && key <= range.second) return true;
+        }
+        return false;
+    }
+
+    // When the hole at the head has been known since (arrival of the oldest
+    // message still waiting)
+    Clock::time_point hole_since() {
+        while (!arrivals_.empty() && arrivals_.front().second < next_) {
+            arrivals_.pop_front();
+        }
+        return arrivals_.empty() ? Clock::now() : arrivals_.front().first;
+    }
+
+    bool over_bound() const {
+        return pending_.size() > options_.max_messages || pending_bytes_ > options_.max_bytes;
+    }
+
+    // Move what can be released from pending_ into `out`, in order
+    void collect(Clock::time_point now, bool flush, std::vector<Release>* out) {
+        while (!pending_.empty()) {
+            auto head = pending_.begin();
+            if (next_ == 0 && options_.gap_timeout.count() == 0) {
+                next_ = head->first;
+            }
+            if (next_ == 0 || head->first != next_) {
+                Clock::time_point since = hole_since();
+                bool timed_out = options_.gap_timeout.count() > 0 && now - since >= options_.gap_timeout;
+                bool overflow = over_bound();
+                if (!flush && !timed_out && !overflow) return;
+
+                if (next_ != 0) {
+                    Release r;
+                    r.is_gap = true;
+                    r.gap.first = next_;
+                    r.gap.last = head->first - 1;
+                    r.gap.reason = flush ? ReorderGap::Reason::Flush
+                        : overflow ? ReorderGap::Reason::Overflow : ReorderGap::Reason::Timeout;
+                    r.gap.waited = std::chrono::duration_cast<std::chrono::microseconds>(now - since);
+                    stats_.gaps++;
+                    stats_.missing += r.gap.size();
+                    if (r.gap.reason == ReorderGap::Reason::Overflow) stats_.overflows++;
+                    recent_gaps_.emplace_back(r.gap.first, r.gap.last);
+                    if (recent_gaps_.size() > kGapHistory) recent_gaps_.pop_front();
+                    out->push_back(std::move(r));
+                }
+                // The start is the lowest sequence that arrived in time
+                next_ = head->first;
+            }
+
+            // The head is next_ now; release the run that follows it
+            while (!pending_.empty() && pending_.begin()->first == next_) {
+                auto it = pending_.begin();
+                Release r;
+                r.message = std::move(it->second.message);
+                if (it->second.held) stats_.held++;
+                pending_bytes_ -= it->second.bytes;
+                pending_.erase(it);
+                out->push_back(std::move(r));
+                stats_.released++;
+                next_++;
+            }
+        }
+    }
+
+    // Deliver whatever is ready. Only one thread delivers at a time; it
+    // keeps going while others add releasable messages or request a flush,
+    // so handler calls stay in order without holding the lock during them.
+    void drain(std::unique_lock<std::mutex>& lock, Clock::time_point now) {
+        if (delivering_) return;
+        delivering_ = true;
+        std::vector<Release> batch;
+        while (true) {
+            bool flush = flush_requested_;
+            flush_requested_ = false;
+            collect(now, flush, &batch);
+            if (batch.empty()) break;
+            lock.unlock();
+            for (const Release& r : batch) {
+                if (r.is_gap) {
+                    if (on_gap_) on_gap_(r.gap);
+                } else if (on_message_) {
+                    on_message_(r.message);
+                }
+            }
+            batch.clear();
+            lock.lock();
+            now = Clock::now();
+        }
+        delivering_ = false;
+    }
+
+    void run_timer() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            if (pending_.empty()) {
+                timer_idle_ = true;
+                timer_cv_.wait(lock);
+                timer_idle_ = false;
+                continue;
+            }
+            Clock::time_point deadline = hole_since() + options_.gap_timeout;
+            if (Clock::now() < deadline) {
+                // The hole may be filled by the time this wakes: recompute
+                timer_cv_.wait_until(lock, deadline);
+                continue;
+            }
+            drain(lock, Clock::now());
+            if (delivering_) {
+                // Another thread is delivering and picks the gap up when
+                // its handler returns
+                timer_cv_.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        }
+    }
+};
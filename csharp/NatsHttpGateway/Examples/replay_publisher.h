@@ -0,0 +1,294 @@
+/*
+ * ReplayPublisher - republish captured traffic with its original timing
+ *
+ * Reads messages in capture order (traffic_capture.h, or any source of
+ * StreamMessages with timestamps) and publishes them to a gateway or
+ * straight to NATS through make_publisher(). Message i is due at
+ *
+ *   start + (timestamp_i - timestamp_0) / speed
+ *
+ * so bursts, lulls and per-subject rates come out as they were recorded,
+ * compressed or stretched by the speed factor. Speed 0 publishes as fast
+ * as the connections allow.
+ *
+ * Messages are spread over several connections by subject hash. Each
+ * connection has its own publisher, thread and bounded queue, and publishes
+ * one message at a time in queue order. That keeps every subject's messages
+ * in capture order while unrelated subjects go out in parallel. The reader
+ * runs ahead of the clock by up to queue_depth messages per connection, and
+ * each connection sleeps until its next message is due. When the target
+ * cannot keep up, messages go out late rather than out of order.
+ * Lateness (publish start minus due time) and publish latency are sampled
+ * per connection, so a report shows whether the target or the replayer was
+ * the limit.
+ *
+ * Requirements:
+ *   - Protobuf, libcurl (gateway), Boost.Asio (direct NATS), pthread
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "message.pb.h"
+#include "receive_modes.h"
+#include "transport.h"
+
+struct ReplayOptions {
+    double speed = 1.0;          // 2 = twice as fast, 0 = no timing
+    int connections = 4;         // parallel publishers; a subject uses one
+    size_t queue_depth = 1024;   // read-ahead per connection
+    uint64_t limit = 0;          // stop after this many messages (0 = all)
+    std::string subject_prefix;  // prepended to every subject
+};
+
+// Fixed-size uniform sample of a stream of values (reservoir sampling)
+class SampleReservoir {
+private:
+    static constexpr size_t kCapacity = 16384;
+
+    std::vector<double> values_;
+    uint64_t seen_ = 0;
+    std::mt19937_64 random_;
+
+public:
+    explicit SampleReservoir(uint64_t seed = 1) : random_(seed) {
+        values_.reserve(kCapacity);
+    }
+
+    void add(double value) {
+        seen_++;
+        if (values_.size() < kCapacity) {
+            values_.push_back(value);
+        } else {
+            uint64_t slot = random_() % seen_;
+            if (slot < kCapacity) values_[slot] = value;
+        }
+    }
+
+    uint64_t seen() const { return seen_; }
+    const std::vector<double>& values() const { return values_; }
+
+    // Combined sample of several reservoirs, each value repeated in
+    // proportion to how many values its reservoir stood for
+    static std::vector<double> merge(const std::vector<const SampleReservoir*>& parts) {
+        std::vector<double> merged;
+        uint64_t smallest = 0;
+        for (const auto* part : parts) {
+            if (part->values_.empty()) continue;
+            uint64_t per_value = part->seen_ / part->values_.size();
+            if (smallest == 0 || per_value < smallest) smallest = per_value;
+        }
+        for (const auto* part : parts) {
+            if (part->values_.empty()) continue;
+            uint64_t copies = std::max<uint64_t>(1, part->seen_ / part->values_.size() / smallest);
+            for (double value : part->values_) merged.insert(merged.end(), copies, value);
+        }
+        std::sort(merged.begin(), merged.end());
+        return merged;
+    }
+};
+
+struct ReplayStats {
+    uint64_t messages = 0;        // read from the source
+    uint64_t published = 0;
+    uint64_t failed = 0;
+    uint64_t bytes = 0;           // payload bytes published
+    double capture_seconds = 0;   // first to last timestamp in the source
+    double elapsed_seconds = 0;   // first publish due to last publish done
+    std::vector<double> lateness_us;   // sorted sample: publish start - due
+    std::vector<double> publish_us;    // sorted sample: publish call time
+    std::vector<uint64_t> per_connection;
+};
+
+class ReplayPublisher {
+public:
+    using Clock = std::chrono::steady_clock;
+    using PublisherFactory = std::function<std::unique_ptr<MessagePublisher>()>;
+    using Source = std::function<bool(nats::messages::StreamMessage*)>;
+
+private:
+    struct Item {
+        std::string subject;
+        nats::messages::PublishMessage message;
+        Clock::time_point due;
+    };
+
+    struct Connection {
+        std::unique_ptr<MessagePublisher> publisher;
+        std::mutex mutex;
+        std::condition_variable ready;    // the worker waits for items
+        std::condition_variable space;    // the reader waits for room
+        std::deque<Item> queue;
+        bool closed = false;
+        std::thread thread;
+
+        // Worker thread only until it is joined
+        uint64_t published = 0;
+        uint64_t failed = 0;
+        uint64_t bytes = 0;
+        Clock::time_point last_done{};
+        SampleReservoir lateness_us;
+        SampleReservoir publish_us;
+
+        explicit Connection(uint64_t seed) : lateness_us(seed), publish_us(seed + 1) {}
+    };
+
+    // stop() sets a flag; waits check it at least this often
+    static constexpr std::chrono::milliseconds kStopPoll{100};
+
+    ReplayOptions options_;
+    PublisherFactory factory_;
+    std::atomic<bool> stopping_{false};
+
+public:
+    ReplayPublisher(const std::string& url, ReplayOptions options)
+        : ReplayPublisher([url] { return make_publisher(url); }, std::move(options))
+    {
+    }
+
+    ReplayPublisher(PublisherFactory factory, ReplayOptions options)
+        : options_(std::move(options))
+        , factory_(std::move(factory))
+    {
+        options_.connections = std::max(1, options_.connections);
+        options_.queue_depth = std::max<size_t>(1, options_.queue_depth);
+    }
+
+    // Ask a running replay to stop: no more messages are read, and each
+    // connection finishes the publish it is in. Safe from any thread.
+    void stop() {
+        stopping_ = true;
+    }
+
+    // Replay everything `next` yields, then wait for the connections to
+    // drain. Returns false if no connection could be opened.
+    bool run(const Source& next, ReplayStats* stats) {
+        std::vector<std::unique_ptr<Connection>> connections;
+        for (int i = 0; i < options_.connections; ++i) {
+            auto connection = std::make_unique<Connection>(static_cast<uint64_t>(i) * 2 + 1);
+            connection->publisher = factory_();
+            if (!connection->publisher) {
+                std::cerr << "✗ Failed to open replay connection " << i << std::endl;
+                return false;
+            }
+            connections.push_back(std::move(connection));
+        }
+        for (auto& connection : connections) {
+            Connection* c = connection.get();
+            c->thread = std::thread([this, c] { work(*c); });
+        }
+
+        *stats = ReplayStats{};
+        nats::messages::StreamMessage record;
+        int64_t first_ns = 0;
+        int64_t last_ns = 0;
+        Clock::time_point start;
+        while (!stopping_ && (options_.limit == 0 || stats->messages < options_.limit) && next(&record)) {
+            int64_t timestamp_ns = record.timestamp().seconds() * 1000000000LL + record.timestamp().nanos();
+            if (stats->messages == 0) {
+                first_ns = last_ns = timestamp_ns;
+                // A little lead so the connections start with a queue
+                start = Clock::now() + std::chrono::milliseconds(5);
+            }
+            // Clock steps backwards in the capture don't rewind the schedule
+            last_ns = std::max(last_ns, timestamp_ns);
+            stats->messages++;
+
+            Item item;
+            item.subject = options_.subject_prefix + record.subject();
+            item.message.set_subject(item.subject);
+            item.message.set_source("natsgw-replay");
+            item.message.set_data(std::move(*record.mutable_data()));
+            item.due = options_.speed > 0
+                ? start + std::chrono::nanoseconds(static_cast<int64_t>((last_ns - first_ns) / options_.speed))
+                : start;
+
+            size_t index = static_cast<size_t>(mix64(fnv1a64(item.subject)) % connections.size());
+            Connection& c = *connections[index];
+            std::unique_lock<std::mutex> lock(c.mutex);
+            while (c.queue.size() >= options_.queue_depth && !stopping_) {
+                c.space.wait_for(lock, kStopPoll);
+            }
+            c.queue.push_back(std::move(item));
+            c.ready.notify_one();
+        }
+        stats->capture_seconds = (last_ns - first_ns) / 1e9;
+
+        for (auto& connection : connections) {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            connection->closed = true;
+            connection->ready.notify_one();
+        }
+        Clock::time_point finished = start;
+        std::vector<const SampleReservoir*> lateness;
+        std::vector<const SampleReservoir*> latency;
+        for (auto& connection : connections) {
+            connection->thread.join();
+            stats->published += connection->published;
+            stats->failed += connection->failed;
+            stats->bytes += connection->bytes;
+            stats->per_connection.push_back(connection->published + connection->failed);
+            finished = std::max(finished, connection->last_done);
+            lateness.push_back(&connection->lateness_us);
+            latency.push_back(&connection->publish_us);
+        }
+        if (stats->messages > 0) {
+            stats->elapsed_seconds = std::chrono::duration<double>(finished - start).count();
+        }
+        stats->lateness_us = SampleReservoir::merge(lateness);
+        stats->publish_us = SampleReservoir::merge(latency);
+        return true;
+    }
+
+private:
+    void work(Connection& c) {
+        while (true) {
+            Item item;
+            {
+                std::unique_lock<std::mutex> lock(c.mutex);
+                while (c.queue.empty() && !c.closed && !stopping_) {
+                    c.ready.wait_for(lock, kStopPoll);
+                }
+                if (stopping_ || c.queue.empty()) return;
+                item = std::move(c.queue.front());
+                c.queue.pop_front();
+                c.space.notify_one();
+
+                // Wakeups for newly queued items just wait again
+                while (!stopping_ && Clock::now() < item.due) {
+                    c.ready.wait_until(lock, std::min(item.due, Clock::now() + kStopPoll));
+                }
+                if (stopping_) return;
+            }
+
+            Clock::time_point begin = Clock::now();
+            auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            item.message.mutable_timestamp()->set_seconds(now / 1000000000);
+            item.message.mutable_timestamp()->set_nanos(static_cast<int32_t>(now % 1000000000));
+            bool ok = c.publisher->publish(item.subject, item.message);
+            c.last_done = Clock::now();
+
+            if (ok) {
+                c.published++;
+                c.bytes += item.message.data().size();
+            } else {
+                c.failed++;
+            }
+            c.lateness_us.add(std::chrono::duration<double, std::micro>(begin - item.due).count());
+            c.publish_us.add(std::chrono::duration<double, std::micro>(c.last_done - begin).count());
+        }
+    }
+};
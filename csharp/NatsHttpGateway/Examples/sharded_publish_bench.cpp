@@ -0,0 +1,160 @@
+/*
+ * Benchmark: publish throughput of ShardedPublisher vs a single HttpClient
+ *
+ * Publishes --count messages of --size bytes over --subjects subjects:
+ *
+ *   single client   one thread, one HttpClient, blocking publishes
+ *   N shards        ShardedPublisher (sharded_publisher.h) with N shards,
+ *                   fed by --producers producer threads
+ *
+ * for N = 1, 2, 4, ... up to --max-shards (default: hardware threads).
+ * Reports messages/s, MB/s and the speedup over the single client. On a
+ * machine with fewer cores than shards, throughput levels off at the core
+ * count. --json writes the results for bench_compare (bench_report.h).
+ *
+ * Works against the gateway or mock_gateway.cpp.
+ *
+ * Requirements:
+ *   - libcurl, Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 sharded_publish_bench.cpp message.pb.cc \
+ *       -lprotobuf -lcurl -pthread -o sharded_publish_bench
+ *
+ * Usage:
+ *   ./sharded_publish_bench [base_url] [--count 20000] [--size 256]
+ *                           [--subjects 64] [--producers 2] [--connections 4]
+ *                           [--max-shards N] [--json FILE]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench_report.h"
+#include "http_client.h"
+#include "message.pb.h"
+#include "sharded_publisher.h"
+
+using Clock = std::chrono::steady_clock;
+
+static void print_row(BenchReport& report, const std::string& name, uint64_t messages, size_t size, double seconds,
+                      double baseline) {
+    double rate = messages / seconds;
+    report.metric(name, "msgs_per_s", rate, Better::Higher);
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(12) << rate << std::setprecision(1) << std::setw(10) << rate * size / 1e6
+              << std::setprecision(2) << std::setw(10) << (baseline > 0 ? rate / baseline : 1.0) << "x"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    std::string base_url = "http://localhost:8080";
+    uint64_t count = 20000;
+    size_t size = 256;
+    int subjects = 64;
+    int producers = 2;
+    int connections = 4;
+    int max_shards = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) {
+            count = std::stoull(argv[++i]);
+        } else if (arg == "--size" && i + 1 < argc) {
+            size = std::stoull(argv[++i]);
+        } else if (arg == "--subjects" && i + 1 < argc) {
+            subjects = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--producers" && i + 1 < argc) {
+            producers = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--connections" && i + 1 < argc) {
+            connections = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--max-shards" && i + 1 < argc) {
+            max_shards = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            base_url = arg;
+        }
+    }
+
+    std::vector<std::string> names;
+    for (int s = 0; s < subjects; ++s) names.push_back("bench.shard." + std::to_string(s));
+    nats::messages::PublishMessage message;
+    message.set_source("sharded-publish-bench");
+    message.set_data(std::string(size, 'x'));
+
+    std::cout << count << " messages of " << size << " bytes, " << subjects << " subjects, " << producers
+              << " producers, " << connections << " connections per shard, "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl << std::endl;
+    std::cout << std::left << std::setw(16) << "publisher" << std::right << std::setw(12) << "msgs/s"
+              << std::setw(10) << "MB/s" << std::setw(11) << "speedup" << std::endl;
+
+    BenchReport report(argc, argv);
+    try {
+        // Baseline: one blocking client (a tenth of the messages is plenty)
+        uint64_t baseline_count = std::max<uint64_t>(1, count / 10);
+        HttpClient client(base_url);
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < baseline_count; ++i) {
+            if (!client.publish(names[i % names.size()], message)) {
+                return 1;
+            }
+        }
+        double baseline_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        double baseline = baseline_count / baseline_seconds;
+        print_row(report, "single client", baseline_count, size, baseline_seconds, 0);
+
+        bool ok = true;
+        for (int shards = 1; shards <= max_shards; shards *= 2) {
+            ShardedPublisherConfig config;
+            config.base_url = base_url;
+            config.shards = shards;
+            config.connections_per_shard = connections;
+            ShardedPublisher publisher(config);
+
+            start = Clock::now();
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; ++p) {
+                threads.emplace_back([&, p] {
+                    auto producer = publisher.producer();
+                    for (uint64_t i = p; i < count; i += producers) {
+                        producer->publish(names[i % names.size()], message);
+                    }
+                });
+            }
+            for (auto& t : threads) t.join();
+            if (!publisher.flush()) {
+                return 1;
+            }
+            double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+            ShardStats total = publisher.total_stats();
+            print_row(report, std::to_string(shards) + (shards == 1 ? " shard" : " shards"), total.published, size,
+                      seconds, baseline);
+            ok = ok && total.published == count && total.failed == 0;
+        }
+
+        if (!report.write(json_path)) {
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "✗ Some publishes failed" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ All messages acknowledged" << std::endl;
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,514 @@
+/*
+ * ShardedPublisher - shard-per-core publishing runtime
+ *
+ * One HttpClient performs one blocking request at a time, which is one
+ * core at most. Sharing a client pool between threads puts a lock on the
+ * hot path instead. ShardedPublisher runs one shard per core, and shards
+ * share nothing:
+ *
+ *   - an event loop thread (optionally pinned to its core) driving a curl
+ *     multi handle;
+ *   - its own set of keep-alive gateway connections, each with one request
+ *     in flight;
+ *   - its own encoder state and a pool of reusable request buffers.
+ *
+ * Each subject belongs to one shard (and, inside it, to one connection) by
+ * hash. Producer threads submit through a Producer handle. The handle owns
+ * one single-producer/single-consumer ring per shard, so a submission is
+ * a few relaxed stores and one release store. No lock is taken and nothing
+ * else writes that cache line. Shards sleep in curl_multi_poll() when idle
+ * and are woken by curl_multi_wakeup().
+ *
+ * Ordering: messages from one producer on one subject are published in
+ * submission order (same ring, same shard, same connection, one request at
+ * a time). There is no order across producers.
+ *
+ * Publishing is fire-and-forget. Outcomes are counted in stats(). flush()
+ * waits until everything submitted so far has been answered. The
+ * destructor publishes whatever is still queued before it returns.
+ *
+ * Requirements:
+ *   - libcurl >= 7.68 (curl_multi_poll / curl_multi_wakeup)
+ *   - Protobuf, pthread
+ */
+
+#pragma once
+
+#include <curl/curl.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "http_client.h"
+#include "message.pb.h"
+#include "receive_modes.h"
+
+// Bounded single-producer/single-consumer ring. Head and tail live on
+// separate cache lines, and each side caches the other's index so that a
+// push or pop normally touches only its own line.
+template <typename T>
+class SpscQueue {
+private:
+    std::vector<T> slots_;
+    size_t mask_;
+
+    alignas(64) std::atomic<size_t> head_{0};   // next to pop (consumer)
+    size_t cached_tail_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};   // next to push (producer)
+    size_t cached_head_ = 0;
+
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    // Producer side; `item` is moved from only on success
+    bool try_push(T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: the next item without removing it, nullptr if empty
+    T* peek() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+
+    // Consumer side
+    bool try_pop(T* item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) return false;
+        }
+        *item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+};
+
+struct ShardedPublisherConfig {
+    std::string base_url;
+    int shards = 0;                  // 0 = one per hardware thread
+    int connections_per_shard = 4;   // requests in flight per shard
+    size_t queue_capacity = 4096;    // per producer and shard
+    bool pin_threads = true;         // pin shard i to CPU i (Linux)
+};
+
+struct ShardStats {
+    uint64_t published = 0;   // answered 200
+    uint64_t failed = 0;      // transport errors and non-200 answers
+    uint64_t bytes = 0;       // request bodies sent
+    uint64_t wakeups = 0;     // returns from an idle poll
+};
+
+class ShardedPublisher {
+private:
+    struct Submission {
+        std::string subject;
+        nats::messages::PublishMessage message;
+    };
+    using Ring = SpscQueue<Submission>;
+
+    struct Connection {
+        CURL* easy = nullptr;
+        std::deque<Submission> backlog;   // this connection's subjects, in order
+        std::string body;                 // from the shard's buffer pool while busy
+        std::string response;
+        bool busy = false;
+    };
+
+    struct alignas(64) Shard {
+        CURLM* multi = nullptr;
+        std::vector<Connection> connections;
+        std::vector<std::string> buffer_pool;
+        struct curl_slist* headers = nullptr;
+        std::thread thread;
+
+        std::mutex rings_mutex;            // guards `added_rings`
+        std::vector<std::shared_ptr<Ring>> added_rings;
+        std::atomic<bool> rings_changed{false};
+        std::vector<std::shared_ptr<Ring>> rings;   // loop thread only
+        std::vector<char> ring_blocked;             // head waits for a full backlog
+
+        std::atomic<bool> sleeping{false};
+        std::atomic<uint64_t> completed{0};
+        std::atomic<uint64_t> published{0};
+        std::atomic<uint64_t> failed{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> wakeups{0};
+    };
+
+    ShardedPublisherConfig config_;
+    std::string url_prefix_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> stopping_{false};
+
+    std::mutex producers_mutex_;
+    std::vector<std::unique_ptr<std::atomic<uint64_t>>> submitted_;   // per producer
+
+public:
+    // Submits to the shards from one thread. Create one per producer thread.
+    class Producer {
+    private:
+        ShardedPublisher* owner_;
+        std::vector<std::shared_ptr<Ring>> rings_;   // one per shard, shared with it
+        std::atomic<uint64_t>* submitted_;
+
+        friend class ShardedPublisher;
+        Producer(ShardedPublisher* owner, std::atomic<uint64_t>* submitted)
+            : owner_(owner)
+            , submitted_(submitted)
+        {
+        }
+
+    public:
+        // False when the shard's ring is full
+        bool try_publish(const std::string& subject, nats::messages::PublishMessage message) {
+            Submission submission{subject, std::move(message)};
+            return try_submit(submission);
+        }
+
+        // Waits (yielding) while the shard's ring is full. False only when
+        // the publisher is shutting down.
+        bool publish(const std::string& subject, nats::messages::PublishMessage message) {
+            Submission submission{subject, std::move(message)};
+            while (!try_submit(submission)) {
+                if (owner_->stopping_.load(std::memory_order_relaxed)) return false;
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+    private:
+        bool try_submit(Submission& submission) {
+            size_t index = owner_->shard_for(submission.subject);
+            if (!rings_[index]->try_push(submission)) {
+                return false;
+            }
+            // Owned by this thread; the flush() reader only needs a value
+            // that is eventually current
+            submitted_->store(submitted_->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            owner_->wake(index);
+            return true;
+        }
+    };
+
+    explicit ShardedPublisher(ShardedPublisherConfig config) : config_(std::move(config)) {
+        if (config_.shards <= 0) {
+            config_.shards = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+        config_.connections_per_shard = std::max(1, config_.connections_per_shard);
+        url_prefix_ = config_.base_url + "/api/proto/ProtobufMessages/";
+
+        curl_global_once();
+        for (int i = 0; i < config_.shards; ++i) {
+            auto shard = std::make_unique<Shard>();
+            shard->multi = curl_multi_init();
+            if (!shard->multi) {
+                throw std::runtime_error("Failed to initialize CURL multi handle");
+            }
+            shard->headers = curl_slist_append(nullptr, "Content-Type: application/x-protobuf");
+            shard->headers = curl_slist_append(shard->headers, "Expect:");
+            shard->connections.resize(static_cast<size_t>(config_.connections_per_shard));
+            for (auto& connection : shard->connections) {
+                connection.easy = curl_easy_init();
+                if (!connection.easy) {
+                    throw std::runtime_error("Failed to initialize CURL");
+                }
+            }
+            shards_.push_back(std::move(shard));
+        }
+        for (int i = 0; i < config_.shards; ++i) {
+            shards_[i]->thread = std::thread([this, i] { run(i); });
+        }
+    }
+
+    ~ShardedPublisher() {
+        stopping_ = true;
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            curl_multi_wakeup(shards_[i]->multi);
+        }
+        for (auto& shard : shards_) {
+            if (shard->thread.joinable()) shard->thread.join();
+            for (auto& connection : shard->connections) {
+                if (connection.busy) curl_multi_remove_handle(shard->multi, connection.easy);
+                curl_easy_cleanup(connection.easy);
+            }
+            curl_multi_cleanup(shard->multi);
+            curl_slist_free_all(shard->headers);
+        }
+    }
+
+    ShardedPublisher(const ShardedPublisher&) = delete;
+    ShardedPublisher& operator=(const ShardedPublisher&) = delete;
+
+    size_t shard_count() const { return shards_.size(); }
+
+    // Shard that publishes `subject`
+    size_t shard_for(const std::string& subject) const {
+        return static_cast<size_t>(mix64(fnv1a64(subject)) % shards_.size());
+    }
+
+    // A handle for one producer thread. Messages submitted through it are
+    // published even if the handle is destroyed first.
+    std::unique_ptr<Producer> producer() {
+        std::atomic<uint64_t>* submitted;
+        {
+            std::lock_guard<std::mutex> lock(producers_mutex_);
+            submitted_.push_back(std::make_unique<std::atomic<uint64_t>>(0));
+            submitted = submitted_.back().get();
+        }
+        std::unique_ptr<Producer> handle(new Producer(this, submitted));
+        for (auto& shard : shards_) {
+            handle->rings_.push_back(std::make_shared<Ring>(config_.queue_capacity));
+            std::lock_guard<std::mutex> lock(shard->rings_mutex);
+            shard->added_rings.push_back(handle->rings_.back());
+            shard->rings_changed.store(true, std::memory_order_release);
+        }
+        return handle;
+    }
+
+    // Wait until every message submitted before the call has been answered
+    bool flush(std::chrono::milliseconds timeout = std::chrono::milliseconds(30000)) {
+        uint64_t target = 0;
+        {
+            std::lock_guard<std::mutex> lock(producers_mutex_);
+            for (const auto& count : submitted_) target += count->load(std::memory_order_acquire);
+        }
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (completed() < target) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                std::cerr << "✗ Flush timed out with " << target - completed() << " messages outstanding" << std::endl;
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return true;
+    }
+
+    std::vector<ShardStats> stats() const {
+        std::vector<ShardStats> result;
+        for (const auto& shard : shards_) {
+            ShardStats s;
+            s.published = shard->published.load();
+            s.failed = shard->failed.load();
+            s.bytes = shard->bytes.load();
+            s.wakeups = shard->wakeups.load();
+            result.push_back(s);
+        }
+        return result;
+    }
+
+    ShardStats total_stats() const {
+        ShardStats total;
+        for (const auto& s : stats()) {
+            total.published += s.published;
+            total.failed += s.failed;
+            total.bytes += s.bytes;
+            total.wakeups += s.wakeups;
+        }
+        return total;
+    }
+
+private:
+    uint64_t completed() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) total += shard->completed.load(std::memory_order_acquire);
+        return total;
+    }
+
+    void wake(size_t index) {
+        Shard& shard = *shards_[index];
+        // Pairs with the fence in run(): either the shard sees the new
+        // item or we see it sleeping
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shard.sleeping.load(std::memory_order_relaxed)) {
+            curl_multi_wakeup(shard.multi);
+        }
+    }
+
+    void pin(int index) {
+#ifdef __linux__
+        if (!config_.pin_threads) return;
+        unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(static_cast<unsigned>(index) % cpus, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)index;
+#endif
+    }
+
+    // Move submissions from the rings to the connections' backlogs. A ring
+    // whose next submission targets a full backlog stays where it is (its
+    // order must hold), so the backlogs are bounded and full rings push back
+    // on producers.
+    bool drain(Shard& shard) {
+        if (shard.rings_changed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(shard.rings_mutex);
+            shard.rings.insert(shard.rings.end(), shard.added_rings.begin(), shard.added_rings.end());
+            shard.added_rings.clear();
+            shard.rings_changed.store(false, std::memory_order_relaxed);
+            shard.ring_blocked.resize(shard.rings.size(), 0);
+        }
+
+        const size_t backlog_limit = 256;
+        size_t connections = shard.connections.size();
+        size_t shard_count = shards_.size();
+        bool moved = false;
+        Submission submission;
+        for (size_t r = 0; r < shard.rings.size(); ++r) {
+            Ring& ring = *shard.rings[r];
+            shard.ring_blocked[r] = 0;
+            for (int n = 0; n < 64; ++n) {
+                Submission* head = ring.peek();
+                if (!head) break;
+                size_t index = static_cast<size_t>(mix64(fnv1a64(head->subject)) / shard_count % connections);
+                auto& backlog = shard.connections[index].backlog;
+                if (backlog.size() >= backlog_limit) {
+                    shard.ring_blocked[r] = 1;
+                    break;
+                }
+                ring.try_pop(&submission);
+                backlog.push_back(std::move(submission));
+                moved = true;
+            }
+        }
+        return moved;
+    }
+
+    void start_request(Shard& shard, Connection& connection) {
+        Submission submission = std::move(connection.backlog.front());
+        connection.backlog.pop_front();
+
+        if (!shard.buffer_pool.empty()) {
+            connection.body.swap(shard.buffer_pool.back());
+            shard.buffer_pool.pop_back();
+        }
+        // Reuses the pooled buffer's capacity
+        submission.message.SerializeToString(&connection.body);
+        connection.response.clear();
+
+        std::string url = url_prefix_ + submission.subject;
+        CURL* easy = connection.easy;
+        curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, connection.body.data());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(connection.body.size()));
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, shard.headers);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, &connection.response);
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, &connection);
+        curl_multi_add_handle(shard.multi, easy);
+        connection.busy = true;
+        shard.bytes.fetch_add(connection.body.size(), std::memory_order_relaxed);
+    }
+
+    void finish_request(Shard& shard, Connection& connection, CURLcode result) {
+        long status = 0;
+        curl_easy_getinfo(connection.easy, CURLINFO_RESPONSE_CODE, &status);
+        curl_multi_remove_handle(shard.multi, connection.easy);
+        connection.busy = false;
+
+        if (result != CURLE_OK) {
+            std::cerr << "✗ HTTP request failed: " << curl_easy_strerror(result) << std::endl;
+            shard.failed.fetch_add(1, std::memory_order_relaxed);
+        } else if (status != 200) {
+            std::cerr << "✗ Server returned status: " << status << std::endl;
+            shard.failed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            shard.published.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.completed.fetch_add(1, std::memory_order_release);
+
+        std::string buffer;
+        buffer.swap(connection.body);
+        shard.buffer_pool.push_back(std::move(buffer));
+    }
+
+    void run(int index) {
+        pin(index);
+        Shard& shard = *shards_[static_cast<size_t>(index)];
+
+        while (true) {
+            drain(shard);
+
+            bool in_flight = false;
+            bool queued = false;
+            for (auto& connection : shard.connections) {
+                if (!connection.busy && !connection.backlog.empty()) {
+                    start_request(shard, connection);
+                }
+                in_flight = in_flight || connection.busy;
+                queued = queued || !connection.backlog.empty();
+            }
+
+            if (!in_flight && !queued && stopping_.load()) {
+                break;
+            }
+
+            int running = 0;
+            curl_multi_perform(shard.multi, &running);
+            int pending = 0;
+            while (CURLMsg* msg = curl_multi_info_read(shard.multi, &pending)) {
+                if (msg->msg != CURLMSG_DONE) continue;
+                Connection* connection = nullptr;
+                curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &connection);
+                finish_request(shard, *connection, msg->data.result);
+            }
+
+            // Sleep until a socket is ready or a producer wakes us. The flag
+            // is raised before the rings are checked, so a submission made
+            // after the check sees it and calls curl_multi_wakeup(). Rings
+            // blocked on a full backlog wait for a response, not a wakeup.
+            bool idle_work = false;
+            for (auto& connection : shard.connections) {
+                if (!connection.busy && !connection.backlog.empty()) idle_work = true;
+            }
+            if (idle_work) continue;
+            shard.sleeping.store(true, std::memory_order_seq_cst);
+            bool ready = false;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            for (size_t r = 0; r < shard.rings.size(); ++r) {
+                ready = ready || (!shard.ring_blocked[r] && !shard.rings[r]->empty());
+            }
+            if (!ready && !shard.rings_changed.load() && !stopping_.load()) {
+                curl_multi_poll(shard.multi, nullptr, 0, running ? 100 : 1000, nullptr);
+                shard.wakeups.fetch_add(1, std::memory_order_relaxed);
+            }
+            shard.sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+};
@@ -0,0 +1,168 @@
+/*
+ * Snapshot-then-tail bootstrap: recent history, then live messages, with an
+ * exact handover
+ *
+ * Fetching history and then opening a WebSocket stream as two independent
+ * calls loses (stream opened late) or repeats (stream opened early)
+ * whatever is published in between. SnapshotTail::run() instead:
+ *
+ *   1. fetches the last N messages with GET /api/proto/ProtobufMessages/
+ *      {subject}. The response's last_sequence is the stream's last
+ *      sequence when the fetch started;
+ *   2. upgrades the same connection to ws/websocketmessages/{subject}
+ *      ?startSequence=H+1, where H = max(last_sequence, last fetched
+ *      sequence), so the live stream starts exactly after the snapshot.
+ *
+ * That is two requests on one keep-alive connection, one fewer TCP connect
+ * than separate fetch and stream clients.
+ *
+ * Both phases go to one handler, in sequence order, with a flag telling
+ * history from live messages. Live messages at or below the last delivered
+ * sequence are dropped. That covers gateways that ignore startSequence
+ * (they stream new messages only) and resumes. resume() reconnects a dropped
+ * stream from the sequence after the last one delivered.
+ *
+ * run() and resume() return false when the stream dropped (connection error,
+ * failed upgrade) and true when it ended cleanly: the server closed it or
+ * `max_live` messages arrived.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "message.pb.h"
+#include "natsgw_probes.h"
+#include "receive_modes.h"
+#include "websocket_client.h"
+
+struct BootstrapStats {
+    uint64_t history = 0;           // messages from the fetch
+    uint64_t live = 0;              // messages from the stream
+    uint64_t overlap_dropped = 0;   // live messages already delivered
+    uint64_t resume_sequence = 0;   // startSequence of the last stream request
+};
+
+class SnapshotTail {
+public:
+    // `live` is false for messages from the fetch
+    using Handler = std::function<void(const nats::messages::StreamMessage& message, bool live)>;
+
+private:
+    WebSocketURL url_;
+    std::string subject_;
+    int history_limit_;
+    Handler handler_;
+    ReceiveOptions options_;
+    uint64_t last_sequence_ = 0;
+    BootstrapStats stats_;
+
+public:
+    // `url` is the gateway (ws:// or http://); `history_limit` is 1-100, the
+    // gateway's fetch limit
+    SnapshotTail(const std::string& url, const std::string& subject, int history_limit = 100)
+        : subject_(subject)
+        , history_limit_(std::min(100, std::max(1, history_limit)))
+    {
+        std::string ws_url = url;
+        if (ws_url.compare(0, 4, "http") == 0) {
+            ws_url.replace(0, 4, "ws");
+        }
+        url_ = WebSocketURL::parse(ws_url);
+    }
+
+    void set_message_handler(Handler handler) {
+        handler_ = std::move(handler);
+    }
+
+    // Applies to the live phase (sampling, latest-per-subject)
+    void set_receive_options(const ReceiveOptions& options) {
+        options_ = options;
+    }
+
+    // Last sequence delivered to the handler (history or live)
+    uint64_t last_sequence() const { return last_sequence_; }
+    const BootstrapStats& stats() const { return stats_; }
+
+    // Treat everything up to `sequence` as delivered, e.g. restored from a
+    // local snapshot; resume() then streams from the sequence after it
+    void set_last_sequence(uint64_t sequence) {
+        last_sequence_ = sequence;
+    }
+
+    // Deliver the snapshot, then stream live messages until the connection
+    // closes or `max_live` (<= 0: unlimited) have been received
+    bool run(int max_live = 0) {
+        WebSocketClient client(url_.host, url_.port, "", max_live);
+
+        std::string body;
+        std::string target = "/api/proto/ProtobufMessages/" + subject_ + "?limit=" + std::to_string(history_limit_);
+        if (!client.http_get(target, &body)) {
+            return false;
+        }
+        nats::messages::FetchResponse snapshot;
+        if (!snapshot.ParseFromString(body)) {
+            std::cerr << "✗ Failed to parse fetch response" << std::endl;
+            return false;
+        }
+
+        nats::messages::StreamMessage message;
+        for (const auto& fetched : snapshot.messages()) {
+            message.set_subject(fetched.subject());
+            message.set_sequence(fetched.sequence());
+            *message.mutable_timestamp() = fetched.timestamp();
+            message.set_data(fetched.data());
+            message.set_size_bytes(fetched.size_bytes());
+            message.set_stream(fetched.stream());
+            stats_.history++;
+            last_sequence_ = std::max(last_sequence_, fetched.sequence());
+            if (handler_) handler_(message, false);
+        }
+
+        // Everything up to the snapshot point has been seen (or didn't
+        // match the subject); the stream takes over right after it
+        return stream(client, std::max(last_sequence_, snapshot.last_sequence()) + 1);
+    }
+
+    // Reconnect the live stream after the last delivered message. False
+    // without connecting when nothing has been delivered yet (call run(),
+    // or set_last_sequence() from a local snapshot).
+    bool resume(int max_live = 0) {
+        if (last_sequence_ == 0) {
+            std::cerr << "✗ Nothing to resume from on " << subject_ << "; run() first" << std::endl;
+            return false;
+        }
+        NATSGW_PROBE(reconnect, subject_.c_str(), last_sequence_ + 1, 0, 0);
+        WebSocketClient client(url_.host, url_.port, "", max_live);
+        return stream(client, last_sequence_ + 1);
+    }
+
+private:
+    bool stream(WebSocketClient& client, uint64_t start_sequence) {
+        stats_.resume_sequence = start_sequence;
+        client.set_path("/ws/websocketmessages/" + subject_ + "?startSequence=" + std::to_string(start_sequence));
+        client.set_receive_options(options_);
+        client.set_message_handler([this](const nats::messages::StreamMessage& message) {
+            if (message.sequence() != 0 && message.sequence() <= last_sequence_) {
+                stats_.overlap_dropped++;
+                return;
+            }
+            stats_.live++;
+            last_sequence_ = std::max(last_sequence_, message.sequence());
+            if (handler_) handler_(message, true);
+        });
+
+        try {
+            client.connect();
+        } catch (std::exception const&) {
+            return false;
+        }
+        client.stream_messages();
+        bool clean = client.stream_end() != StreamEnd::Error;
+        client.close();
+        return clean;
+    }
+};
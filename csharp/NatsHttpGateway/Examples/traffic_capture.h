@@ -0,0 +1,195 @@
+/*
+ * Traffic capture files
+ *
+ * A capture is a sequence of StreamMessage records (subject, stream,
+ * sequence, original timestamp, data) in the order they were received:
+ *
+ *   "NGCAP001"                      8-byte magic
+ *   u32 length, StreamMessage ...   one record per message, little-endian
+ *
+ * CaptureWriter appends records through a 1 MB buffer. CaptureReader
+ * streams them back one at a time, so captures larger than memory replay
+ * fine. There is no trailer: a capture cut short (Ctrl-C, full disk) reads
+ * up to its last complete record, and truncated() tells the two apart.
+ *
+ * Messages without a stored timestamp (core NATS) are stamped with the
+ * receive time when written, so every record carries one.
+ *
+ * The data recorded is the original payload. Messages from the gateway
+ * (and from NATS streams it fills) carry its JSON envelope with the
+ * payload base64 in "data". The writer unwraps it, because a replay
+ * through the gateway wraps the payload again. Data that is not an
+ * envelope is recorded as-is.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include "message.pb.h"
+#include "nats_json.h"
+
+class CaptureWriter {
+private:
+    static constexpr size_t kFlushBytes = 1 << 20;
+
+    std::ofstream out_;
+    std::string path_;
+    std::string buffer_;
+    std::string record_;
+    std::mutex mutex_;
+    uint64_t count_ = 0;
+    bool failed_ = false;
+
+public:
+    // Check ok() afterwards; the file is truncated if it exists
+    explicit CaptureWriter(const std::string& path) : out_(path, std::ios::binary | std::ios::trunc), path_(path) {
+        if (!out_) {
+            std::cerr << "✗ Cannot write " << path << std::endl;
+            failed_ = true;
+            return;
+        }
+        buffer_.reserve(kFlushBytes * 2);
+        buffer_.append(kCaptureMagic, sizeof(kCaptureMagic));
+    }
+
+    ~CaptureWriter() {
+        flush();
+    }
+
+    bool ok() const { return !failed_; }
+    uint64_t count() const { return count_; }
+
+    // Thread-safe; subscriber handlers may call it from their own threads
+    bool append(const nats::messages::StreamMessage& message) {
+        std::string payload;
+        if (gateway_envelope_data(message.data(), &payload)) {
+            nats::messages::StreamMessage unwrapped = message;
+            unwrapped.set_data(std::move(payload));
+            unwrapped.set_size_bytes(static_cast<int32_t>(unwrapped.data().size()));
+            return write_record(unwrapped);
+        }
+        return write_record(message);
+    }
+
+    bool append(const nats::messages::FetchedMessage& message) {
+        nats::messages::StreamMessage record;
+        record.set_subject(message.subject());
+        record.set_sequence(message.sequence());
+        *record.mutable_timestamp() = message.timestamp();
+        record.set_data(message.data());
+        record.set_size_bytes(message.size_bytes());
+        record.set_stream(message.stream());
+        return append(record);
+    }
+
+    bool flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_locked();
+        return !failed_;
+    }
+
+    static constexpr char kCaptureMagic[8] = {'N', 'G', 'C', 'A', 'P', '0', '0', '1'};
+
+private:
+    bool write_record(const nats::messages::StreamMessage& message) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failed_) return false;
+        if (message.has_timestamp()) {
+            message.SerializeToString(&record_);
+        } else {
+            nats::messages::StreamMessage stamped = message;
+            auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            stamped.mutable_timestamp()->set_seconds(now / 1000000000);
+            stamped.mutable_timestamp()->set_nanos(static_cast<int32_t>(now % 1000000000));
+            stamped.SerializeToString(&record_);
+        }
+        uint32_t size = static_cast<uint32_t>(record_.size());
+        for (int i = 0; i < 4; ++i) buffer_.push_back(static_cast<char>(size >> (8 * i)));
+        buffer_.append(record_);
+        count_++;
+        if (buffer_.size() >= kFlushBytes) {
+            write_locked();
+        }
+        return !failed_;
+    }
+
+    void write_locked() {
+        if (failed_ || buffer_.empty()) return;
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        out_.flush();
+        buffer_.clear();
+        if (!out_) {
+            std::cerr << "✗ Failed to write capture " << path_ << std::endl;
+            failed_ = true;
+        }
+    }
+};
+
+class CaptureReader {
+private:
+    std::ifstream in_;
+    std::string record_;
+    std::streamoff file_size_ = 0;
+    uint64_t count_ = 0;
+    bool ok_ = false;
+    bool truncated_ = false;
+
+public:
+    // Check ok() afterwards
+    explicit CaptureReader(const std::string& path) : in_(path, std::ios::binary) {
+        if (!in_) {
+            std::cerr << "✗ Cannot read " << path << std::endl;
+            return;
+        }
+        in_.seekg(0, std::ios::end);
+        file_size_ = in_.tellg();
+        in_.seekg(0, std::ios::beg);
+        char magic[sizeof(CaptureWriter::kCaptureMagic)] = {};
+        in_.read(magic, sizeof(magic));
+        if (!in_ || std::string(magic, sizeof(magic)) !=
+                        std::string(CaptureWriter::kCaptureMagic, sizeof(CaptureWriter::kCaptureMagic))) {
+            std::cerr << "✗ " << path << " is not a traffic capture" << std::endl;
+            return;
+        }
+        ok_ = true;
+    }
+
+    bool ok() const { return ok_; }
+    uint64_t count() const { return count_; }
+
+    // True when the file ended inside a record (the writer was cut short)
+    bool truncated() const { return truncated_; }
+
+    // Next record in capture order; false at the end of the capture
+    bool next(nats::messages::StreamMessage* message) {
+        if (!ok_) return false;
+        unsigned char header[4];
+        in_.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (in_.gcount() == 0) return false;
+        if (in_.gcount() != sizeof(header)) {
+            truncated_ = true;
+            return false;
+        }
+        uint32_t size = 0;
+        for (int i = 0; i < 4; ++i) size |= static_cast<uint32_t>(header[i]) << (8 * i);
+        // A corrupt length must not allocate more than the file can hold
+        if (size > static_cast<uint64_t>(file_size_ - in_.tellg())) {
+            truncated_ = true;
+            return false;
+        }
+        record_.resize(size);
+        in_.read(record_.data(), size);
+        if (static_cast<uint32_t>(in_.gcount()) != size || !message->ParseFromString(record_)) {
+            truncated_ = true;
+            return false;
+        }
+        count_++;
+        return true;
+    }
+};
@@ -0,0 +1,78 @@
+/*
+ * Pick the gateway or the direct NATS path per deployment
+ *
+ *   make_publisher("http://gateway:8080")   -> HttpClient (via NatsHttpGateway)
+ *   make_publisher("nats://nats:4222")      -> NatsClient (direct, connected)
+ *
+ *   make_subscriber("ws://gateway:8080", "events.>")  -> WebSocketClient
+ *   make_subscriber("nats://nats:4222", "events.>")   -> NatsClient
+ *   make_subscriber("ws://gw-a:8080,ws://gw-b:8080", "events.>")
+ *                                      -> RedundantSubscription (one leg each)
+ *
+ * Call connect() on the subscriber before stream_messages(), as with
+ * WebSocketClient. Deployments switch paths by changing the URL alone
+ * (for example NATS_GATEWAY_URL).
+ */
+
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "http_client.h"
+#include "message_transport.h"
+#include "nats_client.h"
+#include "redundant_subscriber.h"
+#include "websocket_client.h"
+
+inline bool is_nats_url(const std::string& url) {
+    return url.compare(0, 7, "nats://") == 0;
+}
+
+inline std::vector<std::string> split_urls(const std::string& urls) {
+    std::vector<std::string> result;
+    size_t start = 0;
+    while (start <= urls.size()) {
+        size_t comma = urls.find(',', start);
+        if (comma == std::string::npos) comma = urls.size();
+        if (comma > start) result.push_back(urls.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return result;
+}
+
+inline std::unique_ptr<MessagePublisher> make_publisher(const std::string& url) {
+    if (is_nats_url(url)) {
+        auto client = std::make_unique<NatsClient>(url);
+        client->connect();
+        return client;
+    }
+    return std::make_unique<HttpClient>(url);
+}
+
+// http(s):// URLs are accepted for the gateway and mapped to ws(s)://.
+// Several comma-separated gateway URLs subscribe on each of them and
+// deliver the first copy of every message (redundant_subscriber.h).
+inline std::unique_ptr<MessageSubscriber> make_subscriber(const std::string& url, const std::string& subject,
+                                                          int max_messages = 10) {
+    if (url.find(',') != std::string::npos) {
+        auto urls = split_urls(url);
+        for (const auto& u : urls) {
+            if (is_nats_url(u)) {
+                throw std::runtime_error("redundant subscriptions need gateway URLs, not " + u);
+            }
+        }
+        return std::make_unique<RedundantSubscription>(urls, subject, max_messages);
+    }
+    if (is_nats_url(url)) {
+        auto client = std::make_unique<NatsClient>(url, max_messages);
+        if (client->subscribe(subject) == 0) {
+            throw std::runtime_error("invalid subject " + subject);
+        }
+        return client;
+    }
+
+    auto parsed = gateway_stream_url(url, subject);
+    return std::make_unique<WebSocketClient>(parsed.host, parsed.port, parsed.path, max_messages);
+}
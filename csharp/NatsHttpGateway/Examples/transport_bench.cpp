@@ -0,0 +1,163 @@
+/*
+ * Publish throughput through the gateway vs directly to NATS
+ *
+ * The transport is chosen by URL (see transport.h), so the same binary
+ * measures both paths:
+ *
+ *   ./transport_bench http://localhost:8080     # HttpClient -> gateway
+ *   ./transport_bench nats://localhost:4222     # NatsClient -> NATS
+ *
+ * With --ack every publish waits for its PubAck (the gateway always does);
+ * without it the direct path publishes fire-and-forget with coalesced
+ * writes and confirms delivery with one PING/PONG round trip at the end.
+ * --subscribe (direct path only) also counts the messages a second
+ * connection receives. --json writes the results for bench_compare
+ * (bench_report.h), including each publish call's latency.
+ *
+ * Works against a real nats-server with a stream on the subject
+ * (`nats stream add BENCH --subjects 'bench.>'`), or mock_nats_server.cpp
+ * / mock_gateway.cpp.
+ *
+ * Requirements:
+ *   - libcurl, Boost.Beast/Asio, Protobuf, pthread
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 transport_bench.cpp message.pb.cc \
+ *       -lprotobuf -lcurl -lboost_system -pthread -o transport_bench
+ *
+ * Usage:
+ *   ./transport_bench <url> [--messages 100000] [--payload 256] [--subject bench.test]
+ *                           [--ack] [--subscribe] [--json FILE]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench_report.h"
+#include "message.pb.h"
+#include "transport.h"
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[]) {
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <http://gateway|nats://server> [--messages N] [--payload B]"
+                  << " [--subject S] [--ack] [--subscribe] [--json FILE]" << std::endl;
+        return 1;
+    }
+
+    std::string url = argv[1];
+    int messages = 100000;
+    size_t payload = 256;
+    std::string subject = "bench.test";
+    bool with_ack = false;
+    bool subscribe = false;
+    std::string json_path;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--messages" && i + 1 < argc) {
+            messages = std::stoi(argv[++i]);
+        } else if (arg == "--payload" && i + 1 < argc) {
+            payload = std::stoul(argv[++i]);
+        } else if (arg == "--subject" && i + 1 < argc) {
+            subject = argv[++i];
+        } else if (arg == "--ack") {
+            with_ack = true;
+        } else if (arg == "--subscribe") {
+            subscribe = true;
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        }
+    }
+
+    try {
+        std::unique_ptr<NatsClient> subscriber;
+        std::atomic<int> received{0};
+        if (subscribe && is_nats_url(url)) {
+            subscriber = std::make_unique<NatsClient>(url, 0, "transport-bench-sub");
+            subscriber->set_raw_handler([&received](const NatsFrame&) { received++; });
+            subscriber->subscribe(subject);
+            subscriber->connect();
+        }
+
+        auto publisher = make_publisher(url);
+
+        nats::messages::PublishMessage message;
+        message.set_source("transport-bench");
+        message.set_data(std::string(payload, 'x'));
+
+        std::cout << "Publishing " << messages << " x " << payload << " bytes to " << subject
+                  << " via " << (is_nats_url(url) ? "direct NATS" : "gateway")
+                  << (with_ack ? " (acked)" : "") << std::endl;
+
+        // Per-publish timing only when it is recorded: two clock reads are
+        // a noticeable share of a fire-and-forget direct publish
+        nats::messages::PublishAck ack;
+        int failed = 0;
+        bool timed = !json_path.empty();
+        std::vector<double> latencies_us;
+        latencies_us.reserve(timed ? messages : 0);
+        auto start = Clock::now();
+        for (int i = 0; i < messages; ++i) {
+            auto begin = timed ? Clock::now() : Clock::time_point();
+            if (!publisher->publish(subject, message, with_ack ? &ack : nullptr)) {
+                failed++;
+            }
+            if (timed) {
+                latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+            }
+        }
+
+        auto* direct = dynamic_cast<NatsClient*>(publisher.get());
+        if (direct && !direct->flush(std::chrono::seconds(30))) {
+            std::cerr << "✗ Flush failed" << std::endl;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cout << std::fixed << std::setprecision(0);
+        std::cout << "✓ " << (messages - failed) << " published, " << failed << " failed in "
+                  << std::setprecision(3) << seconds << " s" << std::endl;
+        std::cout << std::setprecision(0)
+                  << "  Throughput: " << messages / seconds << " msg/s, "
+                  << std::setprecision(1) << messages * static_cast<double>(payload) / seconds / 1e6
+                  << " MB/s payload" << std::endl;
+        std::cout << std::setprecision(2)
+                  << "  Mean:       " << seconds * 1e6 / messages << " µs/msg" << std::endl;
+
+        if (direct) {
+            NatsWriteStats stats = direct->write_stats();
+            std::cout << "  Writes:     " << stats.writes << " socket writes for " << stats.commands
+                      << " commands (" << std::setprecision(1)
+                      << static_cast<double>(stats.commands) / std::max<uint64_t>(stats.writes, 1)
+                      << " per write)" << std::endl;
+        }
+
+        if (subscriber) {
+            subscriber->flush();
+            std::cout << "  Received:   " << received << " on a second connection" << std::endl;
+            subscriber->close();
+        }
+
+        BenchReport report(argc, argv);
+        std::string name = std::string(is_nats_url(url) ? "direct" : "gateway") + (with_ack ? " acked" : "");
+        report.metric(name, "msgs_per_s", messages / seconds, Better::Higher);
+        report.metric(name, "failed", failed, Better::Lower);
+        report.samples(name, "publish_us", std::move(latencies_us), Better::Lower);
+        if (!report.write(json_path)) {
+            return 1;
+        }
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+    return 0;
+}
@@ -0,0 +1,395 @@
+/*
+ * WebSocketClient for NatsHttpGateway (protobuf WebSocket endpoints)
+ *
+ * Shared by websocket_client_example.cpp and the streaming components.
+ *
+ * Requirements:
+ *   - Boost.Beast (WebSocket support)
+ *   - Boost.Asio (async I/O)
+ *   - Protobuf (message parsing)
+ *   - pthread (receive-side conflation)
+ */
+
+#pragma once
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <iostream>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <iomanip>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "message.pb.h"
+#include "message_transport.h"
+#include "natsgw_probes.h"
+#include "receive_modes.h"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = boost::asio::ip::tcp;
+
+// How the last stream_messages() call ended
+enum class StreamEnd {
+    Limit,    // max_messages received
+    Closed,   // server sent a close frame
+    Error     // connection dropped, read or handshake failure
+};
+
+class WebSocketClient : public MessageSubscriber {
+private:
+    std::string host_;
+    std::string port_;
+    std::string path_;
+    net::io_context ioc_;
+    tcp::resolver resolver_;
+    websocket::stream<tcp::socket> ws_;
+    int message_count_;
+    int max_messages_;
+    MessageHandler handler_;
+    ReceiveOptions options_;
+    ReceiveStats stats_;
+    bool quiet_ = false;
+    StreamEnd end_ = StreamEnd::Error;
+
+public:
+    // max_messages <= 0 streams until the server closes the connection
+    WebSocketClient(const std::string& host, const std::string& port, const std::string& path, int max_messages = 10)
+        : host_(host)
+        , port_(port)
+        , path_(path)
+        , resolver_(ioc_)
+        , ws_(ioc_)
+        , message_count_(0)
+        , max_messages_(max_messages)
+    {
+    }
+
+    // Replace the default (printing) message handler
+    void set_message_handler(MessageHandler handler) override {
+        handler_ = std::move(handler);
+    }
+
+    void set_receive_options(const ReceiveOptions& options) override {
+        options_ = options;
+    }
+
+    const ReceiveStats& stats() const override { return stats_; }
+
+    // Tells a clean end of the stream from a dropped connection
+    StreamEnd stream_end() const { return end_; }
+
+    // Print errors only (no connect/ack/close progress lines), for clients
+    // that reconnect in a loop
+    void set_quiet(bool quiet) {
+        quiet_ = quiet;
+    }
+
+    // Path (and query) used by the upgrade in connect()
+    void set_path(const std::string& path) {
+        path_ = path;
+    }
+
+    // Plain HTTP GET on the same connection before the upgrade (the
+    // connection is kept alive), e.g. to fetch history and then stream
+    // without a second TCP connect. Opens the connection if needed.
+    bool http_get(const std::string& target, std::string* body, unsigned* status = nullptr) {
+        try {
+            open();
+            http::request<http::empty_body> req{http::verb::get, target, 11};
+            req.set(http::field::host, host_ + ":" + port_);
+            req.set(http::field::accept, "application/x-protobuf");
+            req.keep_alive(true);
+            http::write(ws_.next_layer(), req);
+
+            beast::flat_buffer buffer;
+            http::response<http::string_body> res;
+            http::read(ws_.next_layer(), buffer, res);
+            if (status) *status = res.result_int();
+            if (res.result() != http::status::ok) {
+                std::cerr << "✗ Server returned status: " << res.result_int() << std::endl;
+                return false;
+            }
+            *body = std::move(res.body());
+            return true;
+        } catch (std::exception const& e) {
+            std::cerr << "✗ HTTP request failed: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    void connect() override {
+        try {
+            if (!quiet_) std::cout << "Connecting to ws://" << host_ << ":" << port_ << path_ << std::endl;
+
+            // Reuses the connection opened by http_get(), if any
+            auto port = open();
+
+            // Update the host string for the WebSocket handshake
+            std::string host_port = host_ + ":" + std::to_string(port);
+
+            // Set WebSocket options
+            ws_.set_option(websocket::stream_base::decorator(
+                [](websocket::request_type& req) {
+                    req.set(http::field::user_agent,
+                        std::string(BOOST_BEAST_VERSION_STRING) + " websocket-client-coro");
+                }));
+
+            // Perform the WebSocket handshake
+            ws_.handshake(host_port, path_);
+
+            if (!quiet_) std::cout << "✓ WebSocket connected" << std::endl;
+
+        } catch (std::exception const& e) {
+            std::cerr << "✗ Connection error: " << e.what() << std::endl;
+            throw;
+        }
+    }
+
+    void stream_messages() override {
+        HashSampler sampler(options_.sample_every);
+        LatestPerSubject latest;
+        std::thread dispatcher;
+        uint64_t frames = 0;
+
+        if (options_.latest_per_subject) {
+            dispatcher = std::thread([this, &latest] {
+                std::vector<nats::messages::StreamMessage> batch;
+                while (latest.take(batch)) {
+                    for (const auto& message : batch) {
+                        deliver(message);
+                    }
+                }
+            });
+        }
+
+        end_ = StreamEnd::Error;
+        try {
+            while (max_messages_ <= 0 || message_count_ < max_messages_) {
+                // Read a message
+                beast::flat_buffer buffer;
+                int64_t read_start = NATSGW_PROBE_CLOCK(ws_frame);
+                ws_.read(buffer);
+                int64_t read_end = NATSGW_PROBE_ENABLED(ws_frame) || NATSGW_PROBE_ENABLED(decode_done)
+                    ? natsgw_probe_now() : 0;
+                ++frames;
+                NATSGW_PROBE(ws_frame, path_.c_str(), frames, buffer.size(),
+                             read_start != 0 ? read_end - read_start : 0);
+
+                // Convert buffer to string for protobuf parsing
+                std::string frame_data = beast::buffers_to_string(buffer.data());
+
+                // Parse the WebSocketFrame
+                nats::messages::WebSocketFrame frame;
+                if (!frame.ParseFromString(frame_data)) {
+                    std::cerr << "✗ Failed to parse WebSocketFrame" << std::endl;
+                    continue;
+                }
+
+                // Handle different frame types
+                switch (frame.type()) {
+                    case nats::messages::CONTROL:
+                        handle_control_message(frame.control());
+                        break;
+
+                    case nats::messages::MESSAGE:
+                        NATSGW_PROBE(decode_done, frame.message().subject().c_str(), frame.message().sequence(),
+                                     frame_data.size(), natsgw_probe_since(read_end));
+                        message_count_++;
+                        stats_.received++;
+                        if (!sampler.keep(frame.message())) {
+                            stats_.sampled_out++;
+                        } else if (options_.latest_per_subject) {
+                            latest.offer(std::move(*frame.mutable_message()));
+                        } else {
+                            deliver(frame.message());
+                        }
+                        break;
+
+                    default:
+                        std::cout << "• Unknown frame type: " << frame.type() << std::endl;
+                        break;
+                }
+            }
+
+            end_ = StreamEnd::Limit;
+            if (!quiet_) std::cout << "✓ Received " << message_count_ << " messages" << std::endl;
+
+        } catch (beast::system_error const& se) {
+            if (se.code() == websocket::error::closed) {
+                end_ = StreamEnd::Closed;
+            } else {
+                std::cerr << "✗ Stream error: " << se.code().message() << std::endl;
+            }
+        } catch (std::exception const& e) {
+            std::cerr << "✗ Stream error: " << e.what() << std::endl;
+        }
+
+        if (dispatcher.joinable()) {
+            latest.close();
+            dispatcher.join();
+            stats_.conflated = latest.conflated();
+        }
+    }
+
+    void close() override {
+        try {
+            ws_.close(websocket::close_code::normal);
+            if (!quiet_) std::cout << "✓ Connection closed" << std::endl;
+        } catch (std::exception const& e) {
+            std::cerr << "✗ Close error: " << e.what() << std::endl;
+        }
+    }
+
+private:
+    unsigned short open() {
+        if (!ws_.next_layer().is_open()) {
+            net::connect(ws_.next_layer(), resolver_.resolve(host_, port_));
+        }
+        return ws_.next_layer().remote_endpoint().port();
+    }
+
+    void deliver(const nats::messages::StreamMessage& message) {
+        stats_.delivered++;
+        NATSGW_PROBE(handler_start, message.subject().c_str(), message.sequence(), message.data().size(),
+                     natsgw_probe_age(message));
+        int64_t start = NATSGW_PROBE_CLOCK(handler_end);
+        if (handler_) {
+            handler_(message);
+        } else {
+            handle_stream_message(message);
+        }
+        NATSGW_PROBE(handler_end, message.subject().c_str(), message.sequence(), message.data().size(),
+                     natsgw_probe_since(start));
+    }
+
+    void handle_control_message(const nats::messages::ControlMessage& control) {
+        if (quiet_ && control.type() != nats::messages::ERROR) {
+            return;
+        }
+        std::string icon;
+        switch (control.type()) {
+            case nats::messages::ERROR:
+                icon = "✗";
+                break;
+            case nats::messages::SUBSCRIBE_ACK:
+                icon = "✓";
+                break;
+            case nats::messages::CLOSE:
+                icon = "✓";
+                break;
+            case nats::messages::KEEPALIVE:
+                icon = "♥";
+                break;
+            default:
+                icon = "•";
+                break;
+        }
+
+        std::cout << icon << " Control ["
+                  << nats::messages::ControlType_Name(control.type())
+                  << "]: " << control.message() << std::endl;
+    }
+
+    void handle_stream_message(const nats::messages::StreamMessage& message) {
+        std::cout << "  Message received:" << std::endl;
+        std::cout << "    Subject:  " << message.subject() << std::endl;
+        std::cout << "    Sequence: " << message.sequence() << std::endl;
+        std::cout << "    Size:     " << message.size_bytes() << " bytes" << std::endl;
+
+        if (message.has_timestamp()) {
+            auto seconds = message.timestamp().seconds();
+            auto nanos = message.timestamp().nanos();
+            auto time = std::chrono::system_clock::from_time_t(seconds);
+            auto time_t_val = std::chrono::system_clock::to_time_t(time);
+
+            std::cout << "    Time:     "
+                      << std::put_time(std::localtime(&time_t_val), "%Y-%m-%d %H:%M:%S")
+                      << "." << std::setfill('0') << std::setw(3) << (nanos / 1000000)
+                      << std::endl;
+        }
+
+        if (!message.consumer().empty()) {
+            std::cout << "    Consumer: " << message.consumer() << std::endl;
+        }
+
+        if (!message.data().empty()) {
+            // Try to display as UTF-8 string
+            std::string data_str = message.data();
+            if (data_str.length() > 100) {
+                data_str = data_str.substr(0, 100) + "...";
+            }
+
+            // Check if printable
+            bool printable = true;
+            for (char c : data_str) {
+                if (!isprint(static_cast<unsigned char>(c)) && !isspace(static_cast<unsigned char>(c))) {
+                    printable = false;
+                    break;
+                }
+            }
+
+            if (printable) {
+                std::cout << "    Data:     " << data_str << std::endl;
+            } else {
+                std::cout << "    Data:     [binary, " << message.data().length() << " bytes]" << std::endl;
+            }
+        }
+
+        std::cout << std::endl;
+    }
+};
+
+// Parse WebSocket URL
+struct WebSocketURL {
+    std::string host;
+    std::string port;
+    std::string path;
+
+    static WebSocketURL parse(const std::string& url) {
+        WebSocketURL result;
+
+        // Remove ws:// or wss:// prefix
+        std::string remaining = url;
+        if (remaining.substr(0, 5) == "ws://") {
+            remaining = remaining.substr(5);
+        } else if (remaining.substr(0, 6) == "wss://") {
+            remaining = remaining.substr(6);
+            // Note: For wss://, you'd need to use SSL WebSocket stream
+            std::cerr << "Warning: wss:// not supported in this example, treating as ws://" << std::endl;
+        }
+
+        // Find first slash (separates host:port from path)
+        auto slash_pos = remaining.find('/');
+        std::string host_port = remaining.substr(0, slash_pos);
+        result.path = (slash_pos != std::string::npos) ? remaining.substr(slash_pos) : "/";
+
+        // Split host and port
+        auto colon_pos = host_port.find(':');
+        if (colon_pos != std::string::npos) {
+            result.host = host_port.substr(0, colon_pos);
+            result.port = host_port.substr(colon_pos + 1);
+        } else {
+            result.host = host_port;
+            result.port = "8080"; // Default port
+        }
+
+        return result;
+    }
+};
+
+// Stream endpoint for `subject` on a gateway URL; http(s):// is mapped to ws(s)://
+inline WebSocketURL gateway_stream_url(const std::string& url, const std::string& subject) {
+    std::string ws_url = url;
+    if (ws_url.compare(0, 4, "http") == 0) {
+        ws_url.replace(0, 4, "ws");
+    }
+    return WebSocketURL::parse(ws_url + "/ws/websocketmessages/" + subject);
+}
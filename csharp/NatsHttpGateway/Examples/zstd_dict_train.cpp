@@ -0,0 +1,131 @@
+/*
+ * Train a zstd dictionary for small message payloads
+ *
+ * Samples come from captured payload files (one payload per file, as with
+ * `zstd --train`), from a capture file of length-prefixed records (uint32
+ * little-endian length followed by the payload), or from the synthetic
+ * PaymentEvent/UserEvent generator. The trained dictionary embeds its
+ * dictionary ID; ship the .zdict file with the producers and consumers and
+ * load it with ZstdDictionary::load().
+ *
+ * Requirements:
+ *   - libzstd (zstd.h, zdict.h)
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 zstd_dict_train.cpp -lzstd -o zstd_dict_train
+ *
+ * Usage:
+ *   ./zstd_dict_train [--out payloads.zdict] [--size 16384]
+ *                     [--capture records.bin] [--synthetic 20000] [sample files...]
+ */
+
+#include <zstd.h>
+#include <zdict.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "payload_samples.h"
+
+static bool read_file(const std::string& path, std::string* out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out->assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Length-prefixed capture: [uint32 LE length][payload]...
+static bool read_capture(const std::string& path, std::vector<std::string>* samples) {
+    std::string bytes;
+    if (!read_file(path, &bytes)) return false;
+
+    size_t pos = 0;
+    while (pos + 4 <= bytes.size()) {
+        uint32_t length = static_cast<uint8_t>(bytes[pos]) |
+                          static_cast<uint8_t>(bytes[pos + 1]) << 8 |
+                          static_cast<uint8_t>(bytes[pos + 2]) << 16 |
+                          static_cast<uint32_t>(static_cast<uint8_t>(bytes[pos + 3])) << 24;
+        pos += 4;
+        if (pos + length > bytes.size()) break;
+        samples->push_back(bytes.substr(pos, length));
+        pos += length;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string out_path = "payloads.zdict";
+    size_t dict_size = 16 * 1024;
+    size_t synthetic = 0;
+    std::vector<std::string> samples;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg == "--size" && i + 1 < argc) {
+            dict_size = std::stoul(argv[++i]);
+        } else if (arg == "--synthetic" && i + 1 < argc) {
+            synthetic = std::stoul(argv[++i]);
+        } else if (arg == "--capture" && i + 1 < argc) {
+            if (!read_capture(argv[++i], &samples)) {
+                std::cerr << "✗ Cannot read capture file: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: " << argv[0]
+                      << " [--out payloads.zdict] [--size 16384] [--capture records.bin]"
+                      << " [--synthetic N] [sample files...]" << std::endl;
+            return 0;
+        } else {
+            std::string sample;
+            if (!read_file(arg, &sample)) {
+                std::cerr << "✗ Cannot read sample file: " << arg << std::endl;
+                return 1;
+            }
+            samples.push_back(std::move(sample));
+        }
+    }
+
+    if (samples.empty() && synthetic == 0) {
+        synthetic = 20000;
+    }
+    for (auto& sample : sample_payloads(synthetic)) {
+        samples.push_back(std::move(sample));
+    }
+
+    // ZDICT wants all samples concatenated plus their individual sizes
+    std::string concatenated;
+    std::vector<size_t> sizes;
+    for (const auto& sample : samples) {
+        concatenated += sample;
+        sizes.push_back(sample.size());
+    }
+
+    std::cout << "Training zstd dictionary from " << samples.size() << " samples ("
+              << concatenated.size() << " bytes)" << std::endl;
+
+    std::string dictionary(dict_size, '\0');
+    size_t n = ZDICT_trainFromBuffer(&dictionary[0], dictionary.size(), concatenated.data(),
+                                     sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(n)) {
+        std::cerr << "✗ Training failed: " << ZDICT_getErrorName(n) << std::endl;
+        return 1;
+    }
+    dictionary.resize(n);
+
+    std::ofstream out(out_path, std::ios::binary);
+    out.write(dictionary.data(), static_cast<std::streamsize>(dictionary.size()));
+    if (!out) {
+        std::cerr << "✗ Cannot write " << out_path << std::endl;
+        return 1;
+    }
+
+    std::cout << "✓ Wrote " << out_path << std::endl;
+    std::cout << "  Dictionary ID: " << ZDICT_getDictID(dictionary.data(), dictionary.size()) << std::endl;
+    std::cout << "  Size:          " << dictionary.size() << " bytes" << std::endl;
+    return 0;
+}
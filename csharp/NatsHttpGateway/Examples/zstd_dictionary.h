@@ -0,0 +1,214 @@
+/*
+ * Trained zstd dictionary compression for small message payloads
+ *
+ * Generic compression does poorly on 200-500 byte payloads because every
+ * message starts with an empty window. A dictionary trained on captured
+ * payloads (see zstd_dict_train.cpp) primes that window.
+ *
+ *   ZstdDictionary          one trained dictionary, digested once into a
+ *                           CDict/DDict (immutable, shared by all threads)
+ *   ZstdDictionaryRegistry  dictionaries by ID for the receive side
+ *
+ * Compression and decompression contexts are thread_local, so the hot path
+ * never allocates and never takes a lock. compress_payload() starts every
+ * `data` field with a one-byte tag (kPayloadPlain or kPayloadZstd) so the
+ * receiver never has to guess from the bytes themselves; after the tag
+ * comes the payload or an ordinary zstd frame, whose header carries the
+ * dictionary ID, so the receiver picks the right DDict without extra
+ * metadata.
+ *
+ * The content size in a frame header comes from the sender, so decompression
+ * rejects frames that claim more than a maximum (kZstdMaxContentSize by
+ * default, ZstdDictionaryRegistry::set_max_content_size() to change it)
+ * before allocating the output.
+ *
+ * Requirements:
+ *   - libzstd (zstd.h, zdict.h)
+ */
+
+#pragma once
+
+#include <zstd.h>
+#include <zdict.h>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Per-thread contexts, created on first use and reused for every message
+inline ZSTD_CCtx* thread_cctx() {
+    thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> ctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    return ctx.get();
+}
+
+inline ZSTD_DCtx* thread_dctx() {
+    thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> ctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    return ctx.get();
+}
+
+// Largest decompressed payload accepted by default
+constexpr size_t kZstdMaxContentSize = 16 * 1024 * 1024;
+
+// The content size declared in a frame header, if known and at most `max_size`
+inline bool zstd_content_size(std::string_view frame, size_t max_size, size_t* size) {
+    unsigned long long declared = ZSTD_getFrameContentSize(frame.data(), frame.size());
+    if (declared == ZSTD_CONTENTSIZE_ERROR || declared == ZSTD_CONTENTSIZE_UNKNOWN || declared > max_size) {
+        return false;
+    }
+    *size = static_cast<size_t>(declared);
+    return true;
+}
+
+// First byte of a payload built by compress_payload(): what follows it
+constexpr unsigned char kPayloadPlain = 0x00;   // the payload as-is
+constexpr unsigned char kPayloadZstd = 0x01;    // a zstd frame
+
+class ZstdDictionary {
+private:
+    std::string bytes_;
+    uint32_t id_;
+    int level_;
+    std::unique_ptr<ZSTD_CDict, size_t (*)(ZSTD_CDict*)> cdict_;
+    std::unique_ptr<ZSTD_DDict, size_t (*)(ZSTD_DDict*)> ddict_;
+
+public:
+    ZstdDictionary(std::string bytes, int level = 3)
+        : bytes_(std::move(bytes))
+        , id_(ZDICT_getDictID(bytes_.data(), bytes_.size()))
+        , level_(level)
+        , cdict_(ZSTD_createCDict(bytes_.data(), bytes_.size(), level), ZSTD_freeCDict)
+        , ddict_(ZSTD_createDDict(bytes_.data(), bytes_.size()), ZSTD_freeDDict)
+    {
+        if (id_ == 0) {
+            throw std::runtime_error("Not a zstd dictionary (missing dictionary ID)");
+        }
+        if (!cdict_ || !ddict_) {
+            throw std::runtime_error("Failed to digest zstd dictionary");
+        }
+    }
+
+    static std::shared_ptr<ZstdDictionary> load(const std::string& path, int level = 3) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Cannot open zstd dictionary: " + path);
+        }
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return std::make_shared<ZstdDictionary>(std::move(bytes), level);
+    }
+
+    uint32_t id() const { return id_; }
+    int level() const { return level_; }
+    size_t size() const { return bytes_.size(); }
+    const std::string& bytes() const { return bytes_; }
+
+    // Compress `input` into `out` (replacing its contents)
+    bool compress(std::string_view input, std::string* out) const {
+        out->resize(ZSTD_compressBound(input.size()));
+        size_t n = ZSTD_compress_usingCDict(thread_cctx(), &(*out)[0], out->size(),
+                                            input.data(), input.size(), cdict_.get());
+        if (ZSTD_isError(n)) {
+            return false;
+        }
+        out->resize(n);
+        return true;
+    }
+
+    // Decompress a frame produced by compress() into `out`. Frames that
+    // declare more than `max_size` bytes are rejected.
+    bool decompress(std::string_view frame, std::string* out, size_t max_size = kZstdMaxContentSize) const {
+        size_t size = 0;
+        if (!zstd_content_size(frame, max_size, &size)) {
+            return false;
+        }
+        out->resize(size);
+        size_t n = ZSTD_decompress_usingDDict(thread_dctx(), &(*out)[0], out->size(),
+                                              frame.data(), frame.size(), ddict_.get());
+        if (ZSTD_isError(n)) {
+            return false;
+        }
+        out->resize(n);
+        return true;
+    }
+};
+
+class ZstdDictionaryRegistry {
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, std::shared_ptr<ZstdDictionary>> dictionaries_;
+    std::atomic<size_t> max_content_size_{kZstdMaxContentSize};
+
+public:
+    // Frames that declare a larger decompressed size fail to decode
+    void set_max_content_size(size_t bytes) { max_content_size_.store(bytes, std::memory_order_relaxed); }
+    size_t max_content_size() const { return max_content_size_.load(std::memory_order_relaxed); }
+
+    void add(std::shared_ptr<ZstdDictionary> dictionary) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dictionaries_[dictionary->id()] = std::move(dictionary);
+    }
+
+    std::shared_ptr<ZstdDictionary> find(uint32_t id) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = dictionaries_.find(id);
+        return it == dictionaries_.end() ? nullptr : it->second;
+    }
+
+    // Decode a `data` field built by compress_payload(): zstd frames are
+    // decompressed with the dictionary named in their header, plain payloads
+    // lose their tag. Fails for data without a known tag. `data` is the
+    // original payload: unwrap messages fetched through the gateway with
+    // gateway_envelope_data() first.
+    bool decode(std::string_view data, std::string* out) const {
+        if (data.empty()) {
+            return false;
+        }
+        unsigned char tag = static_cast<unsigned char>(data[0]);
+        data.remove_prefix(1);
+        if (tag == kPayloadPlain) {
+            out->assign(data.data(), data.size());
+            return true;
+        }
+        if (tag != kPayloadZstd) {
+            return false;
+        }
+
+        size_t max_size = max_content_size();
+        unsigned id = ZSTD_getDictID_fromFrame(data.data(), data.size());
+        if (id == 0) {
+            // Plain zstd without a dictionary
+            size_t size = 0;
+            if (!zstd_content_size(data, max_size, &size)) return false;
+            out->resize(size);
+            size_t n = ZSTD_decompressDCtx(thread_dctx(), &(*out)[0], out->size(), data.data(), data.size());
+            if (ZSTD_isError(n)) return false;
+            out->resize(n);
+            return true;
+        }
+
+        auto dictionary = find(id);
+        return dictionary && dictionary->decompress(data, out, max_size);
+    }
+};
+
+// Tagged payload for PublishMessage.data. Payloads below `min_size`, or that
+// do not shrink, are sent as-is behind kPayloadPlain.
+inline std::string compress_payload(const ZstdDictionary& dictionary, std::string_view payload,
+                                    size_t min_size = 64) {
+    std::string compressed;
+    if (payload.size() >= min_size && dictionary.compress(payload, &compressed) &&
+        compressed.size() < payload.size()) {
+        compressed.insert(compressed.begin(), static_cast<char>(kPayloadZstd));
+        return compressed;
+    }
+    std::string plain;
+    plain.reserve(payload.size() + 1);
+    plain.push_back(static_cast<char>(kPayloadPlain));
+    plain.append(payload.data(), payload.size());
+    return plain;
+}
@@ -0,0 +1,163 @@
+/*
+ * Benchmark: per-message zstd with a trained dictionary vs plain zstd vs none
+ *
+ * Trains a dictionary on one set of PaymentEvent/UserEvent payloads (or loads
+ * one with --dict) and compresses a disjoint test set message by message,
+ * reporting compression ratio and ns/message for compression and
+ * decompression. --json writes the results for bench_compare
+ * (bench_report.h).
+ *
+ * Requirements:
+ *   - libzstd (zstd.h, zdict.h)
+ *
+ * Build:
+ *   g++ -std=c++17 -O2 zstd_dictionary_bench.cpp -lzstd -o zstd_dictionary_bench
+ *
+ * Usage:
+ *   ./zstd_dictionary_bench [--dict payloads.zdict] [--level 3] [--messages 20000]
+ *                           [--json FILE]
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench_report.h"
+#include "payload_samples.h"
+#include "zstd_dictionary.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    double ratio = 1.0;
+    double compress_ns = 0;
+    double decompress_ns = 0;
+};
+
+template <typename Compress, typename Decompress>
+static Result measure(const std::vector<std::string>& payloads, Compress compress, Decompress decompress) {
+    Result result;
+    std::vector<std::string> frames(payloads.size());
+    size_t raw = 0;
+    size_t packed = 0;
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        compress(payloads[i], &frames[i]);
+    }
+    auto compressed = Clock::now();
+
+    std::string out;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        decompress(frames[i], &out);
+        if (out != payloads[i]) {
+            std::cerr << "✗ Round trip mismatch at message " << i << std::endl;
+            std::exit(1);
+        }
+        raw += payloads[i].size();
+        packed += frames[i].size();
+    }
+    auto decompressed = Clock::now();
+
+    result.ratio = static_cast<double>(raw) / packed;
+    result.compress_ns = std::chrono::duration<double, std::nano>(compressed - start).count() / payloads.size();
+    result.decompress_ns = std::chrono::duration<double, std::nano>(decompressed - compressed).count() / payloads.size();
+    return result;
+}
+
+static std::shared_ptr<ZstdDictionary> train(const std::vector<std::string>& samples, int level) {
+    std::string concatenated;
+    std::vector<size_t> sizes;
+    for (const auto& sample : samples) {
+        concatenated += sample;
+        sizes.push_back(sample.size());
+    }
+    std::string dictionary(16 * 1024, '\0');
+    size_t n = ZDICT_trainFromBuffer(&dictionary[0], dictionary.size(), concatenated.data(),
+                                     sizes.data(), static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(n)) {
+        throw std::runtime_error(std::string("Training failed: ") + ZDICT_getErrorName(n));
+    }
+    dictionary.resize(n);
+    return std::make_shared<ZstdDictionary>(std::move(dictionary), level);
+}
+
+int main(int argc, char* argv[]) {
+    std::string dict_path;
+    int level = 3;
+    size_t messages = 20000;
+    std::string json_path;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dict" && i + 1 < argc) {
+            dict_path = argv[++i];
+        } else if (arg == "--level" && i + 1 < argc) {
+            level = std::stoi(argv[++i]);
+        } else if (arg == "--messages" && i + 1 < argc) {
+            messages = std::stoul(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        }
+    }
+
+    try {
+        auto dictionary = dict_path.empty() ? train(sample_payloads(20000, 42), level)
+                                            : ZstdDictionary::load(dict_path, level);
+        auto payloads = sample_payloads(messages, 7);
+
+        size_t total = 0;
+        for (const auto& p : payloads) total += p.size();
+
+        std::cout << "zstd dictionary benchmark: " << payloads.size() << " messages, avg "
+                  << total / payloads.size() << " bytes, level " << level
+                  << ", dictionary " << dictionary->id() << " (" << dictionary->size() << " bytes)" << std::endl;
+        std::cout << std::string(72, '=') << std::endl;
+
+        Result none = measure(payloads,
+            [](const std::string& in, std::string* out) { out->assign(in); },
+            [](const std::string& in, std::string* out) { out->assign(in); });
+
+        Result plain = measure(payloads,
+            [level](const std::string& in, std::string* out) {
+                out->resize(ZSTD_compressBound(in.size()));
+                out->resize(ZSTD_compressCCtx(thread_cctx(), &(*out)[0], out->size(), in.data(), in.size(), level));
+            },
+            [](const std::string& in, std::string* out) {
+                out->resize(ZSTD_getFrameContentSize(in.data(), in.size()));
+                out->resize(ZSTD_decompressDCtx(thread_dctx(), &(*out)[0], out->size(), in.data(), in.size()));
+            });
+
+        Result dict = measure(payloads,
+            [&](const std::string& in, std::string* out) { dictionary->compress(in, out); },
+            [&](const std::string& in, std::string* out) { dictionary->decompress(in, out); });
+
+        std::cout << std::left << std::setw(16) << "mode"
+                  << std::right << std::setw(10) << "ratio"
+                  << std::setw(18) << "compress ns/msg"
+                  << std::setw(20) << "decompress ns/msg" << std::endl;
+        BenchReport report(argc, argv);
+        auto row = [&](const char* mode, const Result& r) {
+            report.metric(mode, "ratio", r.ratio, Better::Higher);
+            report.metric(mode, "compress_ns", r.compress_ns, Better::Lower);
+            report.metric(mode, "decompress_ns", r.decompress_ns, Better::Lower);
+            std::cout << std::left << std::setw(16) << mode
+                      << std::right << std::fixed << std::setprecision(2) << std::setw(10) << r.ratio
+                      << std::setprecision(0) << std::setw(18) << r.compress_ns
+                      << std::setw(20) << r.decompress_ns << std::endl;
+        };
+        row("none", none);
+        row("zstd", plain);
+        row("zstd+dictionary", dict);
+        if (!report.write(json_path)) {
+            return 1;
+        }
+
+    } catch (std::exception const& e) {
+        std::cerr << "✗ Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -33,6 +33,13 @@ public class FetchMessagesResponse
 
     [JsonPropertyName("stream")]
     public string? Stream { get; set; }
+
+    /// <summary>
+    /// Stream's last sequence when the fetch started. Streaming from
+    /// max(LastSequence, last fetched sequence) + 1 continues exactly where the fetch ended.
+    /// </summary>
+    [JsonPropertyName("last_sequence")]
+    public ulong LastSequence { get; set; }
 }
 
 public class HealthResponse
@@ -172,7 +172,8 @@ public class NatsService : INatsService, IDisposable
                 Subject = subjectFilter,
                 Count = messages.Count,
                 Messages = messages,
-                Stream = streamName
+                Stream = streamName,
+                LastSequence = lastSeq
             };
         }
         catch (Exception ex)
@@ -258,10 +259,12 @@ public class NatsService : INatsService, IDisposable
     }
 
     /// <summary>
-    /// Streams messages from a subject using an ephemeral consumer (for WebSocket)
+    /// Streams messages from a subject using an ephemeral consumer (for WebSocket).
+    /// Starts at startSequence when given, otherwise with new messages only.
     /// </summary>
     public async IAsyncEnumerable<MessageResponse> StreamMessagesAsync(
         string subjectFilter,
+        ulong? startSequence,
         [EnumeratorCancellation] CancellationToken cancellationToken)
     {
         INatsJSConsumer? consumer = null;
@@ -284,6 +287,14 @@ public class NatsService : INatsService, IDisposable
                 InactiveThreshold = TimeSpan.FromMinutes(5)
             };
 
+            // Resume from a known sequence (e.g. right after a fetch), so no
+            // message published in between is missed
+            if (startSequence.HasValue)
+            {
+                consumerConfig.DeliverPolicy = ConsumerConfigDeliverPolicy.ByStartSequence;
+                consumerConfig.OptStartSeq = startSequence.Value;
+            }
+
             consumer = await _js.CreateConsumerAsync(streamName, consumerConfig);
 
             _logger.LogInformation("Started streaming from {SubjectFilter} using consumer {ConsumerName}",